@@ -0,0 +1,373 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#include "server/Hello.h"
+#include "tup/Tars.h"
+#include "tup/RequestF.h"
+#include "util/tc_option.h"
+#include "util/tc_json.h"
+#include "util/tc_file.h"
+
+#include <ctime>
+#include <functional>
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+using namespace Test;
+
+/**
+ * tars-codec-bench: TarsInputStream/TarsOutputStream编解码的吞吐量(MB/s)
+ * 用例参照Google Benchmark: 每个用例自动调整迭代次数, 直到运行时间超过--min_time, 输出每次的耗时和吞吐量
+ * --out输出的json和Google Benchmark的格式一致(benchmarks数组里的name/iterations/real_time/cpu_time/bytes_per_second), 可以直接用它的compare.py对比两次结果
+ *
+ * 用法:
+ * tars-codec-bench [--filter=Decode] [--min_time=0.5] [--out=result.json]
+ * --filter: 只运行名字包含这个字符串的用例
+ * --min_time: 每个用例最少运行的时间(秒)
+ */
+
+struct CodecCase
+{
+	string 					name;
+	string 					buffer;     //编码好的数据, 按它的长度计算吞吐量
+	std::function<void()> 	run;        //执行一次编码或解码
+};
+
+struct CodecResult
+{
+	string 	name;
+	int64_t iterations;
+	double 	realNs;     //每次的耗时
+	double 	cpuNs;
+	double 	bytesPerSecond;
+};
+
+/**
+ * 防止编译器把没有使用的解码结果优化掉
+ */
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+template<typename T>
+static string encodeStruct(const T &t)
+{
+	TarsOutputStream<BufferWriterString> os;
+	t.writeTo(os);
+	return os.getByteBuffer();
+}
+
+/**
+ * 解码的用例, T是解码的类型, 可以和编码的类型不同(比如XxxView)
+ */
+template<typename T>
+static CodecCase decodeCase(const string &name, const string &buffer)
+{
+	CodecCase c;
+	c.name = "BM_Decode/" + name;
+	c.buffer = buffer;
+
+	c.run = [buffer]()
+	{
+		T v;
+		TarsInputStream<BufferReader> is;
+		is.setBuffer(buffer.c_str(), buffer.length());
+		v.readFrom(is);
+		doNotOptimize(v);
+	};
+	return c;
+}
+
+template<typename T>
+static CodecCase encodeCase(const string &name, const T &t)
+{
+	CodecCase c;
+	c.name = "BM_Encode/" + name;
+	c.buffer = encodeStruct(t);
+
+	c.run = [t]()
+	{
+		TarsOutputStream<BufferWriterVector> os;
+		t.writeTo(os);
+		doNotOptimize(os.getLength());
+	};
+	return c;
+}
+
+static RequestPacket makeRequest(size_t size)
+{
+	RequestPacket request;
+	request.iVersion = TARSVERSION;
+	request.iRequestId = 1;
+	request.iTimeout = 3000;
+	request.sServantName = "TestApp.HelloServer.HelloObj";
+	request.sFuncName = "testHello";
+	request.sBuffer.assign(size, 'a');
+	request.context["traceid"] = "0123456789abcdef";
+	request.status["dye"] = "true";
+	return request;
+}
+
+static ViewData makeItem(int i)
+{
+	ViewData item;
+	item.id = i;
+	item.name = "item-" + TC_Common::tostr(i);
+	item.payload.assign(64, 'p');
+	for (int j = 0; j < 4; j++)
+	{
+		item.attrs["attr" + TC_Common::tostr(j)] = "value" + TC_Common::tostr(j);
+	}
+	item.tags.assign(3, "tag");
+	return item;
+}
+
+static ViewPackage makePackage(int count)
+{
+	ViewPackage package;
+	for (int i = 0; i < count; i++)
+	{
+		package.items.push_back(makeItem(i));
+		package.index["key" + TC_Common::tostr(i)] = makeItem(i);
+	}
+	package.head = makeItem(0);
+	return package;
+}
+
+static JsonMap makeJsonMap(int count)
+{
+	JsonMap m;
+	for (int i = 0; i < count; i++)
+	{
+		JsonKey key;
+		key.i = i;
+
+		JsonData &data = m.json[key];
+		data.c = 1;
+		data.s = 2;
+		data.i = i;
+		data.l = (Int64)i << 32;
+		data.f = 1.5;
+		data.d = 2.5;
+		data.b = true;
+		data.k = KEY2;
+		data.ss = "json";
+		data.data[KEY1] = "key1";
+		data.v.assign(4, KEY1);
+		data.iv.assign(16, i);
+		data.dv.assign(16, 0.5);
+	}
+	return m;
+}
+
+/**
+ * 基本类型容器, 包在结构体里按tag 0编解码
+ */
+template<typename T>
+struct CodecValue : public TarsStructBase
+{
+	T value;
+
+	template<typename WriterT>
+	void writeTo(TarsOutputStream<WriterT>& _os) const
+	{
+		_os.write(value, 0);
+	}
+	template<typename ReaderT>
+	void readFrom(TarsInputStream<ReaderT>& _is)
+	{
+		_is.read(value, 0, true);
+	}
+};
+
+static vector<CodecCase> makeCases()
+{
+	vector<CodecCase> cases;
+
+	//服务端每个请求都要解码RequestPacket
+	for (size_t size : { 64, 1024, 64 * 1024 })
+	{
+		cases.push_back(decodeCase<RequestPacket>("RequestPacket/" + TC_Common::tostr(size), encodeStruct(makeRequest(size))));
+	}
+	cases.push_back(encodeCase("RequestPacket/1024", makeRequest(1024)));
+
+	//嵌套的结构体, 包括--view和--lazy生成的结构
+	for (int count : { 10, 100 })
+	{
+		ViewPackage package = makePackage(count);
+		string buffer = encodeStruct(package);
+		cases.push_back(decodeCase<ViewPackage>("ViewPackage/" + TC_Common::tostr(count), buffer));
+		cases.push_back(decodeCase<ViewPackageView>("ViewPackageView/" + TC_Common::tostr(count), buffer));
+		cases.push_back(encodeCase("ViewPackage/" + TC_Common::tostr(count), package));
+	}
+
+	{
+		CodecCase c;
+		c.name = "BM_DecodeLazy/ViewPackage/100";
+		c.buffer = encodeStruct(makePackage(100));
+		string buffer = c.buffer;
+		c.run = [buffer]()
+		{
+			//只取head.id, 其他字段不解码
+			ViewPackageLazy lazy(buffer.c_str(), buffer.length());
+			doNotOptimize(lazy.head_lazy().id());
+		};
+		cases.push_back(c);
+	}
+
+	cases.push_back(decodeCase<JsonMap>("JsonMap/100", encodeStruct(makeJsonMap(100))));
+	cases.push_back(encodeCase("JsonMap/100", makeJsonMap(100)));
+
+	//大块的基本类型数组和字符串map
+	CodecValue<vector<Int64> > int64s;
+	int64s.value.assign(64 * 1024, 0x123456789LL);
+	cases.push_back(decodeCase<CodecValue<vector<Int64> > >("VectorInt64/65536", encodeStruct(int64s)));
+	cases.push_back(encodeCase("VectorInt64/65536", int64s));
+
+	CodecValue<map<string, string> > strings;
+	for (int i = 0; i < 1000; i++)
+	{
+		strings.value["key" + TC_Common::tostr(i)] = string(32, 'v');
+	}
+	cases.push_back(decodeCase<CodecValue<map<string, string> > >("MapString/1000", encodeStruct(strings)));
+
+	return cases;
+}
+
+static double cpuNow()
+{
+	return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+/**
+ * 和Google Benchmark一样, 迭代次数从1开始增加, 直到运行时间超过minTime
+ */
+static CodecResult runCase(const CodecCase &c, double minTime)
+{
+	int64_t iterations = 1;
+
+	while (true)
+	{
+		int64_t start = TC_Common::now2us();
+		double cpuStart = cpuNow();
+
+		for (int64_t i = 0; i < iterations; i++)
+		{
+			c.run();
+		}
+
+		double real = (TC_Common::now2us() - start) / 1000000.;
+		double cpu = cpuNow() - cpuStart;
+
+		if (real >= minTime || iterations >= 1000000000)
+		{
+			CodecResult result;
+			result.name = c.name;
+			result.iterations = iterations;
+			result.realNs = real * 1e9 / iterations;
+			result.cpuNs = cpu * 1e9 / iterations;
+			result.bytesPerSecond = real > 0 ? c.buffer.length() * iterations / real : 0;
+			return result;
+		}
+
+		//按已经用的时间预估需要的次数, 多预留40%, 每次最多增加10倍
+		double multiplier = real > 0 ? minTime * 1.4 / real : 10;
+		multiplier = std::min(std::max(multiplier, 2.), 10.);
+		iterations = (int64_t)(iterations * multiplier);
+	}
+}
+
+static JsonValueObjPtr toJson(const CodecResult &result)
+{
+	JsonValueObjPtr obj = new JsonValueObj();
+	obj->value["name"]              = new JsonValueString(result.name);
+	obj->value["run_name"]          = new JsonValueString(result.name);
+	obj->value["run_type"]          = new JsonValueString("iteration");
+	obj->value["iterations"]        = new JsonValueNum(result.iterations);
+	obj->value["real_time"]         = new JsonValueNum(result.realNs);
+	obj->value["cpu_time"]          = new JsonValueNum(result.cpuNs);
+	obj->value["time_unit"]         = new JsonValueString("ns");
+	obj->value["bytes_per_second"]  = new JsonValueNum(result.bytesPerSecond);
+	return obj;
+}
+
+int main(int argc, char** argv)
+{
+	TC_Option op;
+	op.decode(argc, argv);
+
+	if (op.hasParam("help"))
+	{
+		cout << "usage: " << argv[0] << " [--filter=Decode] [--min_time=0.5] [--out=result.json]" << endl;
+		return 0;
+	}
+
+	string filter   = op.getValue("filter");
+	double minTime  = TC_Common::strto<double>(op.getValue("min_time", "0.5"));
+
+	vector<CodecCase> cases = makeCases();
+
+	JsonValueArrayPtr results = new JsonValueArray();
+
+	cerr << TC_Common::outfill("Benchmark", ' ', 36) << TC_Common::outfill("Time(ns)", ' ', 14) << TC_Common::outfill("CPU(ns)", ' ', 14)
+		<< TC_Common::outfill("Iterations", ' ', 14) << "MB/s" << endl;
+
+	for (auto &c : cases)
+	{
+		if (!filter.empty() && c.name.find(filter) == string::npos)
+		{
+			continue;
+		}
+
+		CodecResult result = runCase(c, minTime);
+
+		cerr << TC_Common::outfill(result.name, ' ', 36) << TC_Common::outfill(TC_Common::tostr((int64_t)result.realNs), ' ', 14)
+			<< TC_Common::outfill(TC_Common::tostr((int64_t)result.cpuNs), ' ', 14) << TC_Common::outfill(TC_Common::tostr(result.iterations), ' ', 14)
+			<< (int64_t)(result.bytesPerSecond / 1024 / 1024) << endl;
+
+		results->push_back(toJson(result));
+	}
+
+	JsonValueObjPtr context = new JsonValueObj();
+	context->value["date"]          = new JsonValueString(TC_Common::now2str("%Y-%m-%d %H:%M:%S"));
+	context->value["executable"]    = new JsonValueString(argv[0]);
+	context->value["version"]       = new JsonValueString(TARS_VERSION);
+
+	JsonValueObjPtr root = new JsonValueObj();
+	root->value["context"]      = context;
+	root->value["benchmarks"]   = results;
+
+	string json = TC_Json::writeValue(root, true);
+
+	if (op.hasParam("out"))
+	{
+		TC_File::save2file(op.getValue("out"), json);
+	}
+	else
+	{
+		cout << json << endl;
+	}
+
+	return 0;
+}
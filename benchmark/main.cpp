@@ -0,0 +1,443 @@
+﻿/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#include "server/HelloServer.h"
+#include "server/Hello.h"
+#include "certs.h"
+#include "util/tc_option.h"
+#include "util/tc_json.h"
+#include "util/tc_coroutine.h"
+
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+using namespace Test;
+
+/**
+ * tars-bench: 进程内启动unit-test的HelloServer, 通过回环地址压测HelloObj.testHello
+ * 服务端依次使用四种SERVER_OPEN_COROUTINE模式, 每种模式下分别测试sync/async/coro/promise调用
+ * 每个用例输出qps以及延时分布(p50/p99/p999, 单位us), 结果以json输出到标准输出(或者--out指定的文件), 过程信息输出到标准错误
+ *
+ * 用法:
+ * tars-bench [--count=100000] [--size=100] [--threads=4] [--concurrency=100] [--mode=0,1,2,3] [--call=sync,async,coro,promise] [--out=result.json]
+ * --count: 每个用例的调用次数
+ * --size: 请求字符串的大小
+ * --threads: sync调用的线程数
+ * --concurrency: async/promise调用的在途请求数, coro调用的协程数
+ */
+
+struct BenchOption
+{
+	int 	count       = 100000;
+	int 	size        = 100;
+	int 	threads     = 4;
+	int 	concurrency = 100;
+};
+
+/**
+ * 记录每次调用的延时(us), 多个线程并发写入预分配的数组
+ */
+class LatencyRecorder
+{
+public:
+	LatencyRecorder(size_t count) : _cost(count, 0)
+	{
+	}
+
+	void add(int64_t us)
+	{
+		size_t index = _index++;
+		if(index < _cost.size())
+		{
+			_cost[index] = us;
+		}
+	}
+
+	void error()
+	{
+		++_errors;
+	}
+
+	size_t size() const { return std::min(_index.load(), _cost.size()); }
+
+	int64_t errors() const { return _errors; }
+
+	vector<int64_t> &cost() { return _cost; }
+
+protected:
+	vector<int64_t> 	_cost;
+	std::atomic<size_t>	_index{0};
+	std::atomic<int64_t> _errors{0};
+};
+
+struct BenchResult
+{
+	int 	mode;
+	string 	call;
+	int64_t count;
+	int64_t errors;
+	int64_t costMs;
+	double 	qps;
+	int64_t avg;
+	int64_t p50;
+	int64_t p99;
+	int64_t p999;
+	int64_t max;
+};
+
+/**
+ * 限制在途请求数
+ */
+class InflightLimiter
+{
+public:
+	InflightLimiter(int limit) : _limit(limit)
+	{
+	}
+
+	void acquire()
+	{
+		while(_inflight >= _limit)
+		{
+			std::this_thread::yield();
+		}
+		++_inflight;
+	}
+
+	void release()
+	{
+		--_inflight;
+		++_done;
+	}
+
+	void waitDone(int count)
+	{
+		while(_done < count)
+		{
+			TC_Common::msleep(1);
+		}
+	}
+
+protected:
+	int 				_limit;
+	std::atomic<int> 	_inflight{0};
+	std::atomic<int> 	_done{0};
+};
+
+struct BenchCallback : public HelloPrxCallback
+{
+	BenchCallback(int64_t start, LatencyRecorder &recorder, InflightLimiter &limiter) : _start(start), _recorder(recorder), _limiter(limiter)
+	{
+	}
+
+	virtual void callback_testHello(tars::Int32 ret, const std::string &r)
+	{
+		_recorder.add(TC_Common::now2us() - _start);
+		_limiter.release();
+	}
+
+	virtual void callback_testHello_exception(tars::Int32 ret)
+	{
+		_recorder.error();
+		_limiter.release();
+	}
+
+	int64_t 			_start;
+	LatencyRecorder 	&_recorder;
+	InflightLimiter 	&_limiter;
+};
+
+static void onPromiseResponse(LatencyRecorder *recorder, InflightLimiter *limiter, int64_t start, const tars::Future<HelloPrxCallbackPromise::PromisetestHelloPtr> &future)
+{
+	try
+	{
+		future.get();
+		recorder->add(TC_Common::now2us() - start);
+	}
+	catch(exception &ex)
+	{
+		recorder->error();
+	}
+
+	limiter->release();
+}
+
+static void syncCall(HelloPrx prx, const string &buffer, int count, LatencyRecorder &recorder)
+{
+	string out;
+	for(int i = 0; i < count; i++)
+	{
+		int64_t start = TC_Common::now2us();
+		try
+		{
+			prx->testHello(i, buffer, out);
+			recorder.add(TC_Common::now2us() - start);
+		}
+		catch(exception &ex)
+		{
+			recorder.error();
+		}
+	}
+}
+
+static void benchSync(HelloPrx prx, const BenchOption &option, const string &buffer, LatencyRecorder &recorder)
+{
+	vector<std::thread> threads;
+	for(int i = 0; i < option.threads; i++)
+	{
+		threads.push_back(std::thread(syncCall, prx, std::cref(buffer), option.count / option.threads, std::ref(recorder)));
+	}
+
+	for(auto &t : threads)
+	{
+		t.join();
+	}
+}
+
+static void benchAsync(HelloPrx prx, const BenchOption &option, const string &buffer, LatencyRecorder &recorder)
+{
+	InflightLimiter limiter(option.concurrency);
+
+	for(int i = 0; i < option.count; i++)
+	{
+		limiter.acquire();
+
+		HelloPrxCallbackPtr cb = new BenchCallback(TC_Common::now2us(), recorder, limiter);
+		try
+		{
+			prx->async_testHello(cb, i, buffer);
+		}
+		catch(exception &ex)
+		{
+			recorder.error();
+			limiter.release();
+		}
+	}
+
+	limiter.waitDone(option.count);
+}
+
+static void benchCoro(HelloPrx prx, const BenchOption &option, const string &buffer, LatencyRecorder &recorder)
+{
+	std::thread cor_call([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+
+		//设置到协程中, 同步调用时切出协程
+		ServantProxyThreadData::getData()->_sched = scheduler;
+
+		scheduler->setNoCoroutineCallback([](TC_CoroutineScheduler *s){ s->terminate(); });
+
+		for(int i = 0; i < option.concurrency; i++)
+		{
+			scheduler->go([&]()
+			{
+				syncCall(prx, buffer, option.count / option.concurrency, recorder);
+			});
+		}
+
+		scheduler->run();
+	});
+	cor_call.join();
+}
+
+static void benchPromise(HelloPrx prx, const BenchOption &option, const string &buffer, LatencyRecorder &recorder)
+{
+	InflightLimiter limiter(option.concurrency);
+
+	for(int i = 0; i < option.count; i++)
+	{
+		limiter.acquire();
+
+		prx->promise_async_testHello(i, buffer, map<string, string>()).then(tars::Bind(&onPromiseResponse, &recorder, &limiter, TC_Common::now2us()));
+	}
+
+	limiter.waitDone(option.count);
+}
+
+static int64_t percentile(const vector<int64_t> &sorted, double p)
+{
+	if(sorted.empty())
+	{
+		return 0;
+	}
+
+	size_t index = (size_t)(p * sorted.size());
+
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static BenchResult runCase(int mode, const string &call, HelloPrx prx, const BenchOption &option, const string &buffer)
+{
+	typedef void (*bench_func)(HelloPrx, const BenchOption &, const string &, LatencyRecorder &);
+
+	map<string, bench_func> funcs = { {"sync", benchSync}, {"async", benchAsync}, {"coro", benchCoro}, {"promise", benchPromise} };
+
+	LatencyRecorder recorder(option.count);
+
+	int64_t start = TC_Common::now2ms();
+
+	funcs[call](prx, option, buffer, recorder);
+
+	int64_t cost = std::max<int64_t>(TC_Common::now2ms() - start, 1);
+
+	vector<int64_t> &sorted = recorder.cost();
+	sorted.resize(recorder.size());
+	std::sort(sorted.begin(), sorted.end());
+
+	int64_t total = 0;
+	for(auto c : sorted)
+	{
+		total += c;
+	}
+
+	BenchResult result;
+	result.mode     = mode;
+	result.call     = call;
+	result.count    = sorted.size();
+	result.errors   = recorder.errors();
+	result.costMs   = cost;
+	result.qps      = sorted.size() * 1000. / cost;
+	result.avg      = sorted.empty() ? 0 : total / (int64_t)sorted.size();
+	result.p50      = percentile(sorted, 0.5);
+	result.p99      = percentile(sorted, 0.99);
+	result.p999     = percentile(sorted, 0.999);
+	result.max      = sorted.empty() ? 0 : sorted.back();
+
+	return result;
+}
+
+static JsonValuePtr toJson(const BenchResult &result)
+{
+	static const char *modeNames[] = {"NET_THREAD_QUEUE_HANDLES_THREAD", "NET_THREAD_QUEUE_HANDLES_CO", "NET_THREAD_MERGE_HANDLES_THREAD", "NET_THREAD_MERGE_HANDLES_CO"};
+
+	JsonValueObjPtr obj = new JsonValueObj();
+	obj->value["mode"]      = new JsonValueNum((int64_t)result.mode);
+	obj->value["mode_name"] = new JsonValueString(modeNames[result.mode]);
+	obj->value["call"]      = new JsonValueString(result.call);
+	obj->value["count"]     = new JsonValueNum(result.count);
+	obj->value["errors"]    = new JsonValueNum(result.errors);
+	obj->value["cost_ms"]   = new JsonValueNum(result.costMs);
+	obj->value["qps"]       = new JsonValueNum(result.qps);
+	obj->value["avg_us"]    = new JsonValueNum(result.avg);
+	obj->value["p50_us"]    = new JsonValueNum(result.p50);
+	obj->value["p99_us"]    = new JsonValueNum(result.p99);
+	obj->value["p999_us"]   = new JsonValueNum(result.p999);
+	obj->value["max_us"]    = new JsonValueNum(result.max);
+
+	return obj;
+}
+
+int main(int argc, char** argv)
+{
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+	tars::TC_Common::ignorePipe();
+#endif
+
+	TC_Option op;
+	op.decode(argc, argv);
+
+	if(op.hasParam("help"))
+	{
+		cout << "usage: " << argv[0] << " [--count=100000] [--size=100] [--threads=4] [--concurrency=100] [--mode=0,1,2,3] [--call=sync,async,coro,promise] [--out=result.json]" << endl;
+		return 0;
+	}
+
+	BenchOption option;
+	option.count        = TC_Common::strto<int>(op.getValue("count", "100000"));
+	option.size         = TC_Common::strto<int>(op.getValue("size", "100"));
+	option.threads      = std::max(TC_Common::strto<int>(op.getValue("threads", "4")), 1);
+	option.concurrency  = std::max(TC_Common::strto<int>(op.getValue("concurrency", "100")), 1);
+
+	vector<int> modes   = TC_Common::sepstr<int>(op.getValue("mode", "0,1,2,3"), ",");
+	vector<string> calls = TC_Common::sepstr<string>(op.getValue("call", "sync,async,coro,promise"), ",");
+
+	string buffer(option.size, 'a');
+
+	JsonValueArrayPtr results = new JsonValueArray();
+
+	for(auto mode : modes)
+	{
+		if(mode < TC_EpollServer::NET_THREAD_QUEUE_HANDLES_THREAD || mode > TC_EpollServer::NET_THREAD_MERGE_HANDLES_CO)
+		{
+			cerr << "invalid mode:" << mode << endl;
+			return -1;
+		}
+
+		TC_Config conf = CONFIG();
+		conf.set("/tars/application/server<opencoroutine>", TC_Common::tostr(mode));
+
+		HelloServer server;
+		server.main(conf.tostr());
+		server.start();
+		server.waitForReady();
+
+		string obj = conf.get("/tars/application/server/HelloAdapter<servant>") + "@" + conf.get("/tars/application/server/HelloAdapter<endpoint>");
+
+		HelloPrx prx = server.getCommunicator()->stringToProxy<HelloPrx>(obj);
+		prx->tars_timeout(60000);
+		prx->tars_async_timeout(60000);
+
+		//预热, 建立连接
+		string out;
+		prx->testHello(0, buffer, out);
+
+		for(auto &call : calls)
+		{
+			if(call != "sync" && call != "async" && call != "coro" && call != "promise")
+			{
+				cerr << "invalid call:" << call << endl;
+				continue;
+			}
+
+			BenchResult result = runCase(mode, call, prx, option, buffer);
+
+			cerr << "mode:" << mode << ", call:" << TC_Common::outfill(call, ' ', 8) << "qps:" << (int64_t)result.qps
+				<< ", avg:" << result.avg << "us, p50:" << result.p50 << "us, p99:" << result.p99 << "us, p999:" << result.p999
+				<< "us, errors:" << result.errors << endl;
+
+			results->push_back(toJson(result));
+		}
+
+		server.terminate();
+		server.getThreadControl().join();
+	}
+
+	JsonValueObjPtr root = new JsonValueObj();
+	root->value["version"]      = new JsonValueString(TARS_VERSION);
+	root->value["count"]        = new JsonValueNum((int64_t)option.count);
+	root->value["size"]         = new JsonValueNum((int64_t)option.size);
+	root->value["threads"]      = new JsonValueNum((int64_t)option.threads);
+	root->value["concurrency"]  = new JsonValueNum((int64_t)option.concurrency);
+	root->value["results"]      = results;
+
+	string json = TC_Json::writeValue(root, true);
+
+	if(op.hasParam("out"))
+	{
+		TC_File::save2file(op.getValue("out"), json);
+	}
+	else
+	{
+		cout << json << endl;
+	}
+
+	return 0;
+}
@@ -23,12 +23,18 @@ macro(build_tars_server MODULE DEPS)
 
             set(CUR_TARS_GEN ${PATH}/${TARS_H})
             LIST(APPEND TARS_LIST_DEPENDS ${CUR_TARS_GEN})
+
+            #单个文件额外的参数, 例如: set_source_files_properties(Xxx.tars PROPERTIES TARS_TOOL_FLAG --arena)
+            get_source_file_property(CUR_TARS_FLAG ${TARS_SRC} TARS_TOOL_FLAG)
+            if (NOT CUR_TARS_FLAG)
+                set(CUR_TARS_FLAG)
+            endif ()
             
             add_custom_command(OUTPUT ${CUR_TARS_GEN}
                     WORKING_DIRECTORY ${PATH}
                     DEPENDS ${TARS2CPP} ${TARS_SRC}
-                    COMMAND ${TARS2CPP} ${TARS_SRC}
-                    COMMENT "${TARS2CPP} ${TARS_SRC}")
+                    COMMAND ${TARS2CPP} ${TARS_TOOL_FLAG} ${CUR_TARS_FLAG} ${TARS_SRC}
+                    COMMENT "${TARS2CPP} ${TARS_TOOL_FLAG} ${CUR_TARS_FLAG} ${TARS_SRC}")
 
             list(APPEND CLEAN_LIST ${PATH}/${TARS_H})
 
@@ -23,6 +23,7 @@ foreach(OUTPUTCONFIG ${CMAKE_CONFIGURATION_TYPES})
 endforeach()   
 
 option(ONLY_LIB "option for only lib" ON)
+option(TARS_FUZZ "option for decode fuzzer, need TESTS and clang for libFuzzer" OFF)
 
 # option(TARS_OPENTRACKING "option for open tracking" OFF)
 
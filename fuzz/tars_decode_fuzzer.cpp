@@ -0,0 +1,343 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#include "tup/Tars.h"
+#include "tup/RequestF.h"
+#include "tup/tup.h"
+#include "server/Hello.h"
+#include "util/tc_file.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+using namespace Test;
+
+/**
+ * tars-decode-fuzzer: TarsInputStream解码的fuzz入口
+ * 输入的第一个字节选择解码目标, 剩下的字节作为待解码的数据:
+ * 0: 服务端收到的请求包, 和Current::initialize一致, TUP请求再按UniAttribute解码参数
+ * 1~3: RequestPacket/ResponsePacket/UniPacket
+ * 4~7: unit-test/server/Hello.tars里的结构体, 包括--view生成的XxxView和--lazy生成的XxxLazy
+ * 8: 不认识的数据, 按字段逐个跳过
+ *
+ * 解码只允许抛std::runtime_error(TarsProtoException或者tup的异常), 其他情况(崩溃, 越界, 栈溢出, 内存耗尽)都是问题
+ * 能解码的结构体, 编码后再解码再编码, 两次编码结果必须一致, 否则abort
+ *
+ * 使用clang编译(cmake -DTARS_FUZZ=ON)时链接libFuzzer, 例如:
+ * tars-decode-fuzzer -max_len=65536 -rss_limit_mb=1024 corpus/
+ * 其他编译器编译出来的是回放程序, 依次解码参数里的文件(或者目录下所有文件), 用来回归corpus和crash:
+ * tars-decode-fuzzer corpus/ crash-xxx
+ * tars-decode-fuzzer --seed=corpus/    生成各个解码目标的合法数据包作为初始corpus
+ */
+
+#define FUZZ_TARGET_NUM 9
+
+template<typename T>
+static string encodeStruct(const T &t)
+{
+	TarsOutputStream<BufferWriterString> os;
+	t.writeTo(os);
+	return os.getByteBuffer();
+}
+
+template<typename T>
+static void decodeStruct(const char *buff, size_t len, T &t)
+{
+	TarsInputStream<BufferReader> is;
+	is.setBuffer(buff, len);
+	t.readFrom(is);
+}
+
+template<typename T>
+static void checkStruct(const char *buff, size_t len)
+{
+	T t;
+	decodeStruct(buff, len, t);
+
+	//编码的结果一定可以解码, 而且再编码不变
+	string first = encodeStruct(t);
+
+	T t1;
+	decodeStruct(first.c_str(), first.length(), t1);
+
+	if (encodeStruct(t1) != first)
+	{
+		cerr << "re-encode mismatch, size:" << len << endl;
+		abort();
+	}
+}
+
+static void checkLazy(const char *buff, size_t len)
+{
+	ViewPackageLazy lazy(buff, len);
+
+	//每个访问函数单独解码, 一个字段解码失败不影响其他字段
+	try { lazy.items(); } catch (TarsDecodeException &ex) {}
+	try { lazy.index(); } catch (TarsDecodeException &ex) {}
+	try { lazy.head(); } catch (TarsDecodeException &ex) {}
+
+	ViewDataLazy head = lazy.head_lazy();
+	head.id();
+	head.name();
+	head.payload();
+	head.attrs();
+	head.tags();
+	head.desc();
+}
+
+static void checkRequest(const char *buff, size_t len)
+{
+	//与Current::initialize一致, sBuffer不copy
+	RequestPacket request;
+	const char *data = NULL;
+	size_t length = 0;
+
+	TarsInputStream<BufferReader> is;
+	is.setBuffer(buff, len);
+	is.read(request.iVersion, 1, true);
+	is.read(request.cPacketType, 2, true);
+	is.read(request.iMessageType, 3, true);
+	is.read(request.iRequestId, 4, true);
+	is.read(request.sServantName, 5, true);
+	is.read(request.sFuncName, 6, true);
+	is.readView(data, length, request.sBuffer, 7, true);
+	is.read(request.iTimeout, 8, true);
+	is.read(request.context, 9, true);
+	is.read(request.status, 10, true);
+
+	if (request.iVersion == TUPVERSION)
+	{
+		//与生成的onDispatch一致
+		UniAttribute<BufferWriterVector, BufferReader> tarsAttr;
+		tarsAttr.setVersion(request.iVersion);
+		tarsAttr.decode(data, length);
+
+		Int32 index = 0;
+		string s;
+		string r;
+		tarsAttr.get("index", index);
+		tarsAttr.get("s", s);
+		tarsAttr.getByDefault("r", r, r);
+	}
+	else
+	{
+		Int32 index = 0;
+		string s;
+		is.setBuffer(data, length);
+		is.read(index, 1, true);
+		is.read(s, 2, true);
+	}
+}
+
+static void checkUniPacket(const char *buff, size_t len)
+{
+	UniPacket<> packet;
+	packet.decode(buff, len);
+
+	string s;
+	packet.getByDefault("s", s, s);
+
+	vector<char> out;
+	packet.encode(out);
+}
+
+static void checkSkip(const char *buff, size_t len)
+{
+	TarsInputStream<BufferReader> is;
+	is.setBuffer(buff, len);
+	while (!is.hasEnd())
+	{
+		is.skipField();
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (size < 1)
+	{
+		return 0;
+	}
+
+	const char *buff = (const char*)data + 1;
+	size_t len = size - 1;
+
+	try
+	{
+		switch (data[0] % FUZZ_TARGET_NUM)
+		{
+			case 0:
+				checkRequest(buff, len);
+				break;
+			case 1:
+				checkStruct<RequestPacket>(buff, len);
+				break;
+			case 2:
+				checkStruct<ResponsePacket>(buff, len);
+				break;
+			case 3:
+				checkUniPacket(buff, len);
+				break;
+			case 4:
+				checkStruct<ViewPackage>(buff, len);
+				break;
+			case 5:
+				checkStruct<ViewPackageView>(buff, len);
+				break;
+			case 6:
+				checkStruct<JsonMap>(buff, len);
+				break;
+			case 7:
+				checkLazy(buff, len);
+				break;
+			case 8:
+				checkSkip(buff, len);
+				break;
+		}
+	}
+	catch (std::runtime_error &ex)
+	{
+	}
+
+	return 0;
+}
+
+#if !TARS_LIBFUZZER
+
+static void saveSeed(const string &dir, int target, const string &name, const string &buff)
+{
+	string file = dir + FILE_SEP + TC_Common::tostr(target) + "-" + name;
+	TC_File::save2file(file, string(1, (char)target) + buff);
+}
+
+static void makeSeeds(const string &dir)
+{
+	TC_File::makeDirRecursive(dir);
+
+	ViewData item;
+	item.id = 1;
+	item.name = "item";
+	item.payload.assign(100, 'p');
+	item.attrs["key"] = "value";
+	item.tags.push_back("tag");
+
+	ViewPackage package;
+	package.items.assign(3, item);
+	package.index["item"] = item;
+	package.head = item;
+
+	JsonMap jsonMap;
+	JsonKey key;
+	key.i = 1;
+	jsonMap.json[key].ss = "json";
+	jsonMap.json[key].iv.assign(10, 1);
+
+	string body = encodeStruct(package);
+
+	RequestPacket request;
+	request.iVersion = TARSVERSION;
+	request.iRequestId = 1;
+	request.sServantName = "TestApp.HelloServer.HelloObj";
+	request.sFuncName = "testHello";
+	request.context["key"] = "value";
+	{
+		TarsOutputStream<BufferWriterVector> os;
+		os.write(1, 1);
+		os.write(string("hello"), 2);
+		os.swap(request.sBuffer);
+	}
+
+	UniPacket<> packet;
+	packet.setRequestId(1);
+	packet.setServantName(request.sServantName);
+	packet.setFuncName(request.sFuncName);
+	packet.put<Int32>("index", 1);
+	packet.put<string>("s", "hello");
+
+	string tup;
+	packet.encode(tup);
+
+	RequestPacket tupRequest = request;
+	tupRequest.iVersion = TUPVERSION;
+	packet.UniAttribute<>::encode(tupRequest.sBuffer);
+
+	ResponsePacket response;
+	response.iRequestId = 1;
+	response.sBuffer.assign(body.begin(), body.end());
+
+	saveSeed(dir, 0, "tars", encodeStruct(request));
+	saveSeed(dir, 0, "tup", encodeStruct(tupRequest));
+	saveSeed(dir, 1, "request", encodeStruct(request));
+	saveSeed(dir, 2, "response", encodeStruct(response));
+	saveSeed(dir, 3, "unipacket", tup);
+	saveSeed(dir, 4, "package", body);
+	saveSeed(dir, 5, "package", body);
+	saveSeed(dir, 6, "json", encodeStruct(jsonMap));
+	saveSeed(dir, 7, "package", body);
+	saveSeed(dir, 8, "package", body);
+}
+
+static void replay(const string &file)
+{
+	string buff = TC_File::load2str(file);
+
+	LLVMFuzzerTestOneInput((const uint8_t*)buff.c_str(), buff.length());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		cout << "usage: " << argv[0] << " [--seed=dir] file|dir ..." << endl;
+		return 0;
+	}
+
+	size_t count = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (TC_Port::strncasecmp(arg.c_str(), "--seed=", 7) == 0)
+		{
+			makeSeeds(arg.substr(7));
+			continue;
+		}
+
+		if (TC_File::isFileExist(arg, S_IFDIR))
+		{
+			vector<string> files;
+			TC_File::listDirectory(arg, files, true);
+			for (auto &file : files)
+			{
+				if (!TC_File::isFileExist(file, S_IFDIR))
+				{
+					replay(file);
+					++count;
+				}
+			}
+		}
+		else
+		{
+			replay(arg);
+			++count;
+		}
+	}
+
+	cout << "replay " << count << " inputs ok" << endl;
+
+	return 0;
+}
+
+#endif
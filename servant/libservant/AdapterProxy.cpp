@@ -21,6 +21,7 @@
 #include "servant/RemoteLogger.h"
 #include "tup/tup.h"
 #include "servant/StatF.h"
+#include <cmath>
 
 // #ifdef TARS_OPENTRACKING
 // #include "servant/text_map_carrier.h"
@@ -52,7 +53,7 @@ AdapterProxy::AdapterProxy(ObjectProxy * pObjectProxy, const EndpointInfo &ep, C
 , _noSendQueueLimit(100000)
 , _id((++_idGen))
 {
-    _timeoutQueue.reset(new TC_TimeoutQueueNew<ReqMessage*>());
+    _timeoutQueue.reset(new TC_TimeoutQueueSlab<ReqMessage*>());
 
     if(pObjectProxy->getCommunicatorEpoll())
     {
@@ -64,31 +65,52 @@ AdapterProxy::AdapterProxy(ObjectProxy * pObjectProxy, const EndpointInfo &ep, C
         _timeoutLogFlag = _communicator->getTimeoutLogFlag();
     }
 
+    //主连接, 其他连接在发起连接时按配置补齐
+    _trans = createTransceiver();
+
+
+//    if (!_endpoint.isTcp())
+//    {
+//        _checkTransInterval = 10;    //udp端口10秒检查一次, 避免影响用户请求
+//    }
+
+    //初始化stat的head信息
+    initStatHead();
+}
+
+AdapterProxy::~AdapterProxy()
+{
+}
+
+TC_Transceiver *AdapterProxy::createTransceiver()
+{
+    TC_Transceiver *trans;
+
 #if TARS_SSL
-    if (ep.isSsl())
+    if (_ep.isSsl())
     {
-        _trans.reset(new TC_SSLTransceiver(pObjectProxy->getCommunicatorEpoll()->getEpoller(), ep.getEndpoint()));
+        trans = new TC_SSLTransceiver(_objectProxy->getCommunicatorEpoll()->getEpoller(), _ep.getEndpoint());
     } 
-    else if (ep.isTcp())
+    else if (_ep.isTcp())
     {
-        _trans.reset(new TC_TCPTransceiver(pObjectProxy->getCommunicatorEpoll()->getEpoller(), ep.getEndpoint()));
+        trans = new TC_TCPTransceiver(_objectProxy->getCommunicatorEpoll()->getEpoller(), _ep.getEndpoint());
     }
     else
     {
-        _trans.reset(new TC_UDPTransceiver(pObjectProxy->getCommunicatorEpoll()->getEpoller(), ep.getEndpoint()));
+        trans = new TC_UDPTransceiver(_objectProxy->getCommunicatorEpoll()->getEpoller(), _ep.getEndpoint());
     }
 #else
-    if (ep.isUdp())
+    if (_ep.isUdp())
     {
-        _trans.reset(new TC_UDPTransceiver(pObjectProxy->getCommunicatorEpoll()->getEpoller(), ep.getEndpoint()));
+        trans = new TC_UDPTransceiver(_objectProxy->getCommunicatorEpoll()->getEpoller(), _ep.getEndpoint());
     } 
     else
     {
-        _trans.reset(new TC_TCPTransceiver(pObjectProxy->getCommunicatorEpoll()->getEpoller(), ep.getEndpoint()));
+        trans = new TC_TCPTransceiver(_objectProxy->getCommunicatorEpoll()->getEpoller(), _ep.getEndpoint());
     }
 #endif
 
-    _trans->initializeClient(std::bind(&AdapterProxy::onCreateCallback, this, std::placeholders::_1), 
+    trans->initializeClient(std::bind(&AdapterProxy::onCreateCallback, this, std::placeholders::_1), 
         std::bind(&AdapterProxy::onCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
         std::bind(&AdapterProxy::onConnectCallback, this, std::placeholders::_1),
         std::bind(&AdapterProxy::onRequestCallback, this, std::placeholders::_1),
@@ -96,28 +118,126 @@ AdapterProxy::AdapterProxy(ObjectProxy * pObjectProxy, const EndpointInfo &ep, C
         std::bind(&AdapterProxy::onOpensslCallback, this, std::placeholders::_1),
 	    std::bind(&AdapterProxy::onCompletePackage, this, std::placeholders::_1));
 
-    _trans->setClientAuthCallback(std::bind(&AdapterProxy::onSendAuthCallback, this, std::placeholders::_1), 
+    trans->setClientAuthCallback(std::bind(&AdapterProxy::onSendAuthCallback, this, std::placeholders::_1), 
         std::bind(&AdapterProxy::onVerifyAuthCallback, this, std::placeholders::_1, std::placeholders::_2));
 
+    if(_objectProxy->getCommunicatorEpoll())
+    {
+        trans->setGatherWrite(_objectProxy->getCommunicatorEpoll()->isGatherWrite());
+    }
 
-//    if (!_endpoint.isTcp())
-//    {
-//        _checkTransInterval = 10;    //udp端口10秒检查一次, 避免影响用户请求
-//    }
+    _transPool.push_back(std::unique_ptr<TC_Transceiver>(trans));
+    _transPending.push_back(0);
+    _transTimeout.push_back(0);
 
-    //初始化stat的head信息
-    initStatHead();
+    return trans;
 }
 
-AdapterProxy::~AdapterProxy()
+void AdapterProxy::prepareTransPool()
 {
+    //udp, 连接串行模式, 以及请求编码依赖连接状态的协议(http2/grpc)只用一个连接
+    if(!_ep.isTcp() || _objectProxy->getRootServantProxy()->tars_connection_serial() > 0 || !_objectProxy->getRootServantProxy()->tars_get_protocol().connectionPool)
+    {
+        return;
+    }
+
+    int num = _objectProxy->getRootServantProxy()->tars_connection_num();
+
+    while((int)_transPool.size() < num)
+    {
+        createTransceiver();
+    }
+}
+
+size_t AdapterProxy::selectTrans()
+{
+    size_t num = _transPool.size();
+    if(num == 1)
+    {
+        return 0;
+    }
+
+    size_t start = _transCursor++;
+
+    if(_objectProxy->getRootServantProxy()->tars_connection_select() == ServantProxy::CONNECTION_LEAST_PENDING)
+    {
+        //在途请求最少的连接, 相同时从游标开始选, 避免总是落在前面的连接上
+        size_t index = num;
+        for(size_t i = 0; i < num; i++)
+        {
+            size_t k = (start + i) % num;
+            if(_transPool[k]->hasConnected() && (index == num || _transPending[k] < _transPending[index]))
+            {
+                index = k;
+            }
+        }
+        return index == num ? 0 : index;
+    }
+
+    for(size_t i = 0; i < num; i++)
+    {
+        size_t k = (start + i) % num;
+        if(_transPool[k]->hasConnected())
+        {
+            return k;
+        }
+    }
+
+    return 0;
+}
+
+size_t AdapterProxy::transIndex(TC_Transceiver *trans)
+{
+    for(size_t i = 0; i < _transPool.size(); i++)
+    {
+        if(_transPool[i].get() == trans)
+        {
+            return i;
+        }
+    }
+
+    assert(false);
+    return 0;
+}
+
+void AdapterProxy::onTransSend(ReqMessage *msg, size_t index)
+{
+    msg->iConnIndex = (int)index;
+    ++_transPending[index];
+}
+
+int AdapterProxy::onTransFinish(ReqMessage *msg, bool bTimeout)
+{
+    int index = msg->iConnIndex;
+
+    if(index >= 0)
+    {
+        --_transPending[index];
+        _transTimeout[index] = (bTimeout ? _transTimeout[index] + 1 : 0);
+        msg->iConnIndex = -1;
+    }
+
+    return index;
+}
+
+bool AdapterProxy::hasActiveTrans(bool connecting)
+{
+    for(auto &trans : _transPool)
+    {
+        if(trans->hasConnected() || (connecting && trans->isConnecting()))
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 shared_ptr<TC_ProxyInfo> AdapterProxy::onCreateCallback(TC_Transceiver* trans)
 {
 	// LOG_CONSOLE_DEBUG << "fd:" << trans->fd() << ", " << trans << endl;
 
-    _objectProxy->getCommunicatorEpoll()->addFd(this);
+    _objectProxy->getCommunicatorEpoll()->addFd(this, trans);
 
     trans->setConnTimeout(_objectProxy->getRootServantProxy()->tars_connect_timeout());
 
@@ -166,7 +286,7 @@ void AdapterProxy::onConnectCallback(TC_Transceiver* trans)
 void AdapterProxy::onRequestCallback(TC_Transceiver* trans)
 {
 //	LOG_CONSOLE_DEBUG  << "fd:" << trans->fd() << ", " << trans << endl;
-    doInvoke();
+    doInvoke(trans);
 }
 
 TC_NetWorkBuffer::PACKET_TYPE AdapterProxy::onParserCallback(TC_NetWorkBuffer& buff, TC_Transceiver* trans)
@@ -316,7 +436,7 @@ int AdapterProxy::invoke_connection_serial(ReqMessage * msg)
 {
 	assert(msg->eType != ReqMessage::ONE_WAY);
 
-	msg->sReqData = _objectProxy->getRootServantProxy()->tars_get_protocol().requestFunc(msg->request, _trans.get());
+	msg->sReqData = _objectProxy->getRootServantProxy()->tars_get_protocol().requestFunc(msg->request, _trans);
 
 	msg->request.iRequestId = _timeoutQueue->generateId();
 
@@ -374,17 +494,30 @@ int AdapterProxy::invoke_connection_serial(ReqMessage * msg)
 
 int AdapterProxy::invoke_connection_parallel(ReqMessage * msg)
 {
-	msg->sReqData = _objectProxy->getRootServantProxy()->tars_get_protocol().requestFunc(msg->request, _trans.get());
+	size_t index = selectTrans();
 
+	TC_Transceiver *trans = _transPool[index].get();
+
+	msg->sReqData = _objectProxy->getRootServantProxy()->tars_get_protocol().requestFunc(msg->request, trans);
+
+	//合并发送: 网络线程正在批量处理请求, 先进队列, 处理完后统一发送
+	if (trans->isGatherWrite() && _objectProxy->getCommunicatorEpoll()->isGathering())
+	{
+		if (!_gatherPending)
+		{
+			_gatherPending = true;
+			_objectProxy->getCommunicatorEpoll()->addGatherAdapter(this);
+		}
+	}
 	//当前队列是空的, 且是连接复用模式, 交给连接发送数据
 	//连接连上 buffer不为空  发送数据成功
-	if (_timeoutQueue->sendListEmpty())
+	else if (_timeoutQueue->sendListEmpty())
 	{
-		int ret = _trans->sendRequest(msg->sReqData);
+		int ret = trans->sendRequest(msg->sReqData);
 
 		if(ret == TC_Transceiver::eRetOk || ret == TC_Transceiver::eRetFull)
 		{
-			TLOGTARS("[AdapterProxy::invoke_connection_parallel push (send) obj: " << _objectProxy->name() << ", desc:" << _trans->getConnectionString() << ", id: " << msg->request.iRequestId << endl);
+			TLOGTARS("[AdapterProxy::invoke_connection_parallel push (send) obj: " << _objectProxy->name() << ", desc:" << trans->getConnectionString() << ", id: " << msg->request.iRequestId << endl);
 
             //请求发送成功了 处理采样
             //这个请求发送成功了。单向调用直接返回
@@ -402,11 +535,15 @@ int AdapterProxy::invoke_connection_parallel(ReqMessage * msg)
 			bool bFlag = _timeoutQueue->push(msg, msg->request.iRequestId, msg->request.iTimeout + msg->iBeginTime);
 			if (!bFlag)
 			{
-				TLOGERROR("[AdapterProxy::invoke_connection_parallel fail1 : insert timeout queue fail,queue size:" << _timeoutQueue->size() << ",id: " << msg->request.iRequestId << "," << _objectProxy->name() << ", " << _trans->getConnectionString() << "]" << endl);
+				TLOGERROR("[AdapterProxy::invoke_connection_parallel fail1 : insert timeout queue fail,queue size:" << _timeoutQueue->size() << ",id: " << msg->request.iRequestId << "," << _objectProxy->name() << ", " << trans->getConnectionString() << "]" << endl);
 				msg->eStatus = ReqMessage::REQ_EXC;
 
 				finishInvoke(msg);
 			}
+			else
+			{
+				onTransSend(msg, index);
+			}
 
 			return 0;
 		}
@@ -422,13 +559,13 @@ int AdapterProxy::invoke_connection_parallel(ReqMessage * msg)
 	}
 
 	//没有发送数据
-	TLOGTARS("[AdapterProxy::invoke_connection_parallel push (no send) " << _objectProxy->name() << ", " << _trans->getConnectionString() << ",id " << msg->request.iRequestId << endl);
+	TLOGTARS("[AdapterProxy::invoke_connection_parallel push (no send) " << _objectProxy->name() << ", " << trans->getConnectionString() << ",id " << msg->request.iRequestId << endl);
 
 	//之前还没有数据没发送 或者 请求发送失败了, 进队列
 	bool bFlag = _timeoutQueue->push(msg, msg->request.iRequestId, msg->request.iTimeout + msg->iBeginTime, false);
 	if (!bFlag)
 	{
-		TLOGERROR("[AdapterProxy::invoke_connection_parallel fail2 : insert timeout queue fail,queue size:" << _timeoutQueue->size() << ", id: " << msg->request.iRequestId << ", " << _objectProxy->name() << ", " << _trans->getConnectionString() << "]" << endl);
+		TLOGERROR("[AdapterProxy::invoke_connection_parallel fail2 : insert timeout queue fail,queue size:" << _timeoutQueue->size() << ", id: " << msg->request.iRequestId << ", " << _objectProxy->name() << ", " << trans->getConnectionString() << "]" << endl);
 		msg->eStatus = ReqMessage::REQ_EXC;
 
 		finishInvoke(msg);
@@ -512,26 +649,69 @@ void AdapterProxy::doInvoke_serial()
     }
 }
 
-void AdapterProxy::doInvoke_parallel()
+void AdapterProxy::doInvoke_parallel(TC_Transceiver *trans)
 {
+	size_t index = transIndex(trans);
+
+	if(trans->isGatherWrite())
+	{
+		//合并发送: 先把积压的请求全部放入发送buffer, 再统一flush
+		while(!_timeoutQueue->sendListEmpty())
+		{
+			ReqMessage * msg = NULL;
+
+			_timeoutQueue->getSend(msg);
+
+			int iRet = trans->appendRequest(msg->sReqData);
+
+			if (iRet == TC_Transceiver::eRetError || iRet == TC_Transceiver::eRetNotSend)
+			{
+				TLOGTARS("[AdapterProxy::doInvoke_parallel appendRequest not send, obj:" << _objectProxy->name() << ",desc:" << trans->getConnectionString() << ",id:" << msg->request.iRequestId << ", ret:" << iRet << endl);
+				break;
+			}
+
+			//已经进入发送buffer，要从队列里面清掉
+			_timeoutQueue->popSend(msg->eType == ReqMessage::ONE_WAY);
+			if (msg->eType == ReqMessage::ONE_WAY)
+			{
+				delete msg;
+				msg = NULL;
+			}
+			else
+			{
+				onTransSend(msg, index);
+			}
+		}
+
+		if (trans->isValid())
+		{
+			size_t saved = trans->getSendStat().saved;
+
+			trans->flushRequest();
+
+			_objectProxy->getCommunicatorEpoll()->addGatherSaved(trans->getSendStat().saved - saved);
+		}
+		return;
+	}
+
 	while(!_timeoutQueue->sendListEmpty())
 	{
 		ReqMessage * msg = NULL;
 
 		_timeoutQueue->getSend(msg);
 
-		int iRet = _trans->sendRequest(msg->sReqData);
+		int iRet = trans->sendRequest(msg->sReqData);
 
 		//发送失败 or 没有发送
 		if (iRet == TC_Transceiver::eRetError)
 		{
-			TLOGTARS("[AdapterProxy::doInvoke_parallel sendRequest failed, obj:" << _objectProxy->name() << ",desc:" << _trans->getConnectionString() << ",id:" << msg->request.iRequestId << ", ret:" << iRet << endl);
+			TLOGTARS("[AdapterProxy::doInvoke_parallel sendRequest failed, obj:" << _objectProxy->name() << ",desc:" << trans->getConnectionString() << ",id:" << msg->request.iRequestId << ", ret:" << iRet << endl);
 			return;
 		}
 
 		if (iRet == TC_Transceiver::eRetNotSend)
 		{
-			TLOGTARS("[AdapterProxy::doInvoke_parallel sendRequest not send, obj:" << _objectProxy->name() << ",desc:" << _trans->getConnectionString() << ",id:" << msg->request.iRequestId << ", ret:" << iRet << endl);
+			TLOGTARS("[AdapterProxy::doInvoke_parallel sendRequest not send, obj:" << _objectProxy->name() << ",desc:" << trans->getConnectionString() << ",id:" << msg->request.iRequestId << ", ret:" << iRet << endl);
 			return;
 		}
 
@@ -542,6 +722,10 @@ void AdapterProxy::doInvoke_parallel()
 			delete msg;
 			msg = NULL;
 		}
+		else
+		{
+			onTransSend(msg, index);
+		}
 
 		//发送buffer已经满了 要返回
 		if (iRet == TC_Transceiver::eRetFull)
@@ -551,7 +735,20 @@ void AdapterProxy::doInvoke_parallel()
 	}
 }
 
-void AdapterProxy::doInvoke()
+void AdapterProxy::doGatherInvoke()
+{
+	_gatherPending = false;
+
+	TC_Transceiver *trans = _transPool[selectTrans()].get();
+
+	//发送buffer里面还有数据, 等待连接可写时再发送
+	if(trans->getSendBuffer().empty())
+	{
+		doInvoke(trans);
+	}
+}
+
+void AdapterProxy::doInvoke(TC_Transceiver *trans)
 {
 	if(_objectProxy->getRootServantProxy()->tars_connection_serial() > 0)
 	{
@@ -559,7 +756,8 @@ void AdapterProxy::doInvoke()
 	}
 	else
 	{
-		doInvoke_parallel();
+		//积压的请求从可写的连接发出去
+		doInvoke_parallel(trans ? trans : _transPool[selectTrans()].get());
 	}
 }
 
@@ -590,7 +788,10 @@ void AdapterProxy::finishInvoke(bool bFail)
 
             _timeoutInvoke = 0;
 
-            _trans->setIsConnTimeout(false);
+            for(auto &trans : _transPool)
+            {
+                trans->setIsConnTimeout(false);
+            }
 
             _connExc              = false;
 
@@ -704,28 +905,33 @@ bool AdapterProxy::checkActive(bool connecting)
 	    resetRetryTime();
     }
 
+    prepareTransPool();
+
     //连接没有建立或者连接无效, 重新建立连接
-    if (!_trans->isValid()) 
+    for(auto &trans : _transPool)
     {
-        try
-        {
-            _trans->connect();
-        }
-        catch (exception & ex) 
+        if (!trans->isValid()) 
         {
-            _activeStatus = false;
-            _trans->close();
+            try
+            {
+                trans->connect();
+            }
+            catch (exception & ex) 
+            {
+                _activeStatus = false;
+                trans->close();
 
-            TLOGERROR("[AdapterProxy::checkActive connect obj:" << _objectProxy->name() << ",desc:" << _trans->getConnectionString() << ", ex:" << ex.what() << endl);
+                TLOGERROR("[AdapterProxy::checkActive connect obj:" << _objectProxy->name() << ",desc:" << trans->getConnectionString() << ", ex:" << ex.what() << endl);
+            }
         }
     }
 
     if(connecting && _activeStatus) {
     	//hash模式, 且是第一次连接(_activeStatus=true, 即没有失败过), 返回已经连接或者正在连接的, 这样保证第一次hash不会错且连接挂过以后, 不会马上就使用, 直到连接成功才使用!
-	    return (_trans->hasConnected() || _trans->isConnecting());
+	    return hasActiveTrans(true);
     }
     else {
-	    return _trans->hasConnected();
+	    return hasActiveTrans(false);
     }
 }
 
@@ -736,7 +942,10 @@ void AdapterProxy::onSetInactive()
 	resetRetryTime();
 
 	//需要关闭连接
-	_trans->close();
+	for(auto &trans : _transPool)
+	{
+		trans->close();
+	}
 }
 
 //屏蔽结点
@@ -831,6 +1040,8 @@ void AdapterProxy::finishInvoke_parallel(shared_ptr<ResponsePacket> & rsp)
 
 		assert(msg->eStatus == ReqMessage::REQ_REQ);
 
+		onTransFinish(msg);
+
 		msg->eStatus = ReqMessage::REQ_RSP;
 	}
 
@@ -900,7 +1111,12 @@ void AdapterProxy::finishInvoke(ReqMessage * msg)
     //异步调用
     if (msg->eType == ReqMessage::ASYNC_CALL)
     {
-        if(!msg->sched)
+        if(msg->awaiter)
+        {
+            //co_await的调用, 恢复等待的协程
+            _objectProxy->getCommunicatorEpoll()->finishAwait(msg);
+        }
+        else if(!msg->sched)
         {
             if (msg->callback->getNetThreadProcess())
             {
@@ -969,6 +1185,17 @@ void AdapterProxy::doTimeout()
 			_trans->close();
 		}
 
+		int index = onTransFinish(msg, true);
+
+		//连接池模式下, 某个连接连续超时, 认为这个连接已经不可用, 关闭它, 下次checkActive时重连
+		if(index >= 0 && _transPool.size() > 1 && _transTimeout[index] >= _objectProxy->getRootServantProxy()->tars_check_timeout_info().frequenceFailInvoke)
+		{
+			TLOGERROR("[AdapterProxy::doTimeout, " << _objectProxy->name() << ", " << _transPool[index]->getConnectionString() << ", conn index:" << index << ", continuous timeout:" << _transTimeout[index] << ", close]" << endl);
+
+			_transTimeout[index] = 0;
+			_transPool[index]->close();
+		}
+
         msg->eStatus = ReqMessage::REQ_TIME;
 
         //有可能是单向调用超时了
@@ -1054,6 +1281,20 @@ void AdapterProxy::doTimeout()
 // }
 // #endif
 
+double AdapterProxy::getLatencyCost()
+{
+    double latency = _latencyEwma;
+
+    //按10s的时间常数衰减
+    int64_t idle = TNOWMS - _latencyTime;
+    if (idle > 0)
+    {
+        latency *= exp(-(double)idle / 10000);
+    }
+
+    return (latency + 1) * (getInflight() + 1);
+}
+
 void AdapterProxy::stat(ReqMessage * msg)
 {
     if (msg->bPush)
@@ -1066,6 +1307,11 @@ void AdapterProxy::stat(ReqMessage * msg)
 
     msg->iEndTime = TNOWMS;
 
+    //超时和异常也按耗时计入, 让慢节点的代价更高
+    int64_t cost = (msg->iEndTime >= msg->iBeginTime) ? (msg->iEndTime - msg->iBeginTime) : 0;
+    _latencyEwma += (cost - _latencyEwma) / 8;
+    _latencyTime = msg->iEndTime;
+
     //包体信息.
     if(msg->eStatus == ReqMessage::REQ_RSP && TARSSERVERSUCCESS == msg->response->iRet)
     {
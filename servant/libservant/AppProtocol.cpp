@@ -46,12 +46,32 @@ shared_ptr<TC_NetWorkBuffer::Buffer> ProxyProtocol::toBuffer(TarsOutputStream<Bu
 	return buff;
 }
 
+vector<shared_ptr<TC_NetWorkBuffer::Buffer>> ProxyProtocol::toBuffers(TarsOutputStream<BufferWriterChain> &os)
+{
+	vector<pair<char*, size_t>> segments;
+	os.detach(segments);
+
+	vector<shared_ptr<TC_NetWorkBuffer::Buffer>> buffs;
+	buffs.reserve(segments.size());
+	for(size_t i = 0; i < segments.size(); i++)
+	{
+		shared_ptr<TC_NetWorkBuffer::Buffer> buff = std::make_shared<TC_NetWorkBuffer::Buffer>();
+		buff->replaceBuffer(segments[i].first, segments[i].second);
+		buffs.push_back(buff);
+	}
+
+	return buffs;
+}
+
 shared_ptr<TC_NetWorkBuffer::Buffer> ProxyProtocol::tarsRequest(RequestPacket& request, TC_Transceiver *)
 {
 	TarsOutputStream<BufferWriter> os;
 
 	int iHeaderLen = 0;
 
+	//请求体已经是编码好的vector<char>, 算大小很便宜, 按精确大小一次分配
+	os.reserveExact(sizeof(iHeaderLen) + request.tars_encoded_size());
+
 //	先预留4个字节长度
 	os.writeBuf((const char *)&iHeaderLen, sizeof(iHeaderLen));
 
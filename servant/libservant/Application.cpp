@@ -74,12 +74,17 @@ int         ServerConfig::IsCheckSet = 1;       //是否对按照set规则调用
 int        ServerConfig::OpenCoroutine = 0;    //是否启用协程处理方式
 size_t      ServerConfig::CoroutineMemSize; //协程占用内存空间的最大大小
 uint32_t    ServerConfig::CoroutineStackSize;   //每个协程的栈大小(默认128k)
+uint32_t    ServerConfig::CoroutineSharedStack; //每个线程协程共享栈的个数(默认0, 不使用共享栈)
+int64_t     ServerConfig::CoroutineStackCheck = 0; //协程栈深度检查间隔(毫秒, 默认0, 不检查)
+bool        ServerConfig::CoroutineStackAuto = false; //是否根据栈的最大深度自动调整协程栈大小
 bool        ServerConfig::ManualListen = false;     //手工启动监听端口
 //bool        ServerConfig::MergeNetImp = false;     //合并网络和处理线程
 int         ServerConfig::NetThread = 1;               //servernet thread
 bool        ServerConfig::CloseCout = true;
 int         ServerConfig::BackPacketLimit = 0;
 int         ServerConfig::BackPacketMin = 1024;
+std::string ServerConfig::QueueType = "thread";
+std::string ServerConfig::TimerType = "map";
 //int         ServerConfig::Pattern = 0;
 
 #if TARS_SSL
@@ -98,6 +103,7 @@ map<string, string> ServerConfig::Context;
 CommunicatorPtr                 Application::_communicator = NULL;
 
 PropertyReportPtr g_pReportRspQueue;
+PropertyReportPtr g_pReportCoroStack;
 
 /**上报服务端发送队列大小的间隔时间**/
 #define REPORT_SEND_QUEUE_INTERVAL 10
@@ -164,6 +170,57 @@ void reportRspQueue(TC_EpollServer *epollServer)
     }
 }
 
+/**
+ * 汇总adapter所有handle线程的协程栈统计
+ */
+static TC_CoroutineScheduler::StackStat getCoroStackStat(const TC_EpollServer::BindAdapterPtr &adapter)
+{
+	TC_CoroutineScheduler::StackStat stat;
+
+	size_t total = 0;
+	for(int i = 0; i < adapter->getHandleNum(); i++)
+	{
+		shared_ptr<TC_CoroutineScheduler> scheduler = adapter->getDataBuffer()->getScheduler(i);
+		if(scheduler)
+		{
+			TC_CoroutineScheduler::StackStat s = scheduler->getStackStat();
+			stat.stackSize = std::max(stat.stackSize, s.stackSize);
+			stat.count += s.count;
+			stat.maxUsed = std::max(stat.maxUsed, s.maxUsed);
+			total += s.avgUsed * s.count;
+		}
+	}
+
+	stat.avgUsed = stat.count > 0 ? total / stat.count : 0;
+
+	return stat;
+}
+
+void reportCoroStack(TC_EpollServer *epollServer)
+{
+	if (!g_pReportCoroStack)
+		return;
+
+	static time_t iLastCheckTime = TNOW;
+
+	time_t iNow = TNOW;
+
+	if (iNow - iLastCheckTime > REPORT_SEND_QUEUE_INTERVAL)
+	{
+		iLastCheckTime = iNow;
+
+		const vector<TC_EpollServer::BindAdapterPtr> &adapters = epollServer->getBindAdapters();
+
+		size_t n = 0;
+		for (size_t i = 0; i < adapters.size(); ++i)
+		{
+			n = std::max(n, getCoroStackStat(adapters[i]).maxUsed);
+		}
+
+		g_pReportCoroStack->report((int)n);
+	}
+}
+
 void heartBeatFunc(const string& adapterName)
 {
     TARS_KEEPALIVE(adapterName);
@@ -183,7 +240,11 @@ void Application::waitForShutdown()
 {
 	assert(_epollServer);
 
-    _epollServer->setCallbackFunctor(reportRspQueue);
+    _epollServer->setCallbackFunctor([](TC_EpollServer *epollServer)
+    {
+        reportRspQueue(epollServer);
+        reportCoroStack(epollServer);
+    });
 
     _epollServer->setHeartBeatFunctor(heartBeatFunc);
 
@@ -636,6 +697,33 @@ bool Application::cmdViewResource(const string& command, const string& params, s
 		outAdapter(os, _servantHelper->getAdapterServant(adapter->getName()), adapter);
 		os << TC_Common::outfill("recv-buffer-count") << adapter->getRecvBufferSize() << endl;
 		os << TC_Common::outfill("send-buffer-count") << adapter->getSendBufferSize() << endl;
+
+		if(adapter->getStealGroup())
+		{
+			TC_CoroutineSchedulerGroup::Stat stat = adapter->getStealGroup()->getStat();
+			os << TC_Common::outfill("steal-task-count") << stat.tasks << endl;
+			os << TC_Common::outfill("steal-count") << stat.steals << endl;
+		}
+
+		if(ServerConfig::CoroutineSharedStack > 0)
+		{
+			//handle协程的共享栈, 平均每次切出时保存的栈大小
+			TC_CoroutineScheduler::SharedStackStat stat;
+			for(int i = 0; i < adapter->getHandleNum(); i++)
+			{
+				shared_ptr<TC_CoroutineScheduler> scheduler = adapter->getDataBuffer()->getScheduler(i);
+				if(scheduler)
+				{
+					TC_CoroutineScheduler::SharedStackStat s = scheduler->getSharedStackStat();
+					stat.saveCount += s.saveCount;
+					stat.saveBytes += s.saveBytes;
+					stat.holdBytes += s.holdBytes;
+				}
+			}
+			os << TC_Common::outfill("shared-stack-save-count") << stat.saveCount << endl;
+			os << TC_Common::outfill("shared-stack-avg-save-size") << stat.avgSaveSize() << endl;
+			os << TC_Common::outfill("shared-stack-hold-bytes") << stat.holdBytes << endl;
+		}
 	}
 
 	result += os.str();
@@ -645,6 +733,39 @@ bool Application::cmdViewResource(const string& command, const string& params, s
 	return true;
 }
 
+bool Application::cmdViewCoroStack(const string& command, const string& params, string& result)
+{
+	TLOGDEBUG("Application::cmdViewCoroStack:" << command << " " << params << endl);
+
+	ostringstream os;
+
+	if(ServerConfig::CoroutineStackCheck <= 0)
+	{
+		os << "coroutine stack check not open, set coroutinestackcheck(ms) in config" << endl;
+	}
+
+	os << TC_Common::outfill("coroutine-stack-size") << ServerConfig::CoroutineStackSize << endl;
+	os << TC_Common::outfill("coroutine-stack-auto") << ServerConfig::CoroutineStackAuto << endl;
+
+	vector<TC_EpollServer::BindAdapterPtr> adapters = _epollServer->getBindAdapters();
+	for(auto adapter : adapters)
+	{
+		//handle线程里协程栈的最大深度和平均深度, 以及当前新协程使用的栈大小
+		TC_CoroutineScheduler::StackStat stat = getCoroStackStat(adapter);
+
+		os << OUT_LINE << endl;
+		os << TC_Common::outfill("name") << adapter->getName() << endl;
+		os << TC_Common::outfill("stack-alloc-size") << stat.stackSize << endl;
+		os << TC_Common::outfill("stack-coroutine-count") << stat.count << endl;
+		os << TC_Common::outfill("stack-max-used") << stat.maxUsed << endl;
+		os << TC_Common::outfill("stack-avg-used") << stat.avgUsed << endl;
+	}
+
+	result += os.str();
+
+	return true;
+}
+
 void Application::outAllAdapter(ostream &os)
 {
     auto m = _epollServer->getListenSocketInfo();
@@ -845,6 +966,9 @@ void Application::main(const string &config)
 	    //设置是否标准输出
 	    TARS_ADD_ADMIN_CMD_PREFIX(TARS_CMD_RESOURCE, Application::cmdViewResource);
 
+	    //查看协程栈的使用情况
+	    TARS_ADD_ADMIN_CMD_PREFIX(TARS_CMD_CORO_STACK, Application::cmdViewCoroStack);
+
         //上报版本
         TARS_REPORTVERSION(TARS_VERSION);
 
@@ -1045,6 +1169,9 @@ void Application::outServer(ostream &os)
 	os << TC_Common::outfill("OpenCoroutine(opencoroutine)")      << ServerConfig::OpenCoroutine << endl;
 	os << TC_Common::outfill("CoroutineMemSize(coroutinememsize)")   << ServerConfig::CoroutineMemSize << endl;
 	os << TC_Common::outfill("CoroutineStackSize(coroutinestack)") << ServerConfig::CoroutineStackSize << endl;
+	os << TC_Common::outfill("CoroutineSharedStack(coroutinesharedstack)") << ServerConfig::CoroutineSharedStack << endl;
+	os << TC_Common::outfill("CoroutineStackCheck(coroutinestackcheck)") << ServerConfig::CoroutineStackCheck << endl;
+	os << TC_Common::outfill("CoroutineStackAuto(coroutinestackauto)") << ServerConfig::CoroutineStackAuto << endl;
 	os << TC_Common::outfill("CloseCout(closecout)")          << ServerConfig::CloseCout << endl;
 	os << TC_Common::outfill("NetThread(netthread)")          << ServerConfig::NetThread << endl;
 	os << TC_Common::outfill("ManualListen(manuallisten)")       << ServerConfig::ManualListen << endl;
@@ -1052,6 +1179,8 @@ void Application::outServer(ostream &os)
 	os << TC_Common::outfill("ReportFlow(reportflow)")                  << ServerConfig::ReportFlow<< endl;
 	os << TC_Common::outfill("BackPacketLimit(backpacketlimit)")  << ServerConfig::BackPacketLimit<< endl;
 	os << TC_Common::outfill("BackPacketMin(backpacketmin)")  << ServerConfig::BackPacketMin<< endl;
+	os << TC_Common::outfill("QueueType(queuetype)")  << ServerConfig::QueueType<< endl;
+	os << TC_Common::outfill("TimerType(timertype)")  << ServerConfig::TimerType<< endl;
 
 #if TARS_SSL
 	os << TC_Common::outfill("Ca(ca)")                    << ServerConfig::CA << endl;
@@ -1125,12 +1254,17 @@ void Application::initializeServer()
     ServerConfig::OpenCoroutine     = TC_Common::strto<int>(toDefault(_conf.get("/tars/application/server<opencoroutine>"), "0"));
     ServerConfig::CoroutineMemSize  =  TC_Common::toSize(toDefault(_conf.get("/tars/application/server<coroutinememsize>"), "1G"), 1024*1024*1024);
     ServerConfig::CoroutineStackSize= (uint32_t)TC_Common::toSize(toDefault(_conf.get("/tars/application/server<coroutinestack>"), "128K"), 1024*128);
+    ServerConfig::CoroutineSharedStack = TC_Common::strto<uint32_t>(toDefault(_conf.get("/tars/application/server<coroutinesharedstack>"), "0"));
+    ServerConfig::CoroutineStackCheck = TC_Common::strto<int64_t>(toDefault(_conf.get("/tars/application/server<coroutinestackcheck>"), "0"));
+    ServerConfig::CoroutineStackAuto = _conf.get("/tars/application/server<coroutinestackauto>", "0") == "0" ? false : true;
     ServerConfig::ManualListen      = _conf.get("/tars/application/server<manuallisten>", "0") == "0" ? false : true;
 //	ServerConfig::MergeNetImp       = _conf.get("/tars/application/server<mergenetimp>", "0") == "0" ? false : true;
 	ServerConfig::NetThread         = TC_Common::strto<int>(toDefault(_conf.get("/tars/application/server<netthread>"), "1"));
 	ServerConfig::CloseCout        = _conf.get("/tars/application/server<closecout>","1")=="0"?0:1;
 	ServerConfig::BackPacketLimit  = TC_Common::strto<int>(_conf.get("/tars/application/server<backpacketlimit>", "100*1024*1024"));
 	ServerConfig::BackPacketMin    = TC_Common::strto<int>(_conf.get("/tars/application/server<backpacketmin>", "1024"));
+	ServerConfig::QueueType        = _conf.get("/tars/application/server<queuetype>", "thread");
+	ServerConfig::TimerType        = _conf.get("/tars/application/server<timertype>", "map");
 
 	ServerConfig::Context["node_name"] = ServerConfig::LocalIp;
 #if TARS_SSL
@@ -1199,6 +1333,10 @@ void Application::initializeServer()
     _epollServer->setThreadNum(ServerConfig::NetThread);
     _epollServer->setOpenCoroutine((TC_EpollServer::SERVER_OPEN_COROUTINE)ServerConfig::OpenCoroutine);
 	_epollServer->setCoroutineStack(ServerConfig::CoroutineMemSize/ServerConfig::CoroutineStackSize, ServerConfig::CoroutineStackSize);
+	_epollServer->setCoroutineSharedStack(ServerConfig::CoroutineSharedStack);
+	_epollServer->setCoroutineStackCheck(ServerConfig::CoroutineStackCheck, ServerConfig::CoroutineStackAuto);
+	_epollServer->setQueueType(TC_EpollServer::parseQueueType(ServerConfig::QueueType));
+	_epollServer->setTimerType(TC_TimerBase::parseTimerType(ServerConfig::TimerType));
 
     _epollServer->setOnAccept(std::bind(&Application::onAccept, this, std::placeholders::_1));
 
@@ -1295,6 +1433,14 @@ void Application::initializeServer()
         sRspQueue += ".sendrspqueue";
 
         g_pReportRspQueue = _communicator->getStatReport()->createPropertyReport(sRspQueue, PropertyReport::avg());
+
+        //协程栈的最大深度
+        if(ServerConfig::CoroutineStackCheck > 0)
+        {
+            string sCoroStack = ServerConfig::Application + "." + ServerConfig::ServerName + ".corostack";
+
+            g_pReportCoroStack = _communicator->getStatReport()->createPropertyReport(sCoroStack, PropertyReport::max());
+        }
     }
 
     TarsTimeLogger::getInstance()->enableLocal(TRACE_LOG_FILENAME, false);
@@ -1381,8 +1527,14 @@ void Application::bindAdapter(vector<TC_EpollServer::BindAdapterPtr>& adapters)
 
             bindAdapter->setQueueCapacity(TC_Common::strto<int>(_conf.get(sLastPath + "<queuecap>", "1024")));
 
+            bindAdapter->setQueueType(TC_EpollServer::parseQueueType(_conf.get(sLastPath + "<queuetype>", ServerConfig::QueueType)));
+
             bindAdapter->setQueueTimeout(TC_Common::strto<int>(_conf.get(sLastPath + "<queuetimeout>", "10000")));
 
+            bindAdapter->setGatherWrite(_conf.get(sLastPath + "<gatherwrite>", "0") == "1");
+
+            bindAdapter->setWorkSteal(_conf.get(sLastPath + "<worksteal>", "0") == "1");
+
             bindAdapter->setProtocolName(_conf.get(sLastPath + "<protocol>", "tars"));
 
 	        bindAdapter->setBackPacketBuffLimit(ServerConfig::BackPacketLimit);
@@ -1392,6 +1544,12 @@ void Application::bindAdapter(vector<TC_EpollServer::BindAdapterPtr>& adapters)
 	        if (bindAdapter->isTarsProtocol())
             {
                 bindAdapter->setProtocol(AppProtocol::parse);
+
+                //请求包直接引用网络buffer, 不copy
+                if (_conf.get(sLastPath + "<zerocopy>", "0") == "1")
+                {
+                    bindAdapter->setSliceProtocol(AppProtocol::parseSlice);
+                }
             }
 
             //校验ssl正常初始化
@@ -1424,6 +1582,12 @@ void Application::bindAdapter(vector<TC_EpollServer::BindAdapterPtr>& adapters)
 
                 p = _communicator->getStatReport()->createPropertyReport(bindAdapter->getName() + ".timeoutNum", PropertyReport::sum());
                 bindAdapter->_pReportTimeoutNum = p.get();
+
+                if(bindAdapter->isGatherWrite())
+                {
+                    p = _communicator->getStatReport()->createPropertyReport(bindAdapter->getName() + ".gatherSaved", PropertyReport::sum());
+                    bindAdapter->_pReportGatherSaved = p.get();
+                }
             }
         }
     }
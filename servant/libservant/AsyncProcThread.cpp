@@ -135,6 +135,13 @@ void AsyncProcThread::callback(ReqMessage * msg)
 		pServantProxyThreadData->_data._szHost = msg->adapter->endpoint().desc();
 	}
 
+	if(msg->awaiter)
+	{
+		//co_await的请求, msg由等待者释放
+		msg->awaiter->resume(msg);
+		return;
+	}
+
 	try
 	{
 		ReqMessagePtr msgPtr = msg;
@@ -342,6 +342,12 @@ void Communicator::initialize()
 
 	bool merge = TC_Common::strto<bool>(getProperty("mergenetasync", "0"));
 
+	//ReqMessage/ReqMonitor池化分配(进程内全局生效)
+	if(getProperty("reqpool", "0") == "1")
+	{
+		ReqMessage::setPooled(true);
+	}
+
     //异步队列的大小
     size_t iAsyncQueueCap = TC_Common::strto<size_t>(getProperty("asyncqueuecap", "100000"));
     if(iAsyncQueueCap < 10000)
@@ -373,6 +379,12 @@ void Communicator::initialize()
 
     //异步队列数目上报
     _reportAsyncQueue= getStatReport()->createPropertyReport(ClientConfig::ModuleName  + ".asyncqueue", PropertyReport::avg());
+
+    //合并发送节省的系统调用次数上报
+    if(getProperty("gatherwrite", "0") == "1")
+    {
+        _reportGatherSaved = getStatReport()->createPropertyReport(ClientConfig::ModuleName  + ".gatherSaved", PropertyReport::sum());
+    }
     
     //初始化统计上报接口
     string statObj = getProperty("stat", "");
@@ -705,7 +717,11 @@ void Communicator::terminate()
 
 void Communicator::pushAsyncThreadQueue(ReqMessage * msg)
 {
-	if(msg->pObjectProxy->getRootServantProxy()->_callback) {
+	if(msg->awaiter) {
+		//co_await的请求不走自定义回调, adapter可能为空, 不按连接hash
+		_asyncThread[(_asyncSeq++) % _asyncThreadNum]->push_back(msg);
+	}
+	else if(msg->pObjectProxy->getRootServantProxy()->_callback) {
 		ReqMessagePtr msgPtr = msg;
 
 		msg->pObjectProxy->getRootServantProxy()->_callback(msgPtr);
@@ -733,6 +749,18 @@ void Communicator::doStat()
         }
         _reportAsyncQueue->report((int) n);
     }
+
+    //合并发送节省的系统调用次数, 上报本周期的增量
+    if (_reportGatherSaved) {
+        size_t saved = 0;
+
+        for (size_t i = 0; i < _communicatorEpoll.size(); ++i)
+        {
+            saved += _communicatorEpoll[i]->getGatherSaved();
+        }
+        _reportGatherSaved->report((int) (saved - _gatherSavedReported));
+        _gatherSavedReported = saved;
+    }
 }
 
 ServantProxy* Communicator::getServantProxy(const string& objectName, const string& setName)
@@ -53,6 +53,12 @@ CommunicatorEpoll::CommunicatorEpoll(Communicator * pCommunicator,size_t netThre
         _timeoutCheckInterval = 5;
     }
 
+    //合并发送, 一批请求在同一个连接上只做一次writev
+    _gatherWrite = (pCommunicator->getProperty("gatherwrite", "0") == "1");
+
+    //定时器实现(map/wheel), 请求量大时用时间轮
+    _timerType = TC_TimerBase::parseTimerType(pCommunicator->getProperty("timertype", "map"));
+
 	for(size_t i = 0;i < MAX_CLIENT_NOTIFYEVENT_NUM;++i)
 	{
 		_notify[i] = NULL;
@@ -288,21 +294,43 @@ ObjectProxy * CommunicatorEpoll::createObjectProxy(ServantProxy *servantProxy, c
 	return pObjectProxy;
 }
 
-void CommunicatorEpoll::addFd(AdapterProxy* adapterProxy)
+void CommunicatorEpoll::addFd(AdapterProxy* adapterProxy, TC_Transceiver *trans)
 {
-    shared_ptr<TC_Epoller::EpollInfo> epollInfo = adapterProxy->trans()->getEpollInfo();
+    shared_ptr<TC_Epoller::EpollInfo> epollInfo = trans->getEpollInfo();
 
     epollInfo->cookie(adapterProxy);
 
 	map<uint32_t, TC_Epoller::EpollInfo::EVENT_CALLBACK> callbacks;
 
-	callbacks[EPOLLIN] = std::bind(&CommunicatorEpoll::handleInputImp, this, std::placeholders::_1);
-	callbacks[EPOLLOUT] = std::bind(&CommunicatorEpoll::handleOutputImp, this, std::placeholders::_1);
-	callbacks[EPOLLERR] = std::bind(&CommunicatorEpoll::handleCloseImp, this, std::placeholders::_1);
+	callbacks[EPOLLIN] = std::bind(&CommunicatorEpoll::handleInputImp, this, std::placeholders::_1, trans);
+	callbacks[EPOLLOUT] = std::bind(&CommunicatorEpoll::handleOutputImp, this, std::placeholders::_1, trans);
+	callbacks[EPOLLERR] = std::bind(&CommunicatorEpoll::handleCloseImp, this, std::placeholders::_1, trans);
 
 	epollInfo->registerCallback(callbacks, EPOLLIN|EPOLLOUT);
 }
 
+void CommunicatorEpoll::finishAwait(ReqMessage * msg)
+{
+	assert(msg->awaiter);
+
+	if(msg->awaiter->sched)
+	{
+		//回到发起调用的调度线程中恢复, 不占用网络线程
+		bool posted = msg->awaiter->sched->post([msg]()
+		{
+			msg->awaiter->resume(msg);
+		});
+
+		if(posted)
+		{
+			return;
+		}
+	}
+
+	//调度器已经退出, 在异步回调线程中恢复
+	pushAsyncThreadQueue(msg);
+}
+
 void CommunicatorEpoll::notify(size_t iSeq)
 {
 	assert(_notify[iSeq] != NULL);
@@ -342,18 +370,16 @@ void CommunicatorEpoll::initNotify(size_t iSeq, const shared_ptr<ReqInfoQueue> &
     }
 }
 
-bool CommunicatorEpoll::handleCloseImp(const shared_ptr<TC_Epoller::EpollInfo> &data)
+bool CommunicatorEpoll::handleCloseImp(const shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans)
 {
 	assert(_threadId == this_thread::get_id());
 
-	AdapterProxy* adapterProxy = (AdapterProxy*)data->cookie();
-
-    adapterProxy->trans()->close();
+    trans->close();
 
     return false;
 }
 
-bool CommunicatorEpoll::handleInputImp(const shared_ptr<TC_Epoller::EpollInfo> &data)
+bool CommunicatorEpoll::handleInputImp(const shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans)
 {
 	assert(_threadId == this_thread::get_id());
 
@@ -361,7 +387,7 @@ bool CommunicatorEpoll::handleInputImp(const shared_ptr<TC_Epoller::EpollInfo> &
 
     try
     {
-        adapterProxy->trans()->doResponse();
+        trans->doResponse();
     }
     catch(const std::exception& e)
     {
@@ -375,7 +401,7 @@ bool CommunicatorEpoll::handleInputImp(const shared_ptr<TC_Epoller::EpollInfo> &
     return true;
 }
 
-bool CommunicatorEpoll::handleOutputImp(const shared_ptr<TC_Epoller::EpollInfo> &data)
+bool CommunicatorEpoll::handleOutputImp(const shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans)
 {
 	assert(_threadId == this_thread::get_id());
 
@@ -385,7 +411,7 @@ bool CommunicatorEpoll::handleOutputImp(const shared_ptr<TC_Epoller::EpollInfo>
 
     try
     {
-        adapterProxy->trans()->doRequest();
+        trans->doRequest();
     }
     catch(const std::exception& e)
     {
@@ -478,6 +504,7 @@ void CommunicatorEpoll::getResourcesInfo(ostringstream &desc)
 			desc << TAB << TAB << TC_Common::outfill("adapter") << adapter->endpoint().getEndpoint().toString() << endl;
 			desc << TAB << TAB << TC_Common::outfill("recv size")  << adapter->trans()->getRecvBuffer().getBufferLength() << endl;
 			desc << TAB << TAB << TC_Common::outfill("send size")  << adapter->trans()->getSendBuffer().getBufferLength() << endl;
+			desc << TAB << TAB << TC_Common::outfill("conn num")  << adapter->getTransNum() << endl;
 		}
 	}
 }
@@ -525,6 +552,8 @@ bool CommunicatorEpoll::handleNotify(const shared_ptr<TC_Epoller::EpollInfo> &da
 
     size_t maxProcessCount = 0;
 
+    _gathering = _gatherWrite;
+
     try
     {
         while (pFDInfo->msgQueue->pop_front(msg))
@@ -541,6 +570,8 @@ bool CommunicatorEpoll::handleNotify(const shared_ptr<TC_Epoller::EpollInfo> &da
             }
         }
 
+        flushGatherAdapters();
+
         if (pFDInfo->msgQueue->empty() && pFDInfo->autoDestroy)
         {
 //			LOG_CONSOLE_DEBUG << "iSeq:" << pFDInfo->iSeq << ", fd:" << pFDInfo->notify.notifyFd() << endl;
@@ -552,15 +583,37 @@ bool CommunicatorEpoll::handleNotify(const shared_ptr<TC_Epoller::EpollInfo> &da
     catch(exception & e)
     {
         TLOGERROR("[CommunicatorEpoll::handleNotify error: " << e.what() << "]"<<endl);
+
+        flushGatherAdapters();
     }
     catch(...)
     {
         TLOGERROR("[CommunicatorEpoll::handleNotify error]" <<endl);
+
+        flushGatherAdapters();
     }
 
     return true;
 }
 
+void CommunicatorEpoll::flushGatherAdapters()
+{
+    _gathering = false;
+
+    if(_gatherAdapters.empty())
+    {
+        return;
+    }
+
+    vector<AdapterProxy*> adapters;
+    adapters.swap(_gatherAdapters);
+
+    for(auto adapterProxy : adapters)
+    {
+        adapterProxy->doGatherInvoke();
+    }
+}
+
 void CommunicatorEpoll::initializeEpoller()
 {
 	_threadId = this_thread::get_id();
@@ -571,6 +624,8 @@ void CommunicatorEpoll::initializeEpoller()
 
     _epoller = _scheduler->getEpoller();
 
+    _epoller->setTimerType(_timerType);
+
     auto id1 = _epoller->postRepeated(1000, false, std::bind(&CommunicatorEpoll::doReconnect, this));
 	auto id2 = _epoller->postRepeated(1000 * 5, false, std::bind(&CommunicatorEpoll::doStat, this));
     auto id3 = _epoller->postRepeated(_timeoutCheckInterval, false, std::bind(&CommunicatorEpoll::doTimeout, this));
@@ -25,6 +25,55 @@ namespace tars
 {
 
 using namespace std;
+
+//应答超过这个大小时分段编码发送: 应答体(sBuffer)仍然是业务编码好的连续内存,
+//分段只省掉了加包头时再申请一整块连续内存(以及扩容时的copy), sBuffer按段copy一次,
+//编码时的内存峰值(sBuffer + 编码结果)和连续编码相同
+#define RESPONSE_CHAIN_SIZE     (1024 * 1024)
+#define RESPONSE_SEGMENT_SIZE   (256 * 1024)
+
+/**
+ * 编码应答包, 前4个字节是包长度
+ */
+template<typename T>
+static void encodeResponse(const T &packet, bool chain, const shared_ptr<TC_EpollServer::SendContext> &send)
+{
+	Int32 iHeaderLen = 0;
+
+	if (chain)
+	{
+		TarsOutputStream<BufferWriterChain> os;
+		os.setSegmentSize(RESPONSE_SEGMENT_SIZE);
+
+		//先预留4个字节长度, 编码完再填写
+		os.writeBuf((const char *)&iHeaderLen, sizeof(iHeaderLen));
+		packet.writeTo(os);
+
+		iHeaderLen = htonl((int)(os.getLength()));
+		os.patch(0, (const char *)&iHeaderLen, sizeof(iHeaderLen));
+
+		send->setBuffers(ProxyProtocol::toBuffers(os));
+		return;
+	}
+
+	TarsOutputStream<BufferWriter> os;
+
+	//应答体已经是编码好的vector<char>, 算大小很便宜; 按精确大小一次分配, 不会按两倍扩容多占内存
+	os.reserveExact(sizeof(iHeaderLen) + packet.tars_encoded_size());
+
+	//先预留4个字节长度
+	os.writeBuf((const char *)&iHeaderLen, sizeof(iHeaderLen));
+	packet.writeTo(os);
+
+	assert(os.getLength() >= 4);
+
+	iHeaderLen = htonl((int)(os.getLength()));
+
+	memcpy((void*)os.getBuffer(), (const char *)&iHeaderLen, sizeof(iHeaderLen));
+
+	send->setBuffer(ProxyProtocol::toBuffer(os));
+}
+
 //////////////////////////////////////////////////////////////////
 Current::Current(ServantHandle *pServantHandle)
     : _servantHandle(pServantHandle)
@@ -103,11 +152,21 @@ const map<string, string>& Current::getRequestStatus() const
     return _request.status;
 }
 
-string Current::getFuncName() const
+const string &Current::getFuncName() const
 {
     return _request.sFuncName;
 }
 
+TC_Arena *Current::getArena()
+{
+    if (!_arena)
+    {
+        //解码后的对象一般比请求包体大, 尽量一个块放下
+        _arena.reset(new TC_Arena(std::max((size_t)4096, _requestLength * 2)));
+    }
+    return _arena.get();
+}
+
 uint32_t Current::getRequestId() const
 {
     return _request.iRequestId;
@@ -141,6 +200,11 @@ const vector<char>& Current::getRequestBuffer() const
 {
 	if (_isTars)
 	{
+		//请求包体延迟copy, 只有需要vector时才copy
+		if (_request.sBuffer.empty() && _requestLength > 0)
+		{
+			_request.sBuffer.assign(_requestData, _requestData + _requestLength);
+		}
 		return _request.sBuffer;
 	}
 	else
@@ -149,6 +213,30 @@ const vector<char>& Current::getRequestBuffer() const
 	}
 }
 
+const char *Current::getRequestData() const
+{
+	if (_isTars)
+	{
+		return _requestData;
+	}
+	else
+	{
+		return _data->buffer().data();
+	}
+}
+
+size_t Current::getRequestLength() const
+{
+	if (_isTars)
+	{
+		return _requestLength;
+	}
+	else
+	{
+		return _data->buffer().size();
+	}
+}
+
 bool Current::isResponse() const
 {
     return _response;
@@ -176,7 +264,15 @@ void Current::initialize(const shared_ptr<TC_EpollServer::RecvContext> &data)
 
     if (_isTars)
     {
-        initialize(_data->buffer());
+        if (_data->hasSlice())
+        {
+            //直接引用网络buffer的切片
+            initialize(_data->slice().data, _data->slice().length);
+        }
+        else
+        {
+            initialize(_data->buffer());
+        }
     }
 }
 
@@ -191,11 +287,29 @@ void Current::initializeClose(const shared_ptr<TC_EpollServer::RecvContext> &dat
 
 void Current::initialize(const vector<char>& sRecvBuffer)
 {
-    TarsInputStream<BufferReader> is;
+    initialize(sRecvBuffer.data(), sRecvBuffer.size());
+}
 
-    is.setBuffer(sRecvBuffer.data(), sRecvBuffer.size());
+void Current::initialize(const char *buff, size_t length)
+{
+    TarsInputStream<BufferReaderView> is;
 
+    is.setBuffer(buff, length);
+
+    //生成的readFrom, sBuffer不copy, 直接引用buff
     _request.readFrom(is);
+
+    if (is.viewData() != NULL)
+    {
+        _requestData   = is.viewData();
+        _requestLength = is.viewLength();
+    }
+    else
+    {
+        //包体不是SimpleList编码(兼容), 已经解码到sBuffer
+        _requestData   = _request.sBuffer.data();
+        _requestLength = _request.sBuffer.size();
+    }
 }
 
 void Current::sendResponse(const char *buff, uint32_t len)
@@ -204,6 +318,7 @@ void Current::sendResponse(const char *buff, uint32_t len)
 	// send->buffer()->assign(buff, len);
 	send->buffer()->addBuffer(buff, len);
 	_servantHandle->sendResponse(send);
+	_responseSent = true;
 }
 
 void Current::sendResponse(int iRet, const vector<char> &buff)
@@ -264,12 +379,8 @@ void Current::sendResponse(int iRet, ResponsePacket &response,  const map<string
 
 	shared_ptr<TC_EpollServer::SendContext> send = _data->createSendContext();
 
-	Int32 iHeaderLen = 0;
-
-	TarsOutputStream<BufferWriter> os;
-
-	//先预留4个字节长度
-	os.writeBuf((const char *)&iHeaderLen, sizeof(iHeaderLen));
+	//大的应答分段编码(udp一个包必须连续)
+	bool chain = response.sBuffer.size() >= RESPONSE_CHAIN_SIZE && !_data->adapter()->isUdp();
 
     if (_request.iVersion != TUPVERSION)
     {
@@ -290,7 +401,7 @@ void Current::sendResponse(int iRet, ResponsePacket &response,  const map<string
                    << _request.sFuncName << "|"
                    << response.iRequestId << endl);
 
-        response.writeTo(os);
+        encodeResponse(response, chain, send);
     }
     else
     {
@@ -332,18 +443,11 @@ void Current::sendResponse(int iRet, ResponsePacket &response,  const map<string
                    << _request.sFuncName << "|"
                    << tupResponse.iRequestId << endl);
 
-	    tupResponse.writeTo(os);
+	    encodeResponse(tupResponse, chain, send);
     }
 
-	assert(os.getLength() >= 4);
-
-	iHeaderLen = htonl((int)(os.getLength()));
-
-	memcpy((void*)os.getBuffer(), (const char *)&iHeaderLen, sizeof(iHeaderLen));
-
-	send->setBuffer(ProxyProtocol::toBuffer(os));
-
 	_servantHandle->sendResponse(send);
+	_responseSent = true;
 
 }
 
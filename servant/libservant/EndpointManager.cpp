@@ -351,14 +351,7 @@ void QueryEpBase::setEndpoints(const string & sEndpoints, set<EndpointInfo> & se
 
     if(bSameWeightType)
     {    
-        if(iWeightType == 1)
-        {
-            _weightType = E_STATIC_WEIGHT;
-        }
-        else
-        {
-            _weightType = E_LOOP;
-        }
+        _weightType = toWeightType(iWeightType);
     }
     else
     {
@@ -366,6 +359,19 @@ void QueryEpBase::setEndpoints(const string & sEndpoints, set<EndpointInfo> & se
     }
 }
 
+EndpointWeightType QueryEpBase::toWeightType(int iWeightType)
+{
+    switch(iWeightType)
+    {
+    case E_STATIC_WEIGHT:
+    case E_LEAST_ACTIVE:
+    case E_LATENCY_EWMA:
+        return (EndpointWeightType)iWeightType;
+    default:
+        return E_LOOP;
+    }
+}
+
 void QueryEpBase::refreshReg(GetEndpointType type, const string & sName)
 {
     onUpdateOutter();
@@ -566,14 +572,7 @@ void QueryEpBase::doEndpoints(const vector<EndpointF>& activeEp, const vector<En
 
     if(bSameWeightType)
     {    
-        if(iWeightType == 1)
-        {
-            _weightType = E_STATIC_WEIGHT;
-        }
-        else
-        {
-            _weightType = E_LOOP;
-        }
+        _weightType = toWeightType(iWeightType);
     }
     else
     {
@@ -885,6 +884,11 @@ bool EndpointManager::selectAdapterProxy(ReqMessage * msg,AdapterProxy * & pAdap
 
         pAdapterProxy = getWeightedProxy(bStaticWeighted);
     }
+    else if(_weightType == E_LEAST_ACTIVE || _weightType == E_LATENCY_EWMA)
+    {
+        //按负载选择
+        pAdapterProxy = getP2CProxy(_weightType == E_LATENCY_EWMA);
+    }
     else
     {
         //普通轮询模式
@@ -943,6 +947,51 @@ AdapterProxy * EndpointManager::getNextValidProxy()
     return adapterProxy;
 }
 
+AdapterProxy * EndpointManager::getP2CProxy(bool bLatency)
+{
+    if (_activeProxys.size() < 2)
+    {
+        return getNextValidProxy();
+    }
+
+    size_t n = _activeProxys.size();
+    size_t i = (uint32_t)rand() % n;
+    size_t j = (uint32_t)rand() % (n - 1);
+    if (j >= i)
+    {
+        ++j;
+    }
+
+    AdapterProxy *first  = _activeProxys[i];
+    AdapterProxy *second = _activeProxys[j];
+
+    bool firstActive  = first->checkActive(false);
+    bool secondActive = second->checkActive(false);
+
+    if (!firstActive && !secondActive)
+    {
+        //两个都不可用, 走轮询的逻辑(会处理重连)
+        return getNextValidProxy();
+    }
+
+    if (!firstActive)
+    {
+        return second;
+    }
+
+    if (!secondActive)
+    {
+        return first;
+    }
+
+    if (bLatency)
+    {
+        return first->getLatencyCost() <= second->getLatencyCost() ? first : second;
+    }
+
+    return first->getInflight() <= second->getInflight() ? first : second;
+}
+
 AdapterProxy* EndpointManager::getHashProxy(int64_t hashCode, bool bConsistentHash)
 {
     if(_weightType == E_STATIC_WEIGHT)
@@ -1,12 +1,47 @@
 ﻿#include "servant/Message.h"
 #include "servant/ServantProxy.h"
 #include "servant/Communicator.h"
+#include "util/tc_thread_cache_pool.h"
 
 namespace tars
 {
 
 using namespace std;
 
+typedef TC_ThreadCachePool<sizeof(ReqMessage)> ReqMessagePool;
+typedef TC_ThreadCachePool<sizeof(ReqMonitor)> ReqMonitorPool;
+
+void ReqMessage::setPooled(bool pooled)
+{
+	ReqMessagePool::setEnable(pooled);
+	ReqMonitorPool::setEnable(pooled);
+}
+
+bool ReqMessage::isPooled()
+{
+	return ReqMessagePool::isEnable();
+}
+
+void *ReqMessage::operator new(size_t size)
+{
+	return ReqMessagePool::allocate(size);
+}
+
+void ReqMessage::operator delete(void *p)
+{
+	ReqMessagePool::deallocate(p);
+}
+
+void *ReqMonitor::operator new(size_t size)
+{
+	return ReqMonitorPool::allocate(size);
+}
+
+void ReqMonitor::operator delete(void *p)
+{
+	ReqMonitorPool::deallocate(p);
+}
+
 void ReqMessage::init(CallType eCallType, ServantProxy *prx)
 {
 	eStatus        = ReqMessage::REQ_REQ;
@@ -28,6 +63,7 @@ void ReqMessage::init(CallType eCallType, ServantProxy *prx)
 	bPush          = false;
 	sched          = NULL;
 	iCoroId        = 0;
+	awaiter        = NULL;
 }
 
 ReqMessage::~ReqMessage()
@@ -294,6 +294,13 @@ void ObjectProxy::doInvokeException(ReqMessage * msg)
         return;
     }
 
+    if(msg->awaiter)
+    {
+        //co_await的调用, 恢复等待的协程
+        _communicatorEpoll->finishAwait(msg);
+        return;
+    }
+
     if(msg->callback)
     {
 		if(!msg->sched)
@@ -248,6 +248,12 @@ void ServantHandle::heartbeat()
 		{
 			_bindAdapter->_pReportQueue->report((int)_bindAdapter->getRecvBufferSize());
 		}
+
+		//合并发送节省的系统调用次数
+		if (_bindAdapter->_pReportGatherSaved)
+		{
+			_bindAdapter->_pReportGatherSaved->report((int)_bindAdapter->takeGatherSavedIncrement());
+		}
 	}
 }
 
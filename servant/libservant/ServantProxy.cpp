@@ -394,6 +394,7 @@ ServantProxy::ServantProxy(Communicator *pCommunicator, const string &name, cons
 {
 	_proxyProtocol.requestFunc  = ProxyProtocol::tarsRequest;
 	_proxyProtocol.responseFunc = ProxyProtocol::tarsResponse;
+	_proxyProtocol.connectionPool = true;
 
     //在每个公有网络线程对象中创建ObjectProxy
     for (size_t i = 0; i < _communicator->getCommunicatorEpollNum(); ++i)
@@ -412,6 +413,17 @@ ServantProxy::ServantProxy(Communicator *pCommunicator, const string &name, cons
         _minTimeout = 1;
     }
 
+    //客户端配置中的连接池
+    string connections = pCommunicator->getServantProperty(_objectProxy->name(), "connections");
+    if(!connections.empty())
+    {
+        _connectionNum = TC_Common::strto<int>(connections);
+    }
+
+    if(pCommunicator->getServantProperty(_objectProxy->name(), "connselect") == "least")
+    {
+        _connectionSelect = CONNECTION_LEAST_PENDING;
+    }
 }
 
 void ServantProxy::tars_initialize()
@@ -585,6 +597,31 @@ int ServantProxy::tars_connection_serial() const
 	return _connectionSerial;
 }
 
+void ServantProxy::tars_connection_pool(int connectionNum, CONNECTION_SELECT select)
+{
+    assert(!_rootPrx);
+    _connectionNum = connectionNum;
+    _connectionSelect = select;
+}
+
+int ServantProxy::tars_connection_num() const
+{
+	if(_rootPrx) {
+		return _rootPrx->tars_connection_num();
+	}
+
+	return _connectionNum;
+}
+
+ServantProxy::CONNECTION_SELECT ServantProxy::tars_connection_select() const
+{
+	if(_rootPrx) {
+		return _rootPrx->tars_connection_select();
+	}
+
+	return _connectionSelect;
+}
+
 void ServantProxy::tars_set_protocol(SERVANT_PROTOCOL protocol, int connectionSerial)
 {
     ProxyProtocol proto;
@@ -614,6 +651,7 @@ void ServantProxy::tars_set_protocol(SERVANT_PROTOCOL protocol, int connectionSe
 		default:
 			proto.requestFunc   = ProxyProtocol::tarsRequest;
 			proto.responseFunc  = ProxyProtocol::tarsResponse;
+			proto.connectionPool = true;
 			break;
 	}
 	tars_set_protocol(proto, connectionSerial);
@@ -988,6 +1026,17 @@ void ServantProxy::tars_invoke_async(char  cPacketType,
                                     const map<string, string>& status,
                                     const ServantProxyCallbackPtr& callback,
                                     bool  bCoro)
+{
+    tars_invoke_async(cPacketType, sFuncName, buf, map<string, string>(context), map<string, string>(status), callback, bCoro);
+}
+
+void ServantProxy::tars_invoke_async(char  cPacketType,
+                                    const string &sFuncName,
+                                    TarsOutputStream<BufferWriterVector> &buf,
+                                    map<string, string>&& context,
+                                    map<string, string>&& status,
+                                    const ServantProxyCallbackPtr& callback,
+                                    bool  bCoro)
 {
 	ReqMessage *msg = new ReqMessage();
 
@@ -1001,8 +1050,8 @@ void ServantProxy::tars_invoke_async(char  cPacketType,
 
     buf.swap(msg->request.sBuffer);
 
-    msg->request.context      = context;
-    msg->request.status       = status;
+    msg->request.context.swap(context);
+    msg->request.status.swap(status);
     msg->request.iTimeout     = _asyncTimeout;
     
 //    // 在RequestPacket中的context设置主调信息
@@ -1053,6 +1102,83 @@ void ServantProxy::tars_invoke_async(char  cPacketType,
 	servant_invoke(msg, bCoro);
 }
 
+ReqMessage *ServantProxy::tars_new_await(char  cPacketType,
+                                    const string &sFuncName,
+                                    TarsOutputStream<BufferWriterVector> &buf,
+                                    map<string, string>&& context,
+                                    map<string, string>&& status)
+{
+	ReqMessage *msg = new ReqMessage();
+
+	msg->init(ReqMessage::ASYNC_CALL, this);
+
+	msg->request.iVersion = TARSVERSION;
+	msg->request.cPacketType = cPacketType;
+	msg->request.sFuncName = sFuncName;
+	msg->request.sServantName = _objectProxy->name();
+
+	buf.swap(msg->request.sBuffer);
+
+	msg->request.context.swap(context);
+	msg->request.status.swap(status);
+	msg->request.iTimeout     = _asyncTimeout;
+
+	checkDye(msg->request);
+	checkTrace(msg->request);
+	checkCookie(msg->request);
+
+	return msg;
+}
+
+void ServantProxy::tars_invoke_await(ReqMessage *msg, ReqAwaiter *awaiter)
+{
+	assert(awaiter != NULL);
+
+	msg->awaiter = awaiter;
+
+	servant_invoke(msg, false);
+}
+
+void ServantProxy::tars_await_result(ReqMessage *msg)
+{
+	if(msg->adapter)
+	{
+		ServantProxyThreadData::getData()->_data._szHost = msg->adapter->endpoint().desc();
+	}
+
+	if(msg->eStatus == ReqMessage::REQ_RSP && msg->response->iRet == TARSSERVERSUCCESS)
+	{
+		return;
+	}
+
+	//和同步调用一样, 超时抛TarsSyncCallTimeoutException, 其他错误按错误码抛异常
+	bool bTimeout = (msg->eStatus == ReqMessage::REQ_TIME && msg->response->iRet != TARSPROXYCONNECTERR);
+
+	ostringstream os;
+	if (bTimeout)
+	{
+		os << "[ServantProxy::tars_await_result timeout:" << msg->request.iTimeout;
+	}
+	else
+	{
+		os << "[ServantProxy::tars_await_result errno:" << msg->response->iRet << ",info:" << msg->response->sResultDesc;
+	}
+
+	os << ",servant:" << msg->request.sServantName << ",func:" << msg->request.sFuncName;
+
+	if (msg->adapter)
+		os << ",adapter:" << msg->adapter->endpoint().desc();
+
+	os << ",reqid:" << msg->request.iRequestId << "]";
+
+	if (bTimeout)
+	{
+		throw TarsSyncCallTimeoutException(os.str());
+	}
+
+	TarsException::throwException(msg->response->iRet, os.str());
+}
+
 shared_ptr<ResponsePacket> ServantProxy::tars_invoke(char  cPacketType,
                               const string& sFuncName,
                               const vector<char>& buf,
@@ -1101,6 +1227,15 @@ shared_ptr<ResponsePacket> ServantProxy::tars_invoke(char  cPacketType,
                               const map<string, string>& context,
                               const map<string, string>& status)
                             //   ResponsePacket& rsp)
+{
+    return tars_invoke(cPacketType, sFuncName, buf, map<string, string>(context), map<string, string>(status));
+}
+
+shared_ptr<ResponsePacket> ServantProxy::tars_invoke(char  cPacketType,
+                              const string& sFuncName,
+                              TarsOutputStream<BufferWriterVector>& buf,
+                              map<string, string>&& context,
+                              map<string, string>&& status)
 {
     ReqMessage * msg = new ReqMessage();
 
@@ -1112,8 +1247,8 @@ shared_ptr<ResponsePacket> ServantProxy::tars_invoke(char  cPacketType,
     msg->request.sServantName = _objectProxy->name();
 
     buf.swap(msg->request.sBuffer);
-    msg->request.context      = context;
-    msg->request.status       = status;
+    msg->request.context.swap(context);
+    msg->request.status.swap(status);
     msg->request.iTimeout     = _syncTimeout;
 
 //    // 在RequestPacket中的context设置主调信息
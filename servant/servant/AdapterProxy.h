@@ -17,7 +17,7 @@
 #ifndef __TARS_ADAPTER_PROXY_H_
 #define __TARS_ADAPTER_PROXY_H_
 
-#include "util/tc_timeout_queue_new.h"
+#include "util/tc_timeout_queue_slab.h"
 #include "util/tc_timeout_queue_map.h"
 #include "util/tc_transceiver.h"
 #include "servant/Global.h"
@@ -69,10 +69,15 @@ public:
     /**
      * 发送请求
      * 发送挤压的数据
-     * @param req
+     * @param trans, 发送用的连接, NULL则按连接池的选择策略选一个
      * @return
      */
-    void doInvoke();
+    void doInvoke(TC_Transceiver *trans = NULL);
+
+    /**
+     * 合并发送模式下, 网络线程处理完一批请求后统一发送
+     */
+    void doGatherInvoke();
 
     /**
      * server端的响应包返回
@@ -163,11 +168,26 @@ public:
     inline void setActiveInReg(bool bActive) { _activeStateInReg = bActive; }
 
     /**
-     * 获取连接
+     * 获取连接(连接池模式下为主连接)
      *
      * @return TC_Transceiver*
      */
-    inline TC_Transceiver* trans() { return _trans.get(); }
+    inline TC_Transceiver* trans() { return _trans; }
+
+    /**
+     * 当前的连接个数
+     */
+    inline size_t getTransNum() const { return _transPool.size(); }
+
+    /**
+     * 第index个连接上已经发送还没有回包的请求数
+     */
+    inline size_t getTransPending(size_t index) const { return _transPending[index]; }
+
+    /**
+     * 第index个连接上的连续超时次数
+     */
+    inline size_t getTransTimeout(size_t index) const { return _transTimeout[index]; }
 
     /**
      * 设置节点的静态权重值
@@ -188,6 +208,17 @@ public:
      */
     inline void resetWeightChanged() { _staticWeightChanged = false; }
 
+    /**
+     * 在途的请求数(包括还没有发送出去的)
+     */
+    inline size_t getInflight() { return _timeoutQueue->size(); }
+
+    /**
+     * 按响应时间的指数滑动平均估计的负载: (平均响应时间+1) * (在途请求数+1)
+     * 长时间没有请求时平均响应时间逐渐衰减, 慢节点恢复后还有机会被选中
+     */
+    double getLatencyCost();
+
     /**
      * 判断权重静态权重值是否变化, 参数reset为true时将权重变化标识重置为false
      */
@@ -214,7 +245,7 @@ public:
 	 * get timeout queue
 	 * @return
 	 */
-	TC_TimeoutQueueNew<ReqMessage*> * getTimeoutQueue() { return _timeoutQueue.get(); }
+	TC_TimeoutQueueSlab<ReqMessage*> * getTimeoutQueue() { return _timeoutQueue.get(); }
 
 protected:
 
@@ -304,7 +335,45 @@ private:
 	/**
 	 * 并行发送的情况(连接复用)
 	 */
-	void doInvoke_parallel();
+	void doInvoke_parallel(TC_Transceiver *trans);
+
+	/**
+	 * 创建连接
+	 */
+	TC_Transceiver *createTransceiver();
+
+	/**
+	 * 连接复用模式下, 按配置的连接数补齐连接池
+	 */
+	void prepareTransPool();
+
+	/**
+	 * 选择发送请求的连接, 只在已经建立的连接中选, 都没有建立则返回主连接
+	 * @return 连接的下标
+	 */
+	size_t selectTrans();
+
+	/**
+	 * 连接在池中的下标
+	 */
+	size_t transIndex(TC_Transceiver *trans);
+
+	/**
+	 * 请求已经在某个连接上发送出去
+	 */
+	void onTransSend(ReqMessage *msg, size_t index);
+
+	/**
+	 * 请求完成(回包或者超时), 扣减所在连接的在途请求数
+	 * @param bTimeout, 是否超时, 记录连接的连续超时次数
+	 * @return 请求所在连接的下标, 没有发送过返回-1
+	 */
+	int onTransFinish(ReqMessage *msg, bool bTimeout = false);
+
+	/**
+	 * 连接池中的连接是否有可用的(已经建立, 或者connecting时正在建立)
+	 */
+	bool hasActiveTrans(bool connecting);
 
 	/**
 	 * slave 名称(去掉set等信息)
@@ -336,14 +405,36 @@ private:
     EndpointInfo                            _ep;
 
     /*
-     * 收发包处理
+     * 收发包处理, 连接池, 第一个为主连接
+     * 连接串行模式只使用主连接; 连接复用模式下按ServantProxy::tars_connection_pool的连接数建立多个连接
+     * 多个连接共用一个超时队列和请求id, 回包从哪个连接回来都可以
+     */
+    std::vector<std::unique_ptr<TC_Transceiver>> _transPool;
+
+    /*
+     * 主连接(_transPool[0]), 屏蔽等判断都以主连接为准, 连接是否可用看整个连接池
+     */
+    TC_Transceiver*                         _trans = NULL;
+
+    /*
+     * 每个连接上已经发送还没有回包的请求数
      */
-    std::unique_ptr<TC_Transceiver>         _trans;
+    std::vector<size_t>                     _transPending;
 
     /*
-     * 超时队列
+     * 每个连接上的连续超时次数, 有回包就清零
      */
-    std::unique_ptr<TC_TimeoutQueueNew<ReqMessage*>> _timeoutQueue;
+    std::vector<size_t>                     _transTimeout;
+
+    /*
+     * 选择连接的游标
+     */
+    size_t                                  _transCursor = 0;
+
+    /*
+     * 超时队列(节点预分配, push/get/timeout不分配内存)
+     */
+    std::unique_ptr<TC_TimeoutQueueSlab<ReqMessage*>> _timeoutQueue;
 
     /*
      * 节点在主控的存活状态
@@ -416,6 +507,21 @@ private:
      */
     size_t                                   _noSendQueueLimit;
 
+    /*
+     * 是否已经登记到网络线程的合并发送列表中
+     */
+    bool                                     _gatherPending = false;
+
+    /*
+     * 响应时间的指数滑动平均(ms)
+     */
+    double                                   _latencyEwma = 0;
+
+    /*
+     * 上一次更新响应时间的时间
+     */
+    int64_t                                  _latencyTime = 0;
+
     /*
      * 模块间调用统计信息的head信息
      */
@@ -69,6 +69,18 @@ public:
         return TC_NetWorkBuffer::parseBinary4<TARS_NET_MIN_PACKAGE_SIZE, TARS_NET_MAX_PACKAGE_SIZE>(in, out);
     }
 
+    /**
+     * 解析协议, 完整包以切片形式返回, 直接引用网络buffer
+     * @param in, 目前的buffer
+     * @param out, 一个完整的包
+     *
+     * @return int, 0表示没有接收完全, 1表示收到一个完整包
+     */
+    static TC_NetWorkBuffer::PACKET_TYPE parseSlice(TC_NetWorkBuffer &in, TC_NetWorkBuffer::Slice &out)
+    {
+        return TC_NetWorkBuffer::parseBinary4<TARS_NET_MIN_PACKAGE_SIZE, TARS_NET_MAX_PACKAGE_SIZE>(in, out);
+    }
+
     /**
      *
      * @param T
@@ -146,6 +158,12 @@ public:
      * 注意: 转换后os无效了, 数据被置换到std::shared_ptr<TC_NetWorkBuffer::Buffer>
      */ 
     static std::shared_ptr<TC_NetWorkBuffer::Buffer> toBuffer(TarsOutputStream<BufferWriter> &os);
+
+    /**
+     * 将分段编码的TarsOutputStream<BufferWriterChain>换成一组Buffer(每段一个), 中间没有内存copy
+     * 注意: 转换后os被清空
+     */
+    static std::vector<std::shared_ptr<TC_NetWorkBuffer::Buffer>> toBuffers(TarsOutputStream<BufferWriterChain> &os);
     static std::shared_ptr<TC_NetWorkBuffer::Buffer> http1Request(tars::RequestPacket& request, TC_Transceiver *);
     static TC_NetWorkBuffer::PACKET_TYPE http1Response(TC_NetWorkBuffer &in, ResponsePacket& done);
 
@@ -722,6 +740,12 @@ public:
     request_protocol requestFunc;
 
     response_protocol responseFunc;
+
+    /**
+     * 请求编码是否与连接无关, 可以在连接池(tars_connection_pool)的任意连接上发送
+     * http2/grpc等在连接上保存编码状态(hpack, stream id)的协议不能使用连接池, 自定义协议需要时自行设置
+     */
+    bool connectionPool = false;
 };
 
 //////////////////////////////////////////////////////////////////////
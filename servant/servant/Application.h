@@ -61,6 +61,7 @@ namespace tars
 #define TARS_CMD_RELOAD_LOCATOR      "tars.reloadlocator"     //重新加载locator的配置信息
 #define TARS_CMD_RESOURCE            "tars.resource"          //get resource
 #define TARS_CMD_VIEW_BID            "tars.bid"               //查看服务编译时间,build id
+#define TARS_CMD_CORO_STACK          "tars.corostack"         //查看协程栈的使用情况(需要配置coroutinestackcheck)
 //////////////////////////////////////////////////////////////////////
 /**
  * 通知信息给notify服务, 展示在页面上
@@ -128,10 +129,15 @@ struct SVT_DLL_API ServerConfig
     static int        OpenCoroutine;       //是否启用协程处理方式(0~3)
     static size_t      CoroutineMemSize;    //协程占用内存空间的最大大小
     static uint32_t    CoroutineStackSize;  //每个协程的栈大小(默认128k)
+    static uint32_t    CoroutineSharedStack;//每个线程协程共享栈的个数(默认0, 不使用共享栈)
+    static int64_t     CoroutineStackCheck; //协程栈深度检查间隔(毫秒, 默认0, 不检查)
+    static bool        CoroutineStackAuto;  //是否根据栈的最大深度自动调整协程栈大小(默认0)
 	static int         NetThread;           //servernet std::thread
 	static bool        ManualListen;        //是否启用手工端口监听
 	static int         BackPacketLimit;     //回包积压检查
 	static int         BackPacketMin;       //回包速度检查
+	static std::string QueueType;           //网络线程和业务线程之间的队列实现(thread/ring)
+	static std::string TimerType;           //网络线程定时器的实现(map/wheel)
 
 	static std::string CA;
 	static std::string Cert;
@@ -443,6 +449,14 @@ protected:
 	*/
 	bool cmdViewResource(const std::string& command, const std::string& params, std::string& result);
 
+	/*
+	* view coroutine stack usage
+	* @param command
+	* @param params
+	* @param result
+	*/
+	bool cmdViewCoroStack(const std::string& command, const std::string& params, std::string& result);
+
 protected:
 
     /**
@@ -0,0 +1,328 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef _TARS_AWAITABLE_H_
+#define _TARS_AWAITABLE_H_
+
+#include "servant/ServantProxy.h"
+#include "servant/Current.h"
+
+/**
+ * 是否支持C++20协程(co_await), 框架本身按C++11编译, 只有用-std=c++20编译的业务代码才会打开
+ */
+#ifndef TARS_CO_AWAIT
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+#define TARS_CO_AWAIT 1
+#else
+#define TARS_CO_AWAIT 0
+#endif
+#endif
+
+#if TARS_CO_AWAIT
+
+#include <coroutine>
+#include <exception>
+
+namespace tars
+{
+
+/**
+ * ServantProxy的co_await调用(tars2cpp --coawait生成的co_xxx接口返回的对象)
+ *
+ * 用法(在C++20协程中):
+ * std::string r;
+ * int ret = co_await prx->co_testHello(1, "hello", r);
+ *
+ * 和async_xxx/promise_async_xxx不同, 不需要创建ServantProxyCallback, 等待的状态直接放在协程帧里
+ * 协程挂起时才发送请求, 响应回来后:
+ * 1 发起调用的线程有正在运行的TC_CoroutineScheduler(比如协程模式的handle线程), 投递回这个调度线程中恢复
+ * 2 否则在通信器的异步回调线程中恢复
+ * 返回值和out参数在恢复时解码, 超时或者服务端返回错误时和同步调用一样抛异常
+ * 注意: 在调度线程中恢复的协程运行在调度器的主协程里, 不能再调用同步接口(会挂起整个线程), 请继续使用co_await
+ *
+ * R: 返回值类型, F: 解码返回值和out参数的函数(生成代码里的lambda)
+ */
+template<typename R, typename F>
+class ProxyAwaitable : public ReqAwaiter
+{
+public:
+	ProxyAwaitable(ServantProxy *prx, ReqMessage *msg, F &&decode)
+	: _prx(prx), _msg(msg), _decode(std::move(decode))
+	{
+	}
+
+	/**
+	 * 等待的状态在协程帧里, 不能拷贝和移动(C++17之后返回临时对象不需要拷贝)
+	 */
+	ProxyAwaitable(const ProxyAwaitable &) = delete;
+	ProxyAwaitable &operator=(const ProxyAwaitable &) = delete;
+
+	~ProxyAwaitable()
+	{
+		//没有co_await, 请求没有发出去
+		if(_msg)
+		{
+			delete _msg;
+		}
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		_handle = handle;
+
+		const std::shared_ptr<TC_CoroutineScheduler> &scheduler = TC_CoroutineScheduler::scheduler();
+		if(scheduler && scheduler->isReady())
+		{
+			this->sched = scheduler;
+		}
+
+		ReqMessage *msg = _msg;
+		_msg = NULL;
+
+		//发送以后可能马上在其他线程恢复协程, 之后不能再访问成员
+		_prx->tars_invoke_await(msg, this);
+	}
+
+	R await_resume()
+	{
+		ReqMessagePtr msg = _done;
+		_done = NULL;
+
+		_prx->tars_await_result(msg.get());
+
+		TarsInputStream<BufferReader> is;
+		is.setBuffer(msg->response->sBuffer);
+
+		return _decode(is);
+	}
+
+	virtual void resume(ReqMessage *msg)
+	{
+		_done = msg;
+
+		_handle.resume();
+	}
+
+protected:
+	ServantProxy            *_prx;
+	ReqMessage              *_msg;
+	ReqMessage              *_done = NULL;
+	F                       _decode;
+	std::coroutine_handle<> _handle;
+};
+
+template<typename R, typename F>
+ProxyAwaitable<R, F> makeAwaitable(ServantProxy *prx, ReqMessage *msg, F &&decode)
+{
+	return ProxyAwaitable<R, F>(prx, msg, std::forward<F>(decode));
+}
+
+template<typename T>
+class Task;
+
+/**
+ * Task的promise公共部分: 创建后不执行, 被co_await时才开始, 结束时切回等待它的协程(对称转移, 不增加调用栈)
+ */
+struct TaskPromiseBase
+{
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+
+		template<typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+		{
+			std::coroutine_handle<> continuation = handle.promise()._continuation;
+
+			return continuation ? continuation : std::noop_coroutine();
+		}
+
+		void await_resume() noexcept {}
+	};
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+
+	FinalAwaiter final_suspend() noexcept { return {}; }
+
+	void unhandled_exception() { _exception = std::current_exception(); }
+
+	void rethrow()
+	{
+		if(_exception)
+		{
+			std::rethrow_exception(_exception);
+		}
+	}
+
+	std::coroutine_handle<> _continuation;
+	std::exception_ptr      _exception;
+};
+
+template<typename T>
+struct TaskPromise : public TaskPromiseBase
+{
+	Task<T> get_return_object();
+
+	template<typename V>
+	void return_value(V &&value) { _value = std::forward<V>(value); }
+
+	T result()
+	{
+		rethrow();
+		return std::move(_value);
+	}
+
+	T _value{};
+};
+
+template<>
+struct TaskPromise<void> : public TaskPromiseBase
+{
+	Task<void> get_return_object();
+
+	void return_void() {}
+
+	void result() { rethrow(); }
+};
+
+/**
+ * 无栈协程的返回类型, 用于协程servant(XxxCoServant::co_xxx)和业务自己拆分的协程函数
+ *
+ * 用法:
+ * tars::Task<tars::Int32> co_testHello(tars::Int32 index, const std::string &s, std::string &r, tars::CurrentPtr current)
+ * {
+ *     co_await prx->co_testHello(index, s, r);
+ *     co_return 0;
+ * }
+ *
+ * 协程挂起时只保留协程帧(参数和跨co_await的局部变量), 不占用独立的栈
+ * 异常在co_await Task的地方重新抛出
+ */
+template<typename T>
+class Task
+{
+public:
+	typedef TaskPromise<T> promise_type;
+
+	explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle)
+	{
+	}
+
+	Task(Task &&task) noexcept : _handle(task._handle)
+	{
+		task._handle = nullptr;
+	}
+
+	Task(const Task &) = delete;
+	Task &operator=(const Task &) = delete;
+
+	~Task()
+	{
+		if(_handle)
+		{
+			_handle.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept { return false; }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+	{
+		_handle.promise()._continuation = continuation;
+
+		return _handle;
+	}
+
+	T await_resume() { return _handle.promise().result(); }
+
+protected:
+	std::coroutine_handle<promise_type> _handle;
+};
+
+template<typename T>
+inline Task<T> TaskPromise<T>::get_return_object()
+{
+	return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+	return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * 协程servant分发请求的根协程(tars2cpp生成), 创建后马上执行, 结束时自动释放
+ * 异常在生成代码里处理(coDispatchException), 这里不会再收到
+ */
+struct CoDispatch
+{
+	struct promise_type
+	{
+		CoDispatch get_return_object() noexcept { return CoDispatch(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+/**
+ * 协程servant的co_xxx抛异常, 和ServantHandle::handleTarsProtocol一样回包
+ * 已经回过包(例如async_response之后才抛异常)时不再回包, 避免一个请求回两次
+ */
+inline void coDispatchException(const CurrentPtr &current, std::exception_ptr ex)
+{
+	if (current->isResponseSent())
+	{
+		return;
+	}
+
+	int ret = TARSSERVERUNKNOWNERR;
+	std::string desc = "co dispatch unknown exception error";
+
+	try
+	{
+		std::rethrow_exception(ex);
+	}
+	catch(TarsDecodeException &e)
+	{
+		ret = TARSSERVERDECODEERR;
+		desc = e.what();
+	}
+	catch(TarsEncodeException &e)
+	{
+		ret = TARSSERVERENCODEERR;
+		desc = e.what();
+	}
+	catch(std::exception &e)
+	{
+		desc = e.what();
+	}
+	catch(...)
+	{
+	}
+
+	ResponsePacket response;
+	current->sendResponse(ret, response, Current::TARS_STATUS(), desc);
+}
+
+}
+
+#endif
+
+#endif
@@ -516,6 +516,12 @@ protected:
      */
     PropertyReportPtr        _reportAsyncQueue;
 
+    /*
+     * 合并发送节省的系统调用次数的上报对象, 以及上次上报时的累计值
+     */
+    PropertyReportPtr        _reportGatherSaved;
+    size_t                   _gatherSavedReported = 0;
+
     /*
      * 异步线程数目
      */
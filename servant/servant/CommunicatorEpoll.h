@@ -113,6 +113,51 @@ public:
         return _noSendQueueLimit;
     }
 
+    /**
+     * 是否开启合并发送(tcp连接上同一批请求通过一次writev发送)
+     */
+    inline bool isGatherWrite()
+    {
+        return _gatherWrite;
+    }
+
+    /**
+     * 是否正在批量处理业务线程投递的请求, 此时请求先积攒, 处理完后统一发送
+     */
+    inline bool isGathering()
+    {
+        return _gathering;
+    }
+
+    /**
+     * 登记本批需要统一发送的节点
+     * @param adapterProxy
+     */
+    inline void addGatherAdapter(AdapterProxy* adapterProxy)
+    {
+        _gatherAdapters.push_back(adapterProxy);
+    }
+
+    /**
+     * 合并发送累计节省的发送系统调用次数
+     */
+    inline size_t getGatherSaved()
+    {
+        return _gatherSaved;
+    }
+
+    /**
+     * 累加合并发送节省的发送系统调用次数
+     * @param n
+     */
+    inline void addGatherSaved(size_t n)
+    {
+        if(n > 0)
+        {
+            _gatherSaved += n;
+        }
+    }
+
     /*
      * 判断是否是第一个网络线程 主控写缓存的时候用到
      */
@@ -153,8 +198,9 @@ public:
     /**
      * 注册fd对应的处理handle
      * @param adapterProxy
+     * @param trans, adapterProxy的某个连接
      */
-    void addFd(AdapterProxy* adapterProxy);
+    void addFd(AdapterProxy* adapterProxy, TC_Transceiver *trans);
 
     /**
      * 通知事件过来
@@ -175,6 +221,12 @@ public:
      */
     inline void pushAsyncThreadQueue(ReqMessage * msg) { _communicator->pushAsyncThreadQueue(msg); }
 
+    /**
+     * co_await的请求完成, 恢复等待的协程(发起调用的调度线程或者异步回调线程中)
+     * @param msg
+     */
+    void finishAwait(ReqMessage * msg);
+
 	/**
 	 * set reconnect
 	 * @param time
@@ -266,25 +318,30 @@ protected:
      * 输入事件
      * @param pi
      */
-    bool handleCloseImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data);
+    bool handleCloseImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans);
 
     /**
      * 输入事件
      * @param pi
      */
-    bool handleInputImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data);
+    bool handleInputImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans);
 
     /**
      * 输出事件
      * @param pi
      */
-    bool handleOutputImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data);
+    bool handleOutputImp(const std::shared_ptr<TC_Epoller::EpollInfo> &data, TC_Transceiver *trans);
 
     /**
      * 处理notify
      */
     bool handleNotify(const std::shared_ptr<TC_Epoller::EpollInfo> & data);
 
+    /**
+     * 合并发送模式下, 把本批积攒的请求统一发送出去
+     */
+    void flushGatherAdapters();
+
     /**
      * 处理超时
      * @param pi
@@ -419,6 +476,31 @@ protected:
      */
     int64_t                _timeoutCheckInterval;
 
+    /*
+     * 是否开启合并发送
+     */
+    bool                   _gatherWrite = false;
+
+    /*
+     * 网络线程epoller定时器的实现(请求超时等)
+     */
+    TC_TimerBase::TIMER_TYPE _timerType = TC_TimerBase::TIMER_MAP;
+
+    /*
+     * 是否正在批量处理请求
+     */
+    bool                   _gathering = false;
+
+    /*
+     * 本批需要统一发送的节点
+     */
+    std::vector<AdapterProxy*> _gatherAdapters;
+
+    /*
+     * 合并发送节省的系统调用次数(网络线程累加, 统计线程读取)
+     */
+    std::atomic<size_t>    _gatherSaved{0};
+
     /**
      * auto reconnect TC_Transceiver
      */
@@ -21,6 +21,7 @@
 #include "tup/RequestF.h"
 #include "tup/tup.h"
 #include "servant/BaseF.h"
+#include "util/tc_arena.h"
 
 namespace tars
 {
@@ -100,6 +101,12 @@ public:
      */
     void setResponse(bool value) { _response = value; }
 
+    /**
+     * 是否已经调用sendResponse回过包
+     * @return bool
+     */
+    bool isResponseSent() const { return _responseSent; }
+
     /**
      * 设置返回的context(仅TARS协议有效)
      */
@@ -132,6 +139,18 @@ public:
      */
     const std::vector<char> &getRequestBuffer() const;
 
+    /**
+     * 获取请求buffer首地址(tars协议时直接引用接收到的数据, 不做copy)
+     * @return const char*
+     */
+    const char *getRequestData() const;
+
+    /**
+     * 获取请求buffer长度
+     * @return size_t
+     */
+    size_t getRequestLength() const;
+
     /**
      * 获取服务Servant名称
      * @return std::string
@@ -161,7 +180,7 @@ public:
      * 函数名称(仅TARS协议有效)
      * @return std::string
      */
-    std::string getFuncName() const;
+    const std::string &getFuncName() const;
 
     /**
      * 请求ID(仅TARS协议有效)
@@ -195,7 +214,14 @@ public:
 	 * 获取RequestPacket
 	 * @return
 	 */
-	const RequestPacket &getBasePacket() const { return _request; }
+	const RequestPacket &getBasePacket() const { getRequestBuffer(); return _request; }
+
+	/**
+	 * 请求的arena, 第一次调用时创建, Current释放时整体释放
+	 * tars2cpp --arena生成的代码把解码的参数分配在上面
+	 * @return
+	 */
+	TC_Arena *getArena();
 
     /**
      * tars协议的发送响应数据(仅TARS协议有效)
@@ -296,6 +322,13 @@ protected:
      */
     void initialize(const std::vector<char> &sRecvBuffer);
 
+    /**
+     * 初始化, 请求包体sBuffer不copy, 直接引用buff(buff的生命周期由_data保证)
+     * @param buff
+     * @param length
+     */
+    void initialize(const char *buff, size_t length);
+
     /**
      * 服务端上报状态，针对单向调用及WUP调用(仅对TARS协议有效)
      */
@@ -330,14 +363,30 @@ protected:
 
     /**
      * 客户端请求包
+     * sBuffer在getRequestBuffer/getBasePacket第一次调用时才从_requestData填充, 所以是mutable, 其他字段在initialize之后不再修改
+     */
+    mutable RequestPacket    _request;
+
+    /**
+     * 请求包体(tars协议), 指向接收到的数据, _request.sBuffer在需要时才copy
      */
-    RequestPacket            _request;
+    const char *             _requestData = NULL;
+
+    /**
+     * 请求包体长度
+     */
+    size_t                   _requestLength = 0;
 
     /**
      * 响应
      */
     bool                    _response;
 
+    /**
+     * 已经回过包
+     */
+    bool                    _responseSent = false;
+
     /**
      * 接口处理的返回值
      */
@@ -365,6 +414,11 @@ protected:
     
     bool                	_traceCall;
     std::string              	_traceKey;
+
+    /**
+     * 请求的arena
+     */
+    std::unique_ptr<TC_Arena> _arena;
 };
 //////////////////////////////////////////////////////////////
 }
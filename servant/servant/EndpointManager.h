@@ -45,6 +45,8 @@ enum  EndpointWeightType
 {
     E_LOOP          = 0,
     E_STATIC_WEIGHT = 1,
+    E_LEAST_ACTIVE  = 2,    //随机选两个节点, 取在途请求少的(power of two choices)
+    E_LATENCY_EWMA  = 3,    //随机选两个节点, 取响应时间滑动平均*在途请求数小的
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -185,6 +187,12 @@ private:
      */
     virtual void onUpdateOutter() {};
 
+protected:
+    /*
+     * 节点上配置的权重类型(EndpointF::weightType, 或者endpoint的-v)转换成路由策略
+     */
+    static EndpointWeightType toWeightType(int iWeightType);
+
 protected:
 
     /*
@@ -384,6 +392,12 @@ private:
      */
     AdapterProxy * getNextValidProxy();
 
+    /*
+     * 随机选两个可用结点, 取负载小的一个
+     * @param bLatency, true: 按响应时间滑动平均*在途请求数比较, false: 按在途请求数比较
+     */
+    AdapterProxy * getP2CProxy(bool bLatency);
+
     /*
      * 根据hash值选取一个结点
      */
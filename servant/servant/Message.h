@@ -132,6 +132,28 @@ struct ThreadPrivateData
 };
 
 struct ReqMonitor;
+struct ReqMessage;
+
+/**
+ * 异步请求的等待者(C++20 co_await), 和ServantProxyCallback不同, 通常直接放在协程帧里, 不需要额外分配
+ * 响应回来(或者超时/异常)时:
+ * sched不为空, 投递到发起调用的调度线程中调用resume, 否则在异步回调线程中调用resume
+ */
+struct ReqAwaiter
+{
+	virtual ~ReqAwaiter() {}
+
+	/**
+	 * 请求完成, 恢复等待的协程
+	 * @param msg, 完成的请求, 由等待者负责释放
+	 */
+	virtual void resume(ReqMessage *msg) = 0;
+
+	/**
+	 * 发起调用的调度器
+	 */
+	std::shared_ptr<TC_CoroutineScheduler> sched;
+};
 
 struct ReqMessage : public TC_HandleBase
 {
@@ -185,6 +207,20 @@ struct ReqMessage : public TC_HandleBase
      */
     void init(CallType eCallType, ServantProxy *proxy);
 
+    /*
+     * 开启/关闭池化分配: ReqMessage和ReqMonitor从线程缓存中分配, 网络线程释放时归还给分配的业务线程
+     */
+    static void setPooled(bool pooled);
+
+    /*
+     * 是否开启池化分配
+     */
+    static bool isPooled();
+
+    static void *operator new(size_t size);
+
+    static void operator delete(void *p);
+
     ReqStatus                   eStatus;        //调用的状态
     CallType                    eType;          //调用类型
     bool                        bFromRpc        = false;       //是否是第三方协议的rcp_call，缺省为false
@@ -195,6 +231,7 @@ struct ReqMessage : public TC_HandleBase
     ServantProxy                *proxy          = NULL;
     ObjectProxy                 *pObjectProxy   = NULL;  //调用端的proxy对象
     AdapterProxy                *adapter        = NULL;       //调用的adapter
+    int                         iConnIndex      = -1;         //连接池模式下发送请求的连接下标, -1表示还没有发送
 
 	ReqMonitor                  *pMonitor       = NULL;      //用于同步的monitor
 
@@ -209,6 +246,8 @@ struct ReqMessage : public TC_HandleBase
     std::shared_ptr<TC_CoroutineScheduler>      sched;
     int                         iCoroId         = 0;
 
+    ReqAwaiter                  *awaiter        = NULL;     //co_await调用的等待者(不使用callback)
+
     std::function<void()>       deconstructor;  //析构时调用
 
     ThreadPrivateData           data;     //线程数据
@@ -228,6 +267,10 @@ struct ReqMonitor
 
 	void wait();
 	void notify();
+
+	static void *operator new(size_t size);
+
+	static void operator delete(void *p);
 };
 
 typedef TC_AutoPtr<ReqMessage>  ReqMessagePtr;
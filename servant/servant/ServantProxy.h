@@ -759,6 +759,15 @@ public:
         PROTOCOL_GRPC,              //grpc协议
     };
 
+    /**
+     * 连接池模式下选择连接的策略
+     */
+    enum CONNECTION_SELECT
+    {
+        CONNECTION_ROUND_ROBIN,     //轮询
+        CONNECTION_LEAST_PENDING,   //在途请求最少的连接
+    };
+
     /**
      * 代理设置
      */
@@ -921,6 +930,28 @@ public:
 	 */
 	int tars_connection_serial() const;
 
+	/**
+	 * 设置每个节点建立的连接个数(连接复用模式下有效), 请求分散到多个连接上, 避免一个连接的socket buffer或者大包响应堵塞其他请求
+	 * 多个连接共用一个节点的状态和统计, 需要在发起调用前设置
+	 * 只对请求编码与连接无关的协议有效(ProxyProtocol::connectionPool, 比如tars), http2/grpc仍然只用一个连接
+	 * 也可以在客户端配置的obj中配置: connections=N, connselect=least(默认rr)
+	 * @param connectionNum, <=1: 一个连接(默认)
+	 * @param select, 选择连接的策略
+	 */
+	void tars_connection_pool(int connectionNum, CONNECTION_SELECT select = CONNECTION_ROUND_ROBIN);
+
+	/**
+	 * 每个节点的连接个数
+	 * @return int
+	 */
+	int tars_connection_num() const;
+
+	/**
+	 * 选择连接的策略
+	 * @return CONNECTION_SELECT
+	 */
+	CONNECTION_SELECT tars_connection_select() const;
+
 	/**
 	 * 直接设置内置支持的协议
 	 */
@@ -1081,6 +1112,15 @@ public:
                             const std::map<std::string, std::string>& context,
                             const std::map<std::string, std::string>& status);
 
+    /**
+     * TARS协议同步方法调用, context/status直接move到请求包里
+     */
+    std::shared_ptr<ResponsePacket> tars_invoke(char cPacketType,
+                            const std::string& sFuncName,
+                            tars::TarsOutputStream<tars::BufferWriterVector>& buf,
+                            std::map<std::string, std::string>&& context,
+                            std::map<std::string, std::string>&& status);
+
     /**
      * TARS协议同步方法调用
      */
@@ -1101,6 +1141,17 @@ public:
                                   const ServantProxyCallbackPtr& callback,
                                   bool bCoro = false);
 
+    /**
+     * TARS协议异步方法调用, context/status直接move到请求包里
+     */
+    void tars_invoke_async(char cPacketType,
+                                  const std::string& sFuncName,
+                                  tars::TarsOutputStream<tars::BufferWriterVector> &buf,
+                                  std::map<std::string, std::string>&& context,
+                                  std::map<std::string, std::string>&& status,
+                                  const ServantProxyCallbackPtr& callback,
+                                  bool bCoro = false);
+
     /**
      * TARS协议异步方法调用
      */
@@ -1111,6 +1162,29 @@ public:
                                   const std::map<std::string, std::string>& status,
                                   const ServantProxyCallbackPtr& callback,
                                   bool bCoro = false);
+
+    /**
+     * TARS协议co_await调用(C++20协程, 见servant/Awaitable.h): 创建请求, 协程挂起时再由tars_invoke_await发送
+     * 染色/调用链/cookie在这里取当前线程的数据
+     * @return 请求, 发送前由调用者释放
+     */
+    ReqMessage *tars_new_await(char cPacketType,
+                                  const std::string& sFuncName,
+                                  tars::TarsOutputStream<tars::BufferWriterVector> &buf,
+                                  std::map<std::string, std::string>&& context,
+                                  std::map<std::string, std::string>&& status);
+
+    /**
+     * 发送co_await请求, 完成时调用awaiter->resume(msg)
+     * 发送失败抛异常, msg已经释放
+     */
+    void tars_invoke_await(ReqMessage *msg, ReqAwaiter *awaiter);
+
+    /**
+     * 检查co_await请求的结果, 和同步调用一样, 超时或者服务端返回错误时抛异常
+     */
+    void tars_await_result(ReqMessage *msg);
+
 	/**
 	 * 获取所有objectproxy(包括子servant), 该函数主要给自动测试使用!
 	 * @return
@@ -1258,6 +1332,16 @@ private:
      */
     int                         _connectionSerial = 0;
 
+    /**
+     * 每个节点的连接个数(连接复用模式)
+     */
+    int                         _connectionNum = 1;
+
+    /**
+     * 选择连接的策略
+     */
+    CONNECTION_SELECT           _connectionSelect = CONNECTION_ROUND_ROBIN;
+
     /**
      * 短连接使用http使用
      */
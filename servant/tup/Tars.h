@@ -26,6 +26,7 @@
 #include <string>
 #include <stdexcept>
 #include <functional>
+#include <algorithm>
 #include <stdint.h>
 #include <string.h>
 #include <limits.h>
@@ -80,19 +81,29 @@
 #define TarsHeadeZeroTag 12
 #define TarsHeadeSimpleList 13
 
+//跳过未知字段时允许的最大嵌套层数, 防止构造的数据包层层嵌套导致栈溢出
+#ifndef TARS_MAX_SKIP_DEPTH
+#define TARS_MAX_SKIP_DEPTH 100
+#endif
+
+#ifdef __APPLE__
+#include "TarsBulk.h"
+#elif defined ANDROID  // android
+#include "TarsBulk.h"
+#else
+#include "tup/TarsBulk.h"
+#endif
 
 //////////////////////////////////////////////////////////////////
 //// 保留接口版本Tars宏定义
 //编码相应的宏
 
+//写入后的长度为len, 空间不够时调用writer的reserveBuf(need), need是这次还要写入的字节数
 #define TarsReserveBuf(os, len) \
 do{ \
     if(tars_likely((os)._buf_len < (len))) \
     { \
-        size_t len1 = (len)<<1; \
-        if(len1<128) len1=128; \
-        (os)._buf = (os)._reserve(os, len1); \
-        (os)._buf_len = (len1); \
+        (os).reserveBuf((len) - (os)._len); \
     } \
 }while(0)
 
@@ -401,6 +412,64 @@ struct TarsNotEnoughBuff : public TarsProtoException
 	TarsNotEnoughBuff(const std::string & s) : TarsProtoException(s) {}
 };
 
+//////////////////////////////////////////////////////////////////
+/**
+ * 指向解码buffer中一段数据的视图, 不拥有内存, 只在解码的buffer有效期间可用
+ * tars2cpp --view生成的XxxView结构体用它代替std::string/vector<char>, 解码时不分配内存也不拷贝
+ */
+class TarsBufferView
+{
+public:
+	TarsBufferView() : _data(""), _size(0) {}
+	TarsBufferView(const char *data, size_t size) : _data(data), _size(size) {}
+	TarsBufferView(const char *data) : _data(data), _size(strlen(data)) {}
+	TarsBufferView(const std::string &s) : _data(s.data()), _size(s.size()) {}
+
+	void assign(const char *data, size_t size) { _data = data; _size = size; }
+	const char *data() const    { return _data; }
+	size_t size() const         { return _size; }
+	size_t length() const       { return _size; }
+	bool empty() const          { return _size == 0; }
+	void clear()                { _data = ""; _size = 0; }
+
+	/// 需要长期保存时拷贝出来
+	std::string str() const     { return std::string(_data, _size); }
+
+	int compare(const TarsBufferView &v) const
+	{
+		int r = memcmp(_data, v._data, _size < v._size ? _size : v._size);
+		if (r != 0) return r;
+		return _size < v._size ? -1 : (_size > v._size ? 1 : 0);
+	}
+
+protected:
+	const char *_data;
+	size_t      _size;
+};
+
+inline bool operator==(const TarsBufferView &l, const TarsBufferView &r) { return l.size() == r.size() && memcmp(l.data(), r.data(), l.size()) == 0; }
+inline bool operator!=(const TarsBufferView &l, const TarsBufferView &r) { return !(l == r); }
+inline bool operator<(const TarsBufferView &l, const TarsBufferView &r) { return l.compare(r) < 0; }
+inline std::ostream& operator<<(std::ostream &os, const TarsBufferView &v) { return os.write(v.data(), v.size()); }
+
+/// 对应string字段
+class TarsStringView : public TarsBufferView
+{
+public:
+	using TarsBufferView::TarsBufferView;
+	TarsStringView() {}
+};
+
+/// 对应vector<byte>字段
+class TarsBytesView : public TarsBufferView
+{
+public:
+	using TarsBufferView::TarsBufferView;
+	TarsBytesView() {}
+
+	std::vector<char> toVector() const { return std::vector<char>(_data, _data + _size); }
+};
+
 //////////////////////////////////////////////////////////////////
 namespace
 {
@@ -705,6 +774,64 @@ public:
 	size_t              _cur_m;        ///< 当前位置
 };
 
+//解码时SimpleList编码的vector<char>字段不copy, 只记录它在缓冲区中的位置, 缓冲区的生命周期由调用者保证
+//用于RequestPacket这类只有一个vector<char>包体字段的结构, 直接复用生成的readFrom:
+//TarsInputStream<BufferReaderView> is;
+//is.setBuffer(buf, len);
+//req.readFrom(is);
+//之后req.sBuffer为空, 包体是is.viewData()/is.viewLength(); 包体按List编码时(兼容)照常解码到sBuffer, viewData()为NULL
+class BufferReaderView : public BufferReader
+{
+private:
+	BufferReaderView(const BufferReaderView&);
+
+	BufferReaderView& operator=(const BufferReaderView&);
+
+public:
+	BufferReaderView() : _view(NULL), _view_len(0) {}
+
+	void reset() { _view = NULL; _view_len = 0; BufferReader::reset();}
+
+	using BufferReader::readBuf;
+
+	/// 读取vector<char>: 不copy, 记录位置
+	template <typename Alloc>
+	void readBuf(std::vector<Char, Alloc>& v, size_t len)
+	{
+		const char *view = _buf + _cur;
+		skip(len);
+
+		v.clear();
+		_view = view;
+		_view_len = len;
+	}
+
+	/// 设置缓存
+	void setBuffer(const char * buf, size_t len)
+	{
+		_view = NULL;
+		_view_len = 0;
+		BufferReader::setBuffer(buf, len);
+	}
+
+	/// 设置缓存
+	template<typename Alloc>
+	void setBuffer(const std::vector<char,Alloc> &buf)
+	{
+		setBuffer(buf.data(), buf.size());
+	}
+
+	/// vector<char>字段的首地址, 没有读到为NULL
+	const char *viewData() const { return _view; }
+
+	/// vector<char>字段的长度
+	size_t viewLength() const { return _view_len; }
+
+protected:
+	const char *        _view;
+	size_t              _view_len;
+};
+
 //////////////////////////////////////////////////////////////////
 /// 缓冲区写入器封装
 class BufferWriter
@@ -739,6 +866,31 @@ public:
 	}
 
 	void reset() { _len = 0;}
+	/**
+	 * 按编码后的精确大小一次分配好(一般是tars_encoded_size()), 编码过程中不再扩容
+	 * 算大小要把数据遍历一遍: 平铺的数据(数值, string, vector<byte>)或者大的数据划算,
+	 * 小的嵌套结构体(几百字节)比按容量倍增扩容还慢, 见test_tars_encode.cpp的compareEncode
+	 * 其他writer的reserveExact语义相同
+	 * @param len: 在当前长度之后还要写入的字节数
+	 */
+	void reserveExact(size_t len)
+	{
+		if(_buf_len < _len + len)
+		{
+			_buf = _reserve(*this, _len + len);
+			_buf_len = _len + len;
+		}
+	}
+	/**
+	 * TarsReserveBuf空间不够时调用: 保证在当前长度之后还能连续写入need字节, 按写入后长度的两倍(至少128)扩容
+	 * @param need
+	 */
+	void reserveBuf(size_t need)
+	{
+		size_t len = std::max((_len + need) << 1, (size_t)128);
+		_buf = _reserve(*this, len);
+		_buf_len = len;
+	}
 	void writeBuf(const char * buf, size_t len)
 	{
 		TarsReserveBuf(*this, _len + len);
@@ -796,6 +948,24 @@ public:
 
 	void reset() { _len = 0;}
 
+	/** 见BufferWriter::reserveExact */
+	void reserveExact(size_t len)
+	{
+		if(_buf_len < _len + len)
+		{
+			_buf = _reserve(*this, _len + len);
+			_buf_len = _len + len;
+		}
+	}
+
+	/** 见BufferWriter::reserveBuf */
+	void reserveBuf(size_t need)
+	{
+		size_t len = std::max((_len + need) << 1, (size_t)128);
+		_buf = _reserve(*this, len);
+		_buf_len = len;
+	}
+
 	void writeBuf(const char * buf, size_t len)
 	{
 		TarsReserveBuf(*this, _len + len);
@@ -869,6 +1039,24 @@ public:
 
 	void reset() { _len = 0;}
 
+	/** 见BufferWriter::reserveExact */
+	void reserveExact(size_t len)
+	{
+		if(_buf_len < _len + len)
+		{
+			_buf = _reserve(*this, _len + len);
+			_buf_len = _len + len;
+		}
+	}
+
+	/** 见BufferWriter::reserveBuf */
+	void reserveBuf(size_t need)
+	{
+		size_t len = std::max((_len + need) << 1, (size_t)128);
+		_buf = _reserve(*this, len);
+		_buf_len = len;
+	}
+
 	void writeBuf(const char * buf, size_t len)
 	{
 		TarsReserveBuf(*this, _len + len);
@@ -905,6 +1093,233 @@ public:
 	}
 };
 
+/// 实际buffer由调用者提供, 编码直接写到调用者的内存里(比如共享内存, 网络发送缓存)
+/// 空间不够时抛TarsEncodeException, 一般先用tars_encoded_size()算好需要的大小
+class BufferWriterFixed
+{
+public:
+	char *  _buf;
+	size_t  _len;
+	size_t  _buf_len;
+	std::function<char*(BufferWriterFixed &, size_t)>  _reserve = BufferWriterFixed::reserve;
+
+	static char* reserve(BufferWriterFixed &os, size_t len)
+	{
+		char ss[128];
+		snprintf(ss, sizeof(ss), "buffer overflow when encoding, capacity: %u, need: %u", (uint32_t)os._buf_len, (uint32_t)len);
+		throw TarsEncodeException(ss);
+	}
+
+private:
+	BufferWriterFixed(const BufferWriterFixed&);
+	BufferWriterFixed& operator=(const BufferWriterFixed& buf);
+
+public:
+	BufferWriterFixed()
+		: _buf(NULL)
+		, _len(0)
+		, _buf_len(0)
+	{}
+
+	/**
+	 * 设置调用者的buffer, 不管理它的生命周期
+	 * @param buf
+	 * @param len: buffer的容量
+	 */
+	void setBuffer(char *buf, size_t len)
+	{
+		_buf = buf;
+		_buf_len = len;
+		_len = 0;
+	}
+
+	void reset() { _len = 0;}
+	/** 见BufferWriter::reserveExact */
+	void reserveExact(size_t len)
+	{
+		if(_buf_len < _len + len)
+		{
+			_buf = _reserve(*this, _len + len);
+		}
+	}
+	/** 见BufferWriter::reserveBuf, 容量固定, 放不下时抛异常 */
+	void reserveBuf(size_t need)
+	{
+		_buf = _reserve(*this, _len + need);
+	}
+	void writeBuf(const char * buf, size_t len)
+	{
+		TarsReserveBuf(*this, _len + len);
+		memcpy(_buf + _len, buf, len);
+		_len += len;
+	}
+	const char * getBuffer() const               { return _buf;}
+	size_t getLength() const                     { return _len;}
+};
+
+/// 编码到一串分段的buffer里, 大的应答不需要一整块连续内存, 也没有扩容时的copy
+/// 小的写入直接写当前段, 放不下时封存当前段, 在新段里接着写; 大块数据(writeBuf)按段切开copy
+/// 编码完用detach取出各段(new[]分配, 一般交给TC_NetWorkBuffer::Buffer::replaceBuffer管理)
+class BufferWriterChain
+{
+public:
+	char *  _buf;
+	size_t  _len;               //当前段已写的长度
+	size_t  _buf_len;           //当前段的容量
+
+	/**
+	 * TarsReserveBuf空间不够时调用: 保证当前段还能连续写入need字节
+	 * 放不下时封存当前段(之前的数据留在里面), 从新段的开头继续写, 新段按段的大小分配, 单次写入更大时按写入的大小
+	 * @param need
+	 */
+	void reserveBuf(size_t need)
+	{
+		if(_buf_len - _len >= need)
+		{
+			return;
+		}
+
+		seal();
+		_buf_len = std::max(_segmentSize, need);
+		_buf = new char[_buf_len];
+	}
+
+private:
+	BufferWriterChain(const BufferWriterChain&);
+	BufferWriterChain& operator=(const BufferWriterChain& buf);
+
+public:
+	BufferWriterChain()
+		: _buf(NULL)
+		, _len(0)
+		, _buf_len(0)
+		, _total(0)
+		, _segmentSize(64 * 1024)
+	{}
+
+	~BufferWriterChain()
+	{
+		clear();
+		delete[] _buf;
+	}
+
+	/**
+	 * 设置每段的大小, 在写入之前设置
+	 * @param size
+	 */
+	void setSegmentSize(size_t size) { _segmentSize = std::max(size, (size_t)128); }
+
+	void reset() { clear(); }
+
+	/**
+	 * 分段写入, 不需要预先分配
+	 * @param len
+	 */
+	void reserveExact(size_t len) {}
+
+	void writeBuf(const char * buf, size_t len)
+	{
+		while(true)
+		{
+			size_t n = std::min(len, _buf_len - _len);
+			if(n > 0)
+			{
+				memcpy(_buf + _len, buf, n);
+				_len += n;
+				buf += n;
+				len -= n;
+			}
+			if(len == 0)
+			{
+				break;
+			}
+			seal();
+			_buf_len = _segmentSize;
+			_buf = new char[_buf_len];
+		}
+	}
+
+	/**
+	 * 覆盖已经写入的数据(比如最后填写包头的长度), 可以跨段
+	 * @param offset
+	 * @param buf
+	 * @param len
+	 */
+	void patch(size_t offset, const char *buf, size_t len)
+	{
+		if(offset + len > getLength())
+		{
+			throw TarsEncodeException("patch out of range");
+		}
+		for(size_t i = 0; i <= _segments.size() && len > 0; i++)
+		{
+			char *seg = i < _segments.size() ? _segments[i].first : _buf;
+			size_t segLen = i < _segments.size() ? _segments[i].second : _len;
+			if(offset >= segLen)
+			{
+				offset -= segLen;
+				continue;
+			}
+			size_t n = std::min(len, segLen - offset);
+			memcpy(seg + offset, buf, n);
+			buf += n;
+			len -= n;
+			offset = 0;
+		}
+	}
+
+	/**
+	 * 取出所有段, 所有权交给调用者(delete[]释放), writer被清空
+	 * @param segments: <段首地址, 段长度>
+	 */
+	void detach(std::vector<std::pair<char*, size_t> > &segments)
+	{
+		seal();
+		segments.swap(_segments);
+		_segments.clear();
+		_total = 0;
+	}
+
+	size_t getLength() const            { return _total + _len;}
+	size_t getSegmentCount() const      { return _segments.size() + (_len > 0 ? 1 : 0);}
+
+protected:
+	/**
+	 * 封存当前段
+	 */
+	void seal()
+	{
+		if(_len > 0)
+		{
+			_segments.push_back(std::make_pair(_buf, _len));
+			_total += _len;
+		}
+		else
+		{
+			delete[] _buf;
+		}
+		_buf = NULL;
+		_len = 0;
+		_buf_len = 0;
+	}
+
+	void clear()
+	{
+		for(size_t i = 0; i < _segments.size(); i++)
+		{
+			delete[] _segments[i].first;
+		}
+		_segments.clear();
+		_total = 0;
+		_len = 0;
+	}
+
+protected:
+	size_t  _total;             //已封存的段的总长度
+	size_t  _segmentSize;
+	std::vector<std::pair<char*, size_t> > _segments;
+};
+
 //////////////////////////////////////////////////////////////////
 template<typename ReaderT = BufferReader>
 class TarsInputStream : public ReaderT
@@ -992,6 +1407,7 @@ public:
 				break;
 			case TarsHeadeMap:
 			{
+				SkipDepthGuard guard(_skipDepth);
 				UInt32 size = 0;
 				read(size, 0);
 				for (UInt32 i = 0; i < size * 2; ++i)
@@ -1000,6 +1416,7 @@ public:
 				break;
 			case TarsHeadeList:
 			{
+				SkipDepthGuard guard(_skipDepth);
 				UInt32 size = 0;
 				read(size, 0);
 				for (UInt32 i = 0; i < size; ++i)
@@ -1022,7 +1439,10 @@ public:
 			}
 				break;
 			case TarsHeadeStructBegin:
+			{
+				SkipDepthGuard guard(_skipDepth);
 				skipToStructEnd();
+			}
 				break;
 			case TarsHeadeStructEnd:
 			case TarsHeadeZeroTag:
@@ -1368,58 +1788,138 @@ public:
 		}
 	}
 
-	void read(char *buf, const UInt32 bufLen, UInt32 & readLen, uint8_t tag, bool isRequire = true)
+	/// 直接指向buffer, 不拷贝
+	void read(TarsStringView& s, uint8_t tag, bool isRequire = true)
 	{
 		uint8_t headType = 0, headTag = 0;
 		bool skipFlag = false;
 		TarsSkipToTag(skipFlag, tag, headType, headTag);
 		if (tars_likely(skipFlag))
 		{
-			switch(headType)
+			uint32_t strLength = 0;
+			switch (headType)
 			{
-				case TarsHeadeSimpleList:
+				case TarsHeadeString1:
 				{
-					uint8_t hheadType, hheadTag;
-					readFromHead(*this, hheadType, hheadTag);
-					if (tars_unlikely(hheadType != TarsHeadeChar))
-					{
-						char s[128];
-						snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d, %d, %d", tag, headType, hheadType, hheadTag);
-						throw TarsDecodeMismatch(s);
-					}
-					UInt32 size = 0;
-					read(size, 0);
-					if (tars_unlikely(size > bufLen))
+					TarsReadTypeBuf(*this, strLength, uint8_t);
+				}
+					break;
+				case TarsHeadeString4:
+				{
+					TarsReadTypeBuf(*this, strLength, uint32_t);
+					strLength = ntohl(strLength);
+					if (tars_unlikely(strLength > TARS_MAX_STRING_LENGTH))
 					{
 						char s[128];
-						snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, %d, size: %d", tag, headType, hheadType, size);
+						snprintf(s, sizeof(s), "invalid string size, tag: %d, size: %d, headTag: %d", tag, strLength, headTag);
 						throw TarsDecodeInvalidValue(s);
 					}
-					//TarsReadTypeBuf(*this, size, UInt32);
-					this->readBuf(buf, size);
-					readLen = size;
 				}
 					break;
-
 				default:
 				{
-					char s[128];
-					snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d", tag, headType);
+					char s[64];
+					snprintf(s, sizeof(s), "read 'string' type mismatch, tag: %d, get type: %d, tag: %d.", tag, headType, headTag);
 					throw TarsDecodeMismatch(s);
 				}
 			}
+			const char *p = this->base() + this->tellp();
+			this->skip(strLength);
+			s.assign(p, strLength);
 		}
 		else if (tars_unlikely(isRequire))
 		{
-			char s[128];
-			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			char s[64];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d", tag);
 			throw TarsDecodeRequireNotExist(s);
 		}
 	}
 
-
-	template<typename K, typename V, typename Cmp, typename Alloc>
-	void read(std::map<K, V, Cmp, Alloc>& m, uint8_t tag, bool isRequire = true)
+	/// 直接指向buffer, 不拷贝, 只支持SimpleList编码(vector<byte>都是这样编码的)
+	void read(TarsBytesView& v, uint8_t tag, bool isRequire = true)
+	{
+		uint8_t headType = 0, headTag = 0;
+		bool skipFlag = false;
+		TarsSkipToTag(skipFlag, tag, headType, headTag);
+		if (tars_likely(skipFlag))
+		{
+			uint8_t hheadType = 0, hheadTag = 0;
+			if (tars_likely(headType == TarsHeadeSimpleList))
+			{
+				readFromHead(*this, hheadType, hheadTag);
+			}
+			if (tars_unlikely(headType != TarsHeadeSimpleList || hheadType != TarsHeadeChar))
+			{
+				char s[128];
+				snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d, %d, %d", tag, headType, hheadType, hheadTag);
+				throw TarsDecodeMismatch(s);
+			}
+			UInt32 size = 0;
+			read(size, 0);
+			const char *p = this->base() + this->tellp();
+			this->skip(size);
+			v.assign(p, size);
+		}
+		else if (tars_unlikely(isRequire))
+		{
+			char s[128];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			throw TarsDecodeRequireNotExist(s);
+		}
+	}
+
+	void read(char *buf, const UInt32 bufLen, UInt32 & readLen, uint8_t tag, bool isRequire = true)
+	{
+		uint8_t headType = 0, headTag = 0;
+		bool skipFlag = false;
+		TarsSkipToTag(skipFlag, tag, headType, headTag);
+		if (tars_likely(skipFlag))
+		{
+			switch(headType)
+			{
+				case TarsHeadeSimpleList:
+				{
+					uint8_t hheadType, hheadTag;
+					readFromHead(*this, hheadType, hheadTag);
+					if (tars_unlikely(hheadType != TarsHeadeChar))
+					{
+						char s[128];
+						snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d, %d, %d", tag, headType, hheadType, hheadTag);
+						throw TarsDecodeMismatch(s);
+					}
+					UInt32 size = 0;
+					read(size, 0);
+					if (tars_unlikely(size > bufLen))
+					{
+						char s[128];
+						snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, %d, size: %d", tag, headType, hheadType, size);
+						throw TarsDecodeInvalidValue(s);
+					}
+					//TarsReadTypeBuf(*this, size, UInt32);
+					this->readBuf(buf, size);
+					readLen = size;
+				}
+					break;
+
+				default:
+				{
+					char s[128];
+					snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d", tag, headType);
+					throw TarsDecodeMismatch(s);
+				}
+			}
+		}
+		else if (tars_unlikely(isRequire))
+		{
+			char s[128];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			throw TarsDecodeRequireNotExist(s);
+		}
+	}
+
+
+	template<typename K, typename V, typename Cmp, typename Alloc>
+	void read(std::map<K, V, Cmp, Alloc>& m, uint8_t tag, bool isRequire = true)
 	{
 		uint8_t headType = 0, headTag = 0;
 		bool skipFlag = false;
@@ -1445,7 +1945,7 @@ public:
 						std::pair<K, V> pr;
 						read(pr.first, 0);
 						read(pr.second, 1);
-						m.insert(pr);
+						m.insert(std::move(pr));
 					}
 				}
 					break;
@@ -1492,7 +1992,7 @@ public:
 						std::pair<K, V> pr;
 						read(pr.first, 0);
 						read(pr.second, 1);
-						m.insert(pr);
+						m.insert(std::move(pr));
 					}
 				}
 					break;
@@ -1542,7 +2042,7 @@ public:
 						read(tmp, 1);
 
 
-						m.insert(pr);
+						m.insert(std::move(pr));
 					}
 				}
 					break;
@@ -1591,7 +2091,7 @@ public:
 						CV tmp(pr.second);
 						read(tmp, 1);
 
-						m.insert(pr);
+						m.insert(std::move(pr));
 					}
 				}
 					break;
@@ -1640,10 +2140,7 @@ public:
 						throw TarsDecodeInvalidValue(s);
 					}
 
-					v.reserve(size);
-					v.resize(size);
-
-					this->readBuf(v.data(), size);
+					this->readBuf(v, size);
 					//TarsReadTypeBuf(*this, v[0], Int32);
 				}
 					break;
@@ -1679,6 +2176,179 @@ public:
 		}
 	}
 
+	/**
+	 * 零拷贝读取vector<char>字段: data直接指向输入缓冲区, 输入缓冲区的生命周期由调用者保证
+	 * 字段不是SimpleList编码时(兼容), 解码到buffer中, data指向buffer
+	 * @param data, 数据首地址
+	 * @param len, 数据长度
+	 * @param buffer, 兼容编码时的解码空间
+	 */
+	template<typename Alloc>
+	void readView(const char *&data, size_t &len, std::vector<Char, Alloc>& buffer, uint8_t tag, bool isRequire = true)
+	{
+		data = NULL;
+		len  = 0;
+
+		uint8_t headType = 0, headTag = 0;
+		bool skipFlag = false;
+		TarsSkipToTag(skipFlag, tag, headType, headTag);
+		if (tars_likely(skipFlag))
+		{
+			if (headType == TarsHeadeSimpleList)
+			{
+				uint8_t hheadType, hheadTag;
+				readFromHead(*this, hheadType, hheadTag);
+				if (tars_unlikely(hheadType != TarsHeadeChar))
+				{
+					char s[128];
+					snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d, %d, %d", tag, headType, hheadType, hheadTag);
+					throw TarsDecodeMismatch(s);
+				}
+				UInt32 size = 0;
+				read(size, 0);
+				if (tars_unlikely(size > this->size() - this->tellp()))
+				{
+					char s[128];
+					snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, %d, size: %d", tag, headType, hheadType, size);
+					throw TarsDecodeInvalidValue(s);
+				}
+
+				data = this->base() + this->tellp();
+				len  = size;
+
+				this->skip(size);
+			}
+			else if (headType == TarsHeadeList)
+			{
+				UInt32 size = 0;
+				read(size, 0);
+				if (tars_unlikely(size > this->size()))
+				{
+					char s[128];
+					snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, size: %d", tag, headType, size);
+					throw TarsDecodeInvalidValue(s);
+				}
+				buffer.resize(size);
+				for (UInt32 i = 0; i < size; ++i)
+					read(buffer[i], 0);
+
+				data = buffer.data();
+				len  = buffer.size();
+			}
+			else
+			{
+				char s[128];
+				snprintf(s, sizeof(s), "type mismatch, tag: %d, type: %d", tag, headType);
+				throw TarsDecodeMismatch(s);
+			}
+		}
+		else if (tars_unlikely(isRequire))
+		{
+			char s[128];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			throw TarsDecodeRequireNotExist(s);
+		}
+	}
+
+	/// 数值vector批量解码, 见TarsBulk
+	template<typename Alloc>
+	void read(std::vector<Int32, Alloc>& v, uint8_t tag, bool isRequire = true)
+	{
+		readBulk(v, tag, isRequire);
+	}
+
+	template<typename Alloc>
+	void read(std::vector<Int64, Alloc>& v, uint8_t tag, bool isRequire = true)
+	{
+		readBulk(v, tag, isRequire);
+	}
+
+	template<typename Alloc>
+	void read(std::vector<Float, Alloc>& v, uint8_t tag, bool isRequire = true)
+	{
+		readBulk(v, tag, isRequire);
+	}
+
+	template<typename Alloc>
+	void read(std::vector<Double, Alloc>& v, uint8_t tag, bool isRequire = true)
+	{
+		readBulk(v, tag, isRequire);
+	}
+
+	template<typename T, typename Alloc>
+	void readBulk(std::vector<T, Alloc>& v, uint8_t tag, bool isRequire)
+	{
+		uint8_t headType = 0, headTag = 0;
+		bool skipFlag = false;
+		TarsSkipToTag(skipFlag, tag, headType, headTag);
+		if (tars_likely(skipFlag))
+		{
+			switch(headType)
+			{
+				case TarsHeadeList:
+				{
+					UInt32 size = 0;
+					read(size, 0);
+					if (tars_unlikely(size > this->size()))
+					{
+						char s[128];
+						snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, size: %d, headTag: %d", tag, headType, size, headTag);
+						throw TarsDecodeInvalidValue(s);
+					}
+					v.resize(size);
+					if (size == 0)
+					{
+						break;
+					}
+
+					//批量解码, 遇到不能处理的元素后逐个解码
+					size_t used = 0;
+					size_t i = bulkDecode(this->_buf + this->_cur, this->_buf_len - this->_cur, size, &v[0], used);
+					this->_cur += used;
+					for (; i < size; ++i)
+						read(v[i], 0);
+				}
+					break;
+				default:
+				{
+					char s[64];
+					snprintf(s, sizeof(s), "read 'vector' type mismatch, tag: %d, get type: %d.", tag, headType);
+					throw TarsDecodeMismatch(s);
+				}
+			}
+		}
+		else if (tars_unlikely(isRequire))
+		{
+			char s[64];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			throw TarsDecodeRequireNotExist(s);
+		}
+	}
+
+	size_t bulkDecode(const char *in, size_t len, size_t n, Int32 *v, size_t &used)
+	{
+		return TarsBulk::decodeInt(in, len, n, v, &used);
+	}
+
+	size_t bulkDecode(const char *in, size_t len, size_t n, Int64 *v, size_t &used)
+	{
+		return TarsBulk::decodeInt(in, len, n, v, &used);
+	}
+
+	size_t bulkDecode(const char *in, size_t len, size_t n, Float *v, size_t &used)
+	{
+		size_t i = TarsBulk::decodeFloat(in, len, n, v);
+		used = i * 5;
+		return i;
+	}
+
+	size_t bulkDecode(const char *in, size_t len, size_t n, Double *v, size_t &used)
+	{
+		size_t i = TarsBulk::decodeDouble(in, len, n, v);
+		used = i * 9;
+		return i;
+	}
+
 	template<typename T, typename Alloc>
 	void read(std::vector<T, Alloc>& v, uint8_t tag, bool isRequire = true)
 	{
@@ -1721,6 +2391,52 @@ public:
 		}
 	}
 
+	/// vector<bool>的元素不能取引用, 单独处理
+	template<typename Alloc>
+	void read(std::vector<Bool, Alloc>& v, uint8_t tag, bool isRequire = true)
+	{
+		uint8_t headType = 0, headTag = 0;
+		bool skipFlag = false;
+		TarsSkipToTag(skipFlag, tag, headType, headTag);
+		if (tars_likely(skipFlag))
+		{
+			switch(headType)
+			{
+				case TarsHeadeList:
+				{
+					UInt32 size = 0;
+					read(size, 0);
+					if (tars_unlikely(size > this->size()))
+					{
+						char s[128];
+						snprintf(s, sizeof(s), "invalid size, tag: %d, type: %d, size: %d, headTag: %d", tag, headType, size, headTag);
+						throw TarsDecodeInvalidValue(s);
+					}
+					v.resize(size);
+					for (UInt32 i = 0; i < size; ++i)
+					{
+						Bool b = false;
+						read(b, 0);
+						v[i] = b;
+					}
+				}
+					break;
+				default:
+				{
+					char s[64];
+					snprintf(s, sizeof(s), "read 'vector' type mismatch, tag: %d, get type: %d.", tag, headType);
+					throw TarsDecodeMismatch(s);
+				}
+			}
+		}
+		else if (tars_unlikely(isRequire))
+		{
+			char s[64];
+			snprintf(s, sizeof(s), "require field not exist, tag: %d, headTag: %d", tag, headTag);
+			throw TarsDecodeRequireNotExist(s);
+		}
+	}
+
 	template<typename T, typename Cmp, typename Alloc>
 	void read(std::set<T, Cmp, Alloc>& v, uint8_t tag, bool isRequire = true)
 	{
@@ -2051,6 +2767,341 @@ public:
 			throw TarsDecodeRequireNotExist(s);
 		}
 	}
+
+protected:
+	/**
+	 * 跳过map/list/struct时记录嵌套层数, 超过TARS_MAX_SKIP_DEPTH抛异常
+	 */
+	struct SkipDepthGuard
+	{
+		SkipDepthGuard(size_t &depth) : _depth(depth)
+		{
+			if (tars_unlikely(++_depth > TARS_MAX_SKIP_DEPTH))
+			{
+				--_depth;
+				char s[64];
+				snprintf(s, sizeof(s), "skipField nested too deep, max depth: %d", TARS_MAX_SKIP_DEPTH);
+				throw TarsDecodeInvalidValue(s);
+			}
+		}
+		~SkipDepthGuard() { --_depth; }
+
+		size_t &_depth;
+	};
+
+	size_t _skipDepth = 0;
+};
+
+//////////////////////////////////////////////////////////////////
+/**
+ * 结构体字段的tag索引, 扫描一遍buffer记录每个tag的位置, 之后按需解码单个字段, 不用解码整个结构体
+ * 比如网关只需要取请求里的用户id来路由
+ * tars2cpp --lazy生成的XxxLazy继承它, 每个字段生成一个访问函数
+ * 不拥有buffer, 只在buffer有效期间可用
+ */
+class TarsTagIndex
+{
+public:
+	TarsTagIndex() : _buf(NULL), _len(0)
+	{
+		memset(_offset, 0, sizeof(_offset));
+	}
+
+	TarsTagIndex(const char *buf, size_t len)
+	{
+		tars_build(buf, len);
+	}
+
+	/**
+	 * 建立索引, 只扫描当前这一层, 遇到StructEnd结束
+	 * @param buf
+	 * @param len
+	 */
+	void tars_build(const char *buf, size_t len)
+	{
+		_buf = buf;
+		_len = len;
+		memset(_offset, 0, sizeof(_offset));
+
+		TarsInputStream<BufferReader> is;
+		is.setBuffer(buf, len);
+		while (!is.hasEnd())
+		{
+			size_t pos = is.tellp();
+			uint8_t headType = 0, headTag = 0;
+			size_t n = 0;
+			TarsPeekFromHead(is, headType, headTag, n);
+			if (headType == TarsHeadeStructEnd)
+			{
+				break;
+			}
+			TarsReadHeadSkip(is, n);
+			is.skipField(headType);
+			//同一个tag出现多次时和readFrom一样取第一个
+			if (_offset[headTag] == 0)
+			{
+				_offset[headTag] = (uint32_t)pos + 1;
+			}
+		}
+	}
+
+	/**
+	 * 是否有这个字段
+	 * @param tag
+	 */
+	bool tars_has(uint8_t tag) const
+	{
+		return _offset[tag] != 0;
+	}
+
+	/**
+	 * 解码一个字段
+	 * @param v
+	 * @param tag
+	 * @param isRequire: 必须存在, 不存在抛异常
+	 * @return 字段是否存在
+	 */
+	template<typename T>
+	bool tars_read(T& v, uint8_t tag, bool isRequire = false) const
+	{
+		if (_offset[tag] == 0)
+		{
+			if (tars_unlikely(isRequire))
+			{
+				char s[64];
+				snprintf(s, sizeof(s), "require field not exist, tag: %d", tag);
+				throw TarsDecodeRequireNotExist(s);
+			}
+			return false;
+		}
+
+		size_t pos = _offset[tag] - 1;
+		TarsInputStream<BufferReader> is;
+		is.setBuffer(_buf + pos, _len - pos);
+		is.read(v, tag, true);
+		return true;
+	}
+
+	/**
+	 * 给结构体类型的字段建立索引, 可以继续按需解码里面的字段
+	 * @param tag
+	 * @param sub
+	 * @param isRequire
+	 * @return 字段是否存在
+	 */
+	bool tars_sub(uint8_t tag, TarsTagIndex& sub, bool isRequire = false) const
+	{
+		if (_offset[tag] == 0)
+		{
+			if (tars_unlikely(isRequire))
+			{
+				char s[64];
+				snprintf(s, sizeof(s), "require field not exist, tag: %d", tag);
+				throw TarsDecodeRequireNotExist(s);
+			}
+			return false;
+		}
+
+		size_t pos = _offset[tag] - 1;
+		TarsInputStream<BufferReader> is;
+		is.setBuffer(_buf + pos, _len - pos);
+		uint8_t headType = 0, headTag = 0;
+		readFromHead(is, headType, headTag);
+		if (tars_unlikely(headType != TarsHeadeStructBegin || headTag != tag))
+		{
+			char s[64];
+			snprintf(s, sizeof(s), "type mismatch, tag: %d, head tag: %d, type: %d", tag, headTag, headType);
+			throw TarsDecodeMismatch(s);
+		}
+		sub.tars_build(_buf + pos + is.tellp(), _len - pos - is.tellp());
+		return true;
+	}
+
+protected:
+	const char *_buf;
+	size_t      _len;
+	uint32_t    _offset[256];   //位置+1, 0表示没有这个字段
+};
+
+//////////////////////////////////////////////////////////////////
+/**
+ * 计算编码后的精确字节数, 和TarsOutputStream::write一一对应(包括数值的压缩编码)
+ * tars2cpp生成的结构体的tars_encoded_size()调用这里, 编码前可以一次分配好空间:
+ * _os.reserveExact(st.tars_encoded_size());
+ * st.writeTo(_os);
+ */
+class TarsEncodedSize
+{
+public:
+	static size_t head(uint8_t tag)
+	{
+		return tars_likely(tag < 15) ? 1 : 2;
+	}
+
+	static size_t of(Bool b, uint8_t tag)
+	{
+		return of((Char) b, tag);
+	}
+
+	static size_t of(Char n, uint8_t tag)
+	{
+		return n == 0 ? head(tag) : head(tag) + sizeof(Char);
+	}
+
+	static size_t of(UInt8 n, uint8_t tag)
+	{
+		return of((Short) n, tag);
+	}
+
+	static size_t of(Short n, uint8_t tag)
+	{
+		if (n >= (-128) && n <= 127)
+		{
+			return of((Char) n, tag);
+		}
+		return head(tag) + sizeof(Short);
+	}
+
+	static size_t of(UInt16 n, uint8_t tag)
+	{
+		return of((Int32) n, tag);
+	}
+
+	static size_t of(Int32 n, uint8_t tag)
+	{
+		if (n >= (-32768) && n <= 32767)
+		{
+			return of((Short) n, tag);
+		}
+		return head(tag) + sizeof(Int32);
+	}
+
+	static size_t of(UInt32 n, uint8_t tag)
+	{
+		return of((Int64) n, tag);
+	}
+
+	static size_t of(Int64 n, uint8_t tag)
+	{
+		if (n >= (-2147483647-1) && n <= 2147483647)
+		{
+			return of((Int32) n, tag);
+		}
+		return head(tag) + sizeof(Int64);
+	}
+
+	static size_t of(Float n, uint8_t tag)
+	{
+		return head(tag) + sizeof(Float);
+	}
+
+	static size_t of(Double n, uint8_t tag)
+	{
+		return head(tag) + sizeof(Double);
+	}
+
+	static size_t of(const std::string& s, uint8_t tag)
+	{
+		return head(tag) + (s.size() > 255 ? sizeof(uint32_t) : sizeof(uint8_t)) + s.size();
+	}
+
+	static size_t of(const TarsStringView& s, uint8_t tag)
+	{
+		return head(tag) + (s.size() > 255 ? sizeof(uint32_t) : sizeof(uint8_t)) + s.size();
+	}
+
+	static size_t of(const TarsBytesView& v, uint8_t tag)
+	{
+		return head(tag) + head(0) + of((Int32)v.size(), 0) + v.size();
+	}
+
+	static size_t of(const char *buf, const UInt32 len, uint8_t tag)
+	{
+		return head(tag) + head(0) + of(len, 0) + len;
+	}
+
+	template<typename K, typename V, typename Cmp, typename Alloc>
+	static size_t of(const std::map<K, V, Cmp, Alloc>& m, uint8_t tag)
+	{
+		size_t n = head(tag) + of((Int32)m.size(), 0);
+		typedef typename std::map<K, V, Cmp, Alloc>::const_iterator IT;
+		for (IT i = m.begin(); i != m.end(); ++i)
+		{
+			n += of(i->first, 0) + of(i->second, 1);
+		}
+		return n;
+	}
+
+	template<typename K, typename V, typename H, typename Cmp, typename Alloc>
+	static size_t of(const std::unordered_map<K, V, H, Cmp, Alloc>& m, uint8_t tag)
+	{
+		size_t n = head(tag) + of((Int32)m.size(), 0);
+		typedef typename std::unordered_map<K, V, H, Cmp, Alloc>::const_iterator IT;
+		for (IT i = m.begin(); i != m.end(); ++i)
+		{
+			n += of(i->first, 0) + of(i->second, 1);
+		}
+		return n;
+	}
+
+	template<typename T, typename Alloc>
+	static size_t of(const std::vector<T, Alloc>& v, uint8_t tag)
+	{
+		size_t n = head(tag) + of((Int32)v.size(), 0);
+		typedef typename std::vector<T, Alloc>::const_iterator IT;
+		for (IT i = v.begin(); i != v.end(); ++i)
+			n += of(*i, 0);
+		return n;
+	}
+
+	template<typename T, typename Cmp, typename Alloc>
+	static size_t of(const std::set<T, Cmp, Alloc>& v, uint8_t tag)
+	{
+		size_t n = head(tag) + of((Int32)v.size(), 0);
+		typedef typename std::set<T, Cmp, Alloc>::const_iterator IT;
+		for (IT i = v.begin(); i != v.end(); ++i)
+			n += of(*i, 0);
+		return n;
+	}
+
+	template<typename T, typename H, typename Cmp, typename Alloc>
+	static size_t of(const std::unordered_set<T, H, Cmp, Alloc>& v, uint8_t tag)
+	{
+		size_t n = head(tag) + of((Int32)v.size(), 0);
+		typedef typename std::unordered_set<T, H, Cmp, Alloc>::const_iterator IT;
+		for (IT i = v.begin(); i != v.end(); ++i)
+			n += of(*i, 0);
+		return n;
+	}
+
+	template<typename T>
+	static size_t of(const T *v, const UInt32 len, uint8_t tag)
+	{
+		size_t n = head(tag) + of(len, 0);
+		for (Int32 i = 0; i < (Int32)len; ++i)
+		{
+			n += of(v[i], 0);
+		}
+		return n;
+	}
+
+	template<typename Alloc>
+	static size_t of(const std::vector<Char, Alloc>& v, uint8_t tag)
+	{
+		return head(tag) + head(0) + of((Int32)v.size(), 0) + v.size();
+	}
+
+	template<typename T>
+	static size_t of(const T& v, uint8_t tag, typename detail::disable_if<detail::is_convertible<T*, TarsStructBase*>, void ***>::type dummy = 0)
+	{
+		return of((Int32) v, tag);
+	}
+
+	template<typename T>
+	static size_t of(const T& v, uint8_t tag, typename detail::enable_if<detail::is_convertible<T*, TarsStructBase*>, void ***>::type dummy = 0)
+	{
+		return head(tag) + v.tars_encoded_size() + head(0);
+	}
 };
 
 //////////////////////////////////////////////////////////////////
@@ -2173,7 +3224,33 @@ public:
 			uint32_t n = htonl((uint32_t)s.size());
 			TarsWriteUInt32TTypeBuf(*this, n, (*this)._len);
 
-			TarsWriteTypeBuf(*this, s.data(), s.size());
+			this->writeBuf(s.data(), s.size());
+		}
+		else
+		{
+			TarsWriteToHead(*this, TarsHeadeString1, tag);
+			uint8_t n = (uint8_t)s.size();
+			TarsWriteUInt8TTypeBuf(*this, n, (*this)._len);
+
+			this->writeBuf(s.data(), s.size());
+		}
+	}
+
+	void write(const TarsStringView& s, uint8_t tag)
+	{
+		if (tars_unlikely(s.size() > 255))
+		{
+			if (tars_unlikely(s.size() > TARS_MAX_STRING_LENGTH))
+			{
+				char ss[128];
+				snprintf(ss, sizeof(ss), "invalid string size, tag: %d, size: %u", tag, (uint32_t)s.size());
+				throw TarsDecodeInvalidValue(ss);
+			}
+			TarsWriteToHead(*this, TarsHeadeString4, tag);
+			uint32_t n = htonl((uint32_t)s.size());
+			TarsWriteUInt32TTypeBuf(*this, n, (*this)._len);
+
+			this->writeBuf(s.data(), s.size());
 		}
 		else
 		{
@@ -2181,17 +3258,27 @@ public:
 			uint8_t n = (uint8_t)s.size();
 			TarsWriteUInt8TTypeBuf(*this, n, (*this)._len);
 
-			TarsWriteTypeBuf(*this, s.data(), s.size());
+			this->writeBuf(s.data(), s.size());
 		}
 	}
 
+	void write(const TarsBytesView& v, uint8_t tag)
+	{
+		TarsWriteToHead(*this, TarsHeadeSimpleList, tag);
+		TarsWriteToHead(*this, TarsHeadeChar, 0);
+		Int32 n = (Int32)v.size();
+		write(n, 0);
+
+		this->writeBuf(v.data(), v.size());
+	}
+
 	void write(const char *buf, const UInt32 len, uint8_t tag)
 	{
 		TarsWriteToHead(*this, TarsHeadeSimpleList, tag);
 		TarsWriteToHead(*this, TarsHeadeChar, 0);
 		write(len, 0);
 
-		TarsWriteTypeBuf(*this, buf, len);
+		this->writeBuf(buf, len);
 	}
 
 	template<typename K, typename V, typename Cmp, typename Alloc>
@@ -2257,6 +3344,70 @@ public:
 			write(*i, 0);
 	}
 
+	/// 数值vector批量编码, 编码结果和逐个write一样, 见TarsBulk
+	template<typename Alloc>
+	void write(const std::vector<Int32, Alloc>& v, uint8_t tag)
+	{
+		writeBulkInt(v, tag);
+	}
+
+	template<typename Alloc>
+	void write(const std::vector<Int64, Alloc>& v, uint8_t tag)
+	{
+		writeBulkInt(v, tag);
+	}
+
+	template<typename Alloc>
+	void write(const std::vector<Float, Alloc>& v, uint8_t tag)
+	{
+		TarsWriteToHead(*this, TarsHeadeList, tag);
+		write((Int32)v.size(), 0);
+		size_t len = v.size() * (1 + sizeof(Float));
+		TarsReserveBuf(*this, this->_len + len);
+		TarsBulk::encodeFloat(v.data(), v.size(), this->_buf + this->_len);
+		this->_len += len;
+	}
+
+	template<typename Alloc>
+	void write(const std::vector<Double, Alloc>& v, uint8_t tag)
+	{
+		TarsWriteToHead(*this, TarsHeadeList, tag);
+		write((Int32)v.size(), 0);
+		size_t len = v.size() * (1 + sizeof(Double));
+		TarsReserveBuf(*this, this->_len + len);
+		TarsBulk::encodeDouble(v.data(), v.size(), this->_buf + this->_len);
+		this->_len += len;
+	}
+
+	/**
+	 * 整数按大小压缩, 长度不定: 分块按最大长度检查剩余空间, 够的话直接写buffer,
+	 * 不够时这一块逐个write(可以扩容的buffer会在这里扩容, 固定buffer只在真的不够时才抛异常)
+	 */
+	template<typename T, typename Alloc>
+	void writeBulkInt(const std::vector<T, Alloc>& v, uint8_t tag)
+	{
+		TarsWriteToHead(*this, TarsHeadeList, tag);
+		write((Int32)v.size(), 0);
+
+		const size_t block = 1024;
+		for (size_t i = 0; i < v.size(); i += block)
+		{
+			size_t n = std::min(block, v.size() - i);
+			if (this->_buf_len - this->_len >= n * (1 + sizeof(T)))
+			{
+				char *p = this->_buf + this->_len;
+				for (size_t j = i; j < i + n; ++j)
+					p = TarsBulk::encodeInt(v[j], p);
+				this->_len = p - this->_buf;
+			}
+			else
+			{
+				for (size_t j = i; j < i + n; ++j)
+					write(v[j], 0);
+			}
+		}
+	}
+
 	template<typename T, typename Cmp, typename Alloc>
 	void write(const std::set<T, Cmp, Alloc>& v, uint8_t tag)
 	{
@@ -2342,7 +3493,7 @@ public:
 		Int32 n = (Int32)v.size();
 		write(n, 0);
 
-		TarsWriteTypeBuf(*this, v.data(), v.size());
+		this->writeBuf(v.data(), v.size());
 	}
 
 	template<typename T>
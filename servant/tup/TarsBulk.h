@@ -0,0 +1,358 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __TARS_BULK_H__
+#define __TARS_BULK_H__
+
+#ifdef __APPLE__
+#include "TarsType.h"
+#elif defined ANDROID  // android
+#include "TarsType.h"
+#else
+#include "tup/TarsType.h"
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && (__BYTE_ORDER == __LITTLE_ENDIAN)
+#define TARS_BULK_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace tars
+{
+//////////////////////////////////////////////////////////////////
+/**
+ * 数值vector的批量编解码, TarsOutputStream/TarsInputStream的vector<Int32/Int64/Float/Double>使用
+ *
+ * 编码格式和逐个元素write完全一致(每个元素tag为0, 一个字节的头), 只是:
+ * - 一次预留空间, 直接写buffer, 没有每个元素的扩容检查和函数调用
+ * - Float/Double每个元素固定是头+4/8字节大端, x86下运行时检测到SSSE3时用pshufb一次处理多个元素的字节序转换和头
+ * - 解码遇到非预期的头(比如其他语言编码的ZeroTag)就停下, 剩下的元素由调用者逐个解码
+ *
+ * 没有引入打包(SimpleList)格式, 其他语言的tars解码不认识, 不兼容
+ */
+struct TarsBulk
+{
+	/**
+	 * 运行时是否支持SSSE3
+	 */
+	static bool hasSSSE3()
+	{
+#if TARS_BULK_SSSE3
+		static bool support = __builtin_cpu_supports("ssse3");
+		return support;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * 编码n个Float, out至少n*5字节
+	 */
+	static void encodeFloat(const Float *v, size_t n, char *out)
+	{
+		size_t i = 0;
+#if TARS_BULK_SSSE3
+		if (hasSSSE3())
+		{
+			i = encodeFloatSSSE3(v, n, out);
+			out += i * 5;
+		}
+#endif
+		for (; i < n; ++i, out += 5)
+		{
+			Float f = tars_htonf(v[i]);
+			out[0] = TarsHeadeFloat;
+			memcpy(out + 1, &f, 4);
+		}
+	}
+
+	/**
+	 * 编码n个Double, out至少n*9字节
+	 */
+	static void encodeDouble(const Double *v, size_t n, char *out)
+	{
+		size_t i = 0;
+#if TARS_BULK_SSSE3
+		if (hasSSSE3())
+		{
+			i = encodeDoubleSSSE3(v, n, out);
+			out += i * 9;
+		}
+#endif
+		for (; i < n; ++i, out += 9)
+		{
+			Double d = tars_htond(v[i]);
+			out[0] = TarsHeadeDouble;
+			memcpy(out + 1, &d, 8);
+		}
+	}
+
+	/**
+	 * 解码Float, 遇到不是Float的头或者数据不够就停下
+	 * @param in
+	 * @param len: in的长度
+	 * @param n: 最多解码个数
+	 * @param v
+	 * @return 解码的个数, in前进了返回值*5字节
+	 */
+	static size_t decodeFloat(const char *in, size_t len, size_t n, Float *v)
+	{
+		if (n > len / 5)
+		{
+			n = len / 5;
+		}
+
+		size_t i = 0;
+#if TARS_BULK_SSSE3
+		if (hasSSSE3())
+		{
+			i = decodeFloatSSSE3(in, n, v);
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			const char *p = in + i * 5;
+			if (p[0] != TarsHeadeFloat)
+			{
+				break;
+			}
+			memcpy(&v[i], p + 1, 4);
+			v[i] = tars_ntohf(v[i]);
+		}
+		return i;
+	}
+
+	/**
+	 * 解码Double, 遇到不是Double的头或者数据不够就停下
+	 * @return 解码的个数, in前进了返回值*9字节
+	 */
+	static size_t decodeDouble(const char *in, size_t len, size_t n, Double *v)
+	{
+		if (n > len / 9)
+		{
+			n = len / 9;
+		}
+
+		size_t i = 0;
+#if TARS_BULK_SSSE3
+		if (hasSSSE3())
+		{
+			i = decodeDoubleSSSE3(in, n, v);
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			const char *p = in + i * 9;
+			if (p[0] != TarsHeadeDouble)
+			{
+				break;
+			}
+			memcpy(&v[i], p + 1, 8);
+			v[i] = tars_ntohd(v[i]);
+		}
+		return i;
+	}
+
+	/**
+	 * 编码一个整数(tag为0), 和TarsOutputStream::write(Int64, 0)一样按大小压缩
+	 * @return 写到的位置
+	 */
+	static char *encodeInt(Int64 n, char *out)
+	{
+		if (n >= -128 && n <= 127)
+		{
+			if (n == 0)
+			{
+				*out++ = TarsHeadeZeroTag;
+			}
+			else
+			{
+				*out++ = TarsHeadeChar;
+				*out++ = (Char)n;
+			}
+		}
+		else if (n >= -32768 && n <= 32767)
+		{
+			Short s = htons((Short)n);
+			*out++ = TarsHeadeShort;
+			memcpy(out, &s, 2);
+			out += 2;
+		}
+		else if (n >= (-2147483647-1) && n <= 2147483647)
+		{
+			Int32 i = htonl((Int32)n);
+			*out++ = TarsHeadeInt32;
+			memcpy(out, &i, 4);
+			out += 4;
+		}
+		else
+		{
+			n = tars_htonll(n);
+			*out++ = TarsHeadeInt64;
+			memcpy(out, &n, 8);
+			out += 8;
+		}
+		return out;
+	}
+
+	/**
+	 * 解码整数, 遇到tag不是0, 类型不是整数(或者超过T的宽度)或者数据不够就停下
+	 * @return 解码的个数, *used为in前进的字节数
+	 */
+	template<typename T>
+	static size_t decodeInt(const char *in, size_t len, size_t n, T *v, size_t *used)
+	{
+		const char *p = in;
+		const char *end = in + len;
+		size_t i = 0;
+		for (; i < n && p < end; ++i)
+		{
+			switch ((uint8_t)*p)
+			{
+				case TarsHeadeZeroTag:
+					v[i] = 0;
+					p += 1;
+					continue;
+				case TarsHeadeChar:
+					if (end - p < 2) break;
+					v[i] = (Char)p[1];
+					p += 2;
+					continue;
+				case TarsHeadeShort:
+				{
+					if (end - p < 3) break;
+					Short s;
+					memcpy(&s, p + 1, 2);
+					v[i] = (Short)ntohs(s);
+					p += 3;
+					continue;
+				}
+				case TarsHeadeInt32:
+				{
+					if (end - p < 5) break;
+					Int32 i32;
+					memcpy(&i32, p + 1, 4);
+					v[i] = (Int32)ntohl(i32);
+					p += 5;
+					continue;
+				}
+				case TarsHeadeInt64:
+				{
+					if (sizeof(T) < sizeof(Int64) || end - p < 9) break;
+					Int64 i64;
+					memcpy(&i64, p + 1, 8);
+					v[i] = (T)tars_ntohll(i64);
+					p += 9;
+					continue;
+				}
+				default:
+					break;
+			}
+			break;
+		}
+		*used = p - in;
+		return i;
+	}
+
+protected:
+#if TARS_BULK_SSSE3
+	__attribute__((target("ssse3")))
+	static size_t encodeFloatSSSE3(const Float *v, size_t n, char *out)
+	{
+		//4个Float -> 20字节: [头, 大端4字节] * 4
+		const __m128i idx0 = _mm_setr_epi8(-1, 3, 2, 1, 0, -1, 7, 6, 5, 4, -1, 11, 10, 9, 8, -1);
+		const __m128i idx1 = _mm_setr_epi8(15, 14, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+		const __m128i head = _mm_setr_epi8(TarsHeadeFloat, 0, 0, 0, 0, TarsHeadeFloat, 0, 0, 0, 0, TarsHeadeFloat, 0, 0, 0, 0, TarsHeadeFloat);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4, out += 20)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i *)(v + i));
+			_mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_shuffle_epi8(a, idx0), head));
+			int tail = _mm_cvtsi128_si32(_mm_shuffle_epi8(a, idx1));
+			memcpy(out + 16, &tail, 4);
+		}
+		return i;
+	}
+
+	__attribute__((target("ssse3")))
+	static size_t encodeDoubleSSSE3(const Double *v, size_t n, char *out)
+	{
+		//2个Double -> 18字节: [头, 大端8字节] * 2
+		const __m128i idx0 = _mm_setr_epi8(-1, 7, 6, 5, 4, 3, 2, 1, 0, -1, 15, 14, 13, 12, 11, 10);
+		const __m128i idx1 = _mm_setr_epi8(9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+		const __m128i head = _mm_setr_epi8(TarsHeadeDouble, 0, 0, 0, 0, 0, 0, 0, 0, TarsHeadeDouble, 0, 0, 0, 0, 0, 0);
+
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2, out += 18)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i *)(v + i));
+			_mm_storeu_si128((__m128i *)out, _mm_or_si128(_mm_shuffle_epi8(a, idx0), head));
+			int tail = _mm_cvtsi128_si32(_mm_shuffle_epi8(a, idx1));
+			memcpy(out + 16, &tail, 2);
+		}
+		return i;
+	}
+
+	__attribute__((target("ssse3")))
+	static size_t decodeFloatSSSE3(const char *in, size_t n, Float *v)
+	{
+		const __m128i idx0 = _mm_setr_epi8(4, 3, 2, 1, 9, 8, 7, 6, 14, 13, 12, 11, -1, -1, -1, -1);
+		const __m128i idx1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, 14, 13, 12);
+		const __m128i head = _mm_set1_epi8(TarsHeadeFloat);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4, in += 20)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i *)in);
+			//头在0, 5, 10, 15
+			if ((_mm_movemask_epi8(_mm_cmpeq_epi8(a, head)) & 0x8421) != 0x8421)
+			{
+				break;
+			}
+			__m128i b = _mm_loadu_si128((const __m128i *)(in + 4));
+			_mm_storeu_si128((__m128i *)(v + i), _mm_or_si128(_mm_shuffle_epi8(a, idx0), _mm_shuffle_epi8(b, idx1)));
+		}
+		return i;
+	}
+
+	__attribute__((target("ssse3")))
+	static size_t decodeDoubleSSSE3(const char *in, size_t n, Double *v)
+	{
+		const __m128i idx0 = _mm_setr_epi8(8, 7, 6, 5, 4, 3, 2, 1, -1, -1, -1, -1, -1, -1, -1, -1);
+		const __m128i idx1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 15, 14, 13, 12, 11, 10, 9, 8);
+		const __m128i head = _mm_set1_epi8(TarsHeadeDouble);
+
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2, in += 18)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i *)in);
+			//头在0, 9
+			if ((_mm_movemask_epi8(_mm_cmpeq_epi8(a, head)) & 0x201) != 0x201)
+			{
+				break;
+			}
+			__m128i b = _mm_loadu_si128((const __m128i *)(in + 2));
+			_mm_storeu_si128((__m128i *)(v + i), _mm_or_si128(_mm_shuffle_epi8(a, idx0), _mm_shuffle_epi8(b, idx1)));
+		}
+		return i;
+	}
+#endif
+};
+
+}
+
+#endif
@@ -20,6 +20,8 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <mutex>
 
 //支持iphone
 #ifdef __APPLE__
@@ -42,16 +44,351 @@ namespace tup
 const std::string STATUS_RESULT_CODE = "STATUS_RESULT_CODE";
 const std::string STATUS_RESULT_DESC = "STATUS_RESULT_DESC"; 
 
+/////////////////////////////////////////////////////////////////////////////////
+/**
+ * UniAttribute的属性存储, 编码和map<string, vector<char>>完全一致
+ * - 属性平铺在数组里, 带名字的hash, 属性少时直接比较hash线性查找, 多了再建开放寻址的索引
+ * - 所有属性值的编码结果放在同一个buffer里, put/decode不再为每个属性分配树节点和vector
+ * - 编码时按名字顺序输出, 和原来std::map的结果一样
+ * - 不支持删除单个属性(UniAttribute也没有这个接口)
+ */
+template<template<typename> class Alloc = std::allocator>
+class UniAttrData
+{
+public:
+    struct Entry
+    {
+        uint32_t    hash;
+        uint32_t    offset;     //在buffer中的位置
+        uint32_t    length;
+        uint32_t    capacity;   //占用的空间, 覆盖时不超过就原地写
+        std::string name;
+    };
+
+    UniAttrData() : _garbage(0), _version(0) {}
+
+    /**
+     * 查找属性
+     * @return 不存在时返回NULL
+     */
+    const Entry *find(const std::string &name) const
+    {
+        size_t i = indexOf(name, hash(name));
+        return i == npos() ? NULL : &_entries[i];
+    }
+
+    /**
+     * 属性值的编码结果
+     */
+    const char *data(const Entry &e) const
+    {
+        return _buffer.data() + e.offset;
+    }
+
+    /**
+     * 设置属性值(编码结果), buf不能指向自身的buffer
+     */
+    void set(const std::string &name, const char *buf, size_t len)
+    {
+        put(name, buf, len, true);
+    }
+
+    /**
+     * 属性不存在时才设置, 已经存在的保持不变(和std::map::insert一样)
+     * @return 是否设置了
+     */
+    bool insert(const std::string &name, const char *buf, size_t len)
+    {
+        return put(name, buf, len, false);
+    }
+
+    void clear()
+    {
+        _entries.clear();
+        _buffer.clear();
+        _index.clear();
+        _garbage = 0;
+        ++_version;
+    }
+
+    bool empty() const { return _entries.empty(); }
+
+    size_t size() const { return _entries.size(); }
+
+    /**
+     * 内容的版本, 每次修改都会变化, 用来判断缓存是否失效
+     */
+    size_t version() const { return _version; }
+
+    const std::vector<Entry, Alloc<Entry> > &entries() const { return _entries; }
+
+    /**
+     * 按map<string, vector<char>>编码
+     */
+    template<typename WriterT>
+    void writeTo(tars::TarsOutputStream<WriterT> &os, uint8_t tag) const
+    {
+        tars::DataHead::writeTo(os, tars::DataHead::eMap, tag);
+        os.write((tars::Int32)_entries.size(), 0);
+
+        if (isSorted())
+        {
+            for (size_t i = 0; i < _entries.size(); i++)
+            {
+                writeEntry(os, _entries[i]);
+            }
+        }
+        else
+        {
+            std::vector<const Entry*> sorted(_entries.size());
+            for (size_t i = 0; i < _entries.size(); i++)
+            {
+                sorted[i] = &_entries[i];
+            }
+            std::sort(sorted.begin(), sorted.end(), [](const Entry *l, const Entry *r){ return l->name < r->name; });
+            for (size_t i = 0; i < sorted.size(); i++)
+            {
+                writeEntry(os, *sorted[i]);
+            }
+        }
+    }
+
+    /**
+     * 按map<string, vector<char>>解码, 会先清空, 名字重复时保留第一个(和解码到std::map一样)
+     */
+    template<typename ReaderT>
+    void readFrom(tars::TarsInputStream<ReaderT> &is, uint8_t tag, bool isRequire = true)
+    {
+        clear();
+
+        if (!is.skipToTag(tag))
+        {
+            if (isRequire)
+            {
+                char s[64];
+                snprintf(s, sizeof(s), "require field not exist, tag: %d", tag);
+                throw tars::TarsDecodeRequireNotExist(s);
+            }
+            return;
+        }
+
+        tars::DataHead h;
+        h.readFrom(is);
+        if (h.getType() != tars::DataHead::eMap)
+        {
+            char s[64];
+            snprintf(s, sizeof(s), "read 'map' type mismatch, tag: %d, get type: %d.", tag, h.getType());
+            throw tars::TarsDecodeMismatch(s);
+        }
+
+        tars::UInt32 size = 0;
+        is.read(size, 0);
+        if (size > is.size())
+        {
+            char s[128];
+            snprintf(s, sizeof(s), "invalid map, tag: %d, size: %d", tag, size);
+            throw tars::TarsDecodeInvalidValue(s);
+        }
+
+        _entries.reserve(size);
+
+        std::string name;
+        std::vector<tars::Char> compat;
+        for (tars::UInt32 i = 0; i < size; i++)
+        {
+            const char *data = NULL;
+            size_t len = 0;
+            is.read(name, 0);
+            is.readView(data, len, compat, 1);
+            insert(name, data, len);
+        }
+    }
+
+protected:
+    bool put(const std::string &name, const char *buf, size_t len, bool overwrite)
+    {
+        uint32_t h = hash(name);
+        size_t i = indexOf(name, h);
+        if (i != npos() && !overwrite)
+        {
+            return false;
+        }
+        if (i == npos())
+        {
+            if (_entries.empty())
+            {
+                _entries.reserve(16);
+                _buffer.reserve(1024);
+            }
+
+            Entry e;
+            e.hash      = h;
+            e.offset    = 0;
+            e.length    = 0;
+            e.capacity  = 0;
+            e.name      = name;
+            _entries.push_back(e);
+            i = _entries.size() - 1;
+            addIndex(i);
+        }
+
+        Entry &e = _entries[i];
+        if (len > e.capacity)
+        {
+            _garbage   += e.capacity;
+            e.offset    = (uint32_t)_buffer.size();
+            e.capacity  = (uint32_t)len;
+            _buffer.insert(_buffer.end(), buf, buf + len);
+        }
+        else if (len > 0)
+        {
+            memcpy(&_buffer[e.offset], buf, len);
+        }
+        e.length = (uint32_t)len;
+
+        //覆盖太多的话整理一下
+        if (_garbage > 4096 && _garbage * 2 > _buffer.size())
+        {
+            compact();
+        }
+
+        ++_version;
+        return true;
+    }
+
+    static size_t npos() { return (size_t)-1; }
+
+    /**
+     * FNV-1a, 不依赖util, tup可以单独使用(iphone/android)
+     */
+    static uint32_t hash(const std::string &name)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            h ^= (uint8_t)name[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    size_t indexOf(const std::string &name, uint32_t h) const
+    {
+        if (_index.empty())
+        {
+            for (size_t i = 0; i < _entries.size(); i++)
+            {
+                if (_entries[i].hash == h && _entries[i].name == name)
+                {
+                    return i;
+                }
+            }
+            return npos();
+        }
+
+        size_t mask = _index.size() - 1;
+        for (size_t pos = h & mask; _index[pos] != 0; pos = (pos + 1) & mask)
+        {
+            const Entry &e = _entries[_index[pos] - 1];
+            if (e.hash == h && e.name == name)
+            {
+                return _index[pos] - 1;
+            }
+        }
+        return npos();
+    }
+
+    /**
+     * 属性超过16个才建索引, 负载不超过1/2, 存下标+1, 0表示空
+     */
+    void addIndex(size_t i)
+    {
+        if (_entries.size() <= 16)
+        {
+            return;
+        }
+
+        if (_entries.size() * 2 > _index.size())
+        {
+            size_t cap = 64;
+            while (cap < _entries.size() * 4)
+            {
+                cap <<= 1;
+            }
+            _index.assign(cap, 0);
+            for (size_t j = 0; j < _entries.size(); j++)
+            {
+                insertIndex(j);
+            }
+        }
+        else
+        {
+            insertIndex(i);
+        }
+    }
+
+    void insertIndex(size_t i)
+    {
+        size_t mask = _index.size() - 1;
+        size_t pos = _entries[i].hash & mask;
+        while (_index[pos] != 0)
+        {
+            pos = (pos + 1) & mask;
+        }
+        _index[pos] = (uint32_t)i + 1;
+    }
+
+    void compact()
+    {
+        std::vector<char, Alloc<char> > buffer;
+        buffer.reserve(_buffer.size() - _garbage);
+        for (size_t i = 0; i < _entries.size(); i++)
+        {
+            Entry &e = _entries[i];
+            size_t offset = buffer.size();
+            buffer.insert(buffer.end(), _buffer.begin() + e.offset, _buffer.begin() + e.offset + e.length);
+            e.offset = (uint32_t)offset;
+            e.capacity = e.length;
+        }
+        _buffer.swap(buffer);
+        _garbage = 0;
+    }
+
+    bool isSorted() const
+    {
+        for (size_t i = 1; i < _entries.size(); i++)
+        {
+            if (!(_entries[i - 1].name < _entries[i].name))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename WriterT>
+    void writeEntry(tars::TarsOutputStream<WriterT> &os, const Entry &e) const
+    {
+        os.write(e.name, 0);
+        os.write(tars::TarsBytesView(data(e), e.length), 1);
+    }
+
+protected:
+    std::vector<Entry, Alloc<Entry> >       _entries;
+    std::vector<char, Alloc<char> >         _buffer;
+    std::vector<uint32_t, Alloc<uint32_t> > _index;
+    size_t                                  _garbage;   //被覆盖的空间
+    size_t                                  _version;
+};
+
 /////////////////////////////////////////////////////////////////////////////////
 // 属性封装类
 
-template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferWriter,template<typename> class Alloc = std::allocator >
+template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferReader,template<typename> class Alloc = std::allocator >
         //template<typename> class Alloc = __gnu_cxx::__pool_alloc >
 class UniAttribute
 {
-    typedef std::vector<char,Alloc<char> > VECTOR_CHAR_TYPE;
-    typedef std::map<std::string, VECTOR_CHAR_TYPE, std::less<std::string>,Alloc< std::pair<const std::string,VECTOR_CHAR_TYPE > > > VECTOR_CHAR_IN_MAP_TYPE;
-    typedef std::map<std::string, VECTOR_CHAR_IN_MAP_TYPE, std::less<std::string>,Alloc< std::pair<const std::string,VECTOR_CHAR_IN_MAP_TYPE > > >   WUP_DATA_TYPE;
+    typedef UniAttrData<Alloc> DATA_TYPE;
 
 public:
 	/**
@@ -79,11 +416,7 @@ public:
 
         os.write(t, 0);
 
-		VECTOR_CHAR_TYPE & v = _data[name];
-        
-        os.swap(v);
-		// v.assign(os.getBuffer(), os.getBuffer() + os.getLength());
-
+        _data.set(name, os.getBuffer(), os.getLength());
     }
 
     void putUnknown(const std::string& name, const std::string& value)
@@ -91,21 +424,17 @@ public:
         os.reset();
         os.writeUnknownV2(value);
 
-        VECTOR_CHAR_TYPE & v = _data[name];
-        os.swap(v);
-        // v.assign(os.getBuffer(), os.getBuffer() + os.getLength());
+        _data.set(name, os.getBuffer(), os.getLength());
     }
 
     void getUnknown(const std::string& name, std::string& value)
     {
-        typename VECTOR_CHAR_IN_MAP_TYPE::iterator mit;
+        const typename DATA_TYPE::Entry *e = _data.find(name);
 
-        mit = _data.find(name);
-
-        if (mit != _data.end() && mit->second.size()>2)
+        if (e != NULL && e->length > 2)
         {
             //去掉DataHead::eStructBegin,DataHead::eStructEnd
-            value = std::string(&mit->second[0]+1, mit->second.size()-2);
+            value = std::string(_data.data(*e) + 1, e->length - 2);
             return;
 
         }
@@ -122,15 +451,13 @@ public:
      */
     template<typename T> void get(const std::string& name, T& t)
     {
-        typename VECTOR_CHAR_IN_MAP_TYPE::iterator mit;
-
-        mit = _data.find(name);
+        const typename DATA_TYPE::Entry *e = _data.find(name);
 
-        if (mit != _data.end())
+        if (e != NULL)
         {
 	        is.reset();
 
-	        is.setBuffer(mit->second);
+	        is.setBuffer(_data.data(*e), e->length);
 
 	        is.read(t, 0, true);
 
@@ -207,7 +534,7 @@ public:
     {
         os.reset();
 
-        os.write(_data, 0);
+        _data.writeTo(os, 0);
 
         os.swap(buff);	
         // buff.assign(os.getBuffer(), os.getLength());
@@ -221,7 +548,7 @@ public:
     {
         os.reset();
 
-        os.write(_data, 0);
+        _data.writeTo(os, 0);
 
         os.swap(buff);
         // buff.assign(os.getBuffer(), os.getBuffer() + os.getLength());
@@ -237,7 +564,7 @@ public:
     {   
         os.reset();
 
-        os.write(_data, 0);
+        _data.writeTo(os, 0);
 
         if(len < os.getLength()) throw std::runtime_error("encode error, buffer length too short");
         memcpy(buff, os.getBuffer(), os.getLength());
@@ -256,9 +583,7 @@ public:
 
         is.setBuffer(buff, len);
 
-        _data.clear();
-	
-        is.read(_data, 0, true);
+        _data.readFrom(is, 0, true);
 		
     }
     /**
@@ -273,20 +598,42 @@ public:
 
         is.setBuffer(buff);
 	
-        _data.clear();
-	
-        is.read(_data, 0, true);
+        _data.readFrom(is, 0, true);
 		
     }
 
     /**
      * 获取已有的属性
+     * 属性平铺存储, 第一次调用(或者属性修改以后)才构造map缓存起来, 返回的引用在下次修改属性之前不变
+     * 构造缓存时加锁, 多个线程可以同时对同一个对象调用getData
+     * 只是遍历属性的话用getFlatData, 不需要构造map
      * 
-     * @return const std::map<std::string,map<std::string,vector<char>>>& : 属性map
+     * @return const std::map<std::string,vector<char>>& : 属性map
      */
     const std::map<std::string, std::vector<char> >& getData() const
     {
-	    return _data;
+        std::lock_guard<std::mutex> lock(_dataMapMutex);
+        if (_dataMapVersion != _data.version())
+        {
+            _dataMap.clear();
+            for (size_t i = 0; i < _data.entries().size(); i++)
+            {
+                const typename DATA_TYPE::Entry &e = _data.entries()[i];
+                _dataMap[e.name].assign(_data.data(e), _data.data(e) + e.length);
+            }
+            _dataMapVersion = _data.version();
+        }
+	    return _dataMap;
+    }
+
+    /**
+     * 获取平铺存储的属性, 不构造map
+     * 
+     * @return const UniAttrData<Alloc>& : entries()是属性列表(按put/解码的顺序), data(entry)是属性值的编码结果
+     */
+    const DATA_TYPE& getFlatData() const
+    {
+        return _data;
     }
 
     /**
@@ -317,13 +664,20 @@ public:
      */
     bool containsKey(const std::string & key)
     {
-        return _data.find(key) != _data.end();
+        return _data.find(key) != NULL;
     }
 
 protected:
-    VECTOR_CHAR_IN_MAP_TYPE _data;
+    DATA_TYPE _data;
     short _iVer;
 
+    /**
+     * getData的缓存, 和_data的版本一致时有效
+     */
+    mutable std::map<std::string, std::vector<char> >   _dataMap;
+    mutable size_t                                      _dataMapVersion = (size_t)-1;
+    mutable std::mutex                                  _dataMapMutex;
+
 public:
     tars::TarsInputStream<TReader>     is;
     tars::TarsOutputStream<TWriter>    os;
@@ -332,7 +686,7 @@ public:
 /////////////////////////////////////////////////////////////////////////////////
 // 请求、回应包封装类
 
-template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferWriter,template<typename> class Alloc = std::allocator >
+template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferReader,template<typename> class Alloc = std::allocator >
 struct UniPacket : protected  tars::RequestPacket, public UniAttribute<TWriter, TReader, Alloc>
 {
 public:
@@ -354,8 +708,6 @@ public:
         UniAttribute<TWriter, TReader,Alloc>::_iVer = iVersion;
 
         UniAttribute<TWriter, TReader,Alloc>::_data.clear();
-
-        UniAttribute<TWriter, TReader,Alloc>::_data.clear();
     }
 
     /**
@@ -416,7 +768,7 @@ public:
      */
     void encode(char* buff, size_t & len)
     {
-        tars::TarsOutputStream<TWriter>& os = UniAttribute<TWriter, TReader>::os;
+        tars::TarsOutputStream<TWriter>& os = UniAttribute<TWriter, TReader,Alloc>::os;
 
         os.reset();
 
@@ -460,9 +812,7 @@ public:
 
         is.setBuffer(sBuffer);
 
-        UniAttribute<TWriter, TReader,Alloc>::_data.clear();
-	
-        is.read(UniAttribute<TWriter, TReader,Alloc>::_data, 0, true);
+        UniAttribute<TWriter, TReader,Alloc>::_data.readFrom(is, 0, true);
 		
     }
 public:
@@ -506,7 +856,7 @@ protected:
     template<typename T>
     void encodeBuff(T& buff)
     {
-        tars::TarsOutputStream<TWriter>& os = UniAttribute<TWriter, TReader>::os;
+        tars::TarsOutputStream<TWriter>& os = UniAttribute<TWriter, TReader,Alloc>::os;
 
         os.reset();
 
@@ -541,7 +891,7 @@ protected:
 
         os.reset();
 
-        os.write(UniAttribute<TWriter, TReader>::_data, 0);
+        UniAttribute<TWriter, TReader,Alloc>::_data.writeTo(os, 0);
 
         os.swap(sBuffer);
 
@@ -552,7 +902,7 @@ protected:
 /////////////////////////////////////////////////////////////////////////////////
 // 调用TARS的服务时使用的类
 
-template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferWriter,template<typename> class Alloc = std::allocator>
+template<typename TWriter = tars::BufferWriter, typename TReader = tars::BufferReader,template<typename> class Alloc = std::allocator>
 struct TarsUniPacket: public UniPacket<TWriter, TReader,Alloc>
 {
 public:
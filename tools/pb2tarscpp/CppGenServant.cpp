@@ -40,11 +40,11 @@ static std::string GenDispatchCase(const ::google::protobuf::MethodDescriptor* m
     out += "{";
     out += LineFeed(++indent);
     out += "tars::TarsInputStream<tars::BufferReader> _is;" + LineFeed(indent) +
-           "_is.setBuffer(_current->getRequestBuffer());" + LineFeed(indent);
+           "_is.setBuffer(_current->getRequestData(), _current->getRequestLength());" + LineFeed(indent);
     out += LineFeed(indent);
 
     out += ToCppNamespace(method->input_type()->full_name()) + " req;" + LineFeed(indent);
-    out += "req.ParseFromArray(&_current->getRequestBuffer()[0], _current->getRequestBuffer().size());" + LineFeed(indent);
+    out += "req.ParseFromArray(_current->getRequestData(), _current->getRequestLength());" + LineFeed(indent);
     out += LineFeed(indent);
 
     out += ToCppNamespace(method->output_type()->full_name()) + " _ret = " + method->name() + "(req, _current);" +  LineFeed(indent);
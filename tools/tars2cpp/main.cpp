@@ -34,6 +34,10 @@ void usage()
     std::cout << "  --tarsMaster                                create get registry info interface"  << std::endl;
     std::cout << "  --currentPriority						   use current path first."  << std::endl;
     std::cout << "  --without-trace                             不需要调用链追踪逻辑"  << std::endl;
+    std::cout << "  --view                                      create XxxView struct, string/vector<byte> fields point into the decoded buffer"  << std::endl;
+    std::cout << "  --lazy                                      create XxxLazy accessors, decode only the requested fields"  << std::endl;
+    std::cout << "  --arena                                     containers use TC_ArenaAllocator, server side params are allocated on the request's arena"  << std::endl;
+    std::cout << "  --coawait                                   create C++20 co_await proxy interface(co_xxx) and coroutine servant(XxxCoServant), enabled when compiled with -std=c++20"  << std::endl;
     std::cout << "  tars2cpp support type: bool byte short int long float double vector map"  << std::endl;
     exit(0);
 }
@@ -154,6 +158,14 @@ int main(int argc, char* argv[])
 
     t2c.setTarsMaster(option.hasParam("tarsMaster"));
 
+    t2c.setViewSupport(option.hasParam("view"));
+
+    t2c.setLazySupport(option.hasParam("lazy"));
+
+    t2c.setArenaSupport(option.hasParam("arena"));
+
+    t2c.setCoAwaitSupport(option.hasParam("coawait"));
+
     try
     {
         //增加include搜索路径
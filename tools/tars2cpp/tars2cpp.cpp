@@ -18,6 +18,7 @@
 #include "util/tc_md5.h"
 #include "util/tc_file.h"
 #include "util/tc_common.h"
+#include "util/tc_hash_fun.h"
 #include <string>
 
 #define TAB g_parse->getTab()
@@ -37,6 +38,11 @@ Tars2Cpp::Tars2Cpp()
 // , _unknownField(false)
 , _tarsMaster(false)
 , _bTrace(true)
+, _bViewSupport(false)
+, _bLazySupport(false)
+, _bArenaSupport(false)
+, _bCoAwaitSupport(false)
+, _bNoAllocType(false)
 {
 
 }
@@ -380,6 +386,134 @@ std::string Tars2Cpp::writeTo(const TypeIdPtr& pPtr) const
     return s.str();
 }
 
+std::string Tars2Cpp::encodedSize(const TypeIdPtr& pPtr) const
+{
+    std::ostringstream s;
+    if (EnumPtr::dynamicCast(pPtr->getTypePtr()))
+    {
+        s << TAB << "_sz += " + _namespace + "::TarsEncodedSize::of((" + _namespace + "::Int32)" << pPtr->getId() << ", " << pPtr->getTag() << ");" << std::endl;
+    }
+    else if (pPtr->getTypePtr()->isArray())
+    {
+        s << TAB << "_sz += " + _namespace + "::TarsEncodedSize::of((const " << tostr(pPtr->getTypePtr()) << " *)" << pPtr->getId() << ", " << pPtr->getId() << "Len" << ", " << pPtr->getTag() << ");" << std::endl;
+    }
+    else if (pPtr->getTypePtr()->isPointer())
+    {
+        s << TAB << "_sz += " + _namespace + "::TarsEncodedSize::of((const " << tostr(pPtr->getTypePtr()) << ")" << pPtr->getId() << ", " << pPtr->getId() << "Len" << ", " << pPtr->getTag() << ");" << std::endl;
+    }
+    else
+    {
+        MapPtr mPtr = MapPtr::dynamicCast(pPtr->getTypePtr());
+        VectorPtr vPtr = VectorPtr::dynamicCast(pPtr->getTypePtr());
+
+        if (!_checkDefault || pPtr->isRequire() || (!pPtr->hasDefault() && !mPtr && !vPtr))
+        {
+            s << TAB << "_sz += " + _namespace + "::TarsEncodedSize::of(" << pPtr->getId() << ", " << pPtr->getTag() << ");" << std::endl;
+        }
+        else
+        {
+            std::string sDefault = pPtr->def();
+
+            BuiltinPtr bPtr = BuiltinPtr::dynamicCast(pPtr->getTypePtr());
+            if (bPtr && bPtr->kind() == Builtin::KindString)
+            {
+                sDefault = "\"" + tars::TC_Common::replace(pPtr->def(), "\"", "\\\"") + "\"";
+            }
+
+            if (mPtr || vPtr)
+            {
+                s << TAB << "if (" << pPtr->getId() << ".size() > 0)" << std::endl;
+            }
+            else
+            {
+                s << TAB << "if (" << pPtr->getId() << " != " << sDefault << ")" << std::endl;
+            }
+
+            s << TAB << "{" << std::endl;
+            INC_TAB;
+            s << TAB << "_sz += " + _namespace + "::TarsEncodedSize::of(" << pPtr->getId() << ", " << pPtr->getTag() << ");" << std::endl;
+            DEL_TAB;
+            s << TAB << "}" << std::endl;
+        }
+    }
+
+    return s.str();
+}
+
+bool Tars2Cpp::isFlat(const TypePtr &pPtr) const
+{
+    if (pPtr->isArray() || pPtr->isPointer())
+    {
+        return false;
+    }
+
+    if (pPtr->isSimple())
+    {
+        return true;
+    }
+
+    BuiltinPtr bPtr = BuiltinPtr::dynamicCast(pPtr);
+    if (bPtr && bPtr->kind() == Builtin::KindString)
+    {
+        return true;
+    }
+
+    VectorPtr vPtr = VectorPtr::dynamicCast(pPtr);
+    if (vPtr)
+    {
+        BuiltinPtr ePtr = BuiltinPtr::dynamicCast(vPtr->getTypePtr());
+        return ePtr && ePtr->kind() == Builtin::KindByte;
+    }
+
+    return false;
+}
+
+std::string Tars2Cpp::reserveExact(const OperationPtr &pPtr, bool bResponse, bool bWithOut) const
+{
+    std::vector<TypeIdPtr> vType;
+
+    if (bResponse && pPtr->getReturnPtr()->getTypePtr())
+    {
+        vType.push_back(pPtr->getReturnPtr());
+    }
+
+    std::vector<ParamDeclPtr>& vParamDecl = pPtr->getAllParamDeclPtr();
+    for (size_t i = 0; i < vParamDecl.size(); i++)
+    {
+        if (bResponse ? vParamDecl[i]->isOut() : (bWithOut || !vParamDecl[i]->isOut()))
+        {
+            vType.push_back(vParamDecl[i]->getTypeIdPtr());
+        }
+    }
+
+    std::ostringstream s;
+    if (vType.empty())
+    {
+        return s.str();
+    }
+
+    for (size_t i = 0; i < vType.size(); i++)
+    {
+        if (!isFlat(vType[i]->getTypePtr()))
+        {
+            return s.str();
+        }
+    }
+
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "size_t _sz = 0;" << std::endl;
+    for (size_t i = 0; i < vType.size(); i++)
+    {
+        s << encodedSize(vType[i]);
+    }
+    s << TAB << "_os.reserveExact(_sz);" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    return s.str();
+}
+
 std::string Tars2Cpp::readFrom(const TypeIdPtr& pPtr, bool bIsRequire) const
 {
     std::ostringstream s;
@@ -622,6 +756,11 @@ std::string Tars2Cpp::tostrVector(const VectorPtr& pPtr) const
 
     std::string s = std::string("std::vector<") + tostr(pPtr->getTypePtr());
 
+    if (_bArenaSupport && !_bNoAllocType)
+    {
+        s += ", tars::TC_ArenaAllocator<" + tostr(pPtr->getTypePtr()) + " > ";
+    }
+
     if (MapPtr::dynamicCast(pPtr->getTypePtr()) || VectorPtr::dynamicCast(pPtr->getTypePtr()))
     {
         s += " >";
@@ -636,6 +775,12 @@ std::string Tars2Cpp::tostrVector(const VectorPtr& pPtr) const
 std::string Tars2Cpp::tostrMap(const MapPtr& pPtr) const
 {
     std::string s = std::string("std::map<") + tostr(pPtr->getLeftTypePtr()) + ", " + tostr(pPtr->getRightTypePtr());
+
+    if (_bArenaSupport && !_bNoAllocType)
+    {
+        s += ", std::less<" + tostr(pPtr->getLeftTypePtr()) + " >, tars::TC_ArenaAllocator<std::pair<const " + tostr(pPtr->getLeftTypePtr()) + ", " + tostr(pPtr->getRightTypePtr()) + " > > ";
+    }
+
     if (MapPtr::dynamicCast(pPtr->getRightTypePtr()) || VectorPtr::dynamicCast(pPtr->getRightTypePtr()))
     {
         s += " >";
@@ -657,10 +802,12 @@ std::string Tars2Cpp::MD5(const StructPtr& pPtr) const
 {
     std::string s;
     std::vector<TypeIdPtr>& member = pPtr->getAllMemberPtr();
+    _bNoAllocType = true;
     for (size_t j = 0; j < member.size(); j++)
     {
         s += "_" + tostr(member[j]->getTypePtr());
     }
+    _bNoAllocType = false;
 
     return "\"" + tars::TC_MD5::md5str(s) + "\"";
 }
@@ -671,6 +818,59 @@ std::string Tars2Cpp::tostrEnum(const EnumPtr& pPtr) const
     return pPtr->getSid();
 }
 ///////////////////////////////////////////////////////////////////////
+std::string Tars2Cpp::generateFieldConstructor(const StructPtr& pPtr) const
+{
+    std::vector<TypeIdPtr>& member = pPtr->getAllMemberPtr();
+    if (member.empty())
+    {
+        return "";
+    }
+
+    //数组和指针成员的长度是单独的字段, 不生成
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        if (member[j]->getTypePtr()->isArray() || member[j]->getTypePtr()->isPointer())
+        {
+            return "";
+        }
+    }
+
+    std::ostringstream s;
+
+    //按值传入, 非简单类型move到成员上, 调用方传右值时没有拷贝, 也可以直接emplace_back(...)
+    s << TAB << (member.size() == 1 ? "explicit " : "") << pPtr->getId() << "(";
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << (j == 0 ? "" : ", ") << tostr(member[j]->getTypePtr()) << " _" << member[j]->getId();
+    }
+    s << ")" << std::endl;
+    INC_TAB;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        const std::string &id = member[j]->getId();
+        s << TAB << (j == 0 ? ": " : ", ") << id;
+        if (member[j]->getTypePtr()->isSimple())
+        {
+            s << "(_" << id << ")" << std::endl;
+        }
+        else
+        {
+            s << "(std::move(_" << id << "))" << std::endl;
+        }
+    }
+    DEL_TAB;
+    s << TAB << "{" << std::endl;
+    if (_bXmlSupport)
+    {
+        INC_TAB;
+        s << TAB << "_cdata_format = false;" << std::endl;
+        DEL_TAB;
+    }
+    s << TAB << "}" << std::endl;
+
+    return s.str();
+}
+
 std::string Tars2Cpp::generateH(const StructPtr& pPtr, const std::string& namespaceId) const
 {
     std::ostringstream s;
@@ -801,6 +1001,7 @@ std::string Tars2Cpp::generateH(const StructPtr& pPtr, const std::string& namesp
     DEL_TAB;
     s << TAB << "}" << std::endl;
 
+    s << generateFieldConstructor(pPtr);
 
     //resetDefault()函数
     s << TAB << "void resetDefautlt()" <<  std::endl;
@@ -896,6 +1097,18 @@ std::string Tars2Cpp::generateH(const StructPtr& pPtr, const std::string& namesp
     DEL_TAB;
     s << TAB << "}" << std::endl;
 
+    s << TAB << "size_t tars_encoded_size() const" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "size_t _sz = 0;" << std::endl;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << encodedSize(member[j]);
+    }
+    s << TAB << "return _sz;" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
     ///////////////////////////////////////////////////////////
     s << TAB << "template<typename ReaderT>" << std::endl;
     s << TAB << "void readFrom(" + _namespace + "::TarsInputStream<ReaderT>& _is)" << std::endl;
@@ -1255,6 +1468,317 @@ std::string Tars2Cpp::generateH(const StructPtr& pPtr, const std::string& namesp
     return s.str();
 }
 
+/*******************************View********************************/
+bool Tars2Cpp::isViewSupport(const StructPtr& pPtr) const
+{
+    std::vector<TypeIdPtr>& member = pPtr->getAllMemberPtr();
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        if (member[j]->getTypePtr()->isArray() || member[j]->getTypePtr()->isPointer())
+        {
+            return false;
+        }
+
+        //容器里面的结构体也要能生成View
+        TypePtr tPtr = member[j]->getTypePtr();
+        while (true)
+        {
+            VectorPtr vPtr = VectorPtr::dynamicCast(tPtr);
+            MapPtr mPtr = MapPtr::dynamicCast(tPtr);
+            if (vPtr)
+            {
+                tPtr = vPtr->getTypePtr();
+            }
+            else if (mPtr)
+            {
+                StructPtr kPtr = StructPtr::dynamicCast(mPtr->getLeftTypePtr());
+                if (kPtr && !isViewSupport(kPtr))
+                {
+                    return false;
+                }
+                tPtr = mPtr->getRightTypePtr();
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        StructPtr sPtr = StructPtr::dynamicCast(tPtr);
+        if (sPtr && !isViewSupport(sPtr))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string Tars2Cpp::tostrView(const TypePtr& pPtr) const
+{
+    BuiltinPtr bPtr = BuiltinPtr::dynamicCast(pPtr);
+    if (bPtr && bPtr->kind() == Builtin::KindString)
+    {
+        return _namespace + "::TarsStringView";
+    }
+
+    VectorPtr vPtr = VectorPtr::dynamicCast(pPtr);
+    if (vPtr)
+    {
+        BuiltinPtr ePtr = BuiltinPtr::dynamicCast(vPtr->getTypePtr());
+        if (ePtr && ePtr->kind() == Builtin::KindByte)
+        {
+            return _namespace + "::TarsBytesView";
+        }
+
+        std::string s = std::string("std::vector<") + tostrView(vPtr->getTypePtr());
+        s += (MapPtr::dynamicCast(vPtr->getTypePtr()) || VectorPtr::dynamicCast(vPtr->getTypePtr())) ? " >" : ">";
+        return s;
+    }
+
+    MapPtr mPtr = MapPtr::dynamicCast(pPtr);
+    if (mPtr)
+    {
+        std::string s = std::string("std::map<") + tostrView(mPtr->getLeftTypePtr()) + ", " + tostrView(mPtr->getRightTypePtr());
+        s += (MapPtr::dynamicCast(mPtr->getRightTypePtr()) || VectorPtr::dynamicCast(mPtr->getRightTypePtr())) ? " >" : ">";
+        return s;
+    }
+
+    StructPtr sPtr = StructPtr::dynamicCast(pPtr);
+    if (sPtr)
+    {
+        return sPtr->getSid() + "View";
+    }
+
+    return tostr(pPtr);
+}
+
+std::string Tars2Cpp::generateViewH(const StructPtr& pPtr) const
+{
+    std::ostringstream s;
+
+    std::string id = pPtr->getId() + "View";
+    std::vector<TypeIdPtr>& member = pPtr->getAllMemberPtr();
+
+    s << TAB << "/* view of " << pPtr->getId() << ", string/vector<byte> fields point into the decoded buffer, only valid while the buffer is alive */" << std::endl;
+    s << TAB << "struct " << id << " : public " + _namespace + "::TarsStructBase" << std::endl;
+    s << TAB << "{" << std::endl;
+    s << TAB << "public:" << std::endl;
+    INC_TAB;
+
+    s << TAB << id << "()" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "resetDefautlt();" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    s << TAB << "void resetDefautlt()" <<  std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        BuiltinPtr bPtr = BuiltinPtr::dynamicCast(member[j]->getTypePtr());
+        VectorPtr vPtr = VectorPtr::dynamicCast(member[j]->getTypePtr());
+        MapPtr mPtr = MapPtr::dynamicCast(member[j]->getTypePtr());
+        if (vPtr || mPtr)
+        {
+            s << TAB << member[j]->getId() << ".clear();" << std::endl;
+        }
+        else if (StructPtr::dynamicCast(member[j]->getTypePtr()))
+        {
+            s << TAB << member[j]->getId() << ".resetDefautlt();" << std::endl;
+        }
+        else if (member[j]->hasDefault())
+        {
+            if (bPtr && bPtr->kind() == Builtin::KindString)
+            {
+                //字面量是静态存储的, 可以直接指向
+                std::string tmp = tars::TC_Common::replace(member[j]->def(), "\"", "\\\"");
+                s << TAB << member[j]->getId() << " = \"" << tmp << "\";" << std::endl;
+            }
+            else
+            {
+                s << TAB << member[j]->getId() << " = " << member[j]->def() << ";" << std::endl;
+            }
+        }
+        else
+        {
+            EnumPtr ePtr = EnumPtr::dynamicCast(member[j]->getTypePtr());
+            if (ePtr)
+            {
+                std::vector<TypeIdPtr>& eMember = ePtr->getAllMemberPtr();
+                if (eMember.size() > 0)
+                {
+                    std::string sid = ePtr->getSid();
+                    s << TAB << member[j]->getId() << " = " << sid.substr(0, sid.find_first_of("::")) << "::" << eMember[0]->getId() << ";" << std::endl;
+                }
+            }
+            else if (bPtr && bPtr->kind() == Builtin::KindString)
+            {
+                s << TAB << member[j]->getId() << ".clear();" << std::endl;
+            }
+        }
+    }
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    s << TAB << "template<typename WriterT>" << std::endl;
+    s << TAB << "void writeTo(" + _namespace + "::TarsOutputStream<WriterT>& _os) const" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << writeTo(member[j]);
+    }
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    s << TAB << "size_t tars_encoded_size() const" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "size_t _sz = 0;" << std::endl;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << encodedSize(member[j]);
+    }
+    s << TAB << "return _sz;" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    s << TAB << "template<typename ReaderT>" << std::endl;
+    s << TAB << "void readFrom(" + _namespace + "::TarsInputStream<ReaderT>& _is)" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "resetDefautlt();" << std::endl;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << readFrom(member[j]);
+    }
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    DEL_TAB;
+    s << TAB << "public:" << std::endl;
+    INC_TAB;
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        s << TAB << tostrView(member[j]->getTypePtr()) << " " << member[j]->getId() << ";" << std::endl;
+    }
+    DEL_TAB;
+    s << TAB << "};" << std::endl;
+
+    //作为map的key需要<
+    std::vector<std::string> key = pPtr->getKey();
+    if (key.size() > 0)
+    {
+        s << TAB << "inline bool operator<(const " << id << "&l, const " << id << "&r)" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+        for (size_t i = 0; i < key.size(); i++)
+        {
+            s << TAB << "if(l." << key[i] << " != r." << key[i] << ") return (l." << key[i] << " < r." << key[i] << ");" << std::endl;
+        }
+        s << TAB << "return false;" << std::endl;
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
+    }
+
+    return s.str();
+}
+
+/*******************************Lazy********************************/
+std::string Tars2Cpp::generateLazyH(const StructPtr& pPtr) const
+{
+    std::ostringstream s;
+
+    std::string id = pPtr->getId() + "Lazy";
+    std::vector<TypeIdPtr>& member = pPtr->getAllMemberPtr();
+
+    s << TAB << "/* lazy accessors of " << pPtr->getId() << ", index the tags in one pass and decode only the requested fields */" << std::endl;
+    s << TAB << "struct " << id << " : public " + _namespace + "::TarsTagIndex" << std::endl;
+    s << TAB << "{" << std::endl;
+    s << TAB << "public:" << std::endl;
+    INC_TAB;
+
+    s << TAB << id << "() {}" << std::endl;
+    s << TAB << id << "(const char *buf, size_t len) : " + _namespace + "::TarsTagIndex(buf, len) {}" << std::endl;
+
+    for (size_t j = 0; j < member.size(); j++)
+    {
+        //数组/指针类型需要MapBufferReader, 不支持
+        if (member[j]->getTypePtr()->isArray() || member[j]->getTypePtr()->isPointer())
+        {
+            continue;
+        }
+
+        std::string sRequire = member[j]->isRequire() ? "true" : "false";
+        EnumPtr ePtr = EnumPtr::dynamicCast(member[j]->getTypePtr());
+        BuiltinPtr bPtr = BuiltinPtr::dynamicCast(member[j]->getTypePtr());
+        StructPtr sPtr = StructPtr::dynamicCast(member[j]->getTypePtr());
+
+        s << TAB << tostr(member[j]->getTypePtr()) << " " << member[j]->getId() << "() const" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+        if (ePtr)
+        {
+            std::string sDefault;
+            if (member[j]->hasDefault())
+            {
+                sDefault = member[j]->def();
+            }
+            else if (ePtr->getAllMemberPtr().size() > 0)
+            {
+                std::string sid = ePtr->getSid();
+                sDefault = sid.substr(0, sid.find_first_of("::")) + "::" + ePtr->getAllMemberPtr()[0]->getId();
+            }
+            s << TAB << _namespace + "::Int32 _v" << (sDefault.empty() ? "" : " = (" + _namespace + "::Int32)" + sDefault) << ";" << std::endl;
+            s << TAB << "tars_read(_v, " << member[j]->getTag() << ", " << sRequire << ");" << std::endl;
+            s << TAB << "return (" << tostr(member[j]->getTypePtr()) << ")_v;" << std::endl;
+        }
+        else
+        {
+            if (bPtr && member[j]->hasDefault())
+            {
+                if (bPtr->kind() == Builtin::KindString)
+                {
+                    std::string tmp = tars::TC_Common::replace(member[j]->def(), "\"", "\\\"");
+                    s << TAB << tostr(member[j]->getTypePtr()) << " _v = \"" << tmp << "\";" << std::endl;
+                }
+                else
+                {
+                    s << TAB << tostr(member[j]->getTypePtr()) << " _v = " << member[j]->def() << ";" << std::endl;
+                }
+            }
+            else
+            {
+                s << TAB << tostr(member[j]->getTypePtr()) << " _v;" << std::endl;
+            }
+            s << TAB << "tars_read(_v, " << member[j]->getTag() << ", " << sRequire << ");" << std::endl;
+            s << TAB << "return _v;" << std::endl;
+        }
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
+
+        //结构体字段可以继续按需解码
+        if (sPtr)
+        {
+            s << TAB << sPtr->getSid() << "Lazy " << member[j]->getId() << "_lazy() const" << std::endl;
+            s << TAB << "{" << std::endl;
+            INC_TAB;
+            s << TAB << sPtr->getSid() << "Lazy _v;" << std::endl;
+            s << TAB << "tars_sub(" << member[j]->getTag() << ", _v, " << sRequire << ");" << std::endl;
+            s << TAB << "return _v;" << std::endl;
+            DEL_TAB;
+            s << TAB << "}" << std::endl;
+        }
+    }
+
+    DEL_TAB;
+    s << TAB << "};" << std::endl;
+
+    return s.str();
+}
+
 /*******************************ContainerPtr********************************/
 std::string Tars2Cpp::generateH(const ContainerPtr& pPtr) const
 {
@@ -1631,8 +2155,13 @@ std::string Tars2Cpp::generateInitValue(const TypeIdPtr& pPtr) const
 std::string Tars2Cpp::generateServantDispatch(const OperationPtr& pPtr, const std::string& cn) const
 {
     std::ostringstream s;
+    if (_bArenaSupport)
+    {
+        //参数的构造和解码都分配在请求的arena上, 调用业务接口前恢复, 避免业务切协程时串用
+        s << TAB << "tars::TC_Arena::Scope _arenaScope(_current->getArena());" << std::endl;
+    }
     s << TAB << _namespace + "::TarsInputStream<" + _namespace + "::BufferReader> _is;" << std::endl;
-    s << TAB << "_is.setBuffer(_current->getRequestBuffer());" << std::endl;
+    s << TAB << "_is.setBuffer(_current->getRequestData(), _current->getRequestLength());" << std::endl;
 
     std::vector<ParamDeclPtr>& vParamDecl = pPtr->getAllParamDeclPtr();
 
@@ -1756,6 +2285,11 @@ std::string Tars2Cpp::generateServantDispatch(const OperationPtr& pPtr, const st
     DEL_TAB;
     s << TAB << "}" << std::endl;
 
+    if (_bArenaSupport)
+    {
+        s << TAB << "_arenaScope.leave();" << std::endl;
+    }
+
     // 处理调用链
     if (_bTrace)
     {
@@ -1914,6 +2448,7 @@ std::string Tars2Cpp::generateServantDispatch(const OperationPtr& pPtr, const st
     s << TAB << "{" << std::endl;
     INC_TAB;
     s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+    s << reserveExact(pPtr, true);
 
     if (pPtr->getReturnPtr()->getTypePtr())
     {
@@ -2052,18 +2587,18 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
 {
     std::ostringstream s;
     //生成函数声明
-    s << TAB << "void async_" << pPtr->getId() << "(";
-    s << cn << "PrxCallbackPtr callback,";
-
     std::vector<ParamDeclPtr>& vParamDecl = pPtr->getAllParamDeclPtr();
 
     std::string routekey = "";
+    std::string sParams;
+    std::string sArgs;
 
     for (size_t i = 0; i < vParamDecl.size(); i++)
     {
         if (!vParamDecl[i]->isOut() )
         {
-            s << generateParamDecl(vParamDecl[i]) << ",";
+            sParams += generateParamDecl(vParamDecl[i]) + ",";
+            sArgs += vParamDecl[i]->getTypeIdPtr()->getId() + ", ";
         }
 
 		if (routekey.empty() && vParamDecl[i]->isRouteKey())
@@ -2071,7 +2606,11 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
             routekey = vParamDecl[i]->getTypeIdPtr()->getId();
         }
     }
-    s << "const std::map<std::string, std::string>& context = TARS_CONTEXT())";
+
+    //context为右值时直接move到请求包里, const引用的版本拷贝一份后转调
+    std::string sDecl = "void async_" + pPtr->getId() + "(" + cn + "PrxCallbackPtr callback," + sParams;
+    s << TAB << sDecl;
+    s << "std::map<std::string, std::string>&& context)";
     s << std::endl;
 
     s << TAB << "{" << std::endl;
@@ -2083,6 +2622,7 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
     }
 
     s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+    s << reserveExact(pPtr, false);
 
     for (size_t i = 0; i < vParamDecl.size(); i++)
     {
@@ -2137,21 +2677,17 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
         s << TAB << "}" << std::endl;
     }
 
-    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, context, _mStatus, callback);" << std::endl;
+    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, std::move(context), std::move(_mStatus), callback);" << std::endl;
     DEL_TAB;
     s << TAB << "}" << std::endl;
+    s << generateContextCopy(sDecl + "const std::map<std::string, std::string>& context = TARS_CONTEXT())",
+        "async_" + pPtr->getId() + "(callback, " + sArgs + "std::map<std::string, std::string>(context))");
     s << TAB << std::endl;
    //promise异步的函数声明
    std::string sStruct = pPtr->getId();
-    s << TAB << "tars::Future< " << cn <<"PrxCallbackPromise::Promise" << sStruct << "Ptr > promise_async_" << pPtr->getId() << "(";
-    for(size_t i = 0; i < vParamDecl.size(); i++)
-    {
-        if (!vParamDecl[i]->isOut())
-        {
-            s << generateParamDecl(vParamDecl[i]) << ",";
-        }
-    }
-    s << "const std::map<std::string, std::string>& context)" << std::endl;
+    sDecl = "tars::Future< " + cn + "PrxCallbackPromise::Promise" + sStruct + "Ptr > promise_async_" + pPtr->getId() + "(" + sParams;
+    s << TAB << sDecl;
+    s << "std::map<std::string, std::string>&& context)" << std::endl;
     s << TAB << "{" << std::endl;
     INC_TAB;
     if (_tarsMaster)
@@ -2162,6 +2698,7 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
     s << TAB << cn << "PrxCallbackPromisePtr callback = new " << cn << "PrxCallbackPromise(promise);" << std::endl;
     s << std::endl;
     s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+    s << reserveExact(pPtr, false);
     for(size_t i = 0; i < vParamDecl.size(); i++)
     {
         if(vParamDecl[i]->isOut())
@@ -2178,27 +2715,105 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
         s << TAB << "_mStatus.insert(std::make_pair(ServantProxy::STATUS_GRID_KEY, " << os.str() << "));" << std::endl;
     }
 
-    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, context, _mStatus, callback);" << std::endl;
+    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, std::move(context), std::move(_mStatus), callback);" << std::endl;
     s << std::endl;
     s << TAB << "return promise.getFuture();" << std::endl;
     DEL_TAB;
     s << TAB << "}" << std::endl;
-    s << std::endl;
+    s << generateContextCopy(sDecl + "const std::map<std::string, std::string>& context)",
+        "promise_async_" + pPtr->getId() + "(" + sArgs + "std::map<std::string, std::string>(context))");
+    s << std::endl;
+
+    //协程并行异步的函数声明
+    sDecl = "void coro_" + pPtr->getId() + "(" + cn + "CoroPrxCallbackPtr callback," + sParams;
+    s << TAB << sDecl;
+    s << "std::map<std::string, std::string>&& context)";
+    s << std::endl;
+
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+
+    if (_tarsMaster)
+    {
+        s << TAB << "this->tars_setMasterFlag(true);" << std::endl;
+    }
+
+    s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+    s << reserveExact(pPtr, false);
+
+    for (size_t i = 0; i < vParamDecl.size(); i++)
+    {
+        if (vParamDecl[i]->isOut())
+        {
+            continue;
+        }
+        s << writeTo(vParamDecl[i]->getTypeIdPtr());
+    }
+
+    s << TAB << "std::map<std::string, std::string> _mStatus;" << std::endl;
+    if (!routekey.empty())
+    {
+        std::ostringstream os;
+
+        os << routekey;
+
+        s << TAB << "_mStatus.insert(std::make_pair(ServantProxy::STATUS_GRID_KEY, " << os.str() << "));" << std::endl;
+    }
+
+    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, std::move(context), std::move(_mStatus), callback, true);" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+    s << generateContextCopy(sDecl + "const std::map<std::string, std::string>& context = TARS_CONTEXT())",
+        "coro_" + pPtr->getId() + "(callback, " + sArgs + "std::map<std::string, std::string>(context))");
+
+    return s.str();
+}
+
+std::string Tars2Cpp::generateContextCopy(const std::string& sDecl, const std::string& sCall) const
+{
+    std::ostringstream s;
+    s << TAB << sDecl << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    s << TAB << "return " << sCall << ";" << std::endl;
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+    return s.str();
+}
 
-    //协程并行异步的函数声明
-    s << TAB << "void coro_" << pPtr->getId() << "(";
-    s << cn << "CoroPrxCallbackPtr callback,";
+std::string Tars2Cpp::generateHCoAwait(const OperationPtr& pPtr) const
+{
+    std::ostringstream s;
+    std::vector<ParamDeclPtr>& vParamDecl = pPtr->getAllParamDeclPtr();
+
+    std::string routekey = "";
+    std::string sParams;
+    std::string sArgs;
+    std::string sCapture;
 
     for (size_t i = 0; i < vParamDecl.size(); i++)
     {
-        if (!vParamDecl[i]->isOut())
+        sParams += generateParamDecl(vParamDecl[i]) + ",";
+        sArgs += vParamDecl[i]->getTypeIdPtr()->getId() + ", ";
+
+        //out参数在恢复时解码, 引用的是调用者协程帧里的变量
+        if (vParamDecl[i]->isOut())
+        {
+            sCapture += std::string(sCapture.empty() ? "" : ", ") + "&" + vParamDecl[i]->getTypeIdPtr()->getId();
+        }
+
+        if (routekey.empty() && vParamDecl[i]->isRouteKey())
         {
-            s << generateParamDecl(vParamDecl[i]) << ",";
+            routekey = vParamDecl[i]->getTypeIdPtr()->getId();
         }
     }
-    s << "const std::map<std::string, std::string>& context = TARS_CONTEXT())";
-    s << std::endl;
 
+    std::string sRet = tostr(pPtr->getReturnPtr()->getTypePtr());
+
+    //C++20 co_await调用, 返回值和同步调用一致
+    s << "#if TARS_CO_AWAIT" << std::endl;
+    std::string sDecl = "auto co_" + pPtr->getId() + "(" + sParams;
+    s << TAB << sDecl << "std::map<std::string, std::string>&& context)" << std::endl;
     s << TAB << "{" << std::endl;
     INC_TAB;
 
@@ -2208,6 +2823,7 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
     }
 
     s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+    s << reserveExact(pPtr, false);
 
     for (size_t i = 0; i < vParamDecl.size(); i++)
     {
@@ -2221,16 +2837,36 @@ std::string Tars2Cpp::generateHAsync(const OperationPtr& pPtr, const std::string
     s << TAB << "std::map<std::string, std::string> _mStatus;" << std::endl;
     if (!routekey.empty())
     {
-        std::ostringstream os;
-
-        os << routekey;
-
-        s << TAB << "_mStatus.insert(std::make_pair(ServantProxy::STATUS_GRID_KEY, " << os.str() << "));" << std::endl;
+        s << TAB << "_mStatus.insert(std::make_pair(ServantProxy::STATUS_GRID_KEY, " << routekey << "));" << std::endl;
     }
 
-    s << TAB << "tars_invoke_async(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, context, _mStatus, callback, true);" << std::endl;
+    s << TAB << "tars::ReqMessage *_msg = tars_new_await(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, std::move(context), std::move(_mStatus));" << std::endl;
+    s << TAB << "return tars::makeAwaitable< " << sRet << " >(this, _msg, [" << sCapture << "](" << _namespace << "::TarsInputStream<" << _namespace << "::BufferReader> &_is)" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+    if (pPtr->getReturnPtr()->getTypePtr())
+    {
+        s << TAB << sRet << " " << pPtr->getReturnPtr()->getId() << generateInitValue(pPtr->getReturnPtr()) << ";" << std::endl;
+        s << readFrom(pPtr->getReturnPtr());
+    }
+    for (size_t i = 0; i < vParamDecl.size(); i++)
+    {
+        if (vParamDecl[i]->isOut())
+        {
+            s << readFrom(vParamDecl[i]->getTypeIdPtr());
+        }
+    }
+    if (pPtr->getReturnPtr()->getTypePtr())
+    {
+        s << TAB << "return " << pPtr->getReturnPtr()->getId() << ";" << std::endl;
+    }
+    DEL_TAB;
+    s << TAB << "});" << std::endl;
     DEL_TAB;
     s << TAB << "}" << std::endl;
+    s << generateContextCopy(sDecl + "const std::map<std::string, std::string>& context = TARS_CONTEXT())",
+        "co_" + pPtr->getId() + "(" + sArgs + "std::map<std::string, std::string>(context))");
+    s << "#endif" << std::endl;
 
     return s.str();
 }
@@ -2245,12 +2881,14 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
 
     if (bVirtual) s << "virtual ";
 
-    s << tostr(pPtr->getReturnPtr()->getTypePtr()) << " " << pPtr->getId() << "(";
+    std::string sDecl = tostr(pPtr->getReturnPtr()->getTypePtr()) + " " + pPtr->getId() + "(";
+    std::string sArgs;
 
     std::string routekey = "";
     for (size_t i = 0; i < vParamDecl.size(); i++)
     {
-        s << generateH(vParamDecl[i]) << ",";
+        sDecl += generateH(vParamDecl[i]) + ",";
+        sArgs += vParamDecl[i]->getTypeIdPtr()->getId() + ", ";
 
         if (routekey.empty() && vParamDecl[i]->isRouteKey())
         {
@@ -2258,13 +2896,15 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
         }
     }
 
+    s << sDecl;
+
     if (bVirtual)
     {
         s << "tars::TarsCurrentPtr current) = 0;";
     }
     else
     {
-        s << "const std::map<std::string, std::string> &context = TARS_CONTEXT(),std::map<std::string, std::string> * pResponseContext = NULL)";
+        s << "std::map<std::string, std::string> &&context,std::map<std::string, std::string> * pResponseContext = NULL)";
 
         s << std::endl;
 
@@ -2278,6 +2918,7 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
         }
 
         s << TAB << _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+        s << reserveExact(pPtr, false, true);
 
         for (size_t i = 0; i < vParamDecl.size(); i++)
         {
@@ -2334,7 +2975,7 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
         }
 
         // s << TAB << "tars_invoke(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os.getByteBuffer(), context, _mStatus, rep);" << std::endl;
-        s << TAB << "std::shared_ptr<" + _namespace + "::ResponsePacket> rep = tars_invoke(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, context, _mStatus);" << std::endl;
+        s << TAB << "std::shared_ptr<" + _namespace + "::ResponsePacket> rep = tars_invoke(tars::TARSNORMAL,\"" << pPtr->getId() << "\", _os, std::move(context), std::move(_mStatus));" << std::endl;
         s << TAB << "if(pResponseContext)" << std::endl;
         s << TAB << "{" << std::endl;
         INC_TAB;
@@ -2417,6 +3058,9 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
         }
         DEL_TAB;
         s << TAB << "}" << std::endl;
+
+        s << generateContextCopy(sDecl + "const std::map<std::string, std::string> &context = TARS_CONTEXT(),std::map<std::string, std::string> * pResponseContext = NULL)",
+            pPtr->getId() + "(" + sArgs + "std::map<std::string, std::string>(context), pResponseContext)");
     }
 
     s << std::endl;
@@ -2537,6 +3181,7 @@ std::string Tars2Cpp::generateH(const OperationPtr& pPtr, bool bVirtual, const s
         INC_TAB;
 
         s << TAB <<  _namespace + "::TarsOutputStream<" + _namespace + "::BufferWriterVector> _os;" << std::endl;
+        s << reserveExact(pPtr, true);
         if(pPtr->getReturnPtr()->getTypePtr())
         {
 	        s << writeTo(pPtr->getReturnPtr()) << std::endl;
@@ -2741,6 +3386,53 @@ std::string Tars2Cpp::generateDispatchPromiseAsync(const OperationPtr &pPtr, con
     return s.str();
 }
 /******************************InterfacePtr***************************************/
+std::string Tars2Cpp::generateDispatch(const std::vector<OperationPtr> &vOperation, const std::string &sFuncName, const std::string &cn, DispatchFunc func) const
+{
+    //按函数名的hash分组, hash冲突的放在同一个case里逐个比较
+    std::map<uint32_t, std::vector<OperationPtr>> mHash;
+    for (size_t i = 0; i < vOperation.size(); i++)
+    {
+        const std::string &id = vOperation[i]->getId();
+        mHash[tars::hash_fnv1a(id.c_str(), id.length())].push_back(vOperation[i]);
+    }
+
+    std::ostringstream s;
+    s << TAB << "const std::string &_sFuncName = " << sFuncName << ";" << std::endl;
+    s << TAB << "switch(tars::hash_fnv1a(_sFuncName.c_str(), _sFuncName.length()))" << std::endl;
+    s << TAB << "{" << std::endl;
+    INC_TAB;
+
+    for (auto it = mHash.begin(); it != mHash.end(); ++it)
+    {
+        s << TAB << "case " << it->first << "u:" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+
+        for (size_t i = 0; i < it->second.size(); i++)
+        {
+            s << TAB << "if(_sFuncName == \"" << it->second[i]->getId() << "\")" << std::endl;
+            s << TAB << "{" << std::endl;
+            INC_TAB;
+
+            s << (this->*func)(it->second[i], cn) << std::endl;
+
+            DEL_TAB;
+            s << TAB << "}" << std::endl;
+        }
+        s << TAB << "break;" << std::endl;
+
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
+    }
+
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
+
+    s << TAB << "return tars::TARSSERVERNOFUNCERR;" << std::endl;
+
+    return s.str();
+}
+
 std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nPtr) const
 {
     std::ostringstream s;
@@ -2792,49 +3484,7 @@ std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nP
     //生成异步回调接口
     s << TAB << "{" << std::endl;
     INC_TAB;
-    std::string dname    = "__" + pPtr->getId() + "_all";
-    std::string dispatch =  "static ::std::string " + dname;
-    s << TAB << dispatch << "[]=" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "\"" << vOperation[i]->getId() << "\"";
-        if (i != vOperation.size() - 1)
-        {
-            s << ",";
-        }
-        s << std::endl;
-
-    }
-    DEL_TAB;
-    s << TAB << "};" << std::endl;
-
-    s << TAB << "std::pair<std::string*, std::string*> r = equal_range(" << dname << ", " << dname << "+" << vOperation.size() << ", std::string(msg->request.sFuncName));" << std::endl;
-
-    s << TAB << "if(r.first == r.second) return tars::TARSSERVERNOFUNCERR;" << std::endl;
-
-    s << TAB << "switch(r.first - " << dname << ")" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "case " << i << ":" << std::endl;
-        s << TAB << "{" << std::endl;
-        INC_TAB;
-
-        s << generateDispatchAsync(vOperation[i], pPtr->getId()) << std::endl;
-
-        DEL_TAB;
-        s << TAB << "}" << std::endl;
-    }
-
-    DEL_TAB;
-    s << TAB << "}" << std::endl;
-
-    s << TAB << "return tars::TARSSERVERNOFUNCERR;" << std::endl;
+    s << generateDispatch(vOperation, "msg->request.sFuncName", pPtr->getId(), &Tars2Cpp::generateDispatchAsync);
     DEL_TAB;
     s << TAB << "}" << std::endl;
 
@@ -2862,40 +3512,7 @@ std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nP
     s << TAB << "virtual int onDispatch(tars::ReqMessagePtr msg)" << std::endl;
 	s << TAB << "{" << std::endl;
     INC_TAB;
-    dname    = "__" + pPtr->getId() + "_all";
-    dispatch =  "static ::std::string " + dname;
-    s << TAB << dispatch << "[]=" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "\"" << vOperation[i]->getId() << "\"";
-        if (i != vOperation.size() - 1)
-        {
-            s << ",";
-        }
-        s << std::endl;
-    }
-    DEL_TAB;
-    s << TAB << "};" << std::endl;
-    s << std::endl;
-    s << TAB << "std::pair<std::string*, std::string*> r = equal_range(" << dname << ", " << dname << "+" << vOperation.size() << ", std::string(msg->request.sFuncName));" << std::endl;
-    s << TAB << "if(r.first == r.second) return tars::TARSSERVERNOFUNCERR;" << std::endl;
-    s << TAB << "switch(r.first - " << dname << ")" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-    for(size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "case " << i << ":" << std::endl;
-        s << TAB << "{" << std::endl;
-        INC_TAB;
-        s << generateDispatchPromiseAsync(vOperation[i], pPtr->getId()) << std::endl;
-        DEL_TAB;
-        s << TAB << "}" << std::endl;
-    }
-    DEL_TAB;
-    s << TAB << "}" << std::endl;
-    s << TAB << "return tars::TARSSERVERNOFUNCERR;" << std::endl;
+    s << generateDispatch(vOperation, "msg->request.sFuncName", pPtr->getId(), &Tars2Cpp::generateDispatchPromiseAsync);
     DEL_TAB;
     s << TAB << "}" << std::endl;
     s << std::endl;
@@ -2927,51 +3544,7 @@ std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nP
     s << TAB << "int onDispatch(tars::ReqMessagePtr msg)" << std::endl;
     s << TAB << "{" << std::endl;
     INC_TAB;
-    dname    = "__" + pPtr->getId() + "_all";
-    dispatch =  "static ::std::string " + dname;
-    s << TAB << dispatch << "[]=" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "\"" << vOperation[i]->getId() << "\"";
-        if (i != vOperation.size() - 1)
-        {
-            s << ",";
-        }
-        s << std::endl;
-    }
-
-    DEL_TAB;
-    s << TAB << "};" << std::endl;
-
-    s << std::endl;
-
-    s << TAB << "std::pair<std::string*, std::string*> r = equal_range(" << dname << ", " << dname << "+" << vOperation.size() << ", std::string(msg->request.sFuncName));" << std::endl;
-
-    s << TAB << "if(r.first == r.second) return tars::TARSSERVERNOFUNCERR;" << std::endl;
-
-    s << TAB << "switch(r.first - " << dname << ")" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "case " << i << ":" << std::endl;
-        s << TAB << "{" << std::endl;
-        INC_TAB;
-
-        s << generateDispatchCoroAsync(vOperation[i], pPtr->getId()) << std::endl;
-
-        DEL_TAB;
-        s << TAB << "}" << std::endl;
-    }
-
-    DEL_TAB;
-    s << TAB << "}" << std::endl;
-
-    s << TAB << "return tars::TARSSERVERNOFUNCERR;" << std::endl;
+    s << generateDispatch(vOperation, "msg->request.sFuncName", pPtr->getId(), &Tars2Cpp::generateDispatchCoroAsync);
     DEL_TAB;
     s << TAB << "}" << std::endl;
 
@@ -3004,6 +3577,10 @@ std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nP
     {
         s << generateH(vOperation[i], false, pPtr->getId()); // << std::endl;
         s << generateHAsync(vOperation[i], pPtr->getId()) << std::endl;
+        if (_bCoAwaitSupport)
+        {
+            s << generateHCoAwait(vOperation[i]) << std::endl;
+        }
     }
 
     s << TAB << pPtr->getId() << "Proxy* tars_hash(int64_t key)" << std::endl;
@@ -3059,56 +3636,124 @@ std::string Tars2Cpp::generateH(const InterfacePtr &pPtr, const NamespacePtr &nP
 
     s << TAB << "{" << std::endl;
     INC_TAB;
-    dname    = "__" + nPtr->getId() + "__" + pPtr->getId() + "_all";
-    dispatch =  "static ::std::string " + dname;
-    s << TAB << dispatch << "[]=" << std::endl;
-    s << TAB << "{" << std::endl;
-    INC_TAB;
-
-    for (size_t i = 0; i < vOperation.size(); i++)
-    {
-        s << TAB << "\"" << vOperation[i]->getId() << "\"";
-        if (i != vOperation.size() - 1)
-        {
-            s << ",";
-        }
-        s << std::endl;
-    }
+    s << generateDispatch(vOperation, "_current->getFuncName()", pPtr->getId(), &Tars2Cpp::generateServantDispatch);
+    DEL_TAB;
+    s << TAB << "}" << std::endl;
 
     DEL_TAB;
     s << TAB << "};" << std::endl;
 
-    s << std::endl;
+    if (_bCoAwaitSupport)
+    {
+        s << std::endl;
+        s << generateHCoServant(pPtr);
+    }
 
-    s << TAB << "std::pair<std::string*, std::string*> r = equal_range(" << dname << ", " << dname << "+" << vOperation.size() << ", _current->getFuncName());" << std::endl;
+    return s.str();
+}
 
-    s << TAB << "if(r.first == r.second) return tars::TARSSERVERNOFUNCERR;" << std::endl;
+std::string Tars2Cpp::generateHCoServant(const InterfacePtr &pPtr) const
+{
+    std::ostringstream s;
+    std::vector<OperationPtr>& vOperation = pPtr->getAllOperationPtr();
 
-    s << TAB << "switch(r.first - " << dname << ")" << std::endl;
+    s << "#if TARS_CO_AWAIT" << std::endl;
+    s << TAB << "/* C++20 coroutine servant for server */" << std::endl;
+    s << TAB << "class " << pPtr->getId() << "CoServant : public " << pPtr->getId() << std::endl;
     s << TAB << "{" << std::endl;
+    s << TAB << "public:" << std::endl;
     INC_TAB;
+    s << TAB << "virtual ~" << pPtr->getId() << "CoServant(){}" << std::endl;
 
     for (size_t i = 0; i < vOperation.size(); i++)
     {
-        s << TAB << "case " << i << ":" << std::endl;
+        OperationPtr &op = vOperation[i];
+        std::vector<ParamDeclPtr>& vParamDecl = op->getAllParamDeclPtr();
+
+        std::string sRet = tostr(op->getReturnPtr()->getTypePtr());
+        std::string sDecl;
+        std::string sInArgs;
+        std::string sInDecl;
+        std::string sArgs;
+        std::string sOutArgs;
+
+        for (size_t j = 0; j < vParamDecl.size(); j++)
+        {
+            std::string sName = vParamDecl[j]->getTypeIdPtr()->getId();
+
+            sDecl += generateH(vParamDecl[j]) + ",";
+            sArgs += sName + ", ";
+
+            if (vParamDecl[j]->isOut())
+            {
+                sOutArgs += ", " + sName;
+            }
+            else
+            {
+                //输入参数拷贝到根协程的协程帧里, 请求挂起以后还有效
+                sInArgs += sName + ", ";
+                sInDecl += tostr(vParamDecl[j]->getTypeIdPtr()->getTypePtr()) + " " + sName + ", ";
+            }
+        }
+
+        //业务实现的协程接口
+        s << std::endl;
+        s << TAB << "virtual tars::Task< " << sRet << " > co_" << op->getId() << "(" << sDecl << "tars::TarsCurrentPtr current) = 0;" << std::endl;
+        s << std::endl;
+
+        //同步接口转成协程, 应答在协程结束时发送
+        s << TAB << sRet << " " << op->getId() << "(" << sDecl << "tars::TarsCurrentPtr current)" << std::endl;
         s << TAB << "{" << std::endl;
         INC_TAB;
+        s << TAB << "current->setResponse(false);" << std::endl;
+        s << TAB << "co_dispatch_" << op->getId() << "(" << sInArgs << "current);" << std::endl;
+        if (op->getReturnPtr()->getTypePtr())
+        {
+            s << TAB << "return " << sRet << "();" << std::endl;
+        }
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
 
-        s << generateServantDispatch(vOperation[i], pPtr->getId()) << std::endl;
-
+        s << std::endl;
+        s << TAB << "tars::CoDispatch co_dispatch_" << op->getId() << "(" << sInDecl << "tars::TarsCurrentPtr current)" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+        for (size_t j = 0; j < vParamDecl.size(); j++)
+        {
+            if (vParamDecl[j]->isOut())
+            {
+                s << TAB << tostr(vParamDecl[j]->getTypeIdPtr()->getTypePtr()) << " " << vParamDecl[j]->getTypeIdPtr()->getId()
+                    << generateInitValue(vParamDecl[j]->getTypeIdPtr()) << ";" << std::endl;
+            }
+        }
+        s << TAB << "try" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+        if (op->getReturnPtr()->getTypePtr())
+        {
+            s << TAB << sRet << " " << op->getReturnPtr()->getId() << " = co_await co_" << op->getId() << "(" << sArgs << "current);" << std::endl;
+            s << TAB << "async_response_" << op->getId() << "(current, " << op->getReturnPtr()->getId() << sOutArgs << ");" << std::endl;
+        }
+        else
+        {
+            s << TAB << "co_await co_" << op->getId() << "(" << sArgs << "current);" << std::endl;
+            s << TAB << "async_response_" << op->getId() << "(current" << sOutArgs << ");" << std::endl;
+        }
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
+        s << TAB << "catch (...)" << std::endl;
+        s << TAB << "{" << std::endl;
+        INC_TAB;
+        s << TAB << "tars::coDispatchException(current, std::current_exception());" << std::endl;
+        DEL_TAB;
+        s << TAB << "}" << std::endl;
         DEL_TAB;
         s << TAB << "}" << std::endl;
     }
 
-    DEL_TAB;
-    s << TAB << "}" << std::endl;
-
-    s << TAB << "return tars::TARSSERVERNOFUNCERR;" << std::endl;
-    DEL_TAB;
-    s << TAB << "}" << std::endl;
-
     DEL_TAB;
     s << TAB << "};" << std::endl;
+    s << "#endif" << std::endl;
 
     return s.str();
 }
@@ -3231,6 +3876,16 @@ std::string Tars2Cpp::generateH(const NamespacePtr& pPtr) const
     for (size_t i = 0; i < ss.size(); i++)
     {
         s << generateH(ss[i], pPtr->getId()) << std::endl;
+
+        if (_bViewSupport && isViewSupport(ss[i]))
+        {
+            s << generateViewH(ss[i]) << std::endl;
+        }
+
+        if (_bLazySupport)
+        {
+            s << generateLazyH(ss[i]) << std::endl;
+        }
     }
 
     s << std::endl;
@@ -3276,6 +3931,7 @@ void Tars2Cpp::generateH(const ContextPtr &pPtr) const
     if (_bJsonSupport) s << "#include \"tup/TarsJson.h\"" << std::endl;
     if (_bSqlSupport) s << "#include \"util/tc_mysql.h\"" << std::endl;
     if (_bXmlSupport) s << "#include \"tup/TarsXml.h\"" << std::endl;
+    if (_bArenaSupport) s << "#include \"util/tc_arena.h\"" << std::endl;
 
     // s << "using namespace std;" << std::endl;
 
@@ -3295,6 +3951,11 @@ void Tars2Cpp::generateH(const ContextPtr &pPtr) const
             s << "#include \"servant/ServantProxy.h\"" << std::endl;
             s << "#include \"servant/Servant.h\"" << std::endl;
 	        s << "#include \"promise/promise.h\"" << std::endl;
+            if (_bCoAwaitSupport)
+            {
+                s << "#include \"servant/Awaitable.h\"" << std::endl;
+            }
+            s << "#include \"util/tc_hash_fun.h\"" << std::endl;
             if (_bTrace)
             {
                 s << "#include \"servant/Application.h\"" << std::endl;
@@ -96,6 +96,30 @@ public:
     */
     void setTrace(bool bTrace) { _bTrace = bTrace; }
 
+    /**
+     * 是否额外生成XxxView结构体(string/vector<byte>字段直接指向解码的buffer, 不拷贝)
+     * @param bViewSupport
+     */
+    void setViewSupport(bool bViewSupport) { _bViewSupport = bViewSupport; }
+
+    /**
+     * 是否额外生成XxxLazy(建立tag索引, 按需解码单个字段)
+     * @param bLazySupport
+     */
+    void setLazySupport(bool bLazySupport) { _bLazySupport = bLazySupport; }
+
+    /**
+     * 是否容器使用TC_ArenaAllocator(服务端解码的参数分配在Current的arena上, 请求结束时一次释放)
+     * @param bArenaSupport
+     */
+    void setArenaSupport(bool bArenaSupport) { _bArenaSupport = bArenaSupport; }
+
+    /**
+     * 是否生成C++20 co_await调用的接口(co_xxx)和无栈协程的servant(XxxCoServant), 用TARS_CO_AWAIT宏包起来, C++11编译时不生效
+     * @param bCoAwaitSupport
+     */
+    void setCoAwaitSupport(bool bCoAwaitSupport) { _bCoAwaitSupport = bCoAwaitSupport; }
+
     //下面是编解码的源码生成
 protected:
     /**
@@ -154,6 +178,34 @@ protected:
      */
     std::string writeTo(const TypeIdPtr &pPtr) const;
 
+    /**
+     * 生成某类型编码后大小的计算源码, 和writeTo一一对应
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string encodedSize(const TypeIdPtr &pPtr) const;
+
+    /**
+     * 生成接口参数编码前按精确大小一次分配好buffer的源码(_os.reserveExact)
+     * 只在参数都是平铺类型(数值, 枚举, string, vector<byte>)时生成, 算大小是O(1)的;
+     * 有结构体或者容器参数时算大小要把参数完整遍历一遍, 小包比按容量倍增还慢, 不生成
+     * @param pPtr
+     * @param bResponse: true: 返回值和输出参数(服务端应答), false: 输入参数(客户端请求)
+     * @param bWithOut: 客户端请求是否也编码输出参数(同步调用)
+     *
+     * @return std::string
+     */
+    std::string reserveExact(const OperationPtr &pPtr, bool bResponse, bool bWithOut = false) const;
+
+    /**
+     * 是否平铺类型: 编码后的大小不用遍历就能算出来
+     * @param pPtr
+     *
+     * @return bool
+     */
+    bool isFlat(const TypePtr &pPtr) const;
+
     /**
      * 生成某类型的编码源码
      * @param pPtr
@@ -316,6 +368,14 @@ protected:
      */
     std::string generateH(const StructPtr &pPtr, const std::string& namespaceId) const;
 
+    /**
+     * 生成结构的逐字段构造函数
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string generateFieldConstructor(const StructPtr &pPtr) const;
+
     /**
      * 生成容器的头文件源码
      * @param pPtr
@@ -402,6 +462,31 @@ protected:
      */
     std::string generateHAsync(const OperationPtr &pPtr, const std::string& interfaceId) const;
 
+    /**
+     * 生成context为const引用的proxy函数, 拷贝一份context后转调右值版本
+     * @param sDecl 函数声明
+     * @param sCall 转调的表达式
+     *
+     * @return std::string
+     */
+    std::string generateContextCopy(const std::string& sDecl, const std::string& sCall) const;
+
+    /**
+     * 生成proxy的co_await调用接口(co_xxx)
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string generateHCoAwait(const OperationPtr &pPtr) const;
+
+    /**
+     * 生成C++20无栈协程的servant(XxxCoServant), 业务实现co_xxx
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string generateHCoServant(const InterfacePtr &pPtr) const;
+
     /**
      * 生成操作的servant的头文件源码
      * @param pPtr
@@ -420,6 +505,19 @@ protected:
      */
     std::string generateDispatchPromiseAsync(const OperationPtr &pPtr, const std::string &cn) const;
 
+    typedef std::string (Tars2Cpp::*DispatchFunc)(const OperationPtr &pPtr, const std::string &cn) const;
+
+    /**
+     * 生成按函数名分发的源码: switch函数名的hash(生成时算好), 再比较一次函数名确认
+     * @param vOperation
+     * @param sFuncName: 取请求函数名的表达式
+     * @param cn
+     * @param func: 生成每个函数分发的源码
+     *
+     * @return std::string
+     */
+    std::string generateDispatch(const std::vector<OperationPtr> &vOperation, const std::string &sFuncName, const std::string &cn, DispatchFunc func) const;
+
     /**
      * 生成操作的servant的头文件源码
      * @param pPtr
@@ -495,6 +593,38 @@ protected:
 
     std::string generateInitValue(const TypeIdPtr &pPtr) const;
 
+    /**
+     * 结构体是否可以生成View(没有数组/指针字段, 嵌套的结构体也可以生成View)
+     * @param pPtr
+     *
+     * @return bool
+     */
+    bool isViewSupport(const StructPtr &pPtr) const;
+
+    /**
+     * View结构体中的字段类型: string -> TarsStringView, vector<byte> -> TarsBytesView, 结构体 -> XxxView
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string tostrView(const TypePtr &pPtr) const;
+
+    /**
+     * 生成结构体的View
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string generateViewH(const StructPtr &pPtr) const;
+
+    /**
+     * 生成结构体按需解码的访问类
+     * @param pPtr
+     *
+     * @return std::string
+     */
+    std::string generateLazyH(const StructPtr &pPtr) const;
+
     bool isPromiseDispatchInitValue(const TypeIdPtr &pPtr) const;
 
 private:
@@ -521,6 +651,17 @@ private:
     bool _tarsMaster;
 
     bool _bTrace;
+
+    bool _bViewSupport;
+
+    bool _bLazySupport;
+
+    bool _bArenaSupport;
+
+    bool _bCoAwaitSupport;
+
+    //生成MD5时类型名不带分配器, 保证和协议相关
+    mutable bool _bNoAllocType;
 };
 
 #endif
@@ -1,5 +1,6 @@
 ﻿
 #include "hello_test.h"
+#include "servant/CommunicatorEpoll.h"
 
 TEST_F(HelloTest, rpcASyncGlobalCommunicator)
 {
@@ -22,6 +23,24 @@ TEST_F(HelloTest, rpcASyncGlobalCommunicatorInCoroutine)
 }
 
 
+TEST_F(HelloTest, rpcASyncGatherWrite)
+{
+	shared_ptr<Communicator> c = getCommunicator();
+	c->setProperty("gatherwrite", "1");
+
+	transGlobalCommunicator([&](Communicator *comm){
+		checkASync(comm);
+	}, c.get());
+
+	//同一批异步请求在一个连接上通过writev合并发送了
+	size_t saved = 0;
+	for(size_t i = 0; i < c->getCommunicatorEpollNum(); i++)
+	{
+		saved += c->getCommunicatorEpoll(i)->getGatherSaved();
+	}
+	ASSERT_TRUE(saved > 0);
+}
+
 TEST_F(HelloTest, rpcASyncServerCommunicator)
 {
 	transServerCommunicator([&](Communicator *comm){
@@ -0,0 +1,267 @@
+﻿#include "hello_test.h"
+#include "servant/Awaitable.h"
+#include "server/HelloServer.h"
+
+//co_xxx接口需要用C++20编译(见unit-test/CMakeLists.txt)
+#if TARS_CO_AWAIT
+
+/**
+ * 测试用的协程类型, 创建后马上执行, 结束时自动释放
+ */
+struct CoDetached
+{
+	struct promise_type
+	{
+		CoDetached get_return_object() { return CoDetached(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+static CoDetached coHello(HelloPrx prx, int index, string buffer, std::atomic<int> &count)
+{
+	string out;
+	int ret = co_await prx->co_testHello(index, buffer, out);
+	if(ret == 0 && out == buffer)
+	{
+		++count;
+	}
+}
+
+static CoDetached coHelloInScheduler(HelloPrx prx, string buffer, std::atomic<int> &count, TC_CoroutineScheduler *scheduler)
+{
+	std::thread::id id = std::this_thread::get_id();
+
+	//在调度线程中发起的调用, 恢复时还在这个线程中
+	for(int i = 0; i < 10; i++)
+	{
+		string out;
+		co_await prx->co_testHello(i, buffer, out);
+		if(out == buffer && std::this_thread::get_id() == id)
+		{
+			++count;
+		}
+	}
+
+	scheduler->terminate();
+}
+
+static CoDetached coTimeout(HelloPrx prx, std::atomic<int> &count)
+{
+	try
+	{
+		co_await prx->co_testTimeout(2);
+	}
+	catch(TarsSyncCallTimeoutException &ex)
+	{
+		++count;
+	}
+}
+
+static std::atomic<bool> g_coResponseSent{false};
+
+/**
+ * 无栈协程的servant: testHello/testTrans转调HelloObj, 等待时不占用handle线程和协程栈
+ */
+class CoHelloImp : public HelloCoServant
+{
+public:
+	virtual void initialize()
+	{
+		Application::getCommunicator()->stringToProxy(g_HelloServerObj, _helloPrx);
+	}
+
+	virtual void destroy()
+	{
+	}
+
+	virtual tars::Task<tars::Bool> co_testCoro(const std::string &sIn, std::string &sOut, tars::TarsCurrentPtr current)
+	{
+		sOut = sIn;
+		co_return true;
+	}
+
+	virtual tars::Task<tars::Int32> co_testDyeing(const std::string &strIn, std::string &strOut, tars::TarsCurrentPtr current)
+	{
+		co_return 0;
+	}
+
+	virtual tars::Task<tars::Int32> co_testDyeingTrans(tars::TarsCurrentPtr current)
+	{
+		co_return 0;
+	}
+
+	virtual tars::Task<tars::Int32> co_testHello(tars::Int32 index, const std::string &s, std::string &r, tars::TarsCurrentPtr current)
+	{
+		co_return co_await _helloPrx->co_testHello(index, s, r);
+	}
+
+	virtual tars::Task<tars::Int32> co_testPid(std::string &r, tars::TarsCurrentPtr current)
+	{
+		//已经回过包以后再抛异常, 不会再回异常包
+		async_response_testPid(current, 0, "co pid");
+		g_coResponseSent = current->isResponseSent();
+
+		throw std::runtime_error("co servant exception after response");
+	}
+
+	virtual tars::Task<tars::Int32> co_testSyncTrans(tars::Int32 index, const std::string &s, std::string &r, tars::TarsCurrentPtr current)
+	{
+		co_return co_await co_testHello(index, s, r, current);
+	}
+
+	virtual tars::Task<tars::Int32> co_testTimeout(tars::Int32 timeout, tars::TarsCurrentPtr current)
+	{
+		//挂起以后抛出的异常, 按服务端异常回包
+		string r;
+		co_await _helloPrx->co_testHello(timeout, "timeout", r);
+
+		throw std::runtime_error("co servant exception");
+	}
+
+	virtual tars::Task<tars::Int32> co_testTrans(tars::Int32 index, const std::string &s, std::string &r, tars::TarsCurrentPtr current)
+	{
+		//多次下游调用
+		string r1;
+		co_await _helloPrx->co_testHello(index, s, r1);
+		co_return co_await _helloPrx->co_testHello(index, r1, r);
+	}
+
+protected:
+	HelloPrx _helloPrx;
+};
+
+/**
+ * TransObj换成协程servant
+ */
+class CoHelloServer : public HelloServer
+{
+public:
+	virtual void initialize()
+	{
+		HelloServer::initialize();
+
+		addServant<CoHelloImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".TransObj");
+	}
+};
+
+TEST_F(HelloTest, rpcCoAwait)
+{
+	forEach([&](Communicator *comm)
+	{
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+
+		std::atomic<int> count{0};
+		for(int i = 0; i < _count; i++)
+		{
+			coHello(prx, i, _buffer, count);
+		}
+
+		waitForFinish(count, _count);
+	});
+}
+
+TEST_F(HelloTest, rpcCoAwaitInScheduler)
+{
+	forEach([&](Communicator *comm)
+	{
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+
+		std::atomic<int> count{0};
+
+		std::thread cor_call([&]()
+		{
+			auto scheduler = TC_CoroutineScheduler::create();
+
+			scheduler->post([&]()
+			{
+				coHelloInScheduler(prx, _buffer, count, scheduler.get());
+			});
+
+			scheduler->run();
+		});
+		cor_call.join();
+
+		ASSERT_TRUE(count == 10);
+	});
+}
+
+TEST_F(HelloTest, rpcCoServant)
+{
+	shared_ptr<Communicator> c = getCommunicator();
+
+	for(int i = 0; i <= TC_EpollServer::NET_THREAD_MERGE_HANDLES_CO; i++)
+	{
+		CoHelloServer server;
+		startServer(server, (TC_EpollServer::SERVER_OPEN_COROUTINE) i);
+
+		HelloPrx prx = getObj<HelloPrx>(c.get(), "TransAdapter");
+
+		for(int j = 0; j < 100; j++)
+		{
+			string r;
+			ASSERT_TRUE(prx->testHello(j, _buffer, r) == 0);
+			ASSERT_TRUE(r == _buffer);
+
+			r = "";
+			ASSERT_TRUE(prx->testTrans(j, _buffer, r) == 0);
+			ASSERT_TRUE(r == _buffer);
+
+			r = "";
+			ASSERT_TRUE(prx->testSyncTrans(j, _buffer, r) == 0);
+			ASSERT_TRUE(r == _buffer);
+		}
+
+		//没有挂起直接返回
+		string out;
+		ASSERT_TRUE(prx->testCoro(_buffer, out));
+		ASSERT_TRUE(out == _buffer);
+
+		bool exception = false;
+		try
+		{
+			prx->testTimeout(1);
+		}
+		catch(TarsServerUnknownException &ex)
+		{
+			exception = true;
+		}
+		ASSERT_TRUE(exception);
+
+		//回包以后抛的异常不再回包, 客户端收到的是正常的回包
+		g_coResponseSent = false;
+		out = "";
+		ASSERT_TRUE(prx->testPid(out) == 0);
+		ASSERT_TRUE(out == "co pid");
+		for(int j = 0; j < 100 && !g_coResponseSent; j++)
+		{
+			TC_Common::msleep(10);
+		}
+		ASSERT_TRUE(g_coResponseSent);
+		ASSERT_TRUE(prx->testCoro(_buffer, out));
+
+		stopServer(server);
+	}
+}
+
+TEST_F(HelloTest, rpcCoAwaitTimeout)
+{
+	shared_ptr<Communicator> c = getCommunicator();
+
+	HelloServer server;
+	startServer(server, TC_EpollServer::NET_THREAD_MERGE_HANDLES_THREAD);
+
+	HelloPrx prx = getObj<HelloPrx>(server.getCommunicator().get(), "HelloAdapter");
+	prx->tars_async_timeout(1000);
+
+	std::atomic<int> count{0};
+	coTimeout(prx, count);
+
+	waitForFinish(count, 1);
+
+	stopServer(server);
+}
+
+#endif
@@ -1,5 +1,8 @@
 ﻿
 #include "hello_test.h"
+#include "servant/AdapterProxy.h"
+#include "server/Arena.h"
+#include <thread>
 
 TEST_F(HelloTest, rpcSyncGlobalCommunicator)
 {
@@ -112,3 +115,507 @@ TEST_F(HelloTest, rpcSyncIpV6GlobalCommunicatorInCoroutine)
 		checkSync(comm, "Ipv6Adapter");
 	}, c.get());
 }
+
+TEST_F(HelloTest, rpcSyncZeroCopy)
+{
+	//请求包直接引用网络buffer
+	_conf.set("/tars/application/server/HelloAdapter<zerocopy>", "1");
+
+	_buffer.assign(64*1024, 'z');
+
+	transServerCommunicator([&](Communicator *comm){
+		checkSync(comm);
+	});
+}
+
+TEST_F(HelloTest, rpcASyncZeroCopy)
+{
+	_conf.set("/tars/application/server/HelloAdapter<zerocopy>", "1");
+
+	transServerCommunicator([&](Communicator *comm){
+		checkASync(comm);
+	});
+}
+
+TEST_F(HelloTest, rpcSyncBigResponse)
+{
+	//大于1M的应答分段编码发送
+	_buffer.assign(3*1024*1024 + 17, 'b');
+	_count = 10;
+
+	transServerCommunicator([&](Communicator *comm){
+		checkSync(comm);
+	});
+}
+
+void checkPrx(HelloPrx prx, const string &buffer, int count)
+{
+	string out;
+	for (int j = 0; j < count; ++j)
+	{
+		prx->testHello(j, buffer, out);
+		ASSERT_TRUE(buffer == out);
+	}
+
+	atomic<int> callback_count{0};
+	for (int j = 0; j < count; ++j)
+	{
+		HelloPrxCallbackPtr p = new ClientHelloCallback(TC_Common::now2us(), j, count, buffer, callback_count);
+		prx->async_testHello(p, j, buffer);
+	}
+
+	while (callback_count != count)
+	{
+		TC_Common::msleep(10);
+	}
+}
+
+void checkP2C(Communicator *comm, TC_Config &conf, const string &weightType, const string &buffer, int count)
+{
+	//同一个服务的两个地址(超时不同), 两个节点之间按负载选择
+	string endpoint = conf.get("/tars/application/server/HelloAdapter<endpoint>");
+	string obj = conf.get("/tars/application/server/HelloAdapter<servant>") + "@" + endpoint + " -v " + weightType + ":" + endpoint + " -t 20000 -v " + weightType;
+
+	checkPrx(comm->stringToProxy<HelloPrx>(obj), buffer, count);
+}
+
+TEST_F(HelloTest, rpcLeastActive)
+{
+	//-v 2: 按在途请求数选择节点
+	transServerCommunicator([&](Communicator *comm){
+		checkP2C(comm, _conf, "2", _buffer, _count);
+	});
+}
+
+TEST_F(HelloTest, rpcLatencyEwma)
+{
+	//-v 3: 按响应时间滑动平均选择节点
+	transServerCommunicator([&](Communicator *comm){
+		checkP2C(comm, _conf, "3", _buffer, _count);
+	});
+}
+
+/**
+ * 慢节点: 把请求转发给上游, 上游的应答延迟delay毫秒再转回给客户端, 同时统计经过的请求个数
+ */
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+class SlowRelay
+{
+public:
+	/**
+	 * 和upstream监听在同一个地址上, 端口由系统分配
+	 */
+	SlowRelay(const TC_Endpoint &upstream, int delay) : _upstream(upstream), _delay(delay)
+	{
+		_listen.createSocket();
+		_listen.setReuseAddr();
+		_listen.bind(upstream.getHost(), 0);
+		_listen.listen(128);
+
+		string host;
+		_listen.getSockName(host, _port);
+
+		_acceptThread = std::thread(&SlowRelay::acceptLoop, this);
+	}
+
+	~SlowRelay()
+	{
+		_terminate = true;
+
+		shutdown(_listen);
+		_acceptThread.join();
+
+		for(auto &sock : _socks)
+		{
+			shutdown(*sock);
+		}
+
+		for(auto &t : _threads)
+		{
+			t.join();
+		}
+	}
+
+	/**
+	 * 经过慢节点的请求个数
+	 */
+	size_t getRequests() const { return _requests; }
+
+	/**
+	 * 慢节点的地址
+	 */
+	TC_Endpoint getEndpoint() const
+	{
+		TC_Endpoint ep = _upstream;
+		ep.setPort(_port);
+		return ep;
+	}
+
+protected:
+	static void shutdown(TC_Socket &sock)
+	{
+		try { sock.shutdown(SHUT_RDWR); } catch(...) { }
+	}
+
+	void acceptLoop()
+	{
+		while(!_terminate)
+		{
+			shared_ptr<TC_Socket> client = std::make_shared<TC_Socket>();
+
+			struct sockaddr_in addr;
+			SOCKET_LEN_TYPE len = sizeof(addr);
+			if(_listen.accept(*client, (struct sockaddr *)&addr, len) < 0 || _terminate)
+			{
+				break;
+			}
+
+			shared_ptr<TC_Socket> server = std::make_shared<TC_Socket>();
+			try
+			{
+				server->createSocket();
+				server->connect(_upstream.getHost(), _upstream.getPort());
+			}
+			catch(exception &ex)
+			{
+				LOG_CONSOLE_DEBUG << "connect upstream error:" << ex.what() << endl;
+				continue;
+			}
+
+			_socks.push_back(client);
+			_socks.push_back(server);
+
+			_threads.push_back(std::thread(&SlowRelay::forward, this, client, server, true));
+			_threads.push_back(std::thread(&SlowRelay::forward, this, server, client, false));
+		}
+	}
+
+	void forward(shared_ptr<TC_Socket> from, shared_ptr<TC_Socket> to, bool request)
+	{
+		vector<char> buff(64*1024);
+		string packet;
+
+		while(!_terminate)
+		{
+			int len = from->recv(buff.data(), buff.size());
+			if(len <= 0)
+			{
+				break;
+			}
+
+			if(request)
+			{
+				//按tars协议的包头长度计数
+				packet.append(buff.data(), len);
+				while(packet.size() >= sizeof(uint32_t))
+				{
+					const unsigned char *p = (const unsigned char *)packet.data();
+					uint32_t packLen = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+					if(packet.size() < packLen)
+					{
+						break;
+					}
+					packet.erase(0, packLen);
+					++_requests;
+				}
+			}
+			else
+			{
+				TC_Common::msleep(_delay);
+			}
+
+			if(to->send(buff.data(), len) != len)
+			{
+				break;
+			}
+		}
+
+		shutdown(*to);
+	}
+
+protected:
+	TC_Endpoint _upstream;
+	int _delay;
+	uint16_t _port = 0;
+	TC_Socket _listen;
+	std::atomic<bool> _terminate{false};
+	std::atomic<size_t> _requests{0};
+	std::thread _acceptThread;
+	vector<shared_ptr<TC_Socket>> _socks;
+	vector<std::thread> _threads;
+};
+
+/**
+ * 一个直连的快节点和一个经过SlowRelay的慢节点, threadNum个线程一起同步调用, 共count次
+ * @return 落到慢节点上的请求个数
+ */
+size_t callP2CSlowNode(Communicator *comm, TC_Config &conf, const TC_Endpoint &ep, const string &weightType, int threadNum, int count)
+{
+	//通信器在每轮之间是共用的, 慢节点每次由系统分配新端口, 保证是新的proxy(节点状态不受上一轮server重启的影响)
+	SlowRelay relay(ep, 50);
+
+	string obj = conf.get("/tars/application/server/HelloAdapter<servant>") + "@" + ep.toString() + " -v " + weightType
+		+ ":" + relay.getEndpoint().toString() + " -v " + weightType;
+
+	HelloPrx prx = comm->stringToProxy<HelloPrx>(obj);
+
+	std::atomic<int> left{count};
+
+	vector<std::thread> threads;
+	for(int i = 0; i < threadNum; i++)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			while(left-- > 0)
+			{
+				string out;
+				prx->testHello(0, "p2c", out);
+			}
+		}));
+	}
+
+	for(auto &t : threads)
+	{
+		t.join();
+	}
+
+	return relay.getRequests();
+}
+
+TEST_F(HelloTest, rpcLeastActiveSlowNode)
+{
+	//并发调用时慢节点上在途请求多, 大部分请求落在快节点上
+	transServerCommunicator([&](Communicator *comm){
+		size_t slow = callP2CSlowNode(comm, _conf, getEndpoint("HelloAdapter"), "2", 4, 200);
+		ASSERT_TRUE(slow < 200 / 4);
+	});
+}
+
+TEST_F(HelloTest, rpcLatencyEwmaSlowNode)
+{
+	//串行调用时没有在途请求, 慢节点的平均耗时高, 之后基本不再选中
+	transServerCommunicator([&](Communicator *comm){
+		size_t slow = callP2CSlowNode(comm, _conf, getEndpoint("HelloAdapter"), "3", 1, 100);
+		ASSERT_TRUE(slow < 100 / 10);
+	});
+}
+#endif
+
+void checkConnectionPool(HelloPrx prx, const string &buffer, int count)
+{
+	checkPrx(prx, buffer, count);
+
+	//调用过的节点都建立了4个连接, 请求都已经完成
+	size_t adapterNum = 0;
+	for(auto objectProxy : prx->getObjectProxys())
+	{
+		for(auto adapter : objectProxy->getAdapters())
+		{
+			if(adapter->getTransNum() > 1)
+			{
+				++adapterNum;
+				ASSERT_TRUE(adapter->getTransNum() == 4);
+				for(size_t i = 0; i < adapter->getTransNum(); i++)
+				{
+					ASSERT_TRUE(adapter->getTransPending(i) == 0);
+				}
+			}
+		}
+	}
+	ASSERT_TRUE(adapterNum > 0);
+}
+
+TEST_F(HelloTest, rpcConnectionPool)
+{
+	transServerCommunicator([&](Communicator *comm){
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+		prx->tars_connection_pool(4);
+
+		checkConnectionPool(prx, _buffer, _count);
+	});
+}
+
+TEST_F(HelloTest, rpcConnectionPoolLeastPending)
+{
+	transServerCommunicator([&](Communicator *comm){
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+		prx->tars_connection_pool(4, ServantProxy::CONNECTION_LEAST_PENDING);
+
+		checkConnectionPool(prx, _buffer, _count);
+	});
+}
+
+/**
+ * 各个节点上连接池的连接数都不超过max, 返回节点个数
+ */
+static size_t checkTransNum(HelloPrx prx, size_t max)
+{
+	size_t adapterNum = 0;
+	for(auto objectProxy : prx->getObjectProxys())
+	{
+		for(auto adapter : objectProxy->getAdapters())
+		{
+			++adapterNum;
+			EXPECT_TRUE(adapter->getTransNum() <= max);
+		}
+	}
+	return adapterNum;
+}
+
+TEST_F(HelloTest, rpcConnectionPoolConnectionBound)
+{
+	//新的communicator, 不影响其他用例共用的proxy
+	transAllocCommunicator([&](Communicator *comm){
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+		prx->tars_connection_pool(4);
+
+		//编码依赖连接状态的自定义协议(和http2/grpc一样没有设置connectionPool), 请求必须在编码它的连接上发送
+		std::mutex mutex;
+		std::set<TC_Transceiver*> encodeTrans;
+		ProxyProtocol proto;
+		proto.requestFunc = [&](RequestPacket &request, TC_Transceiver *trans){
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				encodeTrans.insert(trans);
+			}
+			return ProxyProtocol::tarsRequest(request, trans);
+		};
+		proto.responseFunc = ProxyProtocol::tarsResponse;
+		prx->tars_set_protocol(proto);
+
+		checkPrx(prx, _buffer, _count);
+
+		//连接池没有生效, 每个节点只有一个连接, 请求都在这个连接上编码
+		size_t adapterNum = checkTransNum(prx, 1);
+		ASSERT_TRUE(!encodeTrans.empty());
+		ASSERT_TRUE(encodeTrans.size() <= adapterNum);
+	});
+}
+
+#if TARS_HTTP2
+TEST_F(HelloTest, rpcConnectionPoolHttp2)
+{
+	transAllocCommunicator([&](Communicator *comm){
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+		prx->tars_connection_pool(4);
+		prx->tars_set_protocol(ServantProxy::PROTOCOL_HTTP2);
+		prx->tars_timeout(500);
+
+		ASSERT_FALSE(prx->tars_get_protocol().connectionPool);
+
+		//服务端是tars协议, 调用会失败, 只关心客户端建立的连接数
+		for(int i = 0; i < 10; i++)
+		{
+			try
+			{
+				string out;
+				prx->testHello(i, _buffer, out);
+			}
+			catch(exception &ex)
+			{
+			}
+		}
+
+		//hpack和stream id保存在连接上, 不能使用连接池
+		checkTransNum(prx, 1);
+	});
+}
+#endif
+
+TEST_F(HelloTest, rpcConnectionPoolTimeout)
+{
+	transServerCommunicator([&](Communicator *comm){
+		HelloPrx prx = getObj<HelloPrx>(comm, "HelloAdapter");
+		prx->tars_connection_pool(4);
+		prx->tars_timeout(100);
+
+		//等连接池里的连接都建立好
+		for(int i = 0; i < 10; i++)
+		{
+			ASSERT_TRUE(prx->testTimeout(0) == 0);
+		}
+		TC_Common::msleep(200);
+
+		vector<AdapterProxy*> adapters;
+		size_t transNum = 0;
+		for(auto objectProxy : prx->getObjectProxys())
+		{
+			for(auto adapter : objectProxy->getAdapters())
+			{
+				if(adapter->getTransNum() > 1)
+				{
+					adapters.push_back(adapter);
+					transNum += adapter->getTransNum();
+				}
+			}
+		}
+		ASSERT_TRUE(!adapters.empty());
+
+		//超时的请求比连接数多, 至少有一个连接连续超时两次
+		//(网络线程和业务线程合并的模式下, 后面的请求可能先在服务端队列超时回包)
+		for(size_t i = 0; i <= transNum; i++)
+		{
+			ASSERT_ANY_THROW(prx->testTimeout(2));
+		}
+
+		//连续超时达到次数的连接被关闭, 超时计数清零, 不会一直累加
+		size_t frequenceFailInvoke = prx->tars_check_timeout_info().frequenceFailInvoke;
+		for(auto adapter : adapters)
+		{
+			for(size_t i = 0; i < adapter->getTransNum(); i++)
+			{
+				ASSERT_TRUE(adapter->getTransPending(i) == 0);
+				ASSERT_TRUE(adapter->getTransTimeout(i) < frequenceFailInvoke);
+			}
+		}
+
+		//等服务端处理完超时的请求, 连接重建以后调用恢复
+		TC_Common::sleep(4);
+		prx->tars_timeout(3000);
+		ASSERT_TRUE(prx->testTimeout(0) == 0);
+	});
+}
+
+TEST_F(HelloTest, rpcArena)
+{
+	//Arena.tars按--arena生成, 服务端dispatch把参数解码在请求的arena上
+	ArenaPackage req;
+	for(int i = 0; i < 10; i++)
+	{
+		ArenaItem data;
+		data.id = i;
+		data.name = "name" + TC_Common::tostr(i);
+		data.payload.assign(100, 'a');
+		data.attrs["k"] = "v";
+		data.tags.push_back("t");
+		req.items.push_back(data);
+		req.index[data.name] = data;
+	}
+	req.head.attrs["head"] = "v";
+
+	transServerCommunicator([&](Communicator *comm){
+		ArenaPrx prx = getObj<ArenaPrx>(comm, "ArenaAdapter");
+
+		for(int i = 0; i < 10; i++)
+		{
+			tars::Int32 count = 0;
+			tars::Bool onArena = false;
+			ASSERT_TRUE(prx->testArena(req, count, onArena) == 0);
+			ASSERT_TRUE(count == 20);
+			ASSERT_TRUE(onArena);
+		}
+	});
+}
+
+TEST_F(HelloTest, rpcReqPool)
+{
+	//ReqMessage从业务线程缓存分配, 网络线程释放后归还
+	ReqMessage::setPooled(true);
+
+	transServerCommunicator([&](Communicator *comm){
+		checkSync(comm);
+		checkASync(comm);
+	});
+
+	ReqMessage::setPooled(false);
+}
@@ -0,0 +1,37 @@
+﻿#include "ArenaImp.h"
+
+using namespace std;
+
+//////////////////////////////////////////////////////
+void ArenaImp::initialize()
+{
+}
+
+//////////////////////////////////////////////////////
+void ArenaImp::destroy()
+{
+}
+
+tars::Int32 ArenaImp::testArena(const ArenaPackage &req, tars::Int32 &count, tars::Bool &onArena, CurrentPtr current)
+{
+	//dispatch在调用业务接口前已经离开Scope, 参数的容器仍然在请求的arena上
+	TC_Arena *arena = current->getArena();
+
+	onArena = (TC_Arena::current() == NULL);
+	onArena = onArena && req.items.get_allocator().arena() == arena && req.index.get_allocator().arena() == arena;
+	onArena = onArena && req.head.attrs.get_allocator().arena() == arena && req.head.tags.get_allocator().arena() == arena;
+
+	for(auto &item : req.items)
+	{
+		onArena = onArena && item.payload.get_allocator().arena() == arena && item.attrs.get_allocator().arena() == arena;
+	}
+
+	for(auto &it : req.index)
+	{
+		onArena = onArena && it.second.payload.get_allocator().arena() == arena;
+	}
+
+	count = (tars::Int32)(req.items.size() + req.index.size());
+
+	return 0;
+}
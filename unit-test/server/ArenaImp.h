@@ -0,0 +1,22 @@
+﻿#ifndef _ARENA_IMP_H_
+#define _ARENA_IMP_H_
+
+#include "Arena.h"
+
+using namespace tars;
+using namespace Test;
+
+/**
+ * 按tars2cpp --arena生成的servant, 检查参数是否解码在请求的arena上
+ */
+class ArenaImp : public Arena
+{
+public:
+    virtual void initialize();
+
+    virtual void destroy();
+
+    virtual tars::Int32 testArena(const ArenaPackage &req, tars::Int32 &count, tars::Bool &onArena, CurrentPtr current);
+};
+/////////////////////////////////////////////////////
+#endif
@@ -4,6 +4,7 @@
 #include "HttpImp.h"
 #include "CustomImp.h"
 #include "PushImp.h"
+#include "ArenaImp.h"
 
 #include <thread>
 // #include "gperftools/profiler.h"
@@ -88,6 +89,8 @@ HelloServer::initialize()
 	addServant<HelloImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".UdpObj");
 	addServant<HelloImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".UdpIpv6Obj");
 
+	addServant<ArenaImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".ArenaObj");
+
 	addServant<PushImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".PushObj");
 	addServantProtocol(ServerConfig::Application + "." + ServerConfig::ServerName + ".PushObj", parse);
 
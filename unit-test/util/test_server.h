@@ -8,6 +8,7 @@
 #include "util/tc_network_buffer.h"
 #include "util/tc_epoll_server.h"
 #include "util/tc_openssl.h"
+#include "tup/Tars.h"
 #include "certs.h"
 
 using namespace tars;
@@ -138,6 +139,72 @@ protected:
 	MyTcpServer  *_server;
 };
 
+/**
+ * 分段应答的处理类, 回显的内容按64K分段发送
+ */
+class TcpChainHandle : public TC_EpollServer::Handle
+{
+public:
+
+	virtual void handle(const shared_ptr<TC_EpollServer::RecvContext> &data)
+	{
+		try
+		{
+			shared_ptr<TC_EpollServer::SendContext> send = data->createSendContext();
+
+			//和Current::sendResponse的大应答一样用BufferWriterChain分段编码, 每段一个Buffer, 不再copy
+			const vector<char> &in = data->buffer();
+
+			TarsOutputStream<BufferWriterChain> os;
+			os.setSegmentSize(64 * 1024);
+			os.writeBuf(in.data(), in.size());
+
+			vector<pair<char*, size_t>> segments;
+			os.detach(segments);
+
+			vector<shared_ptr<TC_NetWorkBuffer::Buffer>> buffs;
+			for(auto &segment : segments)
+			{
+				shared_ptr<TC_NetWorkBuffer::Buffer> buff = std::make_shared<TC_NetWorkBuffer::Buffer>();
+				buff->replaceBuffer(segment.first, segment.second);
+				buffs.push_back(buff);
+			}
+
+			send->setBuffers(buffs);
+			sendResponse(send);
+		}
+		catch (exception &ex)
+		{
+			close(data);
+		}
+	}
+};
+
+/**
+ * 耗时的处理类, 处理时阻塞线程, 用于测试handle之间的任务窃取
+ */
+class TcpSlowHandle : public TC_EpollServer::Handle
+{
+public:
+
+	virtual void handle(const shared_ptr<TC_EpollServer::RecvContext> &data)
+	{
+		try
+		{
+			TC_Common::msleep(20);
+
+			shared_ptr<TC_EpollServer::SendContext> send = data->createSendContext();
+
+			send->buffer()->setBuffer(data->buffer());
+			sendResponse(send);
+		}
+		catch (exception &ex)
+		{
+			close(data);
+		}
+	}
+};
+
 class MyTcpServer
 {
 public:
@@ -220,12 +287,56 @@ public:
 		_epollServer->bind(lsPtr);
 	}
 
-	void bindTcpLine(const std::string &str, int maxConnections = 10240)
+	void bindTcpLine(const std::string &str, int maxConnections = 10240, bool gatherWrite = false)
 	{
 		TC_EpollServer::BindAdapterPtr lsPtr = _epollServer->createBindAdapter<TcpHandle>("TcpLineAdapter", str, 5);
 
 		//设置最大连接数
 		lsPtr->setMaxConns(maxConnections);
+		//合并发送
+		lsPtr->setGatherWrite(gatherWrite);
+		//设置协议解析器
+		lsPtr->setProtocol(parseLine);
+		//绑定对象
+		_epollServer->bind(lsPtr);
+	}
+
+	void bindTcpChain(const std::string &str, bool gatherWrite = false)
+	{
+		TC_EpollServer::BindAdapterPtr lsPtr = _epollServer->createBindAdapter<TcpChainHandle>("TcpChainAdapter", str, 5);
+
+		//设置最大连接数
+		lsPtr->setMaxConns(10);
+		//合并发送
+		lsPtr->setGatherWrite(gatherWrite);
+		//设置协议解析器
+		lsPtr->setProtocol(parseLine);
+		//绑定对象
+		_epollServer->bind(lsPtr);
+	}
+
+	void bindTcpRing(const std::string &str)
+	{
+		TC_EpollServer::BindAdapterPtr lsPtr = _epollServer->createBindAdapter<TcpHandle>("TcpRingAdapter", str, 5);
+
+		//设置最大连接数
+		lsPtr->setMaxConns(10);
+		//接收队列使用环形队列
+		lsPtr->setQueueType(TC_EpollServer::QUEUE_RING);
+		//设置协议解析器
+		lsPtr->setProtocol(parseLine);
+		//绑定对象
+		_epollServer->bind(lsPtr);
+	}
+
+	void bindTcpSteal(const std::string &str)
+	{
+		TC_EpollServer::BindAdapterPtr lsPtr = _epollServer->createBindAdapter<TcpSlowHandle>("TcpStealAdapter", str, 2);
+
+		//设置最大连接数
+		lsPtr->setMaxConns(10);
+		//handle之间窃取任务
+		lsPtr->setWorkSteal(true);
 		//设置协议解析器
 		lsPtr->setProtocol(parseLine);
 		//绑定对象
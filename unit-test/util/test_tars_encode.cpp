@@ -0,0 +1,806 @@
+#include "util/tc_common.h"
+#include "gtest/gtest.h"
+#include "../server/Hello.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+using namespace Test;
+
+class TarsEncodeTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+static JsonData makeData(int i, size_t strLen)
+{
+	JsonData data;
+	data.c = (char)i;
+	data.s = (short)(i * 100);
+	data.i = i * 100000;
+	data.l = (int64_t)i * 10000000000;
+	data.f = i * 0.5f;
+	data.d = i * 0.25;
+	data.uc = (uint8_t)i;
+	data.us = (uint16_t)(i * 300);
+	data.ui = (uint32_t)i * 3000000000u;
+	data.b = (i % 2 == 0);
+	data.k = EN_KEY::KEY2;
+	data.ss = string(strLen, 'a');
+	data.data[EN_KEY::KEY1] = "key1";
+	data.v.push_back(EN_KEY::KEY1);
+	data.v.push_back(EN_KEY::KEY2);
+	for(int j = 0; j < 10; j++)
+	{
+		data.im[j * 1000] = TC_Common::tostr(j);
+		data.iv.push_back(j * j * 10000);
+		data.dv.push_back(j * 1.5);
+		data.bv.push_back(j % 3 == 0);
+	}
+	data.bm[true] = "true";
+	data.fm[1.5] = "1.5";
+	return data;
+}
+
+static JsonMap makeMap(int count)
+{
+	JsonMap m;
+	for(int i = 0; i < count; i++)
+	{
+		JsonKey k;
+		k.i = i;
+		m.json[k] = makeData(i, i % 512);
+	}
+	return m;
+}
+
+template<typename T>
+static string encode(const T &st)
+{
+	TarsOutputStream<BufferWriterString> os;
+	st.writeTo(os);
+	return os.getByteBuffer();
+}
+
+template<typename T>
+static size_t encodedLength(const T &st)
+{
+	return encode(st).size();
+}
+
+TEST_F(TarsEncodeTest, encodedSize)
+{
+	//默认值的字段不编码
+	JsonData data;
+	ASSERT_TRUE(data.tars_encoded_size() == encodedLength(data));
+
+	//覆盖各种数值的压缩编码, 短/长字符串, tag >= 15的两字节头
+	for(int i = -300; i < 300; i += 7)
+	{
+		data = makeData(i, (size_t)(i + 300));
+		ASSERT_TRUE(data.tars_encoded_size() == encodedLength(data));
+	}
+
+	JsonMap m = makeMap(100);
+	ASSERT_TRUE(m.tars_encoded_size() == encodedLength(m));
+
+	//结构体作为字段: 头 + 内容 + 结束头
+	TarsOutputStream<BufferWriterString> os;
+	os.write(m, 20);
+	ASSERT_TRUE(TarsEncodedSize::of(m, 20) == os.getLength());
+}
+
+TEST_F(TarsEncodeTest, reserveExact)
+{
+	JsonMap m = makeMap(100);
+	size_t size = m.tars_encoded_size();
+
+	TarsOutputStream<BufferWriterString> os;
+	os.reserveExact(size);
+	const char *buf = os.getBuffer();
+	m.writeTo(os);
+
+	//编码过程中没有再扩容
+	ASSERT_TRUE(os.getBuffer() == buf);
+	ASSERT_TRUE(os.getLength() == size);
+	ASSERT_TRUE(os.getByteBuffer() == encode(m));
+}
+
+TEST_F(TarsEncodeTest, fixedBuffer)
+{
+	JsonMap m = makeMap(10);
+	size_t size = m.tars_encoded_size();
+
+	vector<char> buff(size);
+
+	TarsOutputStream<BufferWriterFixed> os;
+	os.setBuffer(buff.data(), buff.size());
+	m.writeTo(os);
+	ASSERT_TRUE(os.getBuffer() == buff.data());
+	ASSERT_TRUE(os.getLength() == size);
+	ASSERT_TRUE(string(buff.data(), buff.size()) == encode(m));
+
+	//空间不够
+	os.setBuffer(buff.data(), buff.size() - 1);
+	ASSERT_THROW(m.writeTo(os), TarsEncodeException);
+}
+
+static ViewData makeViewData(int i)
+{
+	ViewData data;
+	data.id = i;
+	data.name = "name" + TC_Common::tostr(i);
+	data.payload.assign((size_t)(i * 37 % 1024), (char)i);
+	data.attrs["key" + TC_Common::tostr(i)] = string((size_t)(i % 300), 'v');
+	data.tags.push_back("tag");
+	data.tags.push_back(string(300, 't'));
+	return data;
+}
+
+static ViewPackage makePackage(int count)
+{
+	ViewPackage pkg;
+	for(int i = 0; i < count; i++)
+	{
+		pkg.items.push_back(makeViewData(i));
+		pkg.index[TC_Common::tostr(i)] = makeViewData(i);
+	}
+	pkg.head = makeViewData(count);
+	pkg.head.desc = "head";
+	return pkg;
+}
+
+template<typename T>
+static string encodeChain(const T &st, size_t segmentSize, size_t &segments)
+{
+	TarsOutputStream<BufferWriterChain> os;
+	os.setSegmentSize(segmentSize);
+	st.writeTo(os);
+	segments = os.getSegmentCount();
+
+	vector<pair<char*, size_t> > segs;
+	os.detach(segs);
+
+	string buff;
+	for(size_t i = 0; i < segs.size(); i++)
+	{
+		buff.append(segs[i].first, segs[i].second);
+		delete[] segs[i].first;
+	}
+	return buff;
+}
+
+TEST_F(TarsEncodeTest, chainWriter)
+{
+	ViewPackage pkg = makePackage(100);
+	pkg.head.payload.assign(1024 * 1024, 'p');
+	string buff = encode(pkg);
+
+	for(size_t segmentSize : { 128, 1000, 64 * 1024 })
+	{
+		size_t segments = 0;
+		ASSERT_TRUE(encodeChain(pkg, segmentSize, segments) == buff);
+		//大块数据按段切开
+		ASSERT_TRUE(segments > 1024 * 1024 / (segmentSize * 4));
+	}
+
+	//跨段填写包头
+	TarsOutputStream<BufferWriterChain> os;
+	os.setSegmentSize(128);
+	os.writeBuf("0000", 4);
+	pkg.head.writeTo(os);
+	ASSERT_TRUE(os.getSegmentCount() > 1);
+	os.patch(0, "abcd", 4);
+	os.patch(126, "efgh", 4);
+	ASSERT_THROW(os.patch(os.getLength() - 2, "ijkl", 4), TarsEncodeException);
+
+	vector<pair<char*, size_t> > segs;
+	os.detach(segs);
+	ASSERT_TRUE(os.getLength() == 0);
+	string chain;
+	for(size_t i = 0; i < segs.size(); i++)
+	{
+		chain.append(segs[i].first, segs[i].second);
+		delete[] segs[i].first;
+	}
+	string expect = "0000" + encode(pkg.head);
+	expect.replace(0, 4, "abcd");
+	expect.replace(126, 4, "efgh");
+	ASSERT_TRUE(chain == expect);
+
+	//detach之后可以继续使用
+	pkg.head.writeTo(os);
+	ASSERT_TRUE(os.getLength() == encode(pkg.head).size());
+}
+
+TEST_F(TarsEncodeTest, chainSegmentSize)
+{
+	map<Int64, Int64> data;
+	for(Int64 i = 0; i < 200000; i++)
+	{
+		data[i * 1000000007LL] = i;
+	}
+
+	TarsOutputStream<BufferWriter> flat;
+	flat.write(data, 0);
+
+	const size_t segmentSize = 64 * 1024;
+	TarsOutputStream<BufferWriterChain> os;
+	os.setSegmentSize(segmentSize);
+	os.write(data, 0);
+
+	vector<pair<char*, size_t> > segs;
+	os.detach(segs);
+
+	//小的写入都写在段的大小以内, 段写满才换下一段, 不会越换越大
+	string chain;
+	for(size_t i = 0; i < segs.size(); i++)
+	{
+		ASSERT_TRUE(segs[i].second <= segmentSize);
+		if(i + 1 < segs.size())
+		{
+			ASSERT_TRUE(segs[i].second + 16 >= segmentSize);
+		}
+		chain.append(segs[i].first, segs[i].second);
+		delete[] segs[i].first;
+	}
+	ASSERT_TRUE(chain == string(flat.getBuffer(), flat.getLength()));
+}
+
+TEST_F(TarsEncodeTest, reserveBuf)
+{
+	//连续的writer按写入后长度的两倍扩容, 至少128
+	TarsOutputStream<BufferWriter> flat;
+	flat.reserveBuf(10);
+	ASSERT_TRUE(flat._buf_len == 128);
+	flat.writeBuf(string(100, 'a').data(), 100);
+	flat.reserveBuf(100);
+	ASSERT_TRUE(flat._buf_len == 400);
+	ASSERT_TRUE(string(flat.getBuffer(), flat.getLength()) == string(100, 'a'));
+
+	//分段的writer: 当前段放得下时不换段, 放不下时封存当前段, 新段按段的大小或者这次写入的大小
+	TarsOutputStream<BufferWriterChain> os;
+	os.setSegmentSize(128);
+	os.reserveBuf(10);
+	ASSERT_TRUE(os._buf_len == 128);
+	os.writeBuf(string(100, 'a').data(), 100);
+	os.reserveBuf(28);
+	ASSERT_TRUE(os.getSegmentCount() == 1);
+	os.reserveBuf(29);
+	ASSERT_TRUE(os._buf_len == 128 && os._len == 0);
+	os.reserveBuf(1000);
+	ASSERT_TRUE(os._buf_len == 1000);
+	os.writeBuf(string(1000, 'b').data(), 1000);
+	ASSERT_TRUE(os.getSegmentCount() == 2);
+	ASSERT_TRUE(os.getLength() == 1100);
+
+	//固定的buffer放不下时抛异常
+	char buff[16];
+	TarsOutputStream<BufferWriterFixed> fixed;
+	fixed.setBuffer(buff, sizeof(buff));
+	fixed.writeBuf("0123456789", 10);
+	ASSERT_THROW(fixed.reserveBuf(7), TarsEncodeException);
+}
+
+TEST_F(TarsEncodeTest, fieldConstructor)
+{
+	string name(1000, 'n');
+	vector<Char> payload(1000, 'p');
+	const char *pName = name.data();
+	const Char *pPayload = payload.data();
+
+	//右值直接move到成员上, 不拷贝
+	ViewData data(1, std::move(name), std::move(payload), map<string, string>(), vector<string>(), "desc");
+	ASSERT_TRUE(data.name.data() == pName);
+	ASSERT_TRUE(data.payload.data() == pPayload);
+	ASSERT_TRUE(data.desc == "desc");
+
+	ViewData ref = makeViewData(5);
+	vector<ViewData> items;
+	items.emplace_back(ref.id, ref.name, ref.payload, ref.attrs, ref.tags, ref.desc);
+	ASSERT_TRUE(items.back() == ref);
+	ASSERT_TRUE(encode(items.back()) == encode(ref));
+}
+
+TEST_F(TarsEncodeTest, viewDecode)
+{
+	ViewPackage pkg = makePackage(100);
+	string buff = encode(pkg);
+
+	TarsInputStream<> is;
+	is.setBuffer(buff.c_str(), buff.length());
+
+	ViewPackageView view;
+	view.readFrom(is);
+
+	ASSERT_TRUE(view.items.size() == pkg.items.size());
+	ASSERT_TRUE(view.index.size() == pkg.index.size());
+
+	//直接指向解码的buffer
+	const char *begin = buff.c_str();
+	const char *end = begin + buff.length();
+	for(size_t i = 0; i < view.items.size(); i++)
+	{
+		ASSERT_TRUE(view.items[i].id == pkg.items[i].id);
+		ASSERT_TRUE(view.items[i].name == pkg.items[i].name);
+		ASSERT_TRUE(view.items[i].name.data() >= begin && view.items[i].name.data() < end);
+		ASSERT_TRUE(view.items[i].payload.toVector() == pkg.items[i].payload);
+		ASSERT_TRUE(view.items[i].tags.size() == 2 && view.items[i].tags[1].str() == pkg.items[i].tags[1]);
+		ASSERT_TRUE(view.items[i].desc == "none");
+	}
+
+	ASSERT_TRUE(view.index[TarsStringView("10")].name == "name10");
+	ASSERT_TRUE(view.head.desc == "head");
+
+	//再编码和原来的一致
+	ASSERT_TRUE(view.tars_encoded_size() == buff.length());
+	ASSERT_TRUE(encode(view) == buff);
+
+	//类型不匹配
+	TarsOutputStream<BufferWriterString> os;
+	os.write(10, 1);
+	ViewDataView data;
+	is.setBuffer(os.getBuffer(), os.getLength());
+	ASSERT_THROW(data.readFrom(is), TarsDecodeMismatch);
+}
+
+template<typename T>
+int64_t decodeCost(int count, const string &buff)
+{
+	int64_t start = TC_Common::now2ms();
+
+	for(int i = 0; i < count; i++)
+	{
+		TarsInputStream<> is;
+		is.setBuffer(buff.c_str(), buff.length());
+		T t;
+		t.readFrom(is);
+	}
+
+	return TC_Common::now2ms() - start;
+}
+
+TEST_F(TarsEncodeTest, readerView)
+{
+	RequestPacket req;
+	req.iVersion = 1;
+	req.iRequestId = 100;
+	req.sServantName = "Test.HelloServer.HelloObj";
+	req.sFuncName = "testHello";
+	req.sBuffer.assign(1024, 'a');
+	req.iTimeout = 3000;
+	req.context["k"] = "v";
+	string buff = encode(req);
+
+	//生成的readFrom, 包体直接指向buffer
+	RequestPacket dec;
+	TarsInputStream<BufferReaderView> is;
+	is.setBuffer(buff.c_str(), buff.length());
+	dec.readFrom(is);
+	ASSERT_TRUE(dec.sBuffer.empty());
+	ASSERT_TRUE(is.viewData() > buff.c_str() && is.viewData() + is.viewLength() <= buff.c_str() + buff.length());
+	ASSERT_TRUE(vector<char>(is.viewData(), is.viewData() + is.viewLength()) == req.sBuffer);
+	dec.sBuffer = req.sBuffer;
+	ASSERT_TRUE(encode(dec) == buff);
+
+	//包体按List编码(兼容), 照常解码到sBuffer
+	TarsOutputStream<BufferWriterString> os;
+	os.write(req.iVersion, 1);
+	os.write(req.cPacketType, 2);
+	os.write(req.iMessageType, 3);
+	os.write(req.iRequestId, 4);
+	os.write(req.sServantName, 5);
+	os.write(req.sFuncName, 6);
+	DataHead::writeTo(os, DataHead::eList, 7);
+	os.write((Int32)3, 0);
+	for(char c = 'x'; c <= 'z'; c++)
+	{
+		os.write((Char)c, 0);
+	}
+	os.write(req.iTimeout, 8);
+	os.write(req.context, 9);
+	os.write(req.status, 10);
+	buff = os.getByteBuffer();
+
+	is.setBuffer(buff.c_str(), buff.length());
+	dec.readFrom(is);
+	ASSERT_TRUE(is.viewData() == NULL);
+	ASSERT_TRUE(string(dec.sBuffer.begin(), dec.sBuffer.end()) == "xyz");
+	ASSERT_TRUE(dec.sFuncName == req.sFuncName && dec.context == req.context);
+}
+
+TEST_F(TarsEncodeTest, compareViewDecode)
+{
+	string buff = encode(makePackage(200));
+
+	int count = 1000;
+
+	cout << "decode size:" << buff.length() << endl;
+	cout << "decode struct cost:" << decodeCost<ViewPackage>(count, buff) << "ms" << endl;
+	cout << "decode view cost:" << decodeCost<ViewPackageView>(count, buff) << "ms" << endl;
+}
+
+TEST_F(TarsEncodeTest, lazyDecode)
+{
+	ViewPackage pkg = makePackage(100);
+	string buff = encode(pkg);
+
+	ViewPackageLazy lazy(buff.c_str(), buff.length());
+	ASSERT_TRUE(lazy.tars_has(0) && lazy.tars_has(1) && lazy.tars_has(2));
+	ASSERT_FALSE(lazy.tars_has(3));
+
+	ASSERT_TRUE(lazy.items() == pkg.items);
+	ASSERT_TRUE(lazy.index() == pkg.index);
+	ASSERT_TRUE(lazy.head() == pkg.head);
+
+	//只解码嵌套结构体里的字段
+	ViewDataLazy head = lazy.head_lazy();
+	ASSERT_TRUE(head.id() == pkg.head.id);
+	ASSERT_TRUE(head.name() == pkg.head.name);
+	ASSERT_TRUE(head.desc() == "head");
+	ASSERT_TRUE(head.tags() == pkg.head.tags);
+
+	//没有编码的字段取默认值
+	ViewData data;
+	data.id = 10;
+	buff = encode(data);
+	ViewDataLazy dataLazy(buff.c_str(), buff.length());
+	ASSERT_TRUE(dataLazy.id() == 10);
+	ASSERT_TRUE(dataLazy.desc() == "none");
+	ASSERT_TRUE(dataLazy.name().empty());
+
+	ASSERT_TRUE(dataLazy.tars_read(data.id, 0, true));
+	ASSERT_THROW(dataLazy.tars_read(data.name, 1, true), TarsDecodeRequireNotExist);
+	ASSERT_THROW(dataLazy.tars_read(data.name, 0, true), TarsDecodeMismatch);
+
+	//同一个tag出现多次, 按需解码和readFrom取到的是同一个
+	TarsOutputStream<BufferWriterString> os;
+	os.write((Int32)1, 0);
+	os.write((Int32)2, 0);
+	buff = os.getByteBuffer();
+	TarsInputStream<BufferReader> is;
+	is.setBuffer(buff.c_str(), buff.length());
+	data.readFrom(is);
+	ASSERT_TRUE(data.id == 1);
+	ASSERT_TRUE(ViewDataLazy(buff.c_str(), buff.length()).id() == data.id);
+}
+
+/**
+ * head(tag 2)里带一个不认识的结构体字段(tag 10), 里面再嵌套level层结构体
+ */
+static string makeNested(int level)
+{
+	string buff;
+	buff += (char)(0x20 | TarsHeadeStructBegin);
+	buff += (char)(0xA0 | TarsHeadeStructBegin);
+	buff += string(level, (char)TarsHeadeStructBegin);
+	buff += string(level, (char)TarsHeadeStructEnd);
+	buff += (char)TarsHeadeStructEnd;
+	buff += (char)TarsHeadeStructEnd;
+	return buff;
+}
+
+TEST_F(TarsEncodeTest, skipNested)
+{
+	ViewPackage pkg;
+	string buff = makeNested(TARS_MAX_SKIP_DEPTH - 1);
+	TarsInputStream<BufferReader> is;
+	is.setBuffer(buff.c_str(), buff.length());
+	pkg.readFrom(is);
+	ASSERT_TRUE(is.hasEnd());
+
+	//嵌套太深的数据包抛异常, 而不是递归到栈溢出
+	buff = makeNested(TARS_MAX_SKIP_DEPTH);
+	is.setBuffer(buff.c_str(), buff.length());
+	ASSERT_THROW(pkg.readFrom(is), TarsDecodeInvalidValue);
+
+	buff = makeNested(1024 * 1024);
+	is.setBuffer(buff.c_str(), buff.length());
+	ASSERT_THROW(pkg.readFrom(is), TarsDecodeInvalidValue);
+	ASSERT_THROW(ViewPackageLazy(buff.c_str(), buff.length()), TarsDecodeInvalidValue);
+
+	//list里嵌套list
+	buff.clear();
+	for(int i = 0; i < 1024 * 1024; i++)
+	{
+		buff += (char)TarsHeadeList;
+		buff += (char)TarsHeadeChar;
+		buff += (char)1;
+	}
+	is.setBuffer(buff.c_str(), buff.length());
+	ASSERT_THROW(is.skipField(), TarsDecodeInvalidValue);
+
+	//异常之后深度恢复, 同一个stream可以继续解码
+	buff = makeNested(TARS_MAX_SKIP_DEPTH - 1);
+	is.setBuffer(buff.c_str(), buff.length());
+	pkg.readFrom(is);
+	ASSERT_TRUE(is.hasEnd());
+}
+
+TEST_F(TarsEncodeTest, compareLazyDecode)
+{
+	string buff = encode(makePackage(200));
+
+	int count = 1000;
+
+	cout << "decode size:" << buff.length() << endl;
+	cout << "decode struct cost:" << decodeCost<ViewPackage>(count, buff) << "ms" << endl;
+
+	int64_t start = TC_Common::now2ms();
+	size_t total = 0;
+	for(int i = 0; i < count; i++)
+	{
+		ViewPackageLazy lazy(buff.c_str(), buff.length());
+		total += lazy.head_lazy().id();
+	}
+	cout << "lazy decode one field cost:" << TC_Common::now2ms() - start << "ms" << endl;
+	ASSERT_TRUE(total == (size_t)200 * count);
+}
+
+//逐个元素编码, 和批量编码之前的实现一样
+template<typename T>
+static string encodeElements(const vector<T> &v)
+{
+	TarsOutputStream<BufferWriterString> os;
+	DataHead::writeTo(os, DataHead::eList, 0);
+	os.write((Int32)v.size(), 0);
+	for(size_t i = 0; i < v.size(); i++)
+	{
+		os.write(v[i], 0);
+	}
+	return os.getByteBuffer();
+}
+
+template<typename T>
+static vector<T> decodeVector(const string &buff)
+{
+	vector<T> v;
+	TarsInputStream<> is;
+	is.setBuffer(buff.c_str(), buff.length());
+	is.read(v, 0);
+	return v;
+}
+
+template<typename T>
+static void checkBulk(const vector<T> &v)
+{
+	TarsOutputStream<BufferWriterString> os;
+	os.write(v, 0);
+	ASSERT_TRUE(os.getByteBuffer() == encodeElements(v));
+	ASSERT_TRUE(TarsEncodedSize::of(v, 0) == os.getLength());
+	ASSERT_TRUE(decodeVector<T>(os.getByteBuffer()) == v);
+}
+
+TEST_F(TarsEncodeTest, bulkVector)
+{
+	//覆盖SIMD的块和尾部
+	for(size_t n = 0; n < 20; n++)
+	{
+		vector<Float> fv;
+		vector<Double> dv;
+		vector<Int32> iv;
+		vector<Int64> lv;
+		for(size_t i = 0; i < n; i++)
+		{
+			fv.push_back(i * -1.25f);
+			dv.push_back(i * 3.3e100);
+			iv.push_back((i % 2 ? -1 : 1) * (Int32)(i * i * i * i * i * 1000));
+			lv.push_back((i % 2 ? -1 : 1) * (Int64)i * 999999999999LL);
+		}
+		checkBulk(fv);
+		checkBulk(dv);
+		checkBulk(iv);
+		checkBulk(lv);
+	}
+
+	vector<Int64> lv = { 0, 1, -1, 127, -128, 128, -129, 32767, -32768, 32768, -32769, 2147483647, -2147483647-1, 2147483648, INT64_MAX, INT64_MIN };
+	checkBulk(lv);
+	vector<Int32> iv(lv.begin(), lv.end());
+	checkBulk(iv);
+
+	//其他实现编码的元素(ZeroTag, double里的float, 带tag的元素)逐个解码
+	TarsOutputStream<BufferWriterString> os;
+	DataHead::writeTo(os, DataHead::eList, 0);
+	os.write((Int32)5, 0);
+	os.write((Double)1.5, 0);
+	os.write((Double)2.5, 0);
+	os.write((Char)0, 0);
+	os.write((Float)3.5, 0);
+	os.write((Double)4.5, 0);
+	vector<Double> dv = decodeVector<Double>(os.getByteBuffer());
+	ASSERT_TRUE(dv == vector<Double>({ 1.5, 2.5, 0, 3.5, 4.5 }));
+
+	//Int64的元素不能解码到Int32
+	ASSERT_THROW(decodeVector<Int32>(encodeElements(lv)), TarsDecodeMismatch);
+
+	//数据不完整
+	string buff = encodeElements(vector<Double>(10, 1.5));
+	ASSERT_THROW(decodeVector<Double>(buff.substr(0, buff.length() - 1)), TarsDecodeException);
+	buff = encodeElements(lv);
+	ASSERT_THROW(decodeVector<Int64>(buff.substr(0, buff.length() - 1)), TarsDecodeException);
+
+	//固定buffer刚好放下
+	vector<char> fixed(TarsEncodedSize::of(lv, 0));
+	TarsOutputStream<BufferWriterFixed> fos;
+	fos.setBuffer(fixed.data(), fixed.size());
+	fos.write(lv, 0);
+	ASSERT_TRUE(string(fixed.data(), fixed.size()) == buff);
+}
+
+TEST_F(TarsEncodeTest, compareBulkVector)
+{
+	size_t count = 1000000;
+	vector<Double> dv(count);
+	vector<Int64> lv(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		dv[i] = i * 0.001;
+		lv[i] = (Int64)i * (i % 3 ? 1 : 100000);
+	}
+
+	cout << "ssse3:" << TarsBulk::hasSSSE3() << endl;
+
+	int64_t start = TC_Common::now2ms();
+	string buff = encodeElements(dv);
+	cout << "double encode elements cost:" << TC_Common::now2ms() - start << "ms" << endl;
+
+	start = TC_Common::now2ms();
+	TarsOutputStream<BufferWriterString> os;
+	os.write(dv, 0);
+	cout << "double encode bulk cost:" << TC_Common::now2ms() - start << "ms" << endl;
+	ASSERT_TRUE(os.getByteBuffer() == buff);
+
+	//逐个元素解码
+	start = TC_Common::now2ms();
+	{
+		TarsInputStream<> is;
+		is.setBuffer(buff.c_str(), buff.length());
+		vector<Double> v(count);
+		DataHead h;
+		h.readFrom(is);
+		Int32 n;
+		is.read(n, 0);
+		for(size_t i = 0; i < v.size(); i++)
+		{
+			is.read(v[i], 0);
+		}
+	}
+	cout << "double decode elements cost:" << TC_Common::now2ms() - start << "ms" << endl;
+
+	start = TC_Common::now2ms();
+	ASSERT_TRUE(decodeVector<Double>(buff) == dv);
+	cout << "double decode bulk cost:" << TC_Common::now2ms() - start << "ms" << endl;
+
+	start = TC_Common::now2ms();
+	buff = encodeElements(lv);
+	cout << "int64 encode elements cost:" << TC_Common::now2ms() - start << "ms" << endl;
+
+	start = TC_Common::now2ms();
+	os.reset();
+	os.write(lv, 0);
+	cout << "int64 encode bulk cost:" << TC_Common::now2ms() - start << "ms" << endl;
+	ASSERT_TRUE(os.getByteBuffer() == buff);
+
+	start = TC_Common::now2ms();
+	ASSERT_TRUE(decodeVector<Int64>(buff) == lv);
+	cout << "int64 decode bulk cost:" << TC_Common::now2ms() - start << "ms" << endl;
+}
+
+template<typename Func>
+int64_t encodeCost(int count, Func func)
+{
+	int64_t start = TC_Common::now2ms();
+
+	for(int i = 0; i < count; i++)
+	{
+		func();
+	}
+
+	return TC_Common::now2ms() - start;
+}
+
+TEST_F(TarsEncodeTest, compareEncode)
+{
+	JsonMap m = makeMap(200);
+
+	int count = 2000;
+
+	size_t total = 0;
+
+	cout << "encode size:" << m.tars_encoded_size() << endl;
+
+	cout << "buffer writer cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriter> os;
+		m.writeTo(os);
+		total += os.getLength();
+	}) << "ms" << endl;
+
+	cout << "buffer writer(reserve exact) cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriter> os;
+		os.reserveExact(m.tars_encoded_size());
+		m.writeTo(os);
+		total += os.getLength();
+	}) << "ms" << endl;
+
+	cout << "buffer writer vector cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		m.writeTo(os);
+		total += os.getLength();
+	}) << "ms" << endl;
+
+	cout << "buffer writer vector(reserve exact) cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		os.reserveExact(m.tars_encoded_size());
+		m.writeTo(os);
+		total += os.getLength();
+	}) << "ms" << endl;
+
+	//调用者的buffer复用, 完全没有内存分配
+	vector<char> buff(m.tars_encoded_size());
+	cout << "buffer writer fixed cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterFixed> os;
+		os.setBuffer(buff.data(), buff.size());
+		m.writeTo(os);
+		total += os.getLength();
+	}) << "ms" << endl;
+
+	ASSERT_TRUE(total == m.tars_encoded_size() * count * 5);
+
+	//小的嵌套结构体: 算大小的遍历比省掉的扩容贵, tars2cpp生成的接口代码不对这种参数reserveExact
+	JsonData d = makeData(7, 16);
+	count = 100000;
+	cout << "small struct size:" << TarsEncodedSize::of(d, 1) << endl;
+	cout << "small struct cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		os.write(d, 1);
+	}) << "ms" << endl;
+	cout << "small struct(reserve exact) cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		os.reserveExact(TarsEncodedSize::of(d, 1));
+		os.write(d, 1);
+	}) << "ms" << endl;
+
+	//平铺的参数: 算大小是O(1)的, 生成的接口代码会reserveExact
+	string s(4096, 'a');
+	cout << "flat params cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		os.write(count, 1);
+		os.write(s, 2);
+	}) << "ms" << endl;
+	cout << "flat params(reserve exact) cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriterVector> os;
+		os.reserveExact(TarsEncodedSize::of(count, 1) + TarsEncodedSize::of(s, 2));
+		os.write(count, 1);
+		os.write(s, 2);
+	}) << "ms" << endl;
+
+	//应答包: 应答体是vector<char>, 只有context/status是小map, 算大小很便宜
+	//耗时和按容量倍增持平, 但buffer不会多占一倍内存, 框架编码应答/请求时reserveExact
+	ResponsePacket rsp;
+	rsp.sBuffer.assign(64 * 1024, 'a');
+	rsp.context["key"] = "value";
+	count = 20000;
+	cout << "response packet cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriter> os;
+		rsp.writeTo(os);
+	}) << "ms" << endl;
+	cout << "response packet(reserve exact) cost:" << encodeCost(count, [&]{
+		TarsOutputStream<BufferWriter> os;
+		os.reserveExact(rsp.tars_encoded_size());
+		rsp.writeTo(os);
+	}) << "ms" << endl;
+}
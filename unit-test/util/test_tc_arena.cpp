@@ -0,0 +1,261 @@
+#include "util/tc_common.h"
+#include "util/tc_arena.h"
+#include "tup/Tars.h"
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+
+class UtilArenaTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+TEST_F(UtilArenaTest, allocate)
+{
+	TC_Arena arena(1024);
+	ASSERT_TRUE(arena.getCapacity() == 0);
+
+	char *p1 = (char*)arena.allocate(10, 1);
+	char *p2 = (char*)arena.allocate(8, 8);
+	ASSERT_TRUE(p2 >= p1 + 10 && p2 < p1 + 24);
+	ASSERT_TRUE((size_t)p2 % 8 == 0);
+	ASSERT_TRUE(arena.getUsedSize() == 18);
+	ASSERT_TRUE(arena.getCapacity() == 1024);
+
+	//大于块大小的单独分配, 当前块继续使用
+	char *big = (char*)arena.allocate(4096, 64);
+	ASSERT_TRUE((size_t)big % 64 == 0);
+	memset(big, 0, 4096);
+	char *p3 = (char*)arena.allocate(8, 8);
+	ASSERT_TRUE(p3 > p2 && p3 < p1 + 1024);
+
+	for(int i = 0; i < 100; i++)
+	{
+		memset(arena.allocate(100), 0, 100);
+	}
+	ASSERT_TRUE(arena.getCapacity() > 1024 * 10);
+
+	//只保留一个块
+	arena.reset();
+	ASSERT_TRUE(arena.getUsedSize() == 0);
+	ASSERT_TRUE(arena.getCapacity() == 1024);
+}
+
+TEST_F(UtilArenaTest, allocator)
+{
+	typedef vector<int, TC_ArenaAllocator<int> > ArenaVector;
+
+	TC_Arena arena;
+
+	//不在Scope内, 走系统分配
+	ArenaVector heap;
+	heap.push_back(1);
+	ASSERT_TRUE(heap.get_allocator().arena() == NULL);
+
+	ArenaVector v;
+	{
+		TC_Arena::Scope scope(&arena);
+		ASSERT_TRUE(TC_Arena::current() == &arena);
+
+		ArenaVector av;
+		av.assign(100, 1);
+		ASSERT_TRUE(av.get_allocator().arena() == &arena);
+		ASSERT_TRUE(arena.getUsedSize() >= 100 * sizeof(int));
+
+		//嵌套
+		TC_Arena other;
+		{
+			TC_Arena::Scope inner(&other);
+			ASSERT_TRUE(TC_Arena::current() == &other);
+		}
+		ASSERT_TRUE(TC_Arena::current() == &arena);
+
+		scope.leave();
+		ASSERT_TRUE(TC_Arena::current() == NULL);
+
+		//Scope外拷贝出来的不在arena上
+		v = av;
+		ArenaVector copy(av);
+		ASSERT_TRUE(copy.get_allocator().arena() == NULL);
+		ASSERT_TRUE(copy == av);
+	}
+	ASSERT_TRUE(TC_Arena::current() == NULL);
+	ASSERT_TRUE(v.size() == 100 && v.get_allocator().arena() == NULL);
+}
+
+TEST_F(UtilArenaTest, moveAssign)
+{
+	typedef vector<int, TC_ArenaAllocator<int> > ArenaVector;
+
+	//长期存在的对象, 在Scope外构造
+	ArenaVector saved;
+	{
+		TC_Arena arena;
+		TC_Arena::Scope scope(&arena);
+
+		ArenaVector av;
+		av.assign(100, 2);
+		ASSERT_TRUE(av.get_allocator().arena() == &arena);
+
+		//分配器不同, move赋值时拷贝到目标自己的分配器上, 不指向请求的arena
+		saved = std::move(av);
+		ASSERT_TRUE(saved.get_allocator().arena() == NULL);
+
+		//move构造时分配器跟着走
+		ArenaVector other;
+		other.assign(10, 3);
+		ArenaVector moved(std::move(other));
+		ASSERT_TRUE(moved.get_allocator().arena() == &arena);
+	}
+
+	//arena已经释放, 数据仍然有效
+	ASSERT_TRUE(saved.size() == 100);
+	for(auto i : saved)
+	{
+		ASSERT_TRUE(i == 2);
+	}
+}
+
+/**
+ * 和tars2cpp --arena生成的结构体一样, 容器带分配器
+ */
+template<template<typename> class A>
+struct NestedItem : public TarsStructBase
+{
+	typedef map<string, string, less<string>, A<pair<const string, string> > > AttrMap;
+
+	Int32 id = 0;
+	string name;
+	vector<Int64, A<Int64> > values;
+	AttrMap attrs;
+
+	template<typename WriterT>
+	void writeTo(TarsOutputStream<WriterT>& _os) const
+	{
+		_os.write(id, 0);
+		_os.write(name, 1);
+		_os.write(values, 2);
+		_os.write(attrs, 3);
+	}
+	template<typename ReaderT>
+	void readFrom(TarsInputStream<ReaderT>& _is)
+	{
+		_is.read(id, 0, false);
+		_is.read(name, 1, false);
+		_is.read(values, 2, false);
+		_is.read(attrs, 3, false);
+	}
+};
+
+template<template<typename> class A>
+struct NestedPackage
+{
+	typedef NestedItem<A> Item;
+	typedef map<string, Item, less<string>, A<pair<const string, Item> > > ItemMap;
+	typedef vector<ItemMap, A<ItemMap> > ItemList;
+};
+
+template<template<typename> class A>
+static typename NestedPackage<A>::ItemList makeNested(int count)
+{
+	typename NestedPackage<A>::ItemList data;
+	for(int i = 0; i < count; i++)
+	{
+		typename NestedPackage<A>::ItemMap m;
+		for(int j = 0; j < 10; j++)
+		{
+			NestedItem<A> item;
+			item.id = i * 10 + j;
+			item.name = "n" + TC_Common::tostr(j);
+			for(int k = 0; k < 8; k++)
+			{
+				item.values.push_back(k * j);
+				item.attrs["k" + TC_Common::tostr(k)] = "v";
+			}
+			m["key" + TC_Common::tostr(j)] = item;
+		}
+		data.push_back(m);
+	}
+	return data;
+}
+
+template<typename T>
+static string encodeNested(const T &data)
+{
+	TarsOutputStream<BufferWriterString> os;
+	os.write(data, 0);
+	return os.getByteBuffer();
+}
+
+TEST_F(UtilArenaTest, decode)
+{
+	string buff = encodeNested(makeNested<std::allocator>(10));
+
+	TC_Arena arena;
+	{
+		TC_Arena::Scope scope(&arena);
+
+		NestedPackage<TC_ArenaAllocator>::ItemList data;
+		TarsInputStream<> is;
+		is.setBuffer(buff.c_str(), buff.length());
+		is.read(data, 0);
+
+		ASSERT_TRUE(data.size() == 10);
+		ASSERT_TRUE(data[3]["key5"].id == 35);
+		ASSERT_TRUE(data[3]["key5"].values.get_allocator().arena() == &arena);
+		ASSERT_TRUE(data[3]["key5"].attrs.get_allocator().arena() == &arena);
+		ASSERT_TRUE(data[3]["key5"].attrs["k7"] == "v");
+
+		//再编码一致
+		ASSERT_TRUE(encodeNested(data) == buff);
+	}
+	ASSERT_TRUE(arena.getUsedSize() > buff.length());
+}
+
+TEST_F(UtilArenaTest, compareDecode)
+{
+	string buff = encodeNested(makeNested<std::allocator>(200));
+
+	int count = 200;
+
+	cout << "decode size:" << buff.length() << endl;
+
+	int64_t start = TC_Common::now2ms();
+	for(int i = 0; i < count; i++)
+	{
+		NestedPackage<std::allocator>::ItemList data;
+		TarsInputStream<> is;
+		is.setBuffer(buff.c_str(), buff.length());
+		is.read(data, 0);
+	}
+	cout << "decode std allocator cost:" << TC_Common::now2ms() - start << "ms" << endl;
+
+	//每个请求一个arena, 和Current一样请求结束时整体释放
+	start = TC_Common::now2ms();
+	for(int i = 0; i < count; i++)
+	{
+		TC_Arena arena(buff.length() * 2);
+		TC_Arena::Scope scope(&arena);
+		NestedPackage<TC_ArenaAllocator>::ItemList data;
+		TarsInputStream<> is;
+		is.setBuffer(buff.c_str(), buff.length());
+		is.read(data, 0);
+	}
+	cout << "decode arena allocator cost:" << TC_Common::now2ms() - start << "ms" << endl;
+}
@@ -369,3 +369,310 @@ TEST_F(UtilCoroutineTest, coCoroutineQuit)
 	});
 	cor_call.join();
 }
+
+TEST_F(UtilCoroutineTest, groupSteal)
+{
+	int total = 50;
+
+	std::shared_ptr<TC_CoroutineSchedulerGroup> group = std::make_shared<TC_CoroutineSchedulerGroup>(2);
+
+	atomic<int> done{0};
+	atomic<int> stolen{0};
+	std::thread::id owner;
+
+	auto quit = [&](TC_CoroutineScheduler *s)
+	{
+		if(done == total)
+		{
+			s->terminate();
+		}
+	};
+
+	//空闲的调度器, 只能从组内窃取任务
+	std::thread thief([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+		scheduler->joinGroup(group, 1);
+		scheduler->setNoCoroutineCallback(quit);
+		scheduler->run();
+	});
+
+	std::thread busy([&]()
+	{
+		owner = std::this_thread::get_id();
+
+		auto scheduler = TC_CoroutineScheduler::create();
+		scheduler->setPoolStackSize(10, 128*1024);
+		scheduler->joinGroup(group, 0);
+		scheduler->setNoCoroutineCallback(quit);
+
+		scheduler->go([&]()
+		{
+			for(int i = 0; i < total; i++)
+			{
+				//任务会阻塞线程, 后面的任务只能由其他调度器执行
+				ASSERT_TRUE(scheduler->goStealable([&]()
+				{
+					if(std::this_thread::get_id() != owner)
+					{
+						++stolen;
+					}
+					TC_Common::msleep(10);
+					++done;
+				}));
+			}
+		});
+
+		scheduler->run();
+	});
+
+	busy.join();
+	thief.join();
+
+	ASSERT_TRUE(done == total);
+	ASSERT_TRUE(stolen > 0);
+
+	ASSERT_TRUE(group->getStat().tasks == (size_t)total);
+	ASSERT_TRUE(group->getStat(0).tasks == (size_t)total);
+	ASSERT_TRUE(group->getStat(0).steals == 0);
+	ASSERT_TRUE(group->getStat(1).steals == (size_t)stolen);
+	ASSERT_TRUE(group->getTaskSize() == 0);
+}
+
+TEST_F(UtilCoroutineTest, groupQueueFull)
+{
+	std::shared_ptr<TC_CoroutineSchedulerGroup> group = std::make_shared<TC_CoroutineSchedulerGroup>(1, 2);
+
+	atomic<int> done{0};
+
+	std::thread cor_call([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+		scheduler->setPoolStackSize(10, 128*1024);
+		scheduler->joinGroup(group, 0);
+
+		//任务队列满了直接创建协程, 队列里等待的任务也占用协程数
+		for(int i = 0; i < 5; i++)
+		{
+			ASSERT_TRUE(scheduler->goStealable([&](){ ++done; }));
+		}
+
+		ASSERT_TRUE(group->getTaskSize() == 2);
+		ASSERT_TRUE(scheduler->getFreeSize() == 5);
+
+		scheduler->setNoCoroutineCallback([](TC_CoroutineScheduler *s){ s->terminate(); });
+		scheduler->run();
+
+		ASSERT_TRUE(scheduler->getGroup() == NULL);
+	});
+	cor_call.join();
+
+	ASSERT_TRUE(done == 5);
+	ASSERT_TRUE(group->getStat().tasks == 2);
+}
+
+static void checkSharedStack(TC_CoroutineScheduler *scheduler, int id, atomic<int> &done)
+{
+	//栈上的数据在切换之后不变
+	char buff[1024];
+	memset(buff, id % 128, sizeof(buff));
+
+	for(int i = 0; i < 3; i++)
+	{
+		scheduler->sleep(10);
+
+		for(size_t j = 0; j < sizeof(buff); j++)
+		{
+			ASSERT_TRUE(buff[j] == id % 128);
+		}
+	}
+
+	++done;
+}
+
+TEST_F(UtilCoroutineTest, sharedStack)
+{
+	int total = 1000;
+
+	atomic<int> done{0};
+	TC_CoroutineScheduler::SharedStackStat stat;
+
+	std::thread cor_call([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+		scheduler->setPoolStackSize(total + 1, 128*1024);
+		scheduler->setSharedStack(2);
+
+		//在共享栈上的协程里再创建协程
+		scheduler->go([&]()
+		{
+			for(int i = 0; i < total; i++)
+			{
+				scheduler->go(std::bind(checkSharedStack, scheduler.get(), i, std::ref(done)));
+			}
+		});
+
+		scheduler->setNoCoroutineCallback([&](TC_CoroutineScheduler *s)
+		{
+			stat = s->getSharedStackStat();
+			s->terminate();
+		});
+
+		scheduler->run();
+	});
+	cor_call.join();
+
+	ASSERT_TRUE(done == total);
+
+	ASSERT_TRUE(stat.saveCount > (size_t)total);
+	ASSERT_TRUE(stat.avgSaveSize() > 1024 && stat.avgSaveSize() < 128*1024);
+	//协程结束后保存的栈都释放了
+	ASSERT_TRUE(stat.holdBytes == 0);
+}
+
+static void useStack(atomic<int> &done)
+{
+	//写满16K的局部变量, 栈的高水位至少是16K
+	volatile char buff[16*1024];
+	for(size_t i = 0; i < sizeof(buff); i++)
+	{
+		buff[i] = 1;
+	}
+
+	++done;
+}
+
+TEST_F(UtilCoroutineTest, stackCheck)
+{
+	int total = 200;
+
+	atomic<int> done{0};
+	TC_CoroutineScheduler::StackStat stat;
+	TC_CoroutineScheduler::StackStat last;
+
+	std::thread cor_call([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+		scheduler->setPoolStackSize(total + 10, 256*1024);
+		scheduler->setStackCheck(10, true);
+
+		scheduler->go([&]()
+		{
+			useStack(done);
+
+			//等待定期检查
+			scheduler->sleep(100);
+
+			stat = scheduler->getStackStat();
+
+			//超过初始的100个协程后, 新创建的协程使用调整后的栈大小
+			for(int i = 0; i < total; i++)
+			{
+				scheduler->go([&]()
+				{
+					useStack(done);
+					scheduler->sleep(10);
+				});
+			}
+		});
+
+		scheduler->setNoCoroutineCallback([&](TC_CoroutineScheduler *s)
+		{
+			s->checkStack();
+			last = s->getStackStat();
+			s->terminate();
+		});
+
+		scheduler->run();
+	});
+	cor_call.join();
+
+	ASSERT_TRUE(done == total + 1);
+
+	ASSERT_TRUE(stat.count >= 1);
+	ASSERT_TRUE(stat.maxUsed >= 16*1024 && stat.maxUsed < 256*1024);
+	ASSERT_TRUE(stat.stackSize >= 32*1024 && stat.stackSize < 256*1024);
+
+	//调整后的栈足够运行同样的协程
+	ASSERT_TRUE(last.count > (size_t)total);
+	ASSERT_TRUE(last.maxUsed >= 16*1024 && last.maxUsed * 2 <= last.stackSize + stack_traits::page_size());
+	ASSERT_TRUE(last.avgUsed >= 16*1024 && last.avgUsed <= last.maxUsed);
+}
+
+TEST_F(UtilCoroutineTest, post)
+{
+	int total = 100;
+
+	atomic<int> done{0};
+	std::thread::id schedId;
+
+	auto scheduler = TC_CoroutineScheduler::create();
+
+	std::thread cor_call([&]()
+	{
+		schedId = std::this_thread::get_id();
+
+		scheduler->run();
+	});
+
+	//其他线程投递的函数在调度线程中执行
+	std::thread poster([&]()
+	{
+		for(int i = 0; i < total; i++)
+		{
+			scheduler->post([&]()
+			{
+				if(std::this_thread::get_id() == schedId)
+				{
+					++done;
+				}
+			});
+		}
+	});
+	poster.join();
+
+	while(done < total)
+	{
+		TC_Common::msleep(10);
+	}
+
+	scheduler->terminate();
+	cor_call.join();
+
+	ASSERT_TRUE(done == total);
+}
+
+TEST_F(UtilCoroutineTest, postDrain)
+{
+	int total = 100;
+
+	int done = 0;
+	bool accepted = true;
+
+	std::thread cor_call([&]()
+	{
+		auto scheduler = TC_CoroutineScheduler::create();
+
+		for(int i = 0; i < total; i++)
+		{
+			scheduler->post([&]()
+			{
+				++done;
+			});
+		}
+
+		//退出时队列里的函数都要执行
+		scheduler->terminate();
+		scheduler->run();
+
+		//退出以后不再接受
+		accepted = scheduler->post([&]()
+		{
+			++done;
+		});
+	});
+	cor_call.join();
+
+	ASSERT_TRUE(done == total);
+	ASSERT_FALSE(accepted);
+}
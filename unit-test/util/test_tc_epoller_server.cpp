@@ -109,6 +109,31 @@ TEST_F(UtilEpollServerTest, RunTcp)
 	}
 }
 
+TEST_F(UtilEpollServerTest, RunTcpSharedStack)
+{
+	//两种协程模式下协程使用共享栈
+	for(int i = TC_EpollServer::NET_THREAD_QUEUE_HANDLES_CO; i <= TC_EpollServer::NET_THREAD_MERGE_HANDLES_CO; i += 2)
+	{
+		MyTcpServer server;
+		server._epollServer->setCoroutineSharedStack(2);
+		startServer(server, (TC_EpollServer::SERVER_OPEN_COROUTINE)i);
+
+		TC_TCPClient client(TEST_HOST_EP.getHost(), TEST_HOST_EP.getPort(), TEST_HOST_EP.getTimeout());
+		int iRet = 0;
+		char recvBuffer[1024];
+		size_t recvLenth = 1024;
+
+		for (int i = 0; i < 10; i++) {
+			iRet = client.sendRecv("abc", 3, recvBuffer, recvLenth);
+
+			ASSERT_TRUE(iRet == 0);
+			ASSERT_TRUE(string(recvBuffer, recvLenth) == "abc");
+		}
+
+		stopServer(server);
+	}
+}
+
 TEST_F(UtilEpollServerTest, RunEnableManualListen)
 {
 	int i = 0;
@@ -166,6 +191,206 @@ TEST_F(UtilEpollServerTest, RunLine)
 	}
 }
 
+TEST_F(UtilEpollServerTest, GatherWrite)
+{
+	for(int i = 0; i <= TC_EpollServer::NET_THREAD_MERGE_HANDLES_CO; i++)
+	{
+		MyTcpServer server;
+
+		server.initialize();
+		server._epollServer->setOpenCoroutine((TC_EpollServer::SERVER_OPEN_COROUTINE) i);
+		server.bindTcpLine(LINE_HOST_EP.toString(), 10, true);
+		server.waitForShutdown();
+
+		TC_TCPClient client(LINE_HOST_EP.getHost(), LINE_HOST_EP.getPort(), LINE_HOST_EP.getTimeout());
+
+		//一次发送多行, 服务端多个应答合并发送
+		string sendBuffer;
+		for(int j = 0; j < 100; j++)
+		{
+			sendBuffer += "line-" + TC_Common::tostr(j) + "\r\n";
+		}
+
+		int iRet = client.send(sendBuffer.c_str(), sendBuffer.size());
+		ASSERT_TRUE(iRet == 0);
+
+		string recvBuffer(sendBuffer.size(), '\0');
+		iRet = client.recvLength(&recvBuffer[0], recvBuffer.size());
+
+		ASSERT_TRUE(iRet == 0);
+
+		//多个handle线程并发处理, 应答的顺序不固定
+		vector<string> sendLines = TC_Common::sepstr<string>(sendBuffer, "\n");
+		vector<string> recvLines = TC_Common::sepstr<string>(recvBuffer, "\n");
+		std::sort(sendLines.begin(), sendLines.end());
+		std::sort(recvLines.begin(), recvLines.end());
+		ASSERT_TRUE(recvLines == sendLines);
+
+		//多个应答确实通过writev合并发送了(统计在发送之后才累加, 稍等一下)
+		TC_EpollServer::BindAdapterPtr lsPtr = server._epollServer->getBindAdapter("TcpLineAdapter");
+		for(int j = 0; j < 100 && lsPtr->getGatherSaved() == 0; j++)
+		{
+			TC_Common::msleep(10);
+		}
+		ASSERT_TRUE(lsPtr->getGatherSaved() > 0);
+
+		stopServer(server);
+	}
+}
+
+TEST_F(UtilEpollServerTest, RingQueue)
+{
+	for(int i = 0; i <= TC_EpollServer::NET_THREAD_MERGE_HANDLES_CO; i++)
+	{
+		MyTcpServer server;
+
+		server.initialize();
+		server._epollServer->setOpenCoroutine((TC_EpollServer::SERVER_OPEN_COROUTINE) i);
+		//发送队列也使用环形队列(需在创建网络线程之前设置)
+		server._epollServer->setQueueType(TC_EpollServer::QUEUE_RING);
+		server.bindTcpRing(LINE_HOST_EP.toString());
+		server.waitForShutdown();
+
+		TC_EpollServer::BindAdapterPtr lsPtr = server._epollServer->getBindAdapter("TcpRingAdapter");
+		ASSERT_TRUE(lsPtr->getDataBuffer()->getQueueType() == TC_EpollServer::QUEUE_RING);
+
+		//多个连接同时发送, 请求和应答都经过环形队列
+		vector<std::thread> clients;
+		std::atomic<int> succ{0};
+		for(int c = 0; c < 4; c++)
+		{
+			clients.push_back(std::thread([&, c]()
+			{
+				TC_TCPClient client(LINE_HOST_EP.getHost(), LINE_HOST_EP.getPort(), LINE_HOST_EP.getTimeout());
+
+				string sendBuffer;
+				for(int j = 0; j < 1000; j++)
+				{
+					sendBuffer += "ring-" + TC_Common::tostr(c) + "-" + TC_Common::tostr(j) + "\r\n";
+				}
+
+				if(client.send(sendBuffer.c_str(), sendBuffer.size()) != 0)
+				{
+					return;
+				}
+
+				string recvBuffer(sendBuffer.size(), '\0');
+				if(client.recvLength(&recvBuffer[0], recvBuffer.size()) != 0)
+				{
+					return;
+				}
+
+				vector<string> sendLines = TC_Common::sepstr<string>(sendBuffer, "\n");
+				vector<string> recvLines = TC_Common::sepstr<string>(recvBuffer, "\n");
+				std::sort(sendLines.begin(), sendLines.end());
+				std::sort(recvLines.begin(), recvLines.end());
+				if(recvLines == sendLines)
+				{
+					++succ;
+				}
+			}));
+		}
+
+		for(auto &t : clients)
+		{
+			t.join();
+		}
+
+		ASSERT_EQ(succ, 4);
+		ASSERT_EQ(lsPtr->getRingDiscard(), 0u);
+
+		stopServer(server);
+	}
+}
+
+/**
+ * 按行拆开再排序: 多个handle线程并发处理, 应答之间的顺序不固定, 但每一行必须是完整的
+ */
+static vector<string> sortLines(const string &buff)
+{
+	vector<string> lines = TC_Common::sepstr<string>(buff, "\n");
+	std::sort(lines.begin(), lines.end());
+	return lines;
+}
+
+TEST_F(UtilEpollServerTest, ChainResponse)
+{
+	for(int gatherWrite = 0; gatherWrite <= 1; gatherWrite++)
+	{
+		MyTcpServer server;
+
+		server.initialize();
+		server.bindTcpChain(LINE_HOST_EP.toString(), gatherWrite);
+		server.waitForShutdown();
+
+		TC_TCPClient client(LINE_HOST_EP.getHost(), LINE_HOST_EP.getPort(), LINE_HOST_EP.getTimeout());
+
+		//多个分段的应答, 每个应答的分段连续发送, 不会和其他应答交错
+		string sendBuffer;
+		for(int j = 0; j < 10; j++)
+		{
+			sendBuffer += string(200 * 1024 + j, 'a' + j) + "\r\n";
+		}
+
+		int iRet = client.send(sendBuffer.c_str(), sendBuffer.size());
+		ASSERT_TRUE(iRet == 0);
+
+		string recvBuffer(sendBuffer.size(), '\0');
+		iRet = client.recvLength(&recvBuffer[0], recvBuffer.size());
+
+		ASSERT_TRUE(iRet == 0);
+
+		//每个应答由BufferWriterChain编码成多段, 各段不会和其他应答交错, 所以收到的每一行都和发送的一致
+		ASSERT_TRUE(sortLines(recvBuffer) == sortLines(sendBuffer));
+
+		stopServer(server);
+	}
+}
+
+TEST_F(UtilEpollServerTest, WorkSteal)
+{
+	MyTcpServer server;
+
+	server.initialize();
+	server._epollServer->setOpenCoroutine(TC_EpollServer::NET_THREAD_QUEUE_HANDLES_CO);
+	server.bindTcpSteal(LINE_HOST_EP.toString());
+	server.waitForShutdown();
+
+	TC_TCPClient client(LINE_HOST_EP.getHost(), LINE_HOST_EP.getPort(), LINE_HOST_EP.getTimeout());
+
+	//一次发送多个耗时的请求, 被阻塞的handle取出的请求由另一个handle窃取处理, 应答的顺序不固定
+	vector<string> lines;
+	string sendBuffer;
+	for(int i = 0; i < 40; i++)
+	{
+		lines.push_back("slow-" + TC_Common::tostr(i) + "\r\n");
+		sendBuffer += lines.back();
+	}
+
+	int iRet = client.send(sendBuffer.c_str(), sendBuffer.size());
+	ASSERT_TRUE(iRet == 0);
+
+	string recvBuffer(sendBuffer.size(), '\0');
+	iRet = client.recvLength(&recvBuffer[0], recvBuffer.size());
+	ASSERT_TRUE(iRet == 0);
+
+	vector<string> recvLines = TC_Common::sepstr<string>(recvBuffer, "\n");
+	for(auto &line : recvLines)
+	{
+		line += "\n";
+	}
+	std::sort(recvLines.begin(), recvLines.end());
+	std::sort(lines.begin(), lines.end());
+	ASSERT_TRUE(recvLines == lines);
+
+	const shared_ptr<TC_CoroutineSchedulerGroup> &group = server._epollServer->getBindAdapter("TcpStealAdapter")->getStealGroup();
+	ASSERT_TRUE(group != NULL);
+	ASSERT_TRUE(group->getStat().tasks > 0);
+	ASSERT_TRUE(group->getStat().steals > 0);
+
+	stopServer(server);
+}
+
 TEST_F(UtilEpollServerTest, AcceptCallback)
 {
 
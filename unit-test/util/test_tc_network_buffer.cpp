@@ -3,6 +3,7 @@
 //
 
 #include "util/tc_network_buffer.h"
+#include "util/tc_transceiver.h"
 #include "util/tc_logger.h"
 #include "gtest/gtest.h"
 
@@ -450,4 +451,97 @@ TEST_F(UtilNetworkBufferTest, testCompact)
 	data->compact();
 
 	ASSERT_TRUE(TC_Port::strncasecmp(data->buffer(), &buff[10], data->length()) == 0);
-}
\ No newline at end of file
+}
+
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+TEST_F(UtilNetworkBufferTest, testGetBufferPointers)
+{
+	TC_NetWorkBuffer buff(NULL);
+
+	string a(100, 'a');
+	string b(200, 'b');
+	string c(300, 'c');
+
+	//每个应答一个buffer, 与发送队列的用法一致
+	buff.addBuffer(std::make_shared<TC_NetWorkBuffer::Buffer>(a.c_str(), a.size()));
+	buff.addBuffer(std::make_shared<TC_NetWorkBuffer::Buffer>(b.c_str(), b.size()));
+	buff.addBuffer(std::make_shared<TC_NetWorkBuffer::Buffer>(c.c_str(), c.size()));
+
+	ASSERT_TRUE(buff.listSize() == 3);
+
+	struct iovec vecs[2];
+
+	size_t count = buff.getBufferPointers(vecs, 2);
+
+	ASSERT_TRUE(count == 2);
+	ASSERT_TRUE(vecs[0].iov_len == a.size());
+	ASSERT_TRUE(vecs[1].iov_len == b.size());
+	ASSERT_TRUE(string((const char*)vecs[1].iov_base, vecs[1].iov_len) == b);
+
+	//writev只写了部分数据, 移动头部之后跨越了buffer
+	buff.moveHeader(150);
+
+	struct iovec all[TC_Transceiver::MAX_GATHER_IOV];
+
+	count = buff.getBufferPointers(all, TC_Transceiver::MAX_GATHER_IOV);
+
+	ASSERT_TRUE(count == 2);
+	ASSERT_TRUE(string((const char*)all[0].iov_base, all[0].iov_len) == string(150, 'b'));
+	ASSERT_TRUE(string((const char*)all[1].iov_base, all[1].iov_len) == c);
+}
+#endif
+
+TEST_F(UtilNetworkBufferTest, testSlice)
+{
+	TC_NetWorkBuffer buff(NULL);
+
+	//4字节长度 + 包体
+	string body(100, 'x');
+	uint32_t len = htonl((uint32_t)body.size() + 4);
+
+	auto data = buff.getOrCreateBuffer(1024, 1024);
+	memcpy((void*)data->free(), &len, 4);
+	memcpy((void*)(data->free() + 4), body.c_str(), body.size());
+	data->addWriteIdx(4 + body.size());
+	buff.addLength(4 + body.size());
+
+	TC_NetWorkBuffer::Slice slice;
+	ASSERT_TRUE((TC_NetWorkBuffer::parseBinary4<8, 1024>(buff, slice)) == TC_NetWorkBuffer::PACKET_FULL);
+
+	//同一个buffer中, 直接引用, 不copy
+	ASSERT_TRUE(slice.owner == data);
+	ASSERT_TRUE(slice.length == body.size());
+	ASSERT_TRUE(string(slice.data, slice.length) == body);
+	ASSERT_TRUE(buff.empty());
+
+	//切片还在, 网络buffer不能复用被引用的buffer
+	auto next = buff.getOrCreateBuffer(1024, 1024);
+	ASSERT_TRUE(next != data);
+	memset((void*)next->free(), 'y', next->left());
+
+	ASSERT_TRUE(string(slice.data, slice.length) == body);
+}
+
+TEST_F(UtilNetworkBufferTest, testSliceCopy)
+{
+	TC_NetWorkBuffer buff(NULL);
+
+	string a(10, 'a');
+	string b(20, 'b');
+
+	buff.addBuffer(std::make_shared<TC_NetWorkBuffer::Buffer>(a.c_str(), a.size()));
+	buff.addBuffer(std::make_shared<TC_NetWorkBuffer::Buffer>(b.c_str(), b.size()));
+
+	TC_NetWorkBuffer::Slice slice;
+
+	//跨越多个buffer, copy到新的buffer
+	ASSERT_TRUE(buff.getHeader(25, slice));
+	ASSERT_TRUE(slice.length == 25);
+	ASSERT_TRUE(string(slice.data, slice.length) == a + string(15, 'b'));
+	ASSERT_TRUE(buff.getBufferLength() == 30);
+
+	ASSERT_TRUE(buff.getHeader(5, slice));
+	ASSERT_TRUE(string(slice.data, slice.length) == "aaaaa");
+
+	ASSERT_FALSE(buff.getHeader(31, slice));
+}
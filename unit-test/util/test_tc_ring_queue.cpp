@@ -0,0 +1,204 @@
+#include "util/tc_common.h"
+#include "util/tc_ring_queue.h"
+#include "util/tc_thread_queue.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+
+class UtilRingQueueTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+TEST_F(UtilRingQueueTest, bounded)
+{
+	TC_RingQueue<int> queue(5);
+
+	ASSERT_TRUE(queue.capacity() == 8);
+	ASSERT_TRUE(queue.empty());
+
+	for(int i = 0; i < 8; i++)
+	{
+		ASSERT_TRUE(queue.push_back(i));
+	}
+
+	ASSERT_FALSE(queue.push_back(8));
+	ASSERT_TRUE(queue.size() == 8);
+
+	int v;
+	for(int i = 0; i < 8; i++)
+	{
+		ASSERT_TRUE(queue.pop_front(v));
+		ASSERT_TRUE(v == i);
+	}
+
+	ASSERT_FALSE(queue.pop_front(v));
+	ASSERT_TRUE(queue.empty());
+}
+
+TEST_F(UtilRingQueueTest, sharedPtr)
+{
+	TC_RingQueue<std::shared_ptr<int>> queue(4);
+
+	std::shared_ptr<int> data = std::make_shared<int>(1);
+
+	queue.push_back(data);
+	ASSERT_TRUE(data.use_count() == 2);
+
+	std::shared_ptr<int> out;
+	ASSERT_TRUE(queue.pop_front(out));
+
+	//出队后槽位不再持有引用
+	out.reset();
+	ASSERT_TRUE(data.use_count() == 1);
+}
+
+TEST_F(UtilRingQueueTest, waitTimeout)
+{
+	TC_RingQueue<int> queue(16);
+
+	int64_t start = TC_Common::now2ms();
+
+	int v;
+	ASSERT_FALSE(queue.pop_front(v, 100));
+
+	ASSERT_TRUE(TC_Common::now2ms() - start >= 90);
+}
+
+TEST_F(UtilRingQueueTest, waitNotify)
+{
+	TC_RingQueue<int> queue(16);
+
+	std::thread t([&]{
+		TC_Common::msleep(50);
+		queue.push_back(10);
+	});
+
+	int v = 0;
+	ASSERT_TRUE(queue.pop_front(v, 5000));
+	ASSERT_TRUE(v == 10);
+
+	t.join();
+}
+
+TEST_F(UtilRingQueueTest, mpmc)
+{
+	TC_RingQueue<int64_t> queue(1024);
+
+	const int writers = 4;
+	const int readers = 4;
+	const int64_t count = 200000;
+
+	std::atomic<int64_t> total{0};
+	std::atomic<int64_t> popped{0};
+
+	vector<std::thread> threads;
+	for(int i = 0; i < writers; i++)
+	{
+		threads.push_back(std::thread([&]{
+			for(int64_t j = 1; j <= count; j++)
+			{
+				while(!queue.push_back(j))
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	for(int i = 0; i < readers; i++)
+	{
+		threads.push_back(std::thread([&]{
+			int64_t j;
+			while(popped < writers * count)
+			{
+				if(queue.pop_front(j, 10))
+				{
+					total += j;
+					++popped;
+				}
+			}
+		}));
+	}
+
+	for(auto &t : threads)
+	{
+		t.join();
+	}
+
+	ASSERT_TRUE(total == writers * (count * (count + 1) / 2));
+	ASSERT_TRUE(queue.empty());
+}
+
+template<typename Q>
+int64_t handOff(Q &queue, int writers, int64_t count)
+{
+	int64_t start = TC_Common::now2ms();
+
+	vector<std::thread> threads;
+	for(int i = 0; i < writers; i++)
+	{
+		threads.push_back(std::thread([&]{
+			for(int64_t j = 0; j < count; j++)
+			{
+				while(!queue.push_back(j))
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	int64_t popped = 0;
+	int64_t v;
+	while(popped < writers * count)
+	{
+		if(queue.pop_front(v, 10))
+		{
+			++popped;
+		}
+	}
+
+	for(auto &t : threads)
+	{
+		t.join();
+	}
+
+	return TC_Common::now2ms() - start;
+}
+
+//TC_ThreadQueue::push_back没有返回值, 包装一下
+class ThreadQueueWrapper : public TC_ThreadQueue<int64_t>
+{
+public:
+	bool push_back(const int64_t &t) { TC_ThreadQueue<int64_t>::push_back(t); return true; }
+};
+
+TEST_F(UtilRingQueueTest, compareThreadQueue)
+{
+	ThreadQueueWrapper threadQueue;
+	TC_RingQueue<int64_t> ringQueue(64*1024);
+
+	int64_t count = 500000;
+
+	cout << "thread queue cost:" << handOff(threadQueue, 4, count) << "ms" << endl;
+	cout << "ring queue cost:" << handOff(ringQueue, 4, count) << "ms" << endl;
+}
@@ -0,0 +1,220 @@
+#include "util/tc_common.h"
+#include "util/tc_thread_cache_pool.h"
+#include "util/tc_ring_queue.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <set>
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+
+class UtilThreadCachePoolTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+//每个用例用不同的SIZE, 互不影响
+TEST_F(UtilThreadCachePoolTest, localReuse)
+{
+	typedef TC_ThreadCachePool<100> Pool;
+
+	//未开启时直接走系统分配
+	void *p = Pool::allocate(100);
+	Pool::deallocate(p);
+	ASSERT_TRUE(Pool::getCacheSize() == 0);
+
+	Pool::setEnable(true);
+
+	set<void*> ptrs;
+	vector<void*> blocks;
+	for(int i = 0; i < 10; i++)
+	{
+		blocks.push_back(Pool::allocate(100));
+		ptrs.insert(blocks.back());
+	}
+
+	for(auto b : blocks)
+	{
+		Pool::deallocate(b);
+	}
+	ASSERT_TRUE(Pool::getCacheSize() == 10);
+
+	//再次分配复用缓存的块
+	for(int i = 0; i < 10; i++)
+	{
+		ASSERT_TRUE(ptrs.find(Pool::allocate(100)) != ptrs.end());
+	}
+	ASSERT_TRUE(Pool::getCacheSize() == 0);
+
+	//超过SIZE的不进池
+	p = Pool::allocate(200);
+	Pool::deallocate(p);
+	ASSERT_TRUE(Pool::getCacheSize() == 0);
+
+	//关闭后, 之前池里分配的也能正常释放
+	Pool::setEnable(false);
+	for(auto b : ptrs)
+	{
+		Pool::deallocate(b);
+	}
+	ASSERT_TRUE(Pool::getCacheSize() == 10);
+}
+
+TEST_F(UtilThreadCachePoolTest, crossThreadReturn)
+{
+	typedef TC_ThreadCachePool<101> Pool;
+
+	Pool::setEnable(true);
+
+	set<void*> ptrs;
+	vector<void*> blocks;
+	for(int i = 0; i < 100; i++)
+	{
+		blocks.push_back(Pool::allocate(101));
+		ptrs.insert(blocks.back());
+	}
+
+	//其他线程释放, 还给分配的线程
+	std::thread t([&]{
+		for(auto b : blocks)
+		{
+			Pool::deallocate(b);
+		}
+		ASSERT_TRUE(Pool::getCacheSize() == 0);
+	});
+	t.join();
+
+	ASSERT_TRUE(Pool::getCacheSize() == 0);
+
+	for(int i = 0; i < 100; i++)
+	{
+		ASSERT_TRUE(ptrs.find(Pool::allocate(101)) != ptrs.end());
+	}
+}
+
+TEST_F(UtilThreadCachePoolTest, crossThreadMaxCache)
+{
+	typedef TC_ThreadCachePool<103> Pool;
+
+	Pool::setEnable(true);
+	Pool::setMaxCache(10);
+
+	vector<void*> blocks;
+	for(int i = 0; i < 100; i++)
+	{
+		blocks.push_back(Pool::allocate(103));
+	}
+
+	//其他线程归还的超过上限的直接释放
+	std::thread t([&]{
+		for(auto b : blocks)
+		{
+			Pool::deallocate(b);
+		}
+	});
+	t.join();
+
+	//取回归还的块, 第一次分配用掉一个
+	Pool::deallocate(Pool::allocate(103));
+	ASSERT_TRUE(Pool::getCacheSize() == 10);
+
+	Pool::setMaxCache(4096);
+}
+
+TEST_F(UtilThreadCachePoolTest, threadExit)
+{
+	typedef TC_ThreadCachePool<102> Pool;
+
+	Pool::setEnable(true);
+
+	set<void*> ptrs;
+
+	std::thread t1([&]{
+		vector<void*> blocks;
+		for(int i = 0; i < 10; i++)
+		{
+			blocks.push_back(Pool::allocate(102));
+			ptrs.insert(blocks.back());
+		}
+		for(auto b : blocks)
+		{
+			Pool::deallocate(b);
+		}
+	});
+	t1.join();
+
+	//退出线程的缓存被新线程接管
+	std::thread t2([&]{
+		ASSERT_TRUE(Pool::getCacheSize() == 0);
+		ASSERT_TRUE(ptrs.find(Pool::allocate(102)) != ptrs.end());
+		ASSERT_TRUE(Pool::getCacheSize() == 9);
+	});
+	t2.join();
+}
+
+struct BenchMsg
+{
+	char data[512];
+};
+
+template<typename Alloc, typename Free>
+int64_t handOffCost(int count, Alloc alloc, Free dealloc)
+{
+	TC_RingQueue<void*> queue(64*1024);
+
+	int64_t start = TC_Common::now2ms();
+
+	//业务线程分配, 网络线程释放
+	std::thread net([&]{
+		void *p;
+		int n = 0;
+		while(n < count)
+		{
+			if(queue.pop_front(p, 10))
+			{
+				dealloc(p);
+				++n;
+			}
+		}
+	});
+
+	for(int i = 0; i < count; i++)
+	{
+		void *p = alloc();
+		while(!queue.push_back(p))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	net.join();
+
+	return TC_Common::now2ms() - start;
+}
+
+TEST_F(UtilThreadCachePoolTest, compareNewDelete)
+{
+	typedef TC_ThreadCachePool<sizeof(BenchMsg)> Pool;
+
+	Pool::setEnable(true);
+
+	int count = 1000000;
+
+	cout << "new/delete cost:" << handOffCost(count, []{ return (void*)new BenchMsg(); }, [](void *p){ delete (BenchMsg*)p; }) << "ms" << endl;
+	cout << "thread cache pool cost:" << handOffCost(count, []{ return Pool::allocate(sizeof(BenchMsg)); }, [](void *p){ Pool::deallocate(p); }) << "ms" << endl;
+}
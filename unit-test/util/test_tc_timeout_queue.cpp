@@ -0,0 +1,262 @@
+#include "util/tc_common.h"
+#include "util/tc_timeout_queue_new.h"
+#include "util/tc_timeout_queue_slab.h"
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+
+class UtilTimeoutQueueTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+TEST_F(UtilTimeoutQueueTest, pushGet)
+{
+	TC_TimeoutQueueSlab<int> queue;
+
+	int64_t now = TNOWMS;
+
+	for(int i = 1; i <= 1000; i++)
+	{
+		ASSERT_TRUE(queue.push(i, i, now + 10000));
+	}
+
+	//id重复
+	int v = 1;
+	ASSERT_FALSE(queue.push(v, 1, now + 10000));
+	ASSERT_TRUE(queue.size() == 1000);
+
+	for(int i = 1; i <= 1000; i += 2)
+	{
+		ASSERT_TRUE(queue.get(i, v));
+		ASSERT_TRUE(v == i);
+	}
+
+	ASSERT_FALSE(queue.get(1, v));
+	ASSERT_TRUE(queue.get(2, v, false));
+	ASSERT_TRUE(queue.size() == 500);
+
+	for(int i = 2; i <= 1000; i += 2)
+	{
+		ASSERT_TRUE(queue.erase(i, v));
+		ASSERT_TRUE(v == i);
+	}
+
+	ASSERT_TRUE(queue.size() == 0);
+}
+
+TEST_F(UtilTimeoutQueueTest, sendList)
+{
+	TC_TimeoutQueueSlab<int> queue;
+
+	int64_t now = TNOWMS;
+
+	for(int i = 1; i <= 10; i++)
+	{
+		ASSERT_TRUE(queue.push(i, i, now + 10000, false));
+	}
+
+	ASSERT_TRUE(queue.getSendListSize() == 10);
+
+	int v;
+	ASSERT_TRUE(queue.get(3, v));
+	ASSERT_TRUE(queue.getSendListSize() == 9);
+
+	//先放入的先发送
+	ASSERT_TRUE(queue.getSend(v));
+	ASSERT_TRUE(v == 1);
+	queue.popSend(false);
+	ASSERT_TRUE(queue.size() == 9);
+
+	ASSERT_TRUE(queue.getSend(v));
+	ASSERT_TRUE(v == 2);
+	queue.popSend(true);
+	ASSERT_TRUE(queue.size() == 8);
+
+	ASSERT_TRUE(queue.getSend(v));
+	ASSERT_TRUE(v == 4);
+
+	while(!queue.sendListEmpty())
+	{
+		queue.popSend();
+	}
+
+	ASSERT_FALSE(queue.getSend(v));
+	ASSERT_TRUE(queue.size() == 8);
+}
+
+TEST_F(UtilTimeoutQueueTest, timeoutOrder)
+{
+	TC_TimeoutQueueSlab<int> queue;
+
+	int64_t now = TNOWMS;
+
+	//多种超时时间混在一起, 超过链表(lane)个数的也要有序
+	srand(100);
+	std::multimap<int64_t, int> expect;
+	for(int i = 1; i <= 10000; i++)
+	{
+		int64_t timeout = now - 100000 + i * 5 - (rand() % 20) * 1000;
+		ASSERT_TRUE(queue.push(i, i, timeout, i % 3 == 0));
+		expect.insert(make_pair(timeout, i));
+	}
+
+	//还没超时的
+	int v = 0;
+	ASSERT_TRUE(queue.push(v, 0, now + 10000));
+
+	int64_t last = 0;
+	int count = 0;
+	while(queue.timeout(v))
+	{
+		auto it = expect.begin();
+		ASSERT_TRUE(it->first >= last);
+		last = it->first;
+
+		auto range = expect.equal_range(it->first);
+		bool found = false;
+		for(auto r = range.first; r != range.second; ++r)
+		{
+			if(r->second == v)
+			{
+				expect.erase(r);
+				found = true;
+				break;
+			}
+		}
+		ASSERT_TRUE(found);
+		++count;
+	}
+
+	ASSERT_TRUE(count == 10000);
+	ASSERT_TRUE(queue.size() == 1);
+	ASSERT_TRUE(queue.getSendListSize() == 0);
+
+	queue.push(v, 1, now - 1);
+	queue.push(v, 2, now - 1);
+
+	int fired = 0;
+	TC_TimeoutQueueSlab<int>::data_functor df = [&](int &){ ++fired; };
+	queue.timeout(df);
+	ASSERT_TRUE(fired == 2);
+	ASSERT_TRUE(queue.size() == 1);
+}
+
+class SlabQueue : public TC_TimeoutQueueSlab<int>
+{
+public:
+	SlabQueue(size_t size) : TC_TimeoutQueueSlab<int>(5000, size) {}
+
+	size_t nodeCapacity() const { return _nodes.capacity(); }
+	size_t tableSize() const { return _table.size(); }
+};
+
+TEST_F(UtilTimeoutQueueTest, presized)
+{
+	SlabQueue queue(1000);
+
+	size_t capacity = queue.nodeCapacity();
+	size_t table = queue.tableSize();
+	ASSERT_TRUE(capacity >= 1000);
+
+	//预分配的范围内不分配内存
+	int64_t now = TNOWMS;
+	for(int round = 0; round < 3; round++)
+	{
+		for(int i = 1; i <= 1000; i++)
+		{
+			ASSERT_TRUE(queue.push(i, i, now + (i % 20) * 1000 - i, i % 2 == 0));
+		}
+		ASSERT_TRUE(queue.nodeCapacity() == capacity);
+		ASSERT_TRUE(queue.tableSize() == table);
+
+		int v;
+		for(int i = 1; i <= 1000; i++)
+		{
+			ASSERT_TRUE(queue.get(i, v));
+		}
+		ASSERT_TRUE(queue.size() == 0);
+		ASSERT_TRUE(queue.getSendListSize() == 0);
+	}
+
+	//超过后扩容
+	for(int i = 1; i <= 1001; i++)
+	{
+		queue.push(i, i, now);
+	}
+	ASSERT_TRUE(queue.nodeCapacity() > capacity);
+	ASSERT_TRUE(queue.size() == 1001);
+}
+
+template<typename Q>
+int64_t queueCost(Q &queue, uint32_t count)
+{
+	int64_t start = TC_Common::now2ms();
+
+	int64_t now = TNOWMS;
+
+	int *p = NULL;
+
+	//1M个在途请求, 超时时间基本递增(有两种超时配置)
+	for(uint32_t i = 0; i < count; i++)
+	{
+		uint32_t id = queue.generateId();
+		queue.push(p, id, now - 20000 + (int64_t)i / 100 + (i % 2 ? 3000 : 0), i % 4 != 0);
+	}
+
+	//发送
+	while(!queue.sendListEmpty())
+	{
+		queue.getSend(p);
+		queue.popSend();
+	}
+
+	//一半回包
+	for(uint32_t id = 1; id <= count; id += 2)
+	{
+		queue.get(id, p);
+	}
+
+	//另一半超时
+	while(queue.timeout(p))
+	{
+	}
+
+	return TC_Common::now2ms() - start;
+}
+
+TEST_F(UtilTimeoutQueueTest, compareTimeoutQueueNew)
+{
+	uint32_t count = 1000000;
+
+	{
+		TC_TimeoutQueueNew<int*> queue;
+		cout << "timeout queue new cost:" << queueCost(queue, count) << "ms" << endl;
+		ASSERT_TRUE(queue.size() == 0);
+	}
+	{
+		TC_TimeoutQueueSlab<int*> queue;
+		cout << "timeout queue slab cost:" << queueCost(queue, count) << "ms" << endl;
+		ASSERT_TRUE(queue.size() == 0);
+
+		//节点已经分配好, 第二轮不再分配内存
+		cout << "timeout queue slab(warm) cost:" << queueCost(queue, count) << "ms" << endl;
+		ASSERT_TRUE(queue.size() == 0);
+	}
+}
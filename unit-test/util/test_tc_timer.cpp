@@ -246,3 +246,267 @@ TEST_F(UtilTimerTest, testRepeatUseCount)
 }
 
 
+
+TEST_F(UtilTimerTest, testWheelDelayTask)
+{
+	TC_Timer timer;
+	timer.setTimerType(TC_TimerBase::TIMER_WHEEL);
+	timer.startTimer(1);
+	shared_ptr<TestClass> tPtr = std::make_shared<TestClass>();
+
+	int64_t start = TNOWMS;
+	timer.postDelayed(100, std::bind(&TestClass::test2, tPtr.get(), std::placeholders::_1), 1);
+	//超过第0层(256ms)的事件需要下放
+	timer.postDelayed(400, std::bind(&TestClass::test2, tPtr.get(), std::placeholders::_1), 2);
+	uint64_t id = timer.postDelayed(200, std::bind(&TestClass::test2, tPtr.get(), std::placeholders::_1), 3);
+	timer.erase(id);
+
+	TC_Common::msleep(500);
+
+	ASSERT_TRUE(tPtr->_data.size() == 2);
+	ASSERT_TRUE(tPtr->_data[0].second == 1);
+	ASSERT_TRUE(tPtr->_data[1].second == 2);
+	ASSERT_TRUE(tPtr->_data[0].first - start >= 100);
+	ASSERT_TRUE(tPtr->_data[1].first - start >= 400);
+	ASSERT_TRUE(tPtr->_data[1].first - start <= 420);
+
+	timer.stopTimer();
+}
+
+TEST_F(UtilTimerTest, testWheelRepeatTask)
+{
+	TC_Timer timer;
+	timer.setTimerType(TC_TimerBase::TIMER_WHEEL);
+	shared_ptr<TestClass> tPtr = std::make_shared<TestClass>();
+	timer.startTimer(1);
+	uint64_t id = timer.postRepeated(50, false, std::bind(&TestClass::test1, tPtr.get()));
+
+	TC_Common::msleep(1080);
+
+	ASSERT_TRUE(tPtr->_data.size() >= 20);
+	ASSERT_TRUE(tPtr->_data.size() <= 21);
+
+	timer.erase(id);
+
+	TC_Common::msleep(100);
+
+	ASSERT_TRUE(tPtr->_data.size() >= 20);
+	ASSERT_TRUE(tPtr->_data.size() <= 21);
+
+	timer.stopTimer();
+}
+
+TEST_F(UtilTimerTest, testSwitchTimerType)
+{
+	TC_Timer timer;
+	timer.startTimer(1);
+	shared_ptr<TestClass> tPtr = std::make_shared<TestClass>();
+
+	timer.postDelayed(100, std::bind(&TestClass::test2, tPtr.get(), std::placeholders::_1), 1);
+	timer.postDelayed(300, std::bind(&TestClass::test2, tPtr.get(), std::placeholders::_1), 2);
+
+	//已有的事件迁移到时间轮, 再迁移回来
+	timer.setTimerType(TC_TimerBase::TIMER_WHEEL);
+	TC_Common::msleep(150);
+	ASSERT_TRUE(tPtr->_data.size() == 1);
+
+	timer.setTimerType(TC_TimerBase::TIMER_MAP);
+	TC_Common::msleep(200);
+	ASSERT_TRUE(tPtr->_data.size() == 2);
+
+	timer.stopTimer();
+}
+
+TEST_F(UtilTimerTest, testEpollerWheel)
+{
+	TC_Epoller epoller;
+	epoller.create(1024);
+	epoller.setTimerType(TC_TimerBase::TIMER_WHEEL);
+
+	int count = 0;
+	epoller.postDelayed(50, [&]{ ++count; });
+	epoller.postDelayed(300, [&]{ ++count; epoller.terminate(); });
+
+	int64_t start = TNOWMS;
+	epoller.loop(1000);
+
+	ASSERT_TRUE(count == 2);
+	ASSERT_TRUE(TNOWMS - start >= 300);
+	ASSERT_TRUE(TNOWMS - start < 1000);
+}
+
+/**
+ * 用模拟时间直接驱动时间轮
+ */
+class WheelTester : public TC_TimerBase
+{
+public:
+	typedef TC_TimerBase::EVENT_SET EVENT_SET;
+
+	void add(uint32_t id, uint64_t fireMillseconds, uint64_t now)
+	{
+		auto func = std::make_shared<Func>(fireMillseconds, id);
+		_funcs[id] = func;
+		_wheel.add(func.get(), now);
+	}
+
+	void remove(uint32_t id)
+	{
+		_wheel.remove(_funcs[id].get());
+		_funcs.erase(id);
+	}
+
+	int64_t expire(uint64_t now, EVENT_SET &el)
+	{
+		int64_t next = _wheel.expire(now, el);
+		for (auto id : el)
+		{
+			_funcs.erase(id);
+		}
+		return next;
+	}
+
+	size_t size() const { return _wheel.size(); }
+
+protected:
+	virtual void onFireEvent(std::function<void()> func) { func(); }
+
+	virtual void onAddTimer() {}
+
+	unordered_map<uint32_t, shared_ptr<Func>> _funcs;
+};
+
+TEST_F(UtilTimerTest, testWheelCascade)
+{
+	WheelTester wheel;
+
+	srand(1000);
+
+	uint64_t now = 1000000007;
+
+	//各层都覆盖到, 包括超过2^32ms被截断的
+	uint64_t ranges[] = { 200, 300, 20000, 2000000, 100000000, 6000000000ULL };
+
+	std::set<pair<uint64_t, uint32_t>> pending;
+	std::unordered_map<uint32_t, uint64_t> fires;
+
+	uint32_t id = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		uint64_t range = ranges[i % (sizeof(ranges)/sizeof(ranges[0]))];
+		uint64_t fire = now + ((uint64_t)rand() * RAND_MAX + rand()) % range;
+
+		++id;
+		wheel.add(id, fire, now);
+		pending.insert(make_pair(fire, id));
+		fires[id] = fire;
+	}
+
+	ASSERT_TRUE(wheel.size() == pending.size());
+
+	int step = 0;
+	while (!pending.empty())
+	{
+		//随机步长, 从1ms到2^26ms
+		now += 1 + ((uint64_t)rand() % (1ULL << (rand() % 27)));
+
+		//中途随机删除和新增一些
+		if (step++ % 10 == 0)
+		{
+			auto it = pending.begin();
+			std::advance(it, rand() % pending.size());
+			wheel.remove(it->second);
+			pending.erase(it);
+
+			uint64_t fire = now + rand() % 100000;
+			++id;
+			wheel.add(id, fire, now);
+			pending.insert(make_pair(fire, id));
+			fires[id] = fire;
+		}
+
+		WheelTester::EVENT_SET el;
+		int64_t next = wheel.expire(now, el);
+
+		for (auto eid : el)
+		{
+			auto it = pending.find(make_pair(fires[eid], eid));
+			ASSERT_TRUE(it != pending.end());
+			ASSERT_TRUE(fires[eid] <= now);
+			pending.erase(it);
+		}
+
+		//未到期的都还在, 下一次时间不晚于最近事件
+		ASSERT_TRUE(wheel.size() == pending.size());
+		if (!pending.empty())
+		{
+			ASSERT_TRUE(pending.begin()->first > now);
+			ASSERT_TRUE(next > 0 && (uint64_t)next <= pending.begin()->first);
+		}
+		else
+		{
+			ASSERT_TRUE(next == -1);
+		}
+	}
+}
+
+/**
+ * 不启动线程, 直接触发, 用来比较两种实现的开销
+ */
+class BenchTimer : public TC_TimerBase
+{
+public:
+	int64_t fire() { return fireEvents(0); }
+
+protected:
+	virtual void onFireEvent(std::function<void()> func) { func(); }
+
+	virtual void onAddTimer() {}
+};
+
+int64_t timerCost(TC_TimerBase::TIMER_TYPE type, int count)
+{
+	BenchTimer timer;
+	timer.setTimerType(type);
+
+	srand(100);
+
+	int fired = 0;
+	vector<int64_t> ids;
+	ids.reserve(count);
+
+	int64_t start = TC_Common::now2ms();
+
+	//模拟请求超时: 大部分请求在超时前回包, 超时事件被删除
+	for (int i = 0; i < count; i++)
+	{
+		ids.push_back(timer.postDelayed(1000 + rand() % 5000, [&]{ ++fired; }));
+
+		if (i >= 100)
+		{
+			timer.erase(ids[i - 100]);
+		}
+
+		if (i % 1000 == 0)
+		{
+			timer.fire();
+		}
+	}
+
+	for (int i = count - 100; i < count; i++)
+	{
+		timer.erase(ids[i]);
+	}
+
+	timer.fire();
+
+	return TC_Common::now2ms() - start;
+}
+
+TEST_F(UtilTimerTest, compareMapWheel)
+{
+	int count = 1000000;
+
+	cout << "map timer cost:" << timerCost(TC_TimerBase::TIMER_MAP, count) << "ms" << endl;
+	cout << "wheel timer cost:" << timerCost(TC_TimerBase::TIMER_WHEEL, count) << "ms" << endl;
+}
@@ -0,0 +1,96 @@
+#include "util/tc_transceiver.h"
+#include "util/tc_epoller.h"
+#include "gtest/gtest.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace tars;
+
+class UtilTransceiverTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+/**
+ * 不建连接, 直接按doResponse的方式喂读取的结果
+ */
+class RecvHintTransceiver : public TC_TCPTransceiver
+{
+public:
+	RecvHintTransceiver(TC_Epoller *epoller) : TC_TCPTransceiver(epoller, TC_Endpoint("tcp -h 127.0.0.1 -p 8080"))
+	{
+	}
+
+	/**
+	 * 模拟一次recv: buffer剩余空间按当前的hint, 对端有available字节可读
+	 * @return 本次读取的字节数
+	 */
+	size_t read(size_t available)
+	{
+		size_t left = getRecvHint();
+		size_t readLen = std::min(available, left);
+
+		updateRecvHint(readLen, left);
+
+		return readLen;
+	}
+};
+
+TEST_F(UtilTransceiverTest, recvHint)
+{
+	TC_Epoller epoller;
+	epoller.create(1024);
+
+	RecvHintTransceiver trans(&epoller);
+
+	ASSERT_TRUE(trans.getRecvHint() == TC_Transceiver::MIN_RECV_HINT);
+
+	//大包: 每次都读满, hint翻倍, 直到上限
+	size_t last = trans.getRecvHint();
+	for(int i = 0; i < 4; i++)
+	{
+		trans.read(10*1024*1024);
+		ASSERT_TRUE(trans.getRecvHint() == std::min(last * 2, (size_t)TC_Transceiver::MAX_RECV_HINT));
+		last = trans.getRecvHint();
+	}
+
+	for(int i = 0; i < 10; i++)
+	{
+		trans.read(10*1024*1024);
+	}
+	ASSERT_TRUE(trans.getRecvHint() == TC_Transceiver::MAX_RECV_HINT);
+
+	//之后都是小包: hint逐渐收缩, 最后回到下限
+	last = trans.getRecvHint();
+	trans.read(100);
+	ASSERT_TRUE(trans.getRecvHint() < last);
+
+	for(int i = 0; i < 100; i++)
+	{
+		last = trans.getRecvHint();
+		trans.read(100);
+		ASSERT_TRUE(trans.getRecvHint() <= last);
+	}
+	ASSERT_TRUE(trans.getRecvHint() == TC_Transceiver::MIN_RECV_HINT);
+
+	//中等大小的包稳定在读取大小的两倍附近
+	for(int i = 0; i < 100; i++)
+	{
+		trans.read(64*1024);
+	}
+	ASSERT_TRUE(trans.getRecvHint() >= 64*1024 && trans.getRecvHint() <= 2*64*1024);
+}
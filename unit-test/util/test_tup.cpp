@@ -0,0 +1,336 @@
+#include "util/tc_common.h"
+#include "tup/tup.h"
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+using namespace tars;
+using namespace tup;
+
+class UtilTupTest : public testing::Test
+{
+public:
+	//添加日志
+	static void SetUpTestCase()
+	{
+	}
+	static void TearDownTestCase()
+	{
+	}
+	virtual void SetUp()   //TEST跑之前会执行SetUp
+	{
+	}
+	virtual void TearDown() //TEST跑完之后会执行TearDown
+	{
+	}
+};
+
+/**
+ * 原来的存储方式, 用于比较编码结果和性能
+ */
+class MapAttribute
+{
+public:
+	template<typename T> void put(const string& name, const T& t)
+	{
+		os.reset();
+		os.write(t, 0);
+		os.swap(_data[name]);
+	}
+
+	template<typename T> void get(const string& name, T& t)
+	{
+		auto it = _data.find(name);
+		if (it == _data.end())
+		{
+			throw runtime_error("UniAttribute not found key:" + name);
+		}
+		is.reset();
+		is.setBuffer(it->second);
+		is.read(t, 0, true);
+	}
+
+	void encode(string& buff)
+	{
+		os.reset();
+		os.write(_data, 0);
+		os.swap(buff);
+	}
+
+	void decode(const string &buff)
+	{
+		is.reset();
+		is.setBuffer(buff.c_str(), buff.length());
+		_data.clear();
+		is.read(_data, 0, true);
+	}
+
+	map<string, vector<char> > _data;
+	TarsInputStream<BufferReader>  is;
+	TarsOutputStream<BufferWriter> os;
+};
+
+//属性名和值提前准备好, 只比较存储的开销
+static vector<string> g_names;
+static vector<string> g_strs;
+static vector<vector<Int64> > g_vecs;
+
+template<typename A>
+static void putAttrs(A &attr, int count)
+{
+	while(g_names.size() < (size_t)count)
+	{
+		size_t i = g_names.size();
+		g_names.push_back("attr" + TC_Common::tostr(i));
+		g_strs.push_back(string(i * 10, 'a'));
+		g_vecs.push_back(vector<Int64>(i, i));
+	}
+	for(int i = 0; i < count; i++)
+	{
+		const string &name = g_names[i];
+		if(i % 3 == 0)
+		{
+			attr.put(name, i);
+		}
+		else if(i % 3 == 1)
+		{
+			attr.put(name, g_strs[i]);
+		}
+		else
+		{
+			attr.put(name, g_vecs[i]);
+		}
+	}
+}
+
+TEST_F(UtilTupTest, compatible)
+{
+	for(int count : { 0, 1, 10, 16, 17, 30, 200 })
+	{
+		UniAttribute<> attr;
+		MapAttribute ref;
+		putAttrs(attr, count);
+		putAttrs(ref, count);
+
+		ASSERT_TRUE(attr.size() == (size_t)count);
+
+		string buff, refBuff;
+		attr.encode(buff);
+		ref.encode(refBuff);
+		ASSERT_TRUE(buff == refBuff);
+
+		//原来的编码可以解码
+		UniAttribute<> dec;
+		dec.decode(refBuff.c_str(), refBuff.length());
+		ASSERT_TRUE(dec.getData() == ref._data);
+		for(int i = 0; i < count; i += 3)
+		{
+			ASSERT_TRUE(dec.get<int>("attr" + TC_Common::tostr(i)) == i);
+		}
+		ASSERT_FALSE(dec.containsKey("none"));
+		ASSERT_THROW(dec.get<int>("none"), runtime_error);
+		ASSERT_TRUE(dec.getByDefault<int>("none", 10) == 10);
+
+		ref.decode(buff);
+		ASSERT_TRUE(ref._data == dec.getData());
+	}
+}
+
+TEST_F(UtilTupTest, overwrite)
+{
+	UniAttribute<> attr;
+	MapAttribute ref;
+
+	//逆序插入, 编码仍然按名字排序
+	for(int i = 100; i > 0; i--)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			string name = "k" + TC_Common::tostr(i);
+			string value(i * (j == 1 ? 100 : 1), 'v');
+			attr.put(name, value);
+			ref.put(name, value);
+		}
+	}
+	attr.put("k1", 1);
+	ref.put("k1", 1);
+
+	string buff, refBuff;
+	attr.encode(buff);
+	ref.encode(refBuff);
+	ASSERT_TRUE(buff == refBuff);
+	ASSERT_TRUE(attr.size() == 100);
+	ASSERT_TRUE(attr.get<string>("k50") == string(50, 'v'));
+	ASSERT_TRUE(attr.get<int>("k1") == 1);
+
+	attr.putUnknown("unknown", "raw");
+	string raw;
+	attr.getUnknown("unknown", raw);
+	ASSERT_TRUE(raw == "raw");
+
+	attr.clear();
+	ASSERT_TRUE(attr.isEmpty());
+	ASSERT_FALSE(attr.containsKey("k1"));
+}
+
+TEST_F(UtilTupTest, getData)
+{
+	UniAttribute<> attr;
+	putAttrs(attr, 30);
+
+	//返回引用, 多次调用是同一个map
+	ASSERT_TRUE(&attr.getData() == &attr.getData());
+	ASSERT_TRUE(attr.getData().find("attr3") != attr.getData().end());
+	ASSERT_TRUE(attr.getData().find("none") == attr.getData().end());
+	ASSERT_TRUE(attr.getData().size() == 30);
+
+	//修改属性以后map跟着更新
+	attr.put("attr3", string("new"));
+	attr.put("added", 1);
+	ASSERT_TRUE(attr.getData().size() == 31);
+	ASSERT_TRUE(attr.getData().find("added") != attr.getData().end());
+
+	MapAttribute ref;
+	ref.put("attr3", string("new"));
+	ASSERT_TRUE(attr.getData().at("attr3") == ref._data["attr3"]);
+
+	//平铺的存储, 按put的顺序
+	const UniAttrData<> &flat = attr.getFlatData();
+	ASSERT_TRUE(flat.size() == 31);
+	ASSERT_TRUE(flat.entries()[0].name == "attr0");
+	ASSERT_TRUE(flat.entries()[30].name == "added");
+	const UniAttrData<>::Entry *e = flat.find("attr3");
+	ASSERT_TRUE(e != NULL);
+	ASSERT_TRUE(vector<char>(flat.data(*e), flat.data(*e) + e->length) == ref._data["attr3"]);
+
+	attr.clear();
+	ASSERT_TRUE(attr.getData().empty());
+
+	//多个线程同时第一次读同一个对象
+	putAttrs(attr, 100);
+	MapAttribute expect;
+	putAttrs(expect, 100);
+	std::atomic<int> ok(0);
+	vector<std::thread> threads;
+	for(int i = 0; i < 4; i++)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			if(attr.getData() == expect._data)
+			{
+				++ok;
+			}
+		}));
+	}
+	for(auto &t : threads)
+	{
+		t.join();
+	}
+	ASSERT_TRUE(ok == 4);
+}
+
+TEST_F(UtilTupTest, duplicateKey)
+{
+	//手工编码一个名字重复的map, 解码时和std::map一样保留第一个
+	TarsOutputStream<BufferWriterString> vos;
+	vos.write(1, 0);
+	vector<char> first(vos.getBuffer(), vos.getBuffer() + vos.getLength());
+	vos.reset();
+	vos.write(2, 0);
+	vector<char> second(vos.getBuffer(), vos.getBuffer() + vos.getLength());
+
+	TarsOutputStream<BufferWriterString> os;
+	DataHead::writeTo(os, DataHead::eMap, 0);
+	os.write((Int32)3, 0);
+	os.write(string("k"), 0);
+	os.write(first, 1);
+	os.write(string("other"), 0);
+	os.write(first, 1);
+	os.write(string("k"), 0);
+	os.write(second, 1);
+	string buff = os.getByteBuffer();
+
+	MapAttribute ref;
+	ref.decode(buff);
+
+	UniAttribute<> attr;
+	attr.decode(buff.c_str(), buff.length());
+	ASSERT_TRUE(attr.size() == 2);
+	ASSERT_TRUE(attr.get<int>("k") == 1);
+	ASSERT_TRUE(attr.getData() == ref._data);
+}
+
+TEST_F(UtilTupTest, packet)
+{
+	UniPacket<> req;
+	req.setRequestId(10);
+	req.setServantName("TestApp.HelloServer.HelloObj");
+	req.setFuncName("testHello");
+	putAttrs(req, 20);
+
+	string buff;
+	req.encode(buff);
+
+	UniPacket<> rsp;
+	rsp.decode(buff.c_str(), buff.length());
+	ASSERT_TRUE(rsp.getRequestId() == 10);
+	ASSERT_TRUE(rsp.getFuncName() == "testHello");
+	ASSERT_TRUE(rsp.size() == 20);
+	ASSERT_TRUE(rsp.get<string>("attr4") == string(40, 'a'));
+	ASSERT_TRUE(rsp.get<vector<Int64> >("attr5") == vector<Int64>(5, 5));
+}
+
+template<typename A>
+static void benchmark(const string &name, int attrs, int count)
+{
+	string buff;
+	size_t total = 0;
+
+	int64_t start = TC_Common::now2ms();
+	for(int i = 0; i < count; i++)
+	{
+		A attr;
+		putAttrs(attr, attrs);
+		attr.encode(buff);
+		total += buff.size();
+	}
+	int64_t put = TC_Common::now2ms() - start;
+
+	start = TC_Common::now2ms();
+	for(int i = 0; i < count; i++)
+	{
+		A attr;
+		attr.decode(buff);
+		for(int j = 0; j < attrs; j += 3)
+		{
+			int v;
+			attr.get(g_names[j], v);
+			total += v;
+		}
+	}
+	int64_t get = TC_Common::now2ms() - start;
+
+	cout << name << " " << attrs << " attrs, put+encode cost:" << put << "ms, decode+get cost:" << get << "ms" << endl;
+}
+
+struct FlatAttribute : public UniAttribute<>
+{
+	void decode(const string &buff)
+	{
+		UniAttribute<>::decode(buff.c_str(), buff.length());
+	}
+};
+
+TEST_F(UtilTupTest, compareAttribute)
+{
+	int count = 20000;
+
+	for(int attrs : { 10, 30 })
+	{
+		benchmark<MapAttribute>("map", attrs, count);
+		benchmark<FlatAttribute>("flat", attrs, count);
+	}
+}
@@ -0,0 +1,211 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __TC_ARENA_H_
+#define __TC_ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace tars
+{
+/////////////////////////////////////////////////
+/**
+ * @file tc_arena.h
+ * @brief 单调递增的内存池(arena), 非线程安全.
+ *
+ * - 按块向系统申请内存, 分配只是移动块内的偏移, 单个释放不做任何事, 析构或reset时整体释放
+ * - 一般一个请求一个arena(见Current::getArena), 解码出来的整个对象树都分配在上面, 请求结束时一次释放
+ * - TC_ArenaAllocator是对应的STL分配器, 默认构造时取当前线程的arena(TC_Arena::Scope设置), 没有时走系统分配,
+ *   因此tars2cpp --arena生成的结构体在Scope里构造/解码就分配在arena上, 在Scope外和普通结构体一样
+ */
+/////////////////////////////////////////////////
+
+class TC_Arena
+{
+public:
+    /**
+     * @brief 构造
+     * @param blockSize 每次向系统申请的块大小, 超过块大小的分配单独申请
+     */
+    explicit TC_Arena(size_t blockSize = 4096);
+
+    /**
+     * @brief 析构, 释放所有内存
+     */
+    ~TC_Arena();
+
+    /**
+     * @brief 分配
+     * @param size
+     * @param align 对齐, 必须是2的幂
+     * @return
+     */
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        if (_block != NULL)
+        {
+            size_t cur = (((size_t)_block->data() + _cur + align - 1) & ~(align - 1)) - (size_t)_block->data();
+            if (cur + size <= _block->size)
+            {
+                _cur = cur + size;
+                _used += size;
+                return _block->data() + cur;
+            }
+        }
+        return allocateSlow(size, align);
+    }
+
+    /**
+     * @brief 释放所有分配, 保留第一个块继续使用
+     */
+    void reset();
+
+    /**
+     * @brief 已经分配出去的字节数
+     * @return
+     */
+    size_t getUsedSize() const { return _used; }
+
+    /**
+     * @brief 向系统申请的字节数
+     * @return
+     */
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     * @brief 当前线程的arena
+     * @return 没有时返回NULL
+     */
+    static TC_Arena *current();
+
+    /**
+     * @brief 设置当前线程的arena, 析构或leave时恢复原来的, 可以嵌套
+     * 协程模式下Scope内不要切出协程, 否则同线程的其他协程会分配到这个arena上
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(TC_Arena *arena);
+        ~Scope();
+
+        /**
+         * @brief 提前恢复原来的arena
+         */
+        void leave();
+
+    protected:
+        TC_Arena    *_prev;
+        bool        _left;
+
+    private:
+        Scope(const Scope &);
+        Scope &operator=(const Scope &);
+    };
+
+protected:
+    struct Block
+    {
+        Block   *next;
+        size_t  size;
+
+        char *data() { return (char*)(this + 1); }
+    };
+
+    void *allocateSlow(size_t size, size_t align);
+
+    Block *newBlock(size_t size);
+
+private:
+    TC_Arena(const TC_Arena &);
+    TC_Arena &operator=(const TC_Arena &);
+
+protected:
+    size_t  _blockSize;
+    Block   *_block;        //当前块, 块链表的头
+    size_t  _cur;           //当前块内的偏移
+    size_t  _used;
+    size_t  _capacity;
+};
+
+/**
+ * @brief arena的STL分配器
+ *
+ * - 拷贝构造容器时(select_on_container_copy_construction)取当前线程的arena, 保证在Scope外拷贝出来的容器不指向请求的arena
+ * - 移动赋值时分配器不跟着走, 两边arena不同时逐个元素移动到目标容器自己的分配器上,
+ *   因此把请求的参数move赋值给长期存在的对象(在Scope外构造的成员变量等)是安全的
+ * - 移动构造和交换时分配器跟着走, 结果仍然指向请求的arena, 不能活得比请求长
+ *
+ * 生命周期规则: arena上的对象只在请求内有效, 需要保存到请求之外的数据, 拷贝或者move赋值给Scope外构造的对象
+ */
+template<typename T>
+class TC_ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template<typename U>
+    struct rebind
+    {
+        typedef TC_ArenaAllocator<U> other;
+    };
+
+    TC_ArenaAllocator() : _arena(TC_Arena::current()) {}
+
+    explicit TC_ArenaAllocator(TC_Arena *arena) : _arena(arena) {}
+
+    template<typename U>
+    TC_ArenaAllocator(const TC_ArenaAllocator<U> &a) : _arena(a.arena()) {}
+
+    T *allocate(size_t n)
+    {
+        if (_arena)
+        {
+            return (T*)_arena->allocate(n * sizeof(T), alignof(T));
+        }
+        return (T*)::operator new(n * sizeof(T));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        if (_arena == NULL)
+        {
+            ::operator delete(p);
+        }
+    }
+
+    TC_ArenaAllocator select_on_container_copy_construction() const
+    {
+        return TC_ArenaAllocator();
+    }
+
+    TC_Arena *arena() const { return _arena; }
+
+protected:
+    TC_Arena *_arena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const TC_ArenaAllocator<T> &l, const TC_ArenaAllocator<U> &r) { return l.arena() == r.arena(); }
+
+template<typename T, typename U>
+inline bool operator!=(const TC_ArenaAllocator<T> &l, const TC_ArenaAllocator<U> &r) { return l.arena() != r.arena(); }
+
+}
+#endif
@@ -119,6 +119,15 @@ public:
     static bool equal(const std::vector<float>& vx, const std::vector<float> & vy, float epsilon = _EPSILON_FLOAT);
     static bool equal(const std::vector<float>& vx, const std::vector<float>& vy, double epsilon );
 
+    /**
+    * @brief  带分配器的std::vector(比如TC_ArenaAllocator)
+    * @brief  std::vector with custom allocator(TC_ArenaAllocator etc.)
+    */
+    template<typename A>
+    static bool equal(const std::vector<double, A>& vx, const std::vector<double, A>& vy, double epsilon = _EPSILON_DOUBLE);
+    template<typename A>
+    static bool equal(const std::vector<float, A>& vx, const std::vector<float, A>& vy, float epsilon = _EPSILON_FLOAT);
+
 	static bool equal(const std::set<double> & vx, const std::set<double>& vy, double epsilon = _EPSILON_DOUBLE);
 	static bool equal(const std::set<double>& vx, const std::set<double>& vy, float epsilon );
 	static bool equal(const std::set<float>& vx, const std::set<float> & vy, float epsilon = _EPSILON_FLOAT);
@@ -1295,6 +1304,40 @@ bool TC_Common::equal(const V& x, const V& y,E eps)
     return x == y;
 }
 
+template<typename A>
+bool TC_Common::equal(const std::vector<double, A>& vx, const std::vector<double, A>& vy, double epsilon)
+{
+    if (vx.size() != vy.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < vx.size(); i++)
+    {
+        if (!equal(vx[i], vy[i], epsilon))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename A>
+bool TC_Common::equal(const std::vector<float, A>& vx, const std::vector<float, A>& vy, float epsilon)
+{
+    if (vx.size() != vy.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < vx.size(); i++)
+    {
+        if (!equal(vx[i], vy[i], epsilon))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 template<typename K, typename V, typename D, typename A, typename E>
 bool TC_Common::equal(const std::map<K, V, D, A>& mx, const std::map<K, V, D, A>& my, E epsilon)
 {
@@ -19,16 +19,20 @@
 
 #include <cstddef>
 #include <list>
+#include <vector>
 #include <set>
 #include <deque>
 #include <map>
 #include <functional>
+#include <memory>
+#include <atomic>
 
 #include "util/tc_fcontext.h"
 #include "util/tc_thread_queue.h"
 #include "util/tc_monitor.h"
 #include "util/tc_thread.h"
 #include "util/tc_epoller.h"
+#include "util/tc_ring_queue.h"
 
 namespace tars
 {
@@ -109,10 +113,29 @@ struct stack_traits
 	static stack_context allocate(std::size_t);
 
 	static void deallocate( stack_context &);
+
+	/**
+	 * 栈用到的最大深度(高水位)
+	 * 新分配的栈内容都是0(相当于已经涂过色), 从栈底往上找到第一个非0的位置, 就是栈曾经用到的最低地址
+	 * linux下先用mincore跳过没有访问过的页, 只需要检查一页
+	 * @param scratch: mincore用的缓冲区, 定时检查时传入复用, 为NULL时临时分配
+	 */
+	static std::size_t used_size(const stack_context &, std::vector<unsigned char> *scratch = NULL);
 };
 
 
 class TC_CoroutineScheduler;
+class TC_CoroutineSchedulerGroup;
+class TC_CoroutineInfo;
+
+/**
+ * 共享栈, 共享栈模式下多个协程轮流使用同一块栈
+ */
+struct shared_stack_context
+{
+	stack_context       stack;
+	TC_CoroutineInfo*   owner = NULL;   //当前栈上是哪个协程的数据
+};
 
 ///////////////////////////////////////////
 /**
@@ -263,6 +286,56 @@ public:
      */
     inline stack_context& getStackContext() { return _stack_ctx; }
 
+    /**
+     * 设置共享栈(共享栈模式下协程没有自己的栈)
+     */
+    inline void setSharedStack(shared_stack_context *stack) { _sharedStack = stack; }
+
+    /**
+     * 获取共享栈, 不是共享栈模式返回NULL
+     */
+    inline shared_stack_context *getSharedStack() const { return _sharedStack; }
+
+    /**
+     * 在栈上创建协程的上下文(共享栈模式下第一次切换到协程时才创建)
+     */
+    void makeContext();
+
+    /**
+     * 共享栈模式下, 把栈上实际用到的部分保存到堆上
+     * @return 保存的字节数
+     */
+    size_t saveStack();
+
+    /**
+     * 共享栈模式下, 把保存的栈拷贝回共享栈
+     */
+    void restoreStack();
+
+    /**
+     * 释放保存栈的内存
+     * @return 释放的字节数
+     */
+    size_t releaseStack();
+
+    /**
+     * 保存栈占用的内存
+     */
+    inline size_t getStackMemory() const { return _stackBuffer.capacity(); }
+
+    /**
+     * 检查栈用到的最大深度(在调度线程中调用)
+     * 独立栈检查栈上的高水位, 共享栈取切出时保存的最大字节数
+     * @param scratch: 检查用的缓冲区(见stack_traits::used_size)
+     * @return 最大深度
+     */
+    size_t checkStackPeak(std::vector<unsigned char> *scratch = NULL);
+
+    /**
+     * 上次检查得到的栈最大深度
+     */
+    inline size_t getStackPeak() const { return _stackPeak; }
+
     /**
      * 获取协程所处的调度器
      */
@@ -336,6 +409,21 @@ private:
      * 协程具体执行函数
      */
     std::function<void ()> 		_callback;
+
+    /*
+     * 共享栈
+     */
+    shared_stack_context*       _sharedStack = NULL;
+
+    /*
+     * 共享栈模式下, 协程切出时保存的栈
+     */
+    std::vector<char>           _stackBuffer;
+
+    /*
+     * 栈用到的最大深度
+     */
+    size_t                      _stackPeak = 0;
 };
 
 ///////////////////////////////////////////
@@ -374,16 +462,103 @@ public:
      */
     ~TC_CoroutineScheduler();
 
+    /**
+     * 共享栈统计
+     */
+    struct SharedStackStat
+    {
+        size_t saveCount = 0;   //协程切出时保存栈的次数
+        size_t saveBytes = 0;   //保存的总字节数, saveBytes/saveCount是平均保存的栈大小
+        size_t holdBytes = 0;   //当前挂起的协程保存的栈占用的内存
+
+        size_t avgSaveSize() const { return saveCount > 0 ? saveBytes / saveCount : 0; }
+    };
+
+    /**
+     * 协程栈使用统计
+     */
+    struct StackStat
+    {
+        size_t stackSize = 0;   //新创建的协程使用的栈大小
+        size_t count     = 0;   //统计的协程数(运行过的)
+        size_t maxUsed   = 0;   //栈用到的最大深度
+        size_t avgUsed   = 0;   //栈用到的平均深度
+    };
+
     /**
      * 初始化协程池的大小、以及协程的堆栈大小
      */
     void setPoolStackSize(uint32_t iPoolSize, size_t iStackSize);
 
+    /**
+     * 开启协程栈深度检查(在go/run之前调用)
+     * 调度线程每隔iInterval毫秒检查一次所有协程栈用到的最大深度(高水位), 结果通过getStackStat获取
+     * bAutoSize开启时, 之后创建的协程栈大小按观察到的最大深度的2倍分配(按页对齐, 不小于32K, 不超过setPoolStackSize设置的大小)
+     * 注意: 只有检查之前没有出现过的更深调用可能超过自动调整的栈大小, 需要在有代表性的负载下运行一段时间再依赖这个值
+     * @param iInterval, 检查间隔(毫秒), 0表示不检查
+     * @param bAutoSize, 是否自动调整协程栈大小(共享栈模式下无效)
+     */
+    void setStackCheck(int64_t iInterval, bool bAutoSize = false);
+
+    /**
+     * 立即检查所有协程的栈(在调度线程中调用)
+     */
+    void checkStack();
+
+    /**
+     * 协程栈使用统计(最近一次检查的结果, 可以在其他线程获取)
+     */
+    StackStat getStackStat() const;
+
+    /**
+     * 开启共享栈模式(在go/run之前调用)
+     * 协程不再分配独立的栈, 按协程id轮流使用iStackNum个共享栈(大小是setPoolStackSize的iStackSize)
+     * 协程切出时只把栈上实际用到的部分拷贝到堆上, 切回时再拷贝回来, 适合大量空闲协程的场景(比如长轮询), 代价是切换时的内存拷贝
+     * 注意: 协程挂起后, 它栈上的对象不能被其他协程或者线程访问(这块栈已经被其他协程使用)
+     * @param iStackNum, 共享栈个数, 0表示每个协程使用独立的栈
+     */
+    void setSharedStack(uint32_t iStackNum);
+
+    /**
+     * 共享栈个数, 0表示没有开启共享栈
+     */
+    inline uint32_t getSharedStackNum() const { return _sharedStackNum; }
+
+    /**
+     * 共享栈统计(近似值, 可以在其他线程获取)
+     */
+    SharedStackStat getSharedStackStat() const;
+
     /**
      * 创建协程
      */
     uint32_t go(const std::function<void ()> &callback);
 
+    /**
+     * 创建可以被窃取的协程任务, 没有加入调度器组时和go一样
+     * 加入组后任务先放到自己的任务队列, 调度循环每次取一部分启动协程执行, 组内空闲的调度器会窃取还没有开始的任务, 在它的线程里执行
+     * 因此任务不能依赖当前线程的私有数据
+     * @return false: 任务队列满而且协程用完了
+     */
+    bool goStealable(const std::function<void ()> &callback);
+
+    /**
+     * 加入调度器组(在run之前调用), run结束时自动退出
+     * @param group
+     * @param index, 在组内的序号, 对应一个任务队列
+     */
+    void joinGroup(const std::shared_ptr<TC_CoroutineSchedulerGroup> &group, uint32_t index);
+
+    /**
+     * 退出调度器组, 任务队列里没有执行的任务仍然可以被其他调度器窃取
+     */
+    void leaveGroup();
+
+    /**
+     * 所在的调度器组, 没有加入返回null
+     */
+    inline const std::shared_ptr<TC_CoroutineSchedulerGroup> &getGroup() const { return _group; }
+
     /**
      * 通知循环醒过来
      */
@@ -427,6 +602,14 @@ public:
      */
     void put(uint32_t iCoroId);
 
+    /**
+     * 投递一个函数到调度线程中执行(可以在其他线程调用), 在调度器的主协程中执行, 不创建协程
+     * 用于在调度线程中恢复无栈协程(C++20 co_await), 函数里不能调用yield/sleep等需要切换协程的接口
+     * 调度器退出时还在队列里的函数, 在run()返回前执行完
+     * @return 调度器已经退出(或者正在退出)时不再接受, 返回false, 调用者自己处理
+     */
+    bool post(const std::function<void ()> &func);
+
     /**
      * 协程切换
      */
@@ -470,9 +653,9 @@ public:
     inline size_t getResponseCoroSize() { return _activeCoroQueue.size(); }
 
     /**
-     * 获取理论上空闲的协程数目
+     * 获取理论上空闲的协程数目(加入调度器组时, 任务队列里等待的任务也算占用)
      */
-    inline uint32_t getFreeSize() { return _poolSize - _usedSize; }
+    uint32_t getFreeSize();
 
     /**
      * 减少正在使用的协程数目
@@ -533,11 +716,27 @@ protected:
      */
     int increaseCoroPoolSize();
 
+    /**
+     * 创建协程, 分配独立的栈或者共享栈
+     */
+    TC_CoroutineInfo *newCoroutine(uint32_t iId);
+
+    /**
+     * 切换到共享栈上的协程前, 保存栈上原来协程的数据, 恢复(或者创建)要切换的协程
+     */
+    void acquireSharedStack(TC_CoroutineInfo *coro);
+
     /**
      * 唤醒需要运行的协程
      */
     void wakeup();
 
+    /**
+     * 执行其他线程投递过来的函数
+     * @param bForce: 调度器退出时也执行
+     */
+    void runPosted(bool bForce = false);
+
     /**
      * 唤醒自己放弃运行的协程
      */
@@ -573,6 +772,21 @@ protected:
      */
     void moveToFreeList(TC_CoroutineInfo *coro);
 
+    /**
+     * 启动一个协程执行任务, 直到它第一次让出
+     */
+    bool runTask(const std::function<void ()> &callback);
+
+    /**
+     * 执行自己任务队列里的任务
+     */
+    void runGroupTasks();
+
+    /**
+     * 空闲时窃取组内其他调度器的任务执行, 没有可以窃取的任务时等待在epoll上
+     */
+    void stealOrWait();
+
 private:
 
     /*
@@ -645,6 +859,21 @@ private:
      */
 	std::deque<uint32_t>        _activeCoroQueue;
 
+	/*
+	 * 其他线程投递过来, 在调度线程中执行的函数
+	 */
+	TC_ThreadQueue<std::function<void ()>> _postQueue;
+
+	/*
+	 * 保护_postClosed, 保证run()退出以后不会再有函数放进队列
+	 */
+	std::mutex              _postMutex;
+
+	/*
+	 * run()退出时设置, 之后post返回false
+	 */
+	bool                    _postClosed = false;
+
 	/*
 	 * 需要激活的协程队列，本线程使用
 	 */
@@ -669,6 +898,176 @@ private:
      * 是否正在运行中
      */
     bool                    _ready = false;
+
+    /**
+     * 所在的调度器组
+     */
+    std::shared_ptr<TC_CoroutineSchedulerGroup> _group;
+
+    /**
+     * 在组内的序号
+     */
+    uint32_t                _groupIndex = 0;
+
+    /**
+     * 共享栈个数
+     */
+    uint32_t                _sharedStackNum = 0;
+
+    /**
+     * 共享栈
+     */
+    std::vector<shared_stack_context> _sharedStacks;
+
+    /**
+     * 共享栈统计
+     */
+    std::atomic<size_t>     _saveCount{0};
+    std::atomic<size_t>     _saveBytes{0};
+    std::atomic<size_t>     _holdBytes{0};
+
+    /**
+     * 栈检查的间隔(毫秒), 0表示不检查
+     */
+    int64_t                 _stackCheckInterval = 0;
+
+    /**
+     * 下次检查栈的时间
+     */
+    uint64_t                _nextStackCheck = 0;
+
+    /**
+     * 检查栈时mincore用的缓冲区, 所有协程复用
+     */
+    std::vector<unsigned char> _stackScratch;
+
+    /**
+     * 是否根据栈的最大深度调整栈大小
+     */
+    bool                    _stackAutoSize = false;
+
+    /**
+     * 新创建的协程使用的栈大小(自动调整时小于_stackSize)
+     */
+    std::atomic<size_t>     _allocStackSize{0};
+
+    /**
+     * 栈检查的统计
+     */
+    std::atomic<size_t>     _stackCount{0};
+    std::atomic<size_t>     _stackMaxUsed{0};
+    std::atomic<size_t>     _stackAvgUsed{0};
+};
+
+/**
+ * 协程调度器组, 用于多个线程各自运行调度器, 但是任务量不均衡的场景(比如handle线程处理耗时差别很大的请求)
+ * 每个调度器对应一个无锁任务队列(TC_RingQueue), goStealable把任务放到自己的队列里
+ * 调度器空闲时(没有可以执行的协程)按顺序从其他调度器的队列头部窃取还没有开始的任务, 在自己的线程中启动协程执行
+ * 任务队列有积压而且组内有空闲的调度器时, 唤醒一个空闲的调度器来窃取
+ * 任务只在启动之前可以被窃取, 协程一旦开始执行就不会再迁移到其他线程
+ */
+class TC_CoroutineSchedulerGroup
+{
+public:
+    /**
+     * 统计
+     */
+    struct Stat
+    {
+        size_t tasks  = 0;      //放入任务队列的任务数
+        size_t steals = 0;      //从其他调度器窃取的任务数
+    };
+
+    /**
+     * @param size, 调度器个数
+     * @param capacity, 每个调度器任务队列的容量
+     */
+    TC_CoroutineSchedulerGroup(uint32_t size, size_t capacity = 1024);
+
+    /**
+     * 调度器个数
+     */
+    inline uint32_t size() const { return (uint32_t)_members.size(); }
+
+    /**
+     * 所有调度器的统计汇总
+     */
+    Stat getStat() const;
+
+    /**
+     * 某个调度器的统计
+     * @param index
+     */
+    Stat getStat(uint32_t index) const;
+
+    /**
+     * 所有任务队列里还没有开始的任务数
+     */
+    size_t getTaskSize() const;
+
+protected:
+    friend class TC_CoroutineScheduler;
+
+    TC_CoroutineSchedulerGroup(const TC_CoroutineSchedulerGroup&) = delete;
+    TC_CoroutineSchedulerGroup& operator=(const TC_CoroutineSchedulerGroup&) = delete;
+
+    void join(uint32_t index, TC_CoroutineScheduler *scheduler);
+
+    void leave(uint32_t index);
+
+    /**
+     * 放入index的任务队列, 有积压时唤醒一个空闲的调度器
+     */
+    bool push(uint32_t index, const std::function<void ()> &callback);
+
+    /**
+     * 从自己的任务队列取任务
+     */
+    bool pop(uint32_t index, std::function<void ()> &callback);
+
+    /**
+     * 从其他调度器的任务队列窃取任务
+     */
+    bool steal(uint32_t index, std::function<void ()> &callback);
+
+    /**
+     * 标记空闲, 返回false表示标记之后发现有可以窃取的任务(不要等待)
+     */
+    bool idle(uint32_t index);
+
+    /**
+     * 取消空闲标记
+     */
+    void busy(uint32_t index);
+
+    /**
+     * 任务队列大小
+     */
+    size_t taskSize(uint32_t index) const;
+
+protected:
+    struct Member
+    {
+        Member(size_t capacity) : tasks(capacity) {}
+
+        TC_RingQueue<std::function<void ()>> tasks;
+        TC_CoroutineScheduler*  scheduler = NULL;   //_mutex保护, 退出组后为NULL
+        std::atomic<bool>       idle{false};
+        std::atomic<size_t>     taskCount{0};
+        std::atomic<size_t>     stealCount{0};
+    };
+
+    std::vector<std::unique_ptr<Member>> _members;
+
+    /**
+     * 空闲的调度器个数, 没有空闲的调度器时push不加锁
+     */
+    std::atomic<uint32_t>   _idleCount{0};
+
+    /**
+     * 保护调度器的加入/退出和唤醒
+     */
+    mutable std::mutex      _mutex;
 };
 
 /**
@@ -33,6 +33,7 @@
 #include "util/tc_network_buffer.h"
 #include "util/tc_transceiver.h"
 #include "util/tc_cas_queue.h"
+#include "util/tc_ring_queue.h"
 #include "util/tc_coroutine.h"
 #include "util/tc_openssl.h"
 
@@ -194,6 +195,9 @@ public:
         inline uint16_t port() const       { parseIpPort(); return _port; }
         inline std::vector<char> & buffer()     { return _rbuffer; }
         inline const std::vector<char> & buffer() const { return _rbuffer; }
+        inline TC_NetWorkBuffer::Slice & slice()     { return _slice; }
+        inline const TC_NetWorkBuffer::Slice & slice() const { return _slice; }
+        inline bool hasSlice() const       { return _slice.data != NULL; }
         inline int64_t recvTimeStamp() const { return _recvTimeStamp; }
         inline bool isOverload() const     { return _isOverload; }
         inline void setOverload()          { _isOverload = true; }
@@ -227,6 +231,7 @@ public:
         int _fd;                /*保存产生该消息的fd，用于回包时选择网络线程*/
         std::weak_ptr<BindAdapter> _adapter;        /**标识哪一个adapter的消息*/
         std::vector<char> _rbuffer;        /**接收的内容*/
+        TC_NetWorkBuffer::Slice _slice;    /**接收的内容(切片模式, 直接引用网络buffer, 此时_rbuffer为空)*/
         bool _isOverload = false;     /**是否已过载 */
         bool _isClosed = false;       /**是否已关闭*/
         int _closeType;     /*如果是关闭消息包，则标识关闭类型,0:表示客户端主动关闭；1:服务端主动关闭;2:连接超时服务端主动关闭*/
@@ -249,6 +254,38 @@ public:
         inline const std::shared_ptr<RecvContext> & getRecvContext() { return _context; }
         inline void setBuffer(const std::shared_ptr<TC_NetWorkBuffer::Buffer>& buff) { _sbuffer = buff; }
         inline const std::shared_ptr<TC_NetWorkBuffer::Buffer> & buffer() { return _sbuffer; }
+
+        /**
+         * 分段发送的内容(大的应答按段编码, 发送buffer不需要整包大小的连续内存), 第一段是buffer(), 其余的在chain()里
+         * 网络线程把所有段一起按顺序放进发送buffer, 不会和其他应答交错
+         * @param buffs
+         */
+        void setBuffers(const std::vector<std::shared_ptr<TC_NetWorkBuffer::Buffer>> &buffs)
+        {
+            _chain.clear();
+            if (buffs.empty())
+            {
+                _sbuffer = std::make_shared<TC_NetWorkBuffer::Buffer>();
+                return;
+            }
+            _sbuffer = buffs[0];
+            _chain.assign(buffs.begin() + 1, buffs.end());
+        }
+        inline const std::vector<std::shared_ptr<TC_NetWorkBuffer::Buffer>> & chain() const { return _chain; }
+
+        /**
+         * 还没有发送的长度(所有段)
+         * @return
+         */
+        size_t length() const
+        {
+            size_t len = _sbuffer->length();
+            for (size_t i = 0; i < _chain.size(); i++)
+            {
+                len += _chain[i]->length();
+            }
+            return len;
+        }
         inline char cmd() const        { return _cmd; }
         inline uint32_t uid() const    { return _context->uid(); }
         inline int fd() const          { return _context->fd(); }
@@ -261,6 +298,7 @@ public:
         std::shared_ptr<RecvContext>              _context;
         char _cmd;                                            /**send包才有效, 命令:'c',关闭fd; 's',有数据需要发送*/
         std::shared_ptr<TC_NetWorkBuffer::Buffer> _sbuffer;        /**发送的内容*/
+        std::vector<std::shared_ptr<TC_NetWorkBuffer::Buffer>> _chain;    /**分段发送时第一段之后的内容*/
     };
 
 //    typedef TC_CasQueue<std::shared_ptr<RecvContext>> recv_queue;
@@ -268,6 +306,42 @@ public:
 //    typedef TC_CasQueue<std::shared_ptr<SendContext>> send_queue;
     typedef TC_ThreadQueue<std::shared_ptr<SendContext>> send_queue;
 
+    typedef TC_RingQueue<std::shared_ptr<RecvContext>> recv_ring_queue;
+    typedef TC_RingQueue<std::shared_ptr<SendContext>> send_ring_queue;
+
+    /**
+     * 网络线程和业务线程之间的队列实现
+     */
+    enum QUEUE_TYPE
+    {
+        //互斥锁+条件变量(缺省)
+        QUEUE_THREAD    = 0,
+        //有界无锁环形队列, 空闲时futex休眠
+        QUEUE_RING      = 1,
+    };
+
+    /**
+     * 队列类型配置字符串(thread/ring)转换
+     * @param type
+     * @return
+     */
+    static QUEUE_TYPE parseQueueType(const std::string &type) { return type == "ring" ? QUEUE_RING : QUEUE_THREAD; }
+
+    /**
+     * 环形发送队列的容量
+     */
+    enum { SEND_RING_QUEUE_CAP = 64 * 1024 };
+
+    /**
+     * 环形队列满时的最长等待时间(毫秒), 超时仍然满则丢包并记录
+     * 接收队列在网络线程中等待, 只短暂等待handle消费, 避免阻塞该网络线程上的其他连接
+     */
+    enum
+    {
+        RECV_RING_WAIT_MS = 10,
+        SEND_RING_WAIT_MS = 3000,
+    };
+
 //    typedef recv_queue::queue_type recv_queue_type;
 
     ////////////////////////////////////////////////////////////////////////////
@@ -287,33 +361,50 @@ public:
         	/**
         	 * 通知等待在队列上线程都醒过来
         	 */
-            inline void notify() { return _rbuffer.notifyT(); }
+            inline void notify() { if (_ring) _ring->notifyT(); else _rbuffer.notifyT(); }
 
             /**
              * push数据到队列中, 同时唤醒某个等待处理线程
              * @param recv
+             * @return false: 环形队列已满
              */
-            inline void push_back(const std::shared_ptr<RecvContext> &recv ) { _rbuffer.push_back(recv); }
+            inline bool push_back(const std::shared_ptr<RecvContext> &recv )
+            {
+                if (_ring) return _ring->push_back(recv);
+                _rbuffer.push_back(recv);
+                return true;
+            }
 
             /**
              * 在队列上等待
              * @param millseconds
              * @return
              */
-            inline bool wait(size_t millseconds) { return _rbuffer.wait(millseconds); }
+            inline bool wait(size_t millseconds) { return _ring ? _ring->wait(millseconds) : _rbuffer.wait(millseconds); }
 
             /**
              * 弹出头部数据(如果没有数据也不阻塞)
              * @param data
              * @return
              */
-            inline bool pop_front(std::shared_ptr<RecvContext> &data) { return _rbuffer.pop_front(data, 0, false); }
+            inline bool pop_front(std::shared_ptr<RecvContext> &data) { return _ring ? _ring->pop_front(data, 0, false) : _rbuffer.pop_front(data, 0, false); }
+
+            /**
+             * 切换为环形队列(必须在handle启动前调用)
+             * @param capacity
+             */
+            inline void enableRing(size_t capacity) { _ring.reset(new recv_ring_queue(capacity)); }
 
         protected:
             /**
              * 接收的数据队列
              */
             recv_queue _rbuffer;
+
+            /**
+             * 环形接收队列, 非空时替代_rbuffer
+             */
+            std::unique_ptr<recv_ring_queue> _ring;
         };
 
         /**
@@ -329,10 +420,11 @@ public:
         void notifyBuffer(uint32_t handleIndex);
 
         /**
-         * 插入队列
+         * 插入队列, 环形队列满时唤醒handle消费并最多等待RECV_RING_WAIT_MS
          * @param recv
+         * @return false: 等待后环形队列仍然满, 数据没有插入
          */
-        void insertRecvQueue(const std::shared_ptr<RecvContext> &recv);
+        bool insertRecvQueue(const std::shared_ptr<RecvContext> &recv);
 
         /**
          * 等待在队列上
@@ -360,6 +452,32 @@ public:
          */
         inline void enableQueueMode() { _queueMode = true; }
 
+        /**
+         * 设置队列实现(必须在handle启动前调用)
+         * @param type
+         * @param capacity, 环形队列的容量
+         */
+        void setQueueType(QUEUE_TYPE type, size_t capacity);
+
+        /**
+         * 队列实现
+         * @return
+         */
+        inline QUEUE_TYPE getQueueType() const { return _queueType; }
+
+        /**
+         * 设置handle协程之间是否窃取任务(必须在handle启动前调用), 只在NET_THREAD_QUEUE_HANDLES_CO而且不是队列模式时生效
+         * @param steal
+         * @param capacity, 每个handle任务队列的容量
+         */
+        void setWorkSteal(bool steal, size_t capacity);
+
+        /**
+         * handle协程调度器组, 没有开启任务窃取时为null
+         * @return
+         */
+        inline const std::shared_ptr<TC_CoroutineSchedulerGroup> &getStealGroup() const { return _stealGroup; }
+
         /**
          * 接收buffer的大小
          * @return
@@ -410,6 +528,11 @@ public:
          */
         bool                            _queueMode = false;
 
+        /**
+         * 队列实现
+         */
+        QUEUE_TYPE                      _queueType = QUEUE_THREAD;
+
         /**
          * 每个线程都有自己的队列
          * 0: 给共享队列模式时使用
@@ -422,6 +545,11 @@ public:
          */
         std::vector<std::shared_ptr<TC_CoroutineScheduler>>  _schedulers;
 
+        /**
+         * handle协程调度器组, 开启任务窃取时有效
+         */
+        std::shared_ptr<TC_CoroutineSchedulerGroup> _stealGroup;
+
         /**
          * wait time for queue
          */
@@ -583,6 +711,12 @@ public:
          */
         int sendBuffer();
 
+        /**
+         * 合并发送模式下, 把本轮积攒的应答一次性发送出去
+         * @return int, -1:网络句柄无效, -2:需要关闭连接, 0:成功
+         */
+        int flushMessages();
+
         /**
          * 直接发送裸得应答数据，业务层一般不直接使用，仅仅tcp支持
          * send naked response data
@@ -658,6 +792,20 @@ public:
 
         void onRequestCallback(TC_Transceiver *trans);
 
+        /**
+         * 把应答的所有段放进发送buffer, 不发送
+         * @param sc
+         * @return
+         */
+        TC_Transceiver::ReturnStatus appendContext(const std::shared_ptr<SendContext> &sc);
+
+        /**
+         * 发送应答, 和TC_Transceiver::sendRequest一样, 发送buffer里还有数据时不发送
+         * @param sc
+         * @return
+         */
+        TC_Transceiver::ReturnStatus sendContext(const std::shared_ptr<SendContext> &sc);
+
         TC_NetWorkBuffer::PACKET_TYPE onParserCallback(TC_NetWorkBuffer& buff, TC_Transceiver *trans);
 
         std::shared_ptr<TC_OpenSSL> onOpensslCallback(TC_Transceiver* trans);
@@ -731,6 +879,11 @@ public:
          */
         size_t _messageSize = 0;
 
+        /**
+         * 是否已经在网络线程的待flush列表中
+         */
+        bool _flushPending = false;
+
         /**
          * 每5秒发送的数据
          */
@@ -1034,6 +1187,65 @@ public:
          */
         inline void setQueueCapacity(int n) { _iQueueCapacity = n; }
 
+        /**
+         * 设置接收队列实现, 环形队列容量取queue capacity的两倍(需在setQueueCapacity之后调用)
+         * @param type
+         */
+        void setQueueType(QUEUE_TYPE type);
+
+        /**
+         * 设置是否合并发送(tcp有效), 同一轮网络事件中的多个应答通过一次writev发送
+         * @param gather
+         */
+        inline void setGatherWrite(bool gather) { _gatherWrite = gather; }
+
+        /**
+         * 是否合并发送
+         * @return bool
+         */
+        inline bool isGatherWrite() const { return _gatherWrite; }
+
+        /**
+         * 合并发送累计节省的发送系统调用次数
+         * @return size_t
+         */
+        inline size_t getGatherSaved() const { return _gatherSaved; }
+
+        /**
+         * 累加合并发送节省的发送系统调用次数
+         * @param n
+         */
+        inline void addGatherSaved(size_t n) { if(n > 0) _gatherSaved += n; }
+
+        /**
+         * 环形接收队列满而丢弃的请求数
+         * @return size_t
+         */
+        inline size_t getRingDiscard() const { return _ringDiscard; }
+
+        /**
+         * 上次调用以来合并发送节省的发送系统调用次数(用于上报)
+         * @return size_t
+         */
+        inline size_t takeGatherSavedIncrement()
+        {
+            size_t saved = _gatherSaved;
+            return saved - _gatherSavedReported.exchange(saved);
+        }
+
+        /**
+         * 设置handle协程之间是否窃取任务(需在setQueueCapacity之后调用)
+         * 某个handle线程被耗时的请求阻塞时, 它已经取出但还没有开始处理的请求由空闲的handle线程处理
+         * @param steal
+         */
+        void setWorkSteal(bool steal);
+
+        /**
+         * handle协程调度器组(可以获取窃取的统计), 没有开启任务窃取时为null
+         * @return
+         */
+        inline const std::shared_ptr<TC_CoroutineSchedulerGroup> &getStealGroup() const { return _dataBuffer->getStealGroup(); }
+
         /**
          * 设置协议名称
          * @param name
@@ -1203,6 +1415,19 @@ public:
          */
         inline TC_NetWorkBuffer::protocol_functor & getProtocol() { return _pf; }
 
+        /**
+         * 注册切片协议解析器, 设置后优先使用, 完整的包以切片形式直接引用网络buffer, 不再copy到RecvContext::buffer()
+         * 需在setProtocol之后调用, setProtocol会清除切片协议解析器
+         * @param spf
+         */
+        inline void setSliceProtocol(const TC_NetWorkBuffer::slice_protocol_functor & spf) { _spf = spf; }
+
+        /**
+         * 获取切片协议解析器
+         * @return slice_protocol_functor&
+         */
+        inline TC_NetWorkBuffer::slice_protocol_functor & getSliceProtocol() { return _spf; }
+
         /**
          * 解析包头处理对象
          * @return protocol_functor&
@@ -1432,6 +1657,7 @@ public:
         PropertyReport *_pReportQueue = NULL;
         PropertyReport *_pReportConRate = NULL;
         PropertyReport *_pReportTimeoutNum = NULL;
+        PropertyReport *_pReportGatherSaved = NULL;
 
     protected:
         /**
@@ -1454,6 +1680,11 @@ public:
          */
         TC_NetWorkBuffer::protocol_functor _pf;
 
+        /**
+         * 切片协议解析
+         */
+        TC_NetWorkBuffer::slice_protocol_functor _spf;
+
         /**
          * 首个数据包包头过滤
          */
@@ -1529,6 +1760,22 @@ public:
          */
         int                     _iQueueCapacity;
 
+        /**
+         * 是否合并发送
+         */
+        bool                    _gatherWrite = false;
+
+        /**
+         * 合并发送节省的系统调用次数(累计/已上报)
+         */
+        std::atomic<size_t>     _gatherSaved {0};
+        std::atomic<size_t>     _gatherSavedReported {0};
+
+        /**
+         * 环形接收队列满而丢弃的请求数
+         */
+        std::atomic<size_t>     _ringDiscard {0};
+
         /**
          * 消息超时时间（从入队列到出队列间隔)(毫秒）
          */
@@ -1658,6 +1905,28 @@ public:
          */
         inline void notify() { assert(_scheduler); _scheduler->notify(); }
 
+        /**
+         * 环形发送队列满而丢弃的应答数
+         * @return size_t
+         */
+        inline size_t getSendRingDiscard() const { return _sendRingDiscard; }
+
+    protected:
+        /**
+         * 放入发送队列, 环形队列满时等待网络线程消费, 最多等待SEND_RING_WAIT_MS, 超时丢弃并记录
+         * @param data
+         */
+        void pushSendQueue(const std::shared_ptr<SendContext> & data);
+
+        /**
+         * 从发送队列取数据
+         * @param data
+         * @return
+         */
+        bool popSendQueue(std::shared_ptr<SendContext> & data);
+
+    public:
+
         /**
          * 关闭连接
          * @param uid
@@ -1739,6 +2008,12 @@ public:
          */
         void processPipe();
 
+        /**
+         * 合并发送模式下, 登记本轮需要flush的连接
+         * @param uid
+         */
+        inline void addFlushConnection(uint32_t uid) { _flushUids.push_back(uid); }
+
         /**
          * 空连接超时时间
          */
@@ -1764,6 +2039,7 @@ public:
         friend class BindAdapter;
         friend class TC_EpollServer;
         friend class ConnectionList;
+        friend class Connection;
 
     private:
 
@@ -1807,6 +2083,21 @@ public:
          */
         send_queue              _sbuffer;
 
+        /**
+         * 环形发送队列, 非空时替代_sbuffer
+         */
+        std::unique_ptr<send_ring_queue> _sring;
+
+        /**
+         * 环形发送队列满而丢弃的应答数
+         */
+        std::atomic<size_t>     _sendRingDiscard {0};
+
+        /**
+         * 合并发送模式下本轮待flush的连接
+         */
+        std::vector<uint32_t>   _flushUids;
+
         // /**
         //  * 空连接超时时间,单位是毫秒,默认值2s,
         //  * 该时间必须小于等于adapter自身的超时时间
@@ -1944,6 +2235,12 @@ public:
          */
         void handleCoroutine();
 
+        /**
+         * 在当前线程的handle中处理请求(开启任务窃取时, 请求可能被其他handle线程执行)
+         * @param data
+         */
+        static void handleOnCurrent(const std::shared_ptr<RecvContext> &data);
+
         /**
          * 设置等待队列的时间
          * @param iWaitTime
@@ -2118,12 +2415,68 @@ public:
      */
 	void setCoroutineStack(uint32_t iPoolSize, size_t iStackSize);
 
+	/**
+	 * 设置协程使用的共享栈个数(协程模式有效, 在启动前调用)
+	 * 开启后协程不再分配独立的栈, 挂起时只保存栈上用到的部分, 适合大量空闲协程的场景, 参考TC_CoroutineScheduler::setSharedStack
+	 * @param iStackNum, 每个线程共享栈的个数, 0表示不开启
+	 */
+	inline void setCoroutineSharedStack(uint32_t iStackNum) { _iCoroutineSharedStack = iStackNum; }
+
+	/**
+	 * 获取协程共享栈个数
+	 * @return
+	 */
+	inline uint32_t getCoroutineSharedStack() const { return _iCoroutineSharedStack; }
+
+	/**
+	 * 设置协程栈深度检查(协程模式有效, 在启动前调用), 参考TC_CoroutineScheduler::setStackCheck
+	 * @param iInterval, 检查间隔(毫秒), 0表示不检查
+	 * @param bAutoSize, 是否根据栈的最大深度自动调整新协程的栈大小
+	 */
+	inline void setCoroutineStackCheck(int64_t iInterval, bool bAutoSize) { _iCoroutineStackCheck = iInterval; _bCoroutineStackAuto = bAutoSize; }
+
+	/**
+	 * 获取协程栈深度检查间隔(毫秒)
+	 * @return
+	 */
+	inline int64_t getCoroutineStackCheck() const { return _iCoroutineStackCheck; }
+
+	/**
+	 * 是否自动调整协程栈大小
+	 * @return
+	 */
+	inline bool isCoroutineStackAuto() const { return _bCoroutineStackAuto; }
+
 	/**
 	 * 获取协程池大小
 	 * @return
 	 */
 	uint32_t getCoroutinePoolSize() const { return _iCoroutinePoolSize; }
 
+    /**
+     * 设置网络线程发送队列的实现(在启动前调用)
+     * @param type
+     */
+    inline void setQueueType(QUEUE_TYPE type) { _queueType = type; }
+
+    /**
+     * 网络线程发送队列的实现
+     * @return
+     */
+    inline QUEUE_TYPE getQueueType() const { return _queueType; }
+
+    /**
+     * 设置网络线程epoller定时器的实现(在启动前调用)
+     * @param type
+     */
+    inline void setTimerType(TC_TimerBase::TIMER_TYPE type) { _timerType = type; }
+
+    /**
+     * 网络线程epoller定时器的实现
+     * @return
+     */
+    inline TC_TimerBase::TIMER_TYPE getTimerType() const { return _timerType; }
+
 	/**
 	 * 获取协程堆栈对消
 	 * @return
@@ -2444,11 +2797,36 @@ private:
      */
 	uint32_t _iCoroutinePoolSize = 10000;
 
+    /**
+     * 网络线程发送队列的实现
+     */
+    QUEUE_TYPE _queueType = QUEUE_THREAD;
+
+    /**
+     * 网络线程epoller定时器的实现
+     */
+    TC_TimerBase::TIMER_TYPE _timerType = TC_TimerBase::TIMER_MAP;
+
 	/**
 	 * 堆栈大小
 	 */
 	size_t _iCoroutineStackSize = 64*1024;
 
+	/**
+	 * 共享栈个数
+	 */
+	uint32_t _iCoroutineSharedStack = 0;
+
+	/**
+	 * 协程栈深度检查间隔(毫秒)
+	 */
+	int64_t _iCoroutineStackCheck = 0;
+
+	/**
+	 * 是否自动调整协程栈大小
+	 */
+	bool _bCoroutineStackAuto = false;
+
     /**
      * 应用回调
      */
@@ -59,6 +59,7 @@ namespace tars
  * 9 TC_Epoller对象的loop方法, 会发起一个epoll wait的事件循环, 会阻塞当前线程
  * 10 TC_Epoller对象的done方法, 会执行一次epoll wait事件, 如果没有任何事件发生, 则只会等待最后ms毫秒(参数确定)
  * 11 TC_Epoller对象中的notify方法, 可以主动唤醒epoll wait
+ * 12 定时器默认用std::map存储, 定时事件很多时(比如大量请求超时)可以setTimerType(TIMER_WHEEL)换成时间轮
  */
 /////////////////////////////////////////////////
 
@@ -19,6 +19,7 @@
 
 #include <iostream>
 #include <string>
+#include <cstdint>
 
 namespace tars
 {
@@ -46,6 +47,24 @@ inline size_t hash_string(const char* s)
     return size_t(h);
 }
 
+/**
+ * @brief 32位FNV-1a, 结果和平台无关.
+ * @brief 32-bit FNV-1a, platform independent
+ *
+ *tars2cpp生成代码时算好每个函数名的hash, onDispatch里对请求的函数名算一次hash再switch
+ *tars2cpp precomputes the hash of each function name, onDispatch switches on the hash of the requested name
+ */
+inline uint32_t hash_fnv1a(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 //////////////////////////////////////////////////////////
 /**
  * @brief 尽量采用hash_new, 更均衡一些.
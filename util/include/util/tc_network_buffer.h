@@ -24,6 +24,10 @@
 #include <memory>
 #include "util/tc_socket.h"
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+#include <sys/uio.h>
+#endif
+
 /////////////////////////////////////////////////
 /**
  * @file  tc_network_buffer.h
@@ -301,6 +305,12 @@ public:
 			_writeIdx += len;
 		}
 
+		/**
+		 * 是否被切片引用着, 被引用时不能复用或者压缩空间
+		 * @return
+		 */
+		inline bool isSliced() const { return _slicePin && _slicePin.use_count() > 1; }
+
 		friend class TC_NetWorkBuffer;
 	protected:
 		/**
@@ -322,8 +332,52 @@ public:
 		 * 总内存空间
 		 */
 		size_t			_capacity 	= 1024*8;
+
+		/**
+		 * 切片引用标记, 每个切片持有一份
+		 */
+		std::shared_ptr<void> _slicePin;
 	};
 
+	/**
+	 * buffer切片, 引用Buffer中一段连续的数据, 不做数据copy
+	 * A slice of continuous data in a Buffer, without copy
+	 * 切片持有Buffer的引用计数, 被切片引用的Buffer不会再被TC_NetWorkBuffer复用或者压缩, 切片释放前数据一直有效
+	 * The slice holds a reference of the Buffer, which will not be reused or compacted by TC_NetWorkBuffer until the slice is released
+	 */
+	struct Slice
+	{
+		/**
+		 * 数据所在的Buffer
+		 */
+		std::shared_ptr<Buffer> owner;
+
+		/**
+		 * 切片引用标记, Buffer据此判断是否被切片引用
+		 */
+		std::shared_ptr<void> pin;
+
+		/**
+		 * 数据首地址
+		 */
+		const char *data = NULL;
+
+		/**
+		 * 数据长度
+		 */
+		size_t length = 0;
+
+		inline bool empty() const { return length == 0; }
+
+		inline void clear() { owner.reset(); pin.reset(); data = NULL; length = 0; }
+	};
+
+	/**
+	 * 以切片形式输出完整包的协议解析器
+	 * Protocol parser which outputs a complete package as a slice
+	 */
+	typedef std::function<PACKET_TYPE(TC_NetWorkBuffer &, Slice &)> slice_protocol_functor;
+
 
 	typedef std::list<std::shared_ptr<Buffer>>::const_iterator buffer_list_iterator;
 
@@ -742,6 +796,17 @@ public:
 	 */
 	std::pair<const char*, size_t> getBufferPointer() const;
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+	/**
+	 * 获取前面多块有效数据buffer的指针, 用于writev合并发送
+	 * Fill iovecs with the leading data buffers, used to gather-send with writev
+	 * @param vecs
+	 * @param maxCount, vecs的最大个数
+	 * @return size_t, 填充的个数
+	 */
+	size_t getBufferPointers(struct iovec *vecs, size_t maxCount) const;
+#endif
+
 	/**
 	 * 将链表上的所有buffer拼接起来
 	 * Stitch together all buffers on the std::list
@@ -788,6 +853,16 @@ public:
 	 */
 	bool getHeader(size_t len, std::vector<char> &buffer) const;
 
+	/**
+	 * 读取len字节的切片(注意: 不往后移动)
+	 * Read slice of len bytes (Note: Do not move backwards)
+	 * len个字节在同一个buffer中时不copy数据, 被分割到多个buffer时copy到新的buffer中
+	 * No copy when len bytes are in one buffer, otherwise copy to a new buffer
+	 * @param len
+	 * @return
+	 */
+	bool getHeader(size_t len, Slice &slice) const;
+
 	/**
 	 * 读取len字节的buffer(避免len个字节被分割到多个buffer的情况)(注意: 不往后移动)
 	 * Read buffer of len bytes (to avoid splitting len bytes into multiple buffers) (Note: Do not move backwards)
@@ -938,6 +1013,21 @@ public:
 		return in.parseBufferOf4(out, iMinLength, iMaxLength);
 	}
 
+	/**
+	 * 解析二进制包, 4字节长度(字节序)+包体, 包体以切片的形式返回, 尽量不copy数据
+	 * Parse binary package, 4 byte length (byte order) + package, the package is returned as a slice, avoid copy
+	 * 注意: out只返回包体, 不包括头部的4个字节的长度
+	 * Note: out only returns the package, not including the length of 4 bytes of the head
+	 * @param in
+	 * @param out
+	 * @return
+	 */
+	template<uint32_t iMinLength, uint32_t iMaxLength>
+	static TC_NetWorkBuffer::PACKET_TYPE parseBinary4(TC_NetWorkBuffer&in, Slice &out)
+	{
+		return in.parseBuffer<uint32_t>(out, iMinLength, iMaxLength);
+	}
+
 	/**
 	 * http1
 	 * @param in
@@ -978,8 +1068,8 @@ protected:
 		return 0;
 	}
 
-	template<typename T>
-	TC_NetWorkBuffer::PACKET_TYPE parseBuffer(std::vector<char> &buffer, T minLength, T maxLength)
+	template<typename T, typename O>
+	TC_NetWorkBuffer::PACKET_TYPE parseBuffer(O &buffer, T minLength, T maxLength)
 	{
 		if(getBufferLength() < sizeof(T))
 		{
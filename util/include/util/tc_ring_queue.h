@@ -0,0 +1,386 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __TC_RING_QUEUE_H_
+#define __TC_RING_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "util/tc_platform.h"
+
+#if TARGET_PLATFORM_LINUX
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace tars
+{
+/////////////////////////////////////////////////
+/**
+ * @file tc_ring_queue.h
+ * @brief Bounded lock-free MPMC ring queue
+ * @brief 有界无锁多生产者多消费者环形队列
+ *
+ * - 入队/出队基于每个槽位的序号做CAS, 不使用互斥锁
+ * - 容量固定(向上取整为2的幂), 队列满时push_back返回false, 由调用方决定丢弃还是重试
+ * - 消费者在队列为空时可以wait, linux下通过futex休眠, 其他平台退化为条件变量
+ * - 接口与TC_ThreadQueue保持一致, 可以直接替换网络线程和业务线程之间的队列
+ */
+
+/////////////////////////////////////////////////
+template<typename T>
+class TC_RingQueue
+{
+public:
+    /**
+     * @brief 构造
+     * @param capacity, 队列容量, 会被调整为2的幂
+     */
+    explicit TC_RingQueue(size_t capacity = 1024);
+
+    /**
+     * @brief Put data to the back end of the queue, and wake up one waiter
+     * @brief 放数据到队列后端, 并唤醒一个等待者
+     *
+     * @param t
+     * @param notify 是否唤醒等待者
+     * @return bool: true, success; false, queue is full
+     * @return bool: true, 成功, false, 队列已满
+     */
+    bool push_back(const T& t, bool notify = true);
+
+    /**
+     * @brief Get data from the head
+     * @brief 从头部获取数据
+     *
+     * @param t
+     * @param millsecond 阻塞等待时间(ms), 0表示不阻塞, -1永久等待
+     * @param wait 是否wait
+     * @return bool: true, get data ; false, no data
+     * @return bool: true, 获取了数据, false, 无数据
+     */
+    bool pop_front(T& t, size_t millsecond = 0, bool wait = true);
+
+    /**
+     * @brief 等待数据
+     * @param millsecond 阻塞等待时间(ms), -1永久等待
+     * @return bool 非空返回true, 超时或被唤醒时为空返回false
+     */
+    bool wait(size_t millsecond);
+
+    /**
+     * @brief 唤醒所有等待在队列上的线程
+     */
+    void notifyT();
+
+    /**
+     * @brief 队列大小(近似值)
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief 是否为空(近似值)
+     * @return bool
+     */
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief 队列容量
+     * @return size_t
+     */
+    size_t capacity() const { return _mask + 1; }
+
+protected:
+    TC_RingQueue(const TC_RingQueue&) = delete;
+    TC_RingQueue& operator=(const TC_RingQueue&) = delete;
+
+    /**
+     * 等待事件计数变化
+     */
+    void parkWait(uint32_t event, size_t millsecond);
+
+    /**
+     * 唤醒等待者
+     */
+    void parkWake(bool all);
+
+protected:
+    /**
+     * 槽位
+     */
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T                   data;
+    };
+
+    enum { CACHE_LINE = 64 };
+
+    std::vector<Cell>       _cells;
+
+    size_t                  _mask;
+
+    char                    _pad0[CACHE_LINE];
+
+    /**
+     * 写位置
+     */
+    std::atomic<size_t>     _enqueuePos;
+
+    char                    _pad1[CACHE_LINE];
+
+    /**
+     * 读位置
+     */
+    std::atomic<size_t>     _dequeuePos;
+
+    char                    _pad2[CACHE_LINE];
+
+    /**
+     * 事件计数, futex等待在该地址上
+     */
+    std::atomic<uint32_t>   _event;
+
+    /**
+     * 等待者个数, 没有等待者时push不做系统调用
+     */
+    std::atomic<uint32_t>   _waiters;
+
+#if !TARGET_PLATFORM_LINUX
+    std::mutex              _mutex;
+    std::condition_variable _cond;
+#endif
+};
+
+template<typename T> TC_RingQueue<T>::TC_RingQueue(size_t capacity)
+    : _enqueuePos(0), _dequeuePos(0), _event(0), _waiters(0)
+{
+    size_t n = 2;
+    while (n < capacity)
+    {
+        n <<= 1;
+    }
+
+    _cells = std::vector<Cell>(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    _mask = n - 1;
+}
+
+template<typename T> bool TC_RingQueue<T>::push_back(const T& t, bool notify)
+{
+    Cell *cell;
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &_cells[pos & _mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            //队列满
+            return false;
+        }
+        else
+        {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = t;
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    //与wait中的fence配对, 保证要么看到等待者, 要么等待者看到数据
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (notify && _waiters.load(std::memory_order_relaxed) > 0)
+    {
+        parkWake(false);
+    }
+
+    return true;
+}
+
+template<typename T> bool TC_RingQueue<T>::pop_front(T& t, size_t millsecond, bool wait)
+{
+    for (;;)
+    {
+        Cell *cell;
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                //队列空
+                cell = NULL;
+                break;
+            }
+            else
+            {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (cell != NULL)
+        {
+            t = std::move(cell->data);
+            cell->data = T();
+            cell->seq.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        if (!wait || millsecond == 0)
+        {
+            return false;
+        }
+
+        if (!this->wait(millsecond))
+        {
+            return false;
+        }
+
+        //只等待一轮, 被唤醒后再取一次
+        wait = false;
+    }
+}
+
+template<typename T> bool TC_RingQueue<T>::wait(size_t millsecond)
+{
+    uint32_t event = _event.load(std::memory_order_acquire);
+
+    if (!empty())
+    {
+        return true;
+    }
+
+    _waiters.fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    //注册等待者之后再检查一次, 避免丢失唤醒
+    if (empty())
+    {
+        parkWait(event, millsecond);
+    }
+
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+
+    return !empty();
+}
+
+template<typename T> void TC_RingQueue<T>::notifyT()
+{
+    parkWake(true);
+}
+
+template<typename T> size_t TC_RingQueue<T>::size() const
+{
+    size_t e = _enqueuePos.load(std::memory_order_acquire);
+    size_t d = _dequeuePos.load(std::memory_order_acquire);
+
+    return e > d ? e - d : 0;
+}
+
+#if TARGET_PLATFORM_LINUX
+
+template<typename T> void TC_RingQueue<T>::parkWait(uint32_t event, size_t millsecond)
+{
+    struct timespec ts;
+    struct timespec *pts = NULL;
+
+    if (millsecond != (size_t)-1)
+    {
+        ts.tv_sec  = millsecond / 1000;
+        ts.tv_nsec = (millsecond % 1000) * 1000000;
+        pts = &ts;
+    }
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_event), FUTEX_WAIT_PRIVATE, event, pts, NULL, 0);
+}
+
+template<typename T> void TC_RingQueue<T>::parkWake(bool all)
+{
+    _event.fetch_add(1, std::memory_order_release);
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&_event), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, NULL, NULL, 0);
+}
+
+#else
+
+template<typename T> void TC_RingQueue<T>::parkWait(uint32_t event, size_t millsecond)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto pred = [&]{ return _event.load(std::memory_order_acquire) != event; };
+
+    if (millsecond == (size_t)-1)
+    {
+        _cond.wait(lock, pred);
+    }
+    else
+    {
+        _cond.wait_for(lock, std::chrono::milliseconds(millsecond), pred);
+    }
+}
+
+template<typename T> void TC_RingQueue<T>::parkWake(bool all)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _event.fetch_add(1, std::memory_order_release);
+    }
+
+    if (all)
+    {
+        _cond.notify_all();
+    }
+    else
+    {
+        _cond.notify_one();
+    }
+}
+
+#endif
+
+}
+#endif
@@ -0,0 +1,275 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __TC_THREAD_CACHE_POOL_H_
+#define __TC_THREAD_CACHE_POOL_H_
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+namespace tars
+{
+/////////////////////////////////////////////////
+/**
+ * @file tc_thread_cache_pool.h
+ * @brief 固定大小内存块的线程缓存池
+ *
+ * - 每个线程有自己的空闲链表, 分配和在本线程释放都不加锁
+ * - 在其他线程释放的块(比如业务线程分配, 网络线程释放), 通过无锁栈还给分配它的线程, 该线程本地链表空了时一次取回
+ * - 每个块前面有一个头, 记录所属的线程缓存; 关闭池化时分配的块头为空, 直接走系统的new/delete, 因此可以随时开关
+ * - 线程退出后它的缓存不释放, 留给后面新建的线程接管, 缓存的个数不会超过同时存在的线程数
+ * - 一般用在类的operator new/delete里面, 例如ReqMessage
+ */
+/////////////////////////////////////////////////
+
+template<size_t SIZE>
+class TC_ThreadCachePool
+{
+public:
+    /**
+     * @brief 分配, size大于SIZE或者没有开启时直接用系统分配
+     * @param size
+     * @return
+     */
+    static void *allocate(size_t size);
+
+    /**
+     * @brief 释放
+     * @param p
+     */
+    static void deallocate(void *p);
+
+    /**
+     * @brief 开启/关闭池化(默认关闭)
+     * @param enable
+     */
+    static void setEnable(bool enable) { enableFlag().store(enable, std::memory_order_relaxed); }
+
+    /**
+     * @brief 是否开启
+     * @return
+     */
+    static bool isEnable() { return enableFlag().load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 每个线程本地最多缓存的块数, 超过的直接释放
+     * 其他线程归还还没取回的块也按这个上限计数, 超过的在归还的线程直接释放
+     * @param maxCache
+     */
+    static void setMaxCache(size_t maxCache) { maxCacheNum().store(maxCache, std::memory_order_relaxed); }
+
+    /**
+     * @brief 当前线程本地缓存的块数(不含其他线程归还还没取回的)
+     * @return
+     */
+    static size_t getCacheSize()
+    {
+        Cache *c = tlsCache();
+        return c ? c->count : 0;
+    }
+
+protected:
+    struct Block
+    {
+        Block   *next;
+    };
+
+    struct Cache
+    {
+        Block               *local = NULL;      //本线程的空闲链表
+        size_t              count = 0;
+        std::atomic<Block*> remote{NULL};       //其他线程归还的
+        std::atomic<size_t> remoteCount{0};     //remote上的块数(归还时先计数, 可能略大于实际个数)
+        Cache               *nextFree = NULL;   //线程退出后挂到空闲缓存链表
+    };
+
+    /**
+     * 块头, 保证后面的数据按最大对齐
+     */
+    union Header
+    {
+        Cache       *owner;
+        long double ld;
+        uint64_t    u64;
+    };
+
+    enum { BLOCK_SIZE = SIZE < sizeof(Block) ? sizeof(Block) : SIZE };
+
+    /**
+     * 线程退出时把缓存交出去
+     */
+    struct ThreadGuard
+    {
+        ~ThreadGuard() { release(); }
+    };
+
+    static std::atomic<bool> &enableFlag() { static std::atomic<bool> enable(false); return enable; }
+
+    static std::atomic<size_t> &maxCacheNum() { static std::atomic<size_t> num(4096); return num; }
+
+    static std::mutex &mutex() { static std::mutex m; return m; }
+
+    static Cache *&freeCaches() { static Cache *caches = NULL; return caches; }
+
+    static Cache *&tlsCache() { static thread_local Cache *c = NULL; return c; }
+
+    static bool &tlsExited() { static thread_local bool exited = false; return exited; }
+
+    static Cache *cache();
+
+    static void release();
+
+    static void *plain(size_t size)
+    {
+        Header *h = (Header*)::operator new(sizeof(Header) + size);
+        h->owner = NULL;
+        return h + 1;
+    }
+};
+
+template<size_t SIZE> typename TC_ThreadCachePool<SIZE>::Cache *TC_ThreadCachePool<SIZE>::cache()
+{
+    Cache *&c = tlsCache();
+    if (c == NULL && !tlsExited())
+    {
+        static thread_local ThreadGuard guard;
+        (void)guard;
+
+        std::lock_guard<std::mutex> lock(mutex());
+        Cache *&caches = freeCaches();
+        if (caches)
+        {
+            c = caches;
+            caches = c->nextFree;
+            c->nextFree = NULL;
+        }
+        else
+        {
+            c = new Cache();
+        }
+    }
+    return c;
+}
+
+template<size_t SIZE> void TC_ThreadCachePool<SIZE>::release()
+{
+    Cache *&c = tlsCache();
+    if (c)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        c->nextFree = freeCaches();
+        freeCaches() = c;
+        c = NULL;
+    }
+    //线程退出过程中再分配的直接走系统分配
+    tlsExited() = true;
+}
+
+template<size_t SIZE> void *TC_ThreadCachePool<SIZE>::allocate(size_t size)
+{
+    if (size > SIZE || !isEnable())
+    {
+        return plain(size);
+    }
+
+    Cache *c = cache();
+    if (c == NULL)
+    {
+        return plain(size);
+    }
+
+    Block *b = c->local;
+    if (b == NULL)
+    {
+        //取回其他线程归还的
+        b = c->remote.exchange(NULL, std::memory_order_acquire);
+        size_t n = 0;
+        for (Block *p = b; p != NULL; p = p->next)
+        {
+            ++n;
+        }
+        c->remoteCount.fetch_sub(n, std::memory_order_relaxed);
+        c->count += n;
+    }
+
+    Header *h;
+    if (b)
+    {
+        c->local = b->next;
+        --c->count;
+        h = (Header*)b - 1;
+    }
+    else
+    {
+        h = (Header*)::operator new(sizeof(Header) + BLOCK_SIZE);
+    }
+
+    h->owner = c;
+    return h + 1;
+}
+
+template<size_t SIZE> void TC_ThreadCachePool<SIZE>::deallocate(void *p)
+{
+    if (p == NULL)
+    {
+        return;
+    }
+
+    Header *h = (Header*)p - 1;
+    Cache *owner = h->owner;
+
+    if (owner == NULL)
+    {
+        ::operator delete(h);
+        return;
+    }
+
+    Block *b = (Block*)p;
+
+    if (owner == tlsCache())
+    {
+        if (owner->count >= maxCacheNum().load(std::memory_order_relaxed))
+        {
+            ::operator delete(h);
+            return;
+        }
+
+        b->next = owner->local;
+        owner->local = b;
+        ++owner->count;
+    }
+    else
+    {
+        //归还给其他线程的也不超过上限
+        if (owner->remoteCount.fetch_add(1, std::memory_order_relaxed) >= maxCacheNum().load(std::memory_order_relaxed))
+        {
+            owner->remoteCount.fetch_sub(1, std::memory_order_relaxed);
+            ::operator delete(h);
+            return;
+        }
+
+        b->next = owner->remote.load(std::memory_order_relaxed);
+        while (!owner->remote.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+}
+#endif
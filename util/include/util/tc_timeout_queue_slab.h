@@ -0,0 +1,667 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#ifndef __TC_TIMEOUT_QUEUE_SLAB_H
+#define __TC_TIMEOUT_QUEUE_SLAB_H
+
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cassert>
+#include <cstdint>
+#include "util/tc_timeprovider.h"
+
+namespace tars
+{
+/////////////////////////////////////////////////
+/**
+ * @file tc_timeout_queue_slab.h
+ * @brief 超时队列, 没有锁, 非线程安全, 接口与TC_TimeoutQueueNew一致.
+ *
+ * - 节点存放在连续的数组里(slab), 释放的节点挂在空闲链表上复用
+ * - 构造时按size预分配节点和哈希表, 在途数据不超过size时push/get/timeout都不分配内存;
+ *   超过后节点数组和哈希表按倍数扩容(摊还O(1)), 扩容后的空间之后继续复用
+ * - id到节点的索引是开放寻址的哈希表, 同样是连续数组
+ * - 超时链表和待发送链表都是节点内的下标串起来的侵入式双向链表
+ * - 同一个proxy上请求的超时时间基本是递增的, 超时按若干条有序链表(lane)组织, 新节点挂到尾部不大于它的链表尾,
+ *   不同超时时间的请求各自落在一条链表上, 插入是O(1), 取最早超时只比较各链表头.
+ *   超时时间的种类多于链表数时, 比所有链表尾都小的节点能挂到某条链表头就是O(1), 否则在链表里往前找位置, 最坏O(n)
+ */
+/////////////////////////////////////////////////
+
+template<class T>
+class TC_TimeoutQueueSlab
+{
+public:
+
+    typedef std::function<void(T&)> data_functor;
+
+    /**
+     * @brief 超时队列
+     *
+     * @param timeout 超时设定时间(保留参数, 与TC_TimeoutQueueNew一致)
+     * @param size 预分配的节点数, 按预期的最大在途数据量设置, 不超过它时不再分配内存
+     */
+    TC_TimeoutQueueSlab(int timeout = 5*1000, size_t size = 100);
+
+    /**
+     * @brief  产生该队列的下一个ID
+     */
+    uint32_t generateId();
+
+    /**
+     * 要发送的链表是否为空
+     */
+    bool sendListEmpty() const { return _sendTail == NIL; }
+
+    /**
+     * 获取要发送的数据(最早放入的)
+     */
+    bool getSend(T & t);
+
+    /**
+     * 把已经发送的数据从发送链表里删除
+     * @param del, 是否同时从队列中删除
+     */
+    void popSend(bool del = false);
+
+    /**
+     * 获取要发送链表的size
+     */
+    size_t getSendListSize() const { return _sendSize; }
+
+    /**
+     * @brief 获取指定id的数据.
+     *
+     * @param uniqId 指定的数据的id
+     * @param t 指定id的数据
+     * @param bErase 是否删除
+     * @return bool get的结果
+     */
+    bool get(uint32_t uniqId, T & t, bool bErase = true);
+
+    /**
+     * @brief 删除.
+     *
+     * @param uniqId 要删除的数据的id
+     * @param t      被删除的数据
+     * @return bool 删除结果
+     */
+    bool erase(uint32_t uniqId, T & t);
+
+    /**
+     * @brief 设置消息到队列尾端.
+     *
+     * @param ptr        要插入到队列尾端的消息
+     * @param uniqId     序列号
+     * @param timeout    超时时间(绝对时间, 毫秒)
+     * @param hasSend    是否已经发送, 没有发送的放到发送链表
+     * @return true  成功 false 失败(id重复)
+     */
+    bool push(T& ptr, uint32_t uniqId, int64_t timeout, bool hasSend = true);
+
+    /**
+     * @brief 超时删除数据
+     */
+    void timeout();
+
+    /**
+     * @brief 取出一个超时的数据
+     */
+    bool timeout(T & t);
+
+    /**
+     * @brief 删除超时的数据，并用df对数据做处理
+     */
+    void timeout(data_functor &df);
+
+    /**
+     * @brief 队列中的数据.
+     *
+     * @return size_t
+     */
+    size_t size() const { return _size; }
+
+protected:
+    static const uint32_t NIL = 0xFFFFFFFF;
+
+    enum { MAX_LANE = 8 };
+
+    struct Node
+    {
+        T           ptr;
+        int64_t     timeout  = 0;
+        uint32_t    uniqId   = 0;
+        uint32_t    lane     = 0;
+        uint32_t    timePrev = NIL;
+        uint32_t    timeNext = NIL;  //空闲节点用它串成空闲链表
+        uint32_t    sendPrev = NIL;
+        uint32_t    sendNext = NIL;
+        bool        hasSend  = true;
+    };
+
+    /**
+     * 按超时时间有序的链表
+     */
+    struct Lane
+    {
+        uint32_t    head = NIL;
+        uint32_t    tail = NIL;
+    };
+
+    uint32_t allocNode();
+
+    void freeNode(uint32_t idx);
+
+    inline uint32_t hash(uint32_t uniqId) const { return (uint32_t)(uniqId * 2654435769u) >> (32 - _tableBits); }
+
+    /**
+     * 查找id对应的节点, 没有返回NIL
+     */
+    uint32_t find(uint32_t uniqId) const;
+
+    void insertId(uint32_t idx);
+
+    void eraseId(uint32_t uniqId);
+
+    void rehash(uint32_t bits);
+
+    void linkTime(uint32_t idx);
+
+    void unlinkTime(uint32_t idx);
+
+    void linkSend(uint32_t idx);
+
+    void unlinkSend(uint32_t idx);
+
+    /**
+     * 从所有链表和索引中摘除, 并释放节点
+     */
+    void remove(uint32_t idx);
+
+    /**
+     * 最早超时的节点, 没有返回NIL
+     */
+    uint32_t earliest() const;
+
+protected:
+    std::atomic<uint32_t>   _uniqId;
+
+    std::vector<Node>       _nodes;
+
+    uint32_t                _free = NIL;
+
+    std::vector<uint32_t>   _table;         //uniqId -> 节点下标
+
+    uint32_t                _tableBits = 0;
+
+    Lane                    _lanes[MAX_LANE];
+
+    uint32_t                _laneNum = 0;
+
+    uint32_t                _sendHead = NIL;    //最新放入的
+
+    uint32_t                _sendTail = NIL;    //最早放入的, getSend从这里取
+
+    size_t                  _sendSize = 0;
+
+    size_t                  _size = 0;
+};
+
+template<typename T> const uint32_t TC_TimeoutQueueSlab<T>::NIL;
+
+template<typename T> TC_TimeoutQueueSlab<T>::TC_TimeoutQueueSlab(int timeout, size_t size) : _uniqId(0)
+{
+    _nodes.reserve(size);
+
+    uint32_t bits = 4;
+    while ((1ULL << bits) < size * 2)
+    {
+        ++bits;
+    }
+    rehash(bits);
+}
+
+template<typename T> uint32_t TC_TimeoutQueueSlab<T>::generateId()
+{
+    uint32_t i = ++_uniqId;
+    if(i == 0) {
+        i = ++_uniqId;
+    }
+
+    return i;
+}
+
+template<typename T> uint32_t TC_TimeoutQueueSlab<T>::allocNode()
+{
+    if (_free != NIL)
+    {
+        uint32_t idx = _free;
+        _free = _nodes[idx].timeNext;
+        return idx;
+    }
+
+    _nodes.emplace_back();
+    return (uint32_t)(_nodes.size() - 1);
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::freeNode(uint32_t idx)
+{
+    Node &node = _nodes[idx];
+    node.ptr      = T();
+    node.timePrev = NIL;
+    node.sendPrev = NIL;
+    node.sendNext = NIL;
+    node.timeNext = _free;
+    _free = idx;
+}
+
+template<typename T> uint32_t TC_TimeoutQueueSlab<T>::find(uint32_t uniqId) const
+{
+    uint32_t mask = (uint32_t)_table.size() - 1;
+    uint32_t pos  = hash(uniqId);
+
+    while (true)
+    {
+        uint32_t idx = _table[pos];
+        if (idx == NIL || _nodes[idx].uniqId == uniqId)
+        {
+            return idx;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::insertId(uint32_t idx)
+{
+    //负载不超过1/2
+    if ((_size + 1) * 2 > _table.size())
+    {
+        rehash(_tableBits + 1);
+    }
+
+    uint32_t mask = (uint32_t)_table.size() - 1;
+    uint32_t pos  = hash(_nodes[idx].uniqId);
+
+    while (_table[pos] != NIL)
+    {
+        pos = (pos + 1) & mask;
+    }
+    _table[pos] = idx;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::eraseId(uint32_t uniqId)
+{
+    uint32_t mask = (uint32_t)_table.size() - 1;
+    uint32_t pos  = hash(uniqId);
+
+    while (_nodes[_table[pos]].uniqId != uniqId)
+    {
+        pos = (pos + 1) & mask;
+    }
+
+    //后面同一簇的往前挪, 保证线性探测不断链
+    _table[pos] = NIL;
+
+    uint32_t next = (pos + 1) & mask;
+    while (_table[next] != NIL)
+    {
+        uint32_t home = hash(_nodes[_table[next]].uniqId);
+        if (((next - home) & mask) >= ((next - pos) & mask))
+        {
+            _table[pos]  = _table[next];
+            _table[next] = NIL;
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::rehash(uint32_t bits)
+{
+    std::vector<uint32_t> old;
+    old.swap(_table);
+
+    _tableBits = bits;
+    _table.assign((size_t)1 << bits, NIL);
+
+    uint32_t mask = (uint32_t)_table.size() - 1;
+    for (auto idx : old)
+    {
+        if (idx != NIL)
+        {
+            uint32_t pos = hash(_nodes[idx].uniqId);
+            while (_table[pos] != NIL)
+            {
+                pos = (pos + 1) & mask;
+            }
+            _table[pos] = idx;
+        }
+    }
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::linkTime(uint32_t idx)
+{
+    int64_t timeout = _nodes[idx].timeout;
+
+    //优先挂到尾部不大于它的链表中尾部最大的那条, 这样插入都在链表尾
+    int best = -1, empty = -1, smallest = -1, front = -1;
+    for (uint32_t i = 0; i < _laneNum; i++)
+    {
+        if (_lanes[i].tail == NIL)
+        {
+            if (empty < 0) empty = i;
+            continue;
+        }
+
+        int64_t tail = _nodes[_lanes[i].tail].timeout;
+        if (tail <= timeout && (best < 0 || tail > _nodes[_lanes[best].tail].timeout))
+        {
+            best = i;
+        }
+        if (smallest < 0 || tail < _nodes[_lanes[smallest].tail].timeout)
+        {
+            smallest = i;
+        }
+        if (_nodes[_lanes[i].head].timeout >= timeout)
+        {
+            front = i;
+        }
+    }
+
+    if (best < 0)
+    {
+        if (empty >= 0)
+        {
+            best = empty;
+        }
+        else if (_laneNum < MAX_LANE)
+        {
+            best = _laneNum++;
+        }
+        else if (front >= 0)
+        {
+            //链表都用完了, 能挂到某条链表头上也是O(1)
+            best = front;
+        }
+        else
+        {
+            //退化为有序插入, 从尾往前找位置
+            best = smallest;
+        }
+    }
+
+    Lane &lane = _lanes[best];
+    Node &node = _nodes[idx];
+    node.lane = best;
+
+    uint32_t prev = lane.tail;
+    if (prev != NIL && _nodes[prev].timeout > timeout && _nodes[lane.head].timeout >= timeout)
+    {
+        prev = NIL;
+    }
+    while (prev != NIL && _nodes[prev].timeout > timeout)
+    {
+        prev = _nodes[prev].timePrev;
+    }
+
+    node.timePrev = prev;
+    node.timeNext = (prev == NIL ? lane.head : _nodes[prev].timeNext);
+
+    if (prev == NIL)
+    {
+        lane.head = idx;
+    }
+    else
+    {
+        _nodes[prev].timeNext = idx;
+    }
+
+    if (node.timeNext == NIL)
+    {
+        lane.tail = idx;
+    }
+    else
+    {
+        _nodes[node.timeNext].timePrev = idx;
+    }
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::unlinkTime(uint32_t idx)
+{
+    Node &node = _nodes[idx];
+    Lane &lane = _lanes[node.lane];
+
+    if (node.timePrev == NIL)
+    {
+        lane.head = node.timeNext;
+    }
+    else
+    {
+        _nodes[node.timePrev].timeNext = node.timeNext;
+    }
+
+    if (node.timeNext == NIL)
+    {
+        lane.tail = node.timePrev;
+    }
+    else
+    {
+        _nodes[node.timeNext].timePrev = node.timePrev;
+    }
+
+    node.timePrev = NIL;
+    node.timeNext = NIL;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::linkSend(uint32_t idx)
+{
+    Node &node = _nodes[idx];
+    node.sendPrev = NIL;
+    node.sendNext = _sendHead;
+
+    if (_sendHead == NIL)
+    {
+        _sendTail = idx;
+    }
+    else
+    {
+        _nodes[_sendHead].sendPrev = idx;
+    }
+    _sendHead = idx;
+
+    ++_sendSize;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::unlinkSend(uint32_t idx)
+{
+    Node &node = _nodes[idx];
+
+    if (node.sendPrev == NIL)
+    {
+        _sendHead = node.sendNext;
+    }
+    else
+    {
+        _nodes[node.sendPrev].sendNext = node.sendNext;
+    }
+
+    if (node.sendNext == NIL)
+    {
+        _sendTail = node.sendPrev;
+    }
+    else
+    {
+        _nodes[node.sendNext].sendPrev = node.sendPrev;
+    }
+
+    node.sendPrev = NIL;
+    node.sendNext = NIL;
+
+    --_sendSize;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::remove(uint32_t idx)
+{
+    eraseId(_nodes[idx].uniqId);
+    unlinkTime(idx);
+    if (!_nodes[idx].hasSend)
+    {
+        unlinkSend(idx);
+    }
+    freeNode(idx);
+
+    --_size;
+}
+
+template<typename T> uint32_t TC_TimeoutQueueSlab<T>::earliest() const
+{
+    uint32_t idx = NIL;
+    for (uint32_t i = 0; i < _laneNum; i++)
+    {
+        uint32_t head = _lanes[i].head;
+        if (head != NIL && (idx == NIL || _nodes[head].timeout < _nodes[idx].timeout))
+        {
+            idx = head;
+        }
+    }
+    return idx;
+}
+
+template<typename T> bool TC_TimeoutQueueSlab<T>::getSend(T & t)
+{
+    //链表为空返回失败
+    if (_sendTail == NIL)
+    {
+        return false;
+    }
+
+    assert(!_nodes[_sendTail].hasSend);
+    t = _nodes[_sendTail].ptr;
+    return true;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::popSend(bool del)
+{
+    assert(_sendTail != NIL);
+
+    uint32_t idx = _sendTail;
+    unlinkSend(idx);
+    _nodes[idx].hasSend = true;
+
+    if (del)
+    {
+        remove(idx);
+    }
+}
+
+template<typename T> bool TC_TimeoutQueueSlab<T>::get(uint32_t uniqId, T & t, bool bErase)
+{
+    uint32_t idx = find(uniqId);
+    if (idx == NIL)
+    {
+        return false;
+    }
+
+    t = _nodes[idx].ptr;
+
+    if (bErase)
+    {
+        remove(idx);
+    }
+
+    return true;
+}
+
+template<typename T> bool TC_TimeoutQueueSlab<T>::erase(uint32_t uniqId, T & t)
+{
+    return get(uniqId, t, true);
+}
+
+template<typename T> bool TC_TimeoutQueueSlab<T>::push(T& ptr, uint32_t uniqId, int64_t timeout, bool hasSend)
+{
+    if (find(uniqId) != NIL)
+    {
+        return false;
+    }
+
+    uint32_t idx = allocNode();
+
+    Node &node   = _nodes[idx];
+    node.ptr     = ptr;
+    node.uniqId  = uniqId;
+    node.timeout = timeout;
+    node.hasSend = hasSend;
+
+    insertId(idx);
+    ++_size;
+
+    linkTime(idx);
+
+    //没有发送放到发送链表里面
+    if (!hasSend)
+    {
+        linkSend(idx);
+    }
+
+    return true;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::timeout()
+{
+    int64_t iNow = TNOWMS;
+    while (true)
+    {
+        uint32_t idx = earliest();
+        if (idx == NIL || _nodes[idx].timeout > iNow)
+        {
+            break;
+        }
+
+        remove(idx);
+    }
+}
+
+template<typename T> bool TC_TimeoutQueueSlab<T>::timeout(T & t)
+{
+    uint32_t idx = earliest();
+    if (idx == NIL || _nodes[idx].timeout > (int64_t)TNOWMS)
+    {
+        return false;
+    }
+
+    t = _nodes[idx].ptr;
+    remove(idx);
+    return true;
+}
+
+template<typename T> void TC_TimeoutQueueSlab<T>::timeout(data_functor &df)
+{
+    while (true)
+    {
+        T ptr;
+        if (!timeout(ptr))
+        {
+            break;
+        }
+
+        try { df(ptr); } catch(...) { }
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+}
+#endif
@@ -57,6 +57,9 @@ protected:
 		uint64_t                _fireMillseconds = 0;	//事件触发时间
         TC_Cron                 _cron;  //crontab
         uint32_t                _uniqueId = 0;
+        Func*                   _prev = NULL;   //时间轮槽位链表
+        Func*                   _next = NULL;
+        int32_t                 _slot = -1;     //所在时间轮槽位, -1表示不在时间轮中
 	};
 
     typedef std::unordered_set<uint64_t> EVENT_SET;
@@ -66,6 +69,21 @@ protected:
     typedef std::map<uint64_t, std::unordered_set<uint64_t>> MAP_TIMER;
 
 public:
+    /**
+     * 定时事件的存储方式
+     */
+    enum TIMER_TYPE
+    {
+        TIMER_MAP   = 0,    //std::map按触发时间排序(默认)
+        TIMER_WHEEL = 1,    //分层时间轮, 插入/删除O(1), 精度1ms
+    };
+
+    /**
+     * 配置字符串(map/wheel)转换
+     * @param type
+     * @return
+     */
+    static TIMER_TYPE parseTimerType(const std::string &type) { return type == "wheel" ? TIMER_WHEEL : TIMER_MAP; }
 
     /**
      * 析构
@@ -160,7 +178,102 @@ public:
      */
     void clear();
 
+    /**
+     * 设置定时事件的存储方式, 已经存在的事件会迁移过去
+     * @param type
+     */
+    void setTimerType(TIMER_TYPE type);
+
+    /**
+     * 定时事件的存储方式
+     * @return
+     */
+    TIMER_TYPE getTimerType() const { return _timerType; }
+
 protected:
+    /**
+     * 分层时间轮(参考linux内核timer wheel)
+     * 第0层256个槽, 每个槽1ms; 第1~4层各64个槽, 每层粒度是下一层的64倍, 最多覆盖2^32ms
+     * 事件通过Func里的指针串在槽位链表上, 插入和删除都是O(1), 每跨过一圈时把上一层对应槽位的事件下放(cascade)
+     * 不加锁, 由TC_TimerBase的_mutex保护
+     */
+    class TimeWheel
+    {
+    public:
+        TimeWheel();
+
+        /**
+         * 加入事件(事件已经在时间轮中时, 先摘除)
+         * @param func
+         * @param now, 当前时间, 时间轮为空时以它为起点
+         */
+        void add(Func *func, uint64_t now);
+
+        /**
+         * 摘除事件
+         * @param func
+         */
+        void remove(Func *func);
+
+        /**
+         * 取出所有触发时间<=now的事件
+         * @param now
+         * @param el
+         * @return 下一次需要处理的时间(不晚于最近事件的触发时间), -1: 无事件
+         */
+        int64_t expire(uint64_t now, EVENT_SET &el);
+
+        /**
+         * 清空(摘除所有事件)
+         */
+        void clear();
+
+        /**
+         * 事件个数
+         */
+        size_t size() const { return _size; }
+
+    protected:
+        enum
+        {
+            ROOT_BITS   = 8,
+            LEVEL_BITS  = 6,
+            LEVELS      = 5,
+            ROOT_SIZE   = 1 << ROOT_BITS,
+            LEVEL_SIZE  = 1 << LEVEL_BITS,
+            SLOTS       = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE,
+            PENDING     = SLOTS,    //加入时已经过期的事件, 下一次expire时立即触发
+        };
+
+        void link(int32_t slot, Func *func);
+
+        void unlink(Func *func);
+
+        /**
+         * 把第level层的index槽位重新分配到下层
+         */
+        int cascade(int level, uint64_t tick);
+
+        /**
+         * 第0层从from开始第一个非空槽位, -1表示没有
+         */
+        int findRoot(int from) const;
+
+        /**
+         * 下一次需要处理的时间
+         */
+        int64_t next() const;
+
+    protected:
+        Func*       _slots[SLOTS + 1];
+
+        uint64_t    _bitmap[SLOTS / 64];
+
+        uint64_t    _current = 0;   //下一个待处理的时刻(ms)
+
+        size_t      _size = 0;
+    };
+
     template <class F, class... Args>
     std::shared_ptr<Func> create(int64_t fireMillseconds, int64_t repeatTime, const std::string & cronexpr, F &&f, Args &&... args)
     {
@@ -270,6 +383,10 @@ protected:
 	
     std::set<int64_t> _repeatIds; //循环任务的所有ID
 
+    TIMER_TYPE  _timerType = TIMER_MAP;
+
+    TimeWheel   _wheel;         //_timerType为TIMER_WHEEL时代替_mapTimer
+
 };
 
 
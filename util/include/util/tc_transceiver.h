@@ -123,7 +123,20 @@ public:
 
     enum
     {
-        DEFAULT_RECV_BUFFERSIZE = 64*1024       /*缺省数据接收buffer的大小*/
+        DEFAULT_RECV_BUFFERSIZE = 64*1024,      /*缺省数据接收buffer的大小*/
+        MAX_GATHER_IOV          = 64,           /*合并发送时一次writev最多的buffer个数*/
+        MIN_RECV_HINT           = 16*1024,      /*tcp自适应接收大小的下限*/
+        MAX_RECV_HINT           = 1024*1024,    /*tcp自适应接收大小的上限*/
+    };
+
+    /**
+     * 发送统计(合并发送模式下才有意义)
+     */
+    struct SendStat
+    {
+        uint64_t syscalls   = 0;    //发送的系统调用次数
+        uint64_t buffers    = 0;    //发送的buffer块数
+        uint64_t saved      = 0;    //合并发送节省的系统调用次数
     };
 
     struct SocketOpt
@@ -285,6 +298,39 @@ public:
      */ 
     virtual ReturnStatus sendRequest(const std::shared_ptr<TC_NetWorkBuffer::Buffer> &buff, const TC_Socket::addr_type& addr = TC_Socket::addr_type());
 
+    /**
+     * 只把buffer追加到发送buffer中, 不发送(合并发送模式下使用, 之后调用flushRequest统一发送)
+     * 与sendRequest不同, 发送buffer中有未发完的数据时也可以追加
+     * @param buff, buffer内容
+     * @param addr, 发送地址
+     * @return eRetOk: 已追加, eRetNotSend: 当前不能发送, eRetError: 出错
+     */
+    ReturnStatus appendRequest(const std::shared_ptr<TC_NetWorkBuffer::Buffer> &buff, const TC_Socket::addr_type& addr = TC_Socket::addr_type());
+
+    /**
+     * 发送发送buffer中的所有数据, 合并发送模式下多块buffer一次writev发出
+     * @return eRetOk: 全部发送, eRetFull: 系统buffer满了, eRetError: 出错
+     */
+    ReturnStatus flushRequest();
+
+    /**
+     * 设置合并发送模式(只对tcp有效)
+     * @param gather
+     */
+    inline void setGatherWrite(bool gather) { _gatherWrite = gather && _ep.isTcp(); }
+
+    /**
+     * 是否合并发送模式
+     * @return
+     */
+    inline bool isGatherWrite() const { return _gatherWrite; }
+
+    /**
+     * 发送统计
+     * @return
+     */
+    inline const SendStat &getSendStat() const { return _sendStat; }
+
     /**
      * 是否鉴权成功
      */ 
@@ -471,6 +517,28 @@ protected:
      */
     virtual int send(const void* buf, uint32_t len, uint32_t flag) = 0;
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+    /*
+     * 网络合并发送接口, 缺省只发送第一块
+     * @param vecs
+     * @param vcnt
+     * @return int
+     */
+    virtual int sendv(const struct iovec *vecs, int vcnt) { return send(vecs[0].iov_base, (uint32_t)vecs[0].iov_len, 0); }
+#endif
+
+    /*
+     * 检查当前是否可以发送业务数据
+     * @return eRetOk: 可以发送, 其他: 不能发送
+     */
+    ReturnStatus checkSend();
+
+    /*
+     * 发送一次发送buffer中的数据(合并发送模式下使用writev)
+     * @return int, send的返回值
+     */
+    int sendOnce();
+
     /*
      * 网络接收接口
      * @param buf
@@ -569,6 +637,16 @@ protected:
      */
     TC_Socket::addr_type    _lastAddr;
 
+    /**
+     * 合并发送模式
+     */
+    bool                    _gatherWrite = false;
+
+    /**
+     * 发送统计
+     */
+    SendStat                _sendStat;
+
     /*
      * 接收缓存(udp情况才有效)
      */
@@ -635,6 +713,16 @@ public:
      */
     virtual int send(const void* buf, uint32_t len, uint32_t flag);
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+    /**
+     * TCP 合并发送实现
+     * @param vecs
+     * @param vcnt
+     * @return int
+     */
+    virtual int sendv(const struct iovec *vecs, int vcnt);
+#endif
+
     /**
      * TCP 接收实现
      * @param buf
@@ -650,6 +738,27 @@ public:
      * @return throw
      */
 	virtual void doResponse();
+
+    /**
+     * 当前自适应的单次接收大小
+     * @return size_t
+     */
+    inline size_t getRecvHint() const { return _recvHint; }
+
+protected:
+    /**
+     * 根据最近一次读取的大小调整接收buffer的大小
+     * 读满了buffer则翻倍, 否则向最近读取大小的两倍平滑收敛
+     * @param readLen, 本次读取的字节数
+     * @param left, 本次读取时buffer的剩余空间
+     */
+    void updateRecvHint(size_t readLen, size_t left);
+
+protected:
+    /**
+     * 自适应的单次接收大小, 直接recv到_recvBuffer尾部的空闲空间
+     */
+    size_t                  _recvHint = MIN_RECV_HINT;
 };
 
 
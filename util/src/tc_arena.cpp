@@ -0,0 +1,134 @@
+/**
+ * Tencent is pleased to support the open source community by making Tars available.
+ *
+ * Copyright (C) 2016THL A29 Limited, a Tencent company. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+#include "util/tc_arena.h"
+#include <cstdlib>
+
+namespace tars
+{
+
+static thread_local TC_Arena *g_arena = NULL;
+
+TC_Arena::TC_Arena(size_t blockSize)
+: _blockSize(blockSize), _block(NULL), _cur(0), _used(0), _capacity(0)
+{
+}
+
+TC_Arena::~TC_Arena()
+{
+    while (_block)
+    {
+        Block *next = _block->next;
+        ::free(_block);
+        _block = next;
+    }
+}
+
+TC_Arena::Block *TC_Arena::newBlock(size_t size)
+{
+    Block *block = (Block*)::malloc(sizeof(Block) + size);
+    if (block == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    block->next = NULL;
+    block->size = size;
+    _capacity += size;
+
+    return block;
+}
+
+void *TC_Arena::allocateSlow(size_t size, size_t align)
+{
+    //Block头的大小是max_align_t对齐的, 多申请align保证能对齐
+    size_t need = size + (align > alignof(std::max_align_t) ? align : 0);
+
+    if (need > _blockSize / 4 && _block != NULL)
+    {
+        //大块单独申请, 挂在当前块后面, 当前块继续使用
+        Block *block = newBlock(need);
+        block->next = _block->next;
+        _block->next = block;
+
+        _used += size;
+        size_t pos = ((size_t)block->data() + align - 1) & ~(align - 1);
+        return (void*)pos;
+    }
+
+    Block *block = newBlock(need > _blockSize ? need : _blockSize);
+    block->next = _block;
+    _block = block;
+    _cur = 0;
+
+    return allocate(size, align);
+}
+
+void TC_Arena::reset()
+{
+    if (_block == NULL)
+    {
+        return;
+    }
+
+    //只保留第一个常规大小的块
+    Block *keep = NULL;
+    while (_block)
+    {
+        Block *next = _block->next;
+        if (keep == NULL && _block->size == _blockSize)
+        {
+            keep = _block;
+            keep->next = NULL;
+        }
+        else
+        {
+            _capacity -= _block->size;
+            ::free(_block);
+        }
+        _block = next;
+    }
+
+    _block = keep;
+    _cur = 0;
+    _used = 0;
+}
+
+TC_Arena *TC_Arena::current()
+{
+    return g_arena;
+}
+
+TC_Arena::Scope::Scope(TC_Arena *arena) : _prev(g_arena), _left(false)
+{
+    g_arena = arena;
+}
+
+TC_Arena::Scope::~Scope()
+{
+    leave();
+}
+
+void TC_Arena::Scope::leave()
+{
+    if (!_left)
+    {
+        g_arena = _prev;
+        _left = true;
+    }
+}
+
+}
@@ -209,6 +209,47 @@ void stack_traits::deallocate(stack_context & sctx) {
 
 #endif
 
+std::size_t stack_traits::used_size(const stack_context &sctx, std::vector<unsigned char> *scratch)
+{
+	assert(sctx.sp);
+
+	const char *top = static_cast< const char * >(sctx.sp);
+
+	//跳过最底下的保护页
+	const char *p = top - sctx.size + stack_traits::page_size();
+
+#if TARGET_PLATFORM_LINUX
+	//没有访问过的页内容一定是0, 从最低的驻留页开始检查, 避免扫描(以及映射)整个栈
+	const std::size_t pages = (top - p) / stack_traits::page_size();
+
+	std::vector<unsigned char> tmp;
+	std::vector<unsigned char> &vec = scratch ? *scratch : tmp;
+	if(vec.size() < pages)
+	{
+		vec.resize(pages);
+	}
+
+	if(::mincore((void*)p, top - p, vec.data()) == 0)
+	{
+		std::size_t i = 0;
+		while(i < pages && !(vec[i] & 1))
+		{
+			++i;
+		}
+		p += i * stack_traits::page_size();
+	}
+#endif
+
+	const uint64_t *w   = reinterpret_cast< const uint64_t * >(p);
+	const uint64_t *end = reinterpret_cast< const uint64_t * >(top);
+	while(w < end && *w == 0)
+	{
+		++w;
+	}
+
+	return top - reinterpret_cast< const char * >(w);
+}
+
 ////////////////////////////////////////////////////////
 TC_CoroutineInfo::TC_CoroutineInfo()
 : _prev(NULL)
@@ -246,7 +287,21 @@ void TC_CoroutineInfo::registerFunc(const std::function<void ()>& callback)
 
     _init_func.args     = this;
 
-	fcontext_t ctx      = make_fcontext(_stack_ctx.sp, _stack_ctx.size, TC_CoroutineInfo::corotineEntry);
+	if(_sharedStack)
+	{
+		//共享栈可能正被当前协程使用, 第一次切换过去时再创建上下文
+		_ctx = NULL;
+		return;
+	}
+
+	makeContext();
+}
+
+void TC_CoroutineInfo::makeContext()
+{
+	const stack_context &stack_ctx = _sharedStack ? _sharedStack->stack : _stack_ctx;
+
+	fcontext_t ctx      = make_fcontext(stack_ctx.sp, stack_ctx.size, TC_CoroutineInfo::corotineEntry);
 
 	transfer_t tf       = jump_fcontext(ctx, this);
 
@@ -254,6 +309,50 @@ void TC_CoroutineInfo::registerFunc(const std::function<void ()>& callback)
 	this->setCtx(tf.fctx);
 }
 
+size_t TC_CoroutineInfo::saveStack()
+{
+	assert(_sharedStack && _ctx);
+
+	//ctx是切出时保存寄存器的位置, 也就是栈上用到的最低地址
+	const char *top = (const char*)_sharedStack->stack.sp;
+	const char *bottom = (const char*)_ctx;
+
+	assert(bottom < top && (size_t)(top - bottom) <= _sharedStack->stack.size);
+
+	_stackBuffer.assign(bottom, top);
+
+	_stackPeak = std::max(_stackPeak, _stackBuffer.size());
+
+	return _stackBuffer.size();
+}
+
+void TC_CoroutineInfo::restoreStack()
+{
+	assert(_sharedStack && _ctx && !_stackBuffer.empty());
+
+	memcpy((char*)_sharedStack->stack.sp - _stackBuffer.size(), _stackBuffer.data(), _stackBuffer.size());
+}
+
+size_t TC_CoroutineInfo::releaseStack()
+{
+	size_t size = _stackBuffer.capacity();
+
+	std::vector<char>().swap(_stackBuffer);
+
+	return size;
+}
+
+size_t TC_CoroutineInfo::checkStackPeak(std::vector<unsigned char> *scratch)
+{
+	//共享栈的高水位在切出保存时已经记录
+	if(!_sharedStack && _stack_ctx.sp)
+	{
+		_stackPeak = stack_traits::used_size(_stack_ctx, scratch);
+	}
+
+	return _stackPeak;
+}
+
 void TC_CoroutineInfo::corotineEntry(transfer_t tf)
 {
     TC_CoroutineInfo * coro = static_cast< TC_CoroutineInfo * >(tf.data);
@@ -337,6 +436,8 @@ TC_CoroutineScheduler::TC_CoroutineScheduler()
 TC_CoroutineScheduler::~TC_CoroutineScheduler()
 {
     // LOG_CONSOLE_DEBUG << endl;
+    leaveGroup();
+
     if(_epoller)
 	{
 		delete _epoller;
@@ -365,11 +466,143 @@ void TC_CoroutineScheduler::setPoolStackSize(uint32_t iPoolSize, size_t iStackSi
 	_stackSize  = iStackSize;
 }
 
+void TC_CoroutineScheduler::setSharedStack(uint32_t iStackNum)
+{
+	assert(_all_coro == NULL);
+
+	_sharedStackNum = iStackNum;
+}
+
+TC_CoroutineScheduler::SharedStackStat TC_CoroutineScheduler::getSharedStackStat() const
+{
+	SharedStackStat stat;
+	stat.saveCount = _saveCount.load(std::memory_order_relaxed);
+	stat.saveBytes = _saveBytes.load(std::memory_order_relaxed);
+	stat.holdBytes = _holdBytes.load(std::memory_order_relaxed);
+	return stat;
+}
+
+void TC_CoroutineScheduler::setStackCheck(int64_t iInterval, bool bAutoSize)
+{
+	_stackCheckInterval = iInterval;
+	_stackAutoSize      = bAutoSize;
+}
+
+TC_CoroutineScheduler::StackStat TC_CoroutineScheduler::getStackStat() const
+{
+	StackStat stat;
+	stat.stackSize  = _allocStackSize.load(std::memory_order_relaxed);
+	stat.count      = _stackCount.load(std::memory_order_relaxed);
+	stat.maxUsed    = _stackMaxUsed.load(std::memory_order_relaxed);
+	stat.avgUsed    = _stackAvgUsed.load(std::memory_order_relaxed);
+	return stat;
+}
+
+void TC_CoroutineScheduler::checkStack()
+{
+	if(!_all_coro)
+	{
+		return;
+	}
+
+	size_t count    = 0;
+	size_t maxUsed  = 0;
+	size_t total    = 0;
+
+	for(size_t i = 1; i <= _poolSize; ++i)
+	{
+		if(_all_coro[i])
+		{
+			//没有运行过的协程不统计
+			size_t used = _all_coro[i]->checkStackPeak(&_stackScratch);
+			if(used > 0)
+			{
+				++count;
+				total += used;
+				maxUsed = std::max(maxUsed, used);
+			}
+		}
+	}
+
+	//当前占用共享栈的协程还没有保存过, 直接检查共享栈
+	for(auto &stack : _sharedStacks)
+	{
+		maxUsed = std::max(maxUsed, stack_traits::used_size(stack.stack, &_stackScratch));
+	}
+
+	_stackCount.store(count, std::memory_order_relaxed);
+	_stackMaxUsed.store(maxUsed, std::memory_order_relaxed);
+	_stackAvgUsed.store(count > 0 ? total / count : 0, std::memory_order_relaxed);
+
+	if(_stackAutoSize && _sharedStackNum == 0 && maxUsed > 0)
+	{
+		//预留一倍的余量, 按页对齐, 只影响之后新创建的协程
+		size_t page     = stack_traits::page_size();
+		size_t floor    = std::min(_stackSize, std::max((size_t)32 * 1024, stack_traits::minimum_size()));
+		size_t size     = (maxUsed * 2 + page - 1) / page * page;
+
+		_allocStackSize.store(std::min(_stackSize, std::max(floor, size)), std::memory_order_relaxed);
+	}
+}
+
+TC_CoroutineInfo *TC_CoroutineScheduler::newCoroutine(uint32_t iId)
+{
+	if(_sharedStackNum == 0)
+	{
+		return new TC_CoroutineInfo(this, iId, stack_traits::allocate(_allocStackSize.load(std::memory_order_relaxed)));
+	}
+
+	TC_CoroutineInfo *coro = new TC_CoroutineInfo(this, iId, stack_context());
+
+	coro->setSharedStack(&_sharedStacks[iId % _sharedStacks.size()]);
+
+	return coro;
+}
+
+void TC_CoroutineScheduler::acquireSharedStack(TC_CoroutineInfo *coro)
+{
+	shared_stack_context *stack = coro->getSharedStack();
+
+	if(stack->owner == coro)
+	{
+		//栈上就是自己的数据, 不需要拷贝
+		return;
+	}
+
+	if(stack->owner != NULL)
+	{
+		TC_CoroutineInfo *owner = stack->owner;
+
+		//保存的内存可以复用, 只有变大时才重新分配
+		size_t old = owner->getStackMemory();
+		size_t size = owner->saveStack();
+
+		_saveCount.fetch_add(1, std::memory_order_relaxed);
+		_saveBytes.fetch_add(size, std::memory_order_relaxed);
+		_holdBytes.fetch_add(owner->getStackMemory(), std::memory_order_relaxed);
+		_holdBytes.fetch_sub(old, std::memory_order_relaxed);
+	}
+
+	stack->owner = coro;
+
+	if(coro->getCtx() == NULL)
+	{
+		coro->makeContext();
+	}
+	else
+	{
+		coro->restoreStack();
+	}
+}
+
 void TC_CoroutineScheduler::init()
 {
 	_usedSize   = 0;
 	_uniqId     = 0;
 
+	_allocStackSize = _stackSize;
+	_nextStackCheck = TNOWMS + _stackCheckInterval;
+
     if(_poolSize <= 100)
     {
         _currentSize = _poolSize;
@@ -381,6 +614,14 @@ void TC_CoroutineScheduler::init()
 
 	createCoroutineInfo(_poolSize);
 
+	//共享栈在协程之前分配好, 协程保存的是它的地址
+	_sharedStacks.resize(_sharedStackNum);
+	for(auto &stack : _sharedStacks)
+	{
+		stack.stack = stack_traits::allocate(_stackSize);
+		stack.owner = NULL;
+	}
+
     TC_CoroutineInfo::CoroutineHeadInit(&_active);
     TC_CoroutineInfo::CoroutineHeadInit(&_avail);
     TC_CoroutineInfo::CoroutineHeadInit(&_inactive);
@@ -396,9 +637,7 @@ void TC_CoroutineScheduler::init()
 
         assert(iId != 0);
 
-        stack_context s_ctx = stack_traits::allocate(_stackSize);
-
-	    TC_CoroutineInfo *coro = new TC_CoroutineInfo(this, iId, s_ctx);
+	    TC_CoroutineInfo *coro = newCoroutine(iId);
 
         _all_coro[iId] = coro;
 
@@ -425,9 +664,8 @@ int TC_CoroutineScheduler::increaseCoroPoolSize()
     for(int i = 0; i < iInc; ++i)
     {
 	    uint32_t iId        = generateId();
-	    stack_context s_ctx = stack_traits::allocate(_stackSize);
 
-	    TC_CoroutineInfo *coro = new TC_CoroutineInfo(this, iId, s_ctx);
+	    TC_CoroutineInfo *coro = newCoroutine(iId);
 
         _all_coro[iId] = coro;
 
@@ -470,6 +708,106 @@ uint32_t TC_CoroutineScheduler::go(const std::function<void ()> &callback)
     return coro->getUid();
 }
 
+bool TC_CoroutineScheduler::goStealable(const std::function<void ()> &callback)
+{
+	if(_group && _group->push(_groupIndex, callback))
+	{
+		return true;
+	}
+
+	//没有加入组或者任务队列满了, 直接在当前调度器创建协程
+	return go(callback) != 0;
+}
+
+void TC_CoroutineScheduler::joinGroup(const std::shared_ptr<TC_CoroutineSchedulerGroup> &group, uint32_t index)
+{
+	leaveGroup();
+
+	assert(index < group->size());
+
+	_group      = group;
+	_groupIndex = index;
+
+	_group->join(_groupIndex, this);
+}
+
+void TC_CoroutineScheduler::leaveGroup()
+{
+	if(_group)
+	{
+		_group->leave(_groupIndex);
+		_group.reset();
+	}
+}
+
+uint32_t TC_CoroutineScheduler::getFreeSize()
+{
+	size_t used = _usedSize;
+	if(_group)
+	{
+		used += _group->taskSize(_groupIndex);
+	}
+
+	return used < _poolSize ? (uint32_t)(_poolSize - used) : 0;
+}
+
+bool TC_CoroutineScheduler::runTask(const std::function<void ()> &callback)
+{
+	uint32_t iCoroId = go(callback);
+	if(iCoroId == 0)
+	{
+		return false;
+	}
+
+	//go放在avail链表的尾部, 这里直接切换过去执行
+	switchCoro(_all_coro[iCoroId]);
+
+	return true;
+}
+
+void TC_CoroutineScheduler::runGroupTasks()
+{
+	int iLoop = 100;
+
+	//按放入的顺序执行, 每次最多100个, 协程用完了就留在队列里(可以被其他调度器窃取)
+	std::function<void ()> callback;
+	while(iLoop > 0 && _usedSize < _poolSize && !_epoller->isTerminate() && _group->pop(_groupIndex, callback))
+	{
+		if(!runTask(callback))
+		{
+			break;
+		}
+
+		--iLoop;
+	}
+}
+
+void TC_CoroutineScheduler::stealOrWait()
+{
+	if(_group->taskSize(_groupIndex) > 0)
+	{
+		return;
+	}
+
+	std::function<void ()> callback;
+	if(_usedSize < _poolSize && _group->steal(_groupIndex, callback))
+	{
+		//窃取的任务马上执行, 先处理掉已经就绪的网络事件和定时器
+		_epoller->done(0);
+
+		runTask(callback);
+		return;
+	}
+
+	//标记空闲后再检查一次, 避免和push之间丢失唤醒
+	if(_group->idle(_groupIndex))
+	{
+		_epoller->done(1000);
+	}
+
+	_group->busy(_groupIndex);
+}
+
 bool TC_CoroutineScheduler::full()
 {
 	if(_usedSize >= _currentSize || TC_CoroutineInfo::CoroutineHeadEmpty(&_free))
@@ -495,24 +833,53 @@ void TC_CoroutineScheduler::run()
 		init();
 	}
 
+	{
+		std::lock_guard<std::mutex> lock(_postMutex);
+		_postClosed = false;
+	}
+
 	_ready = true;
 
 	while(!_epoller->isTerminate())
 	{
-		if(_activeCoroQueue.empty() && TC_CoroutineInfo::CoroutineHeadEmpty(&_avail) && TC_CoroutineInfo::CoroutineHeadEmpty(&_active))
+		if(_activeCoroQueue.empty() && _postQueue.empty() && TC_CoroutineInfo::CoroutineHeadEmpty(&_avail) && TC_CoroutineInfo::CoroutineHeadEmpty(&_active))
 		{
-			_epoller->done(1000);
+			if(_group)
+			{
+				stealOrWait();
+			}
+			else
+			{
+				_epoller->done(1000);
+			}
 		}
 
 		//唤醒需要激活的协程
 		wakeup();
 
+		//执行其他线程投递的函数
+		runPosted();
+
 		//唤醒sleep的协程
 		wakeupbytimeout();
 
 		//唤醒yield的协程
 		wakeupbyself();
 
+		//执行自己任务队列里还没有被窃取的任务
+		if(_group)
+		{
+			runGroupTasks();
+		}
+
+		//定期检查协程栈的高水位
+		if(_stackCheckInterval > 0 && TNOWMS >= _nextStackCheck)
+		{
+			checkStack();
+
+			_nextStackCheck = TNOWMS + _stackCheckInterval;
+		}
+
 		int iLoop = 100;
 
 		//执行active协程, 每次执行100个, 避免占满cpu
@@ -544,6 +911,15 @@ void TC_CoroutineScheduler::run()
         }
 	}
 
+	//已经投递的函数都执行完(比如要恢复的co_await), 之后不再接受投递
+	{
+		std::lock_guard<std::mutex> lock(_postMutex);
+		_postClosed = true;
+	}
+	runPosted(true);
+
+	leaveGroup();
+
 	destroy();
 
 	_ready = false;
@@ -613,6 +989,47 @@ void TC_CoroutineScheduler::put(uint32_t iCoroId)
     }
 }
 
+bool TC_CoroutineScheduler::post(const std::function<void ()> &func)
+{
+    {
+        std::lock_guard<std::mutex> lock(_postMutex);
+        if(_postClosed)
+        {
+            return false;
+        }
+
+        _postQueue.push_back(func, false);
+    }
+
+    _epoller->notify();
+
+    return true;
+}
+
+void TC_CoroutineScheduler::runPosted(bool bForce)
+{
+    if(_postQueue.empty() || (!bForce && _epoller->isTerminate()))
+    {
+        return;
+    }
+
+    TC_ThreadQueue<std::function<void ()>>::queue_type funcs;
+
+    _postQueue.swap(funcs, 0, false);
+
+    for(auto &func : funcs)
+    {
+        try
+        {
+            func();
+        }
+        catch(std::exception &ex)
+        {
+            cerr << "TC_CoroutineScheduler::runPosted exception:" << ex.what() << endl;
+        }
+    }
+}
+
 void TC_CoroutineScheduler::wakeup()
 {
     if(!_activeCoroQueue.empty() && !_epoller->isTerminate())
@@ -683,6 +1100,12 @@ uint32_t TC_CoroutineScheduler::generateId()
 
 void TC_CoroutineScheduler::switchCoro(TC_CoroutineInfo *to)
 {
+    //共享栈上的协程只会从主协程切换过去, 这里在主协程的栈上
+    if(to->getSharedStack())
+    {
+        acquireSharedStack(to);
+    }
+
     //跳转到to协程
     _currentCoro = to;
 
@@ -752,6 +1175,17 @@ void TC_CoroutineScheduler::moveToFreeList(TC_CoroutineInfo *coro)
 {
     if(coro->getStatus() != TC_CoroutineInfo::CORO_FREE)
     {
+        shared_stack_context *stack = coro->getSharedStack();
+        if(stack)
+        {
+            //协程已经结束, 栈上的数据不需要再保存
+            if(stack->owner == coro)
+            {
+                stack->owner = NULL;
+            }
+            _holdBytes.fetch_sub(coro->releaseStack(), std::memory_order_relaxed);
+        }
+
         TC_CoroutineInfo::CoroutineDel(coro);
         coro->setStatus(TC_CoroutineInfo::CORO_FREE);
         TC_CoroutineInfo::CoroutineAddTail(coro, &_free);
@@ -773,7 +1207,10 @@ void TC_CoroutineScheduler::destroy()
         {
             if(_all_coro[i])
             {
-                stack_traits::deallocate(_all_coro[i]->getStackContext());
+                if(_all_coro[i]->getSharedStack() == NULL)
+                {
+                    stack_traits::deallocate(_all_coro[i]->getStackContext());
+                }
                 delete _all_coro[i];
                 _all_coro[i] = NULL;
             }
@@ -781,7 +1218,155 @@ void TC_CoroutineScheduler::destroy()
         delete [] _all_coro;
 		_all_coro = NULL;
     }
+
+    for(auto &stack : _sharedStacks)
+    {
+        stack_traits::deallocate(stack.stack);
+    }
+    _sharedStacks.clear();
+
+    _holdBytes = 0;
 }
+
+/////////////////////////////////////////////////////////
+TC_CoroutineSchedulerGroup::TC_CoroutineSchedulerGroup(uint32_t size, size_t capacity)
+{
+	assert(size > 0);
+
+	for(uint32_t i = 0; i < size; ++i)
+	{
+		_members.push_back(std::unique_ptr<Member>(new Member(capacity)));
+	}
+}
+
+TC_CoroutineSchedulerGroup::Stat TC_CoroutineSchedulerGroup::getStat() const
+{
+	Stat stat;
+	for(size_t i = 0; i < _members.size(); ++i)
+	{
+		stat.tasks  += _members[i]->taskCount.load(std::memory_order_relaxed);
+		stat.steals += _members[i]->stealCount.load(std::memory_order_relaxed);
+	}
+	return stat;
+}
+
+TC_CoroutineSchedulerGroup::Stat TC_CoroutineSchedulerGroup::getStat(uint32_t index) const
+{
+	assert(index < _members.size());
+
+	Stat stat;
+	stat.tasks  = _members[index]->taskCount.load(std::memory_order_relaxed);
+	stat.steals = _members[index]->stealCount.load(std::memory_order_relaxed);
+	return stat;
+}
+
+size_t TC_CoroutineSchedulerGroup::getTaskSize() const
+{
+	size_t size = 0;
+	for(size_t i = 0; i < _members.size(); ++i)
+	{
+		size += _members[i]->tasks.size();
+	}
+	return size;
+}
+
+size_t TC_CoroutineSchedulerGroup::taskSize(uint32_t index) const
+{
+	return _members[index]->tasks.size();
+}
+
+void TC_CoroutineSchedulerGroup::join(uint32_t index, TC_CoroutineScheduler *scheduler)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	assert(_members[index]->scheduler == NULL);
+
+	_members[index]->scheduler = scheduler;
+}
+
+void TC_CoroutineSchedulerGroup::leave(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Member *member = _members[index].get();
+
+	if(member->idle.exchange(false))
+	{
+		--_idleCount;
+	}
+
+	member->scheduler = NULL;
+}
+
+bool TC_CoroutineSchedulerGroup::push(uint32_t index, const std::function<void ()> &callback)
+{
+	Member *member = _members[index].get();
+
+	if(!member->tasks.push_back(callback, false))
+	{
+		return false;
+	}
+
+	member->taskCount.fetch_add(1, std::memory_order_relaxed);
+
+	//只有一个任务时自己马上就会执行, 有积压才唤醒空闲的调度器(push_back中的fence和idle中的fence配对)
+	if(_idleCount.load(std::memory_order_relaxed) > 0 && member->tasks.size() > 1)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		for(size_t i = 1; i < _members.size(); ++i)
+		{
+			Member *peer = _members[(index + i) % _members.size()].get();
+			if(peer->scheduler && peer->idle.load(std::memory_order_relaxed))
+			{
+				peer->scheduler->notify();
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool TC_CoroutineSchedulerGroup::pop(uint32_t index, std::function<void ()> &callback)
+{
+	return _members[index]->tasks.pop_front(callback, 0, false);
+}
+
+bool TC_CoroutineSchedulerGroup::steal(uint32_t index, std::function<void ()> &callback)
+{
+	//从下一个开始轮询, 避免所有空闲的调度器都去窃取同一个
+	for(size_t i = 1; i < _members.size(); ++i)
+	{
+		Member *peer = _members[(index + i) % _members.size()].get();
+		if(peer->tasks.pop_front(callback, 0, false))
+		{
+			_members[index]->stealCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TC_CoroutineSchedulerGroup::idle(uint32_t index)
+{
+	_members[index]->idle.store(true, std::memory_order_relaxed);
+	++_idleCount;
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	return getTaskSize() == 0;
+}
+
+void TC_CoroutineSchedulerGroup::busy(uint32_t index)
+{
+	if(_members[index]->idle.exchange(false))
+	{
+		--_idleCount;
+	}
+}
+
 /////////////////////////////////////////////////////////
 TC_Coroutine::TC_Coroutine()
 : _coroSched(NULL)
@@ -73,11 +73,78 @@ void TC_EpollServer::DataBuffer::notifyBuffer(uint32_t handleIndex)
 	getDataQueue(handleIndex)->notify();
 }
 
-void TC_EpollServer::DataBuffer::insertRecvQueue(const shared_ptr<RecvContext> &recv)
+void TC_EpollServer::DataBuffer::setQueueType(QUEUE_TYPE type, size_t capacity)
+{
+	_queueType = type;
+
+	if(_queueType == QUEUE_RING)
+	{
+		for(auto &dataQueue : _threadDataQueue)
+		{
+			dataQueue->enableRing(capacity);
+		}
+	}
+}
+
+void TC_EpollServer::DataBuffer::setWorkSteal(bool steal, size_t capacity)
+{
+	if(steal)
+	{
+		_stealGroup = std::make_shared<TC_CoroutineSchedulerGroup>(_schedulers.size(), capacity);
+	}
+	else
+	{
+		_stealGroup.reset();
+	}
+}
+
+bool TC_EpollServer::DataBuffer::insertRecvQueue(const shared_ptr<RecvContext> &recv)
 {
 	++_iRecvBufferSize;
 
-	getDataQueue(recv->fd())->push_back(recv);
+	const shared_ptr<DataQueue> &queue = getDataQueue(recv->fd());
+
+	if(!queue->push_back(recv))
+	{
+		//环形队列满, 唤醒handle消费后短暂等待(反压), 消费者就是当前线程(网络线程和处理线程合并)时等待没有意义
+		const shared_ptr<TC_CoroutineScheduler> &current = TC_CoroutineScheduler::scheduler();
+
+		bool selfConsume = false;
+		for(size_t i = 0; i < _schedulers.size(); i++)
+		{
+			if(current && _schedulers[i] == current && (!isQueueMode() || (int)i == index(recv->fd())))
+			{
+				selfConsume = true;
+				break;
+			}
+		}
+
+		int64_t deadline = TC_Common::now2ms() + RECV_RING_WAIT_MS;
+
+		bool inserted = false;
+		while(!selfConsume && TC_Common::now2ms() < deadline)
+		{
+			queue->notify();
+			for(auto &scheduler : _schedulers)
+			{
+				if(scheduler) scheduler->notify();
+			}
+
+			std::this_thread::yield();
+
+			if(queue->push_back(recv))
+			{
+				inserted = true;
+				break;
+			}
+		}
+
+		if(!inserted)
+		{
+			--_iRecvBufferSize;
+			return false;
+		}
+	}
 
 	if(_schedulers[0] != NULL)
 	{
@@ -91,6 +158,8 @@ void TC_EpollServer::DataBuffer::insertRecvQueue(const shared_ptr<RecvContext> &
 			_schedulers[index(rand())]->notify();
 		}
 	}
+
+	return true;
 }
 
 bool TC_EpollServer::DataBuffer::wait(uint32_t handleIndex)
@@ -184,6 +253,16 @@ void TC_EpollServer::Handle::terminate()
 	notifyFilter();
 }
 
+//当前线程正在运行的handle(NET_THREAD_QUEUE_HANDLES_CO)
+static thread_local TC_EpollServer::Handle *g_currentHandle = NULL;
+
+void TC_EpollServer::Handle::handleOnCurrent(const shared_ptr<RecvContext> &data)
+{
+	assert(g_currentHandle != NULL);
+
+	g_currentHandle->handle(data);
+}
+
 void TC_EpollServer::Handle::handleOnceCoroutine()
 {
 	const shared_ptr<TC_CoroutineScheduler> &scheduler = TC_CoroutineScheduler::scheduler();
@@ -233,8 +312,18 @@ void TC_EpollServer::Handle::handleOnceCoroutine()
 				}
 				else
 				{
-					uint32_t iRet = scheduler->go(std::bind(&Handle::handle, this, data));
-					if (iRet == 0)
+					bool bRet;
+					if (scheduler->getGroup())
+					{
+						//可能被空闲的handle线程窃取, 在执行的线程对应的handle中处理
+						bRet = scheduler->goStealable(std::bind(&Handle::handleOnCurrent, data));
+					}
+					else
+					{
+						bRet = scheduler->go(std::bind(&Handle::handle, this, data)) != 0;
+					}
+
+					if (!bRet)
 					{
 //						LOG_CONSOLE_DEBUG << "handleOverload" << endl;
 						handleOverload(data);
@@ -386,10 +475,20 @@ void TC_EpollServer::Handle::handleLoopCoroutine()
 	//因此当网络层收到数据, 写对队列后, 需要唤醒某一个handle的epoll, 从而唤醒某个协程
 	_scheduler = TC_CoroutineScheduler::create();
 	_scheduler->setPoolStackSize(this->_epollServer->getCoroutinePoolSize(), this->_epollServer->getCoroutineStackSize());
+	_scheduler->setSharedStack(this->_epollServer->getCoroutineSharedStack());
+	_scheduler->setStackCheck(this->_epollServer->getCoroutineStackCheck(), this->_epollServer->isCoroutineStackAuto());
 	_scheduler->getEpoller()->setName("epoller-handle");
 
 	_dataBuffer->registerScheduler(_handleIndex, _scheduler);
 
+	//队列模式下同一个连接的请求固定在一个handle中处理, 不窃取
+	if (_dataBuffer->getStealGroup() && !_dataBuffer->isQueueMode())
+	{
+		_scheduler->joinGroup(_dataBuffer->getStealGroup(), _handleIndex);
+	}
+
+	g_currentHandle = this;
+
 	initialize();
 
 	_scheduler->go(std::bind(&Handle::handleCoroutine, this));
@@ -535,6 +634,8 @@ void TC_EpollServer::Connection::initialize(TC_Epoller *epoller, unsigned int ui
 
 	_trans->setServerAuthCallback(_pBindAdapter->_onVerifyCallback);
 
+	_trans->setGatherWrite(_pBindAdapter->isGatherWrite());
+
 	_trans->getRecvBuffer().setConnection(this);
 
 }
@@ -667,11 +768,43 @@ std::shared_ptr<TC_OpenSSL> TC_EpollServer::Connection::onOpensslCallback(TC_Tra
 
 void TC_EpollServer::Connection::onRequestCallback(TC_Transceiver *trans)
 {
+	if(_trans->isGatherWrite())
+	{
+		//合并发送: 先把积攒的应答全部放入发送buffer, 再统一flush, 尽量一次writev发送完
+		while(!_messages.empty())
+		{
+			auto it = _messages.begin();
+
+			TC_Transceiver::ReturnStatus iRet = appendContext(*it);
+
+			if (iRet == TC_Transceiver::eRetError)
+			{
+				return;
+			}
+
+			if (iRet == TC_Transceiver::eRetNotSend)
+			{
+				break;
+			}
+
+			_messageSize -= (*it)->length();
+
+			_messages.erase(it);
+		}
+
+		size_t saved = _trans->getSendStat().saved;
+
+		_trans->flushRequest();
+
+		_pBindAdapter->addGatherSaved(_trans->getSendStat().saved - saved);
+		return;
+	}
+
 	while(!_messages.empty())
 	{
 		auto it = _messages.begin();
 
-		TC_Transceiver::ReturnStatus iRet = _trans->sendRequest((*it)->buffer(), (*it)->getRecvContext()->addr());
+		TC_Transceiver::ReturnStatus iRet = sendContext(*it);
 
 		if (iRet == TC_Transceiver::eRetError)
 		{
@@ -680,7 +813,7 @@ void TC_EpollServer::Connection::onRequestCallback(TC_Transceiver *trans)
 
 		if(iRet != TC_Transceiver::eRetNotSend)
 		{
-			_messageSize -= (*it)->buffer()->length();
+			_messageSize -= (*it)->length();
 
 			_messages.erase(it);
 		}
@@ -694,6 +827,41 @@ void TC_EpollServer::Connection::onRequestCallback(TC_Transceiver *trans)
 
 }
 
+TC_Transceiver::ReturnStatus TC_EpollServer::Connection::appendContext(const shared_ptr<SendContext> &sc)
+{
+	TC_Transceiver::ReturnStatus iRet = _trans->appendRequest(sc->buffer(), sc->getRecvContext()->addr());
+
+	const vector<shared_ptr<TC_NetWorkBuffer::Buffer>> &chain = sc->chain();
+	for(size_t i = 0; i < chain.size() && iRet == TC_Transceiver::eRetOk; i++)
+	{
+		iRet = _trans->appendRequest(chain[i], sc->getRecvContext()->addr());
+	}
+
+	return iRet;
+}
+
+TC_Transceiver::ReturnStatus TC_EpollServer::Connection::sendContext(const shared_ptr<SendContext> &sc)
+{
+	if(sc->chain().empty())
+	{
+		return _trans->sendRequest(sc->buffer(), sc->getRecvContext()->addr());
+	}
+
+	//分段的应答: 所有段一起进发送buffer再发送
+	if(!_trans->getSendBuffer().empty())
+	{
+		return TC_Transceiver::eRetNotSend;
+	}
+
+	TC_Transceiver::ReturnStatus iRet = appendContext(sc);
+	if(iRet != TC_Transceiver::eRetOk)
+	{
+		return iRet;
+	}
+
+	return _trans->flushRequest();
+}
+
 TC_NetWorkBuffer::PACKET_TYPE TC_EpollServer::Connection::onParserCallback(TC_NetWorkBuffer& rbuf, TC_Transceiver *trans)
 {
 	if(rbuf.empty())
@@ -720,6 +888,29 @@ TC_NetWorkBuffer::PACKET_TYPE TC_EpollServer::Connection::onParserCallback(TC_Ne
 	}
 
 
+	//tcp且注册了切片协议解析器, 完整包直接引用网络buffer, 避免copy
+	if (_pBindAdapter->getSliceProtocol() && isTcp())
+	{
+		TC_NetWorkBuffer::Slice slice;
+
+		TC_NetWorkBuffer::PACKET_TYPE ret = _pBindAdapter->getSliceProtocol()(rbuf, slice);
+
+		if (ret == TC_NetWorkBuffer::PACKET_FULL)
+		{
+			auto recv = std::make_shared<RecvContext>(_netThread->getIndex(), getId(), trans->getClientAddr(), getfd(), _pBindAdapter->shared_from_this());
+
+			recv->slice() = std::move(slice);
+
+			//收到完整的包才算
+			this->_bEmptyConn = false;
+
+			//收到完整包
+			insertRecvQueue(recv);
+		}
+
+		return ret;
+	}
+
 	vector<char> ro;
 
 	TC_NetWorkBuffer::PACKET_TYPE ret = _pBindAdapter->getProtocol()(rbuf, ro);
@@ -905,11 +1096,26 @@ int TC_EpollServer::Connection::send(const shared_ptr<SendContext> &sc)
 
 	//队列为空, 直接发送, 发送失败进队列
 	//队列不为空, 直接进队列
-	const shared_ptr<TC_NetWorkBuffer::Buffer>& buff = sc->buffer();
+	if(_trans->isGatherWrite())
+	{
+		//合并发送: 先进队列, 本轮发送队列处理完后由网络线程统一flush
+		size_t length = sc->length();
+		if(length > 0)
+		{
+			_messageSize += length;
+
+			_messages.push_back(sc);
+		}
 
-	if(_messages.empty())
+		if(!_flushPending)
+		{
+			_flushPending = true;
+			_netThread->addFlushConnection(getId());
+		}
+	}
+	else if(_messages.empty())
 	{
-		_trans->sendRequest(buff, sc->getRecvContext()->addr());
+		sendContext(sc);
 	}
 
 	//网络句柄无效了, 返回-1, 上层会关闭连接
@@ -919,9 +1125,9 @@ int TC_EpollServer::Connection::send(const shared_ptr<SendContext> &sc)
 	}
 
 	//数据没有发送完
-	if(!buff->empty())
+	if(!_trans->isGatherWrite() && sc->length() > 0)
 	{
-		_messageSize += sc->buffer()->length();
+		_messageSize += sc->length();
 
 		_messages.push_back(sc);
 	}
@@ -935,6 +1141,32 @@ int TC_EpollServer::Connection::send(const shared_ptr<SendContext> &sc)
 	return 0;
 }
 
+int TC_EpollServer::Connection::flushMessages()
+{
+	_flushPending = false;
+
+	//发送buffer里面还有数据, 说明socket已经写满, 等待EPOLLOUT事件再发送
+	if(!_trans->getSendBuffer().empty())
+	{
+		return 0;
+	}
+
+	onRequestCallback(_trans.get());
+
+	if(!_trans->isValid())
+	{
+		return -1;
+	}
+
+	//需要关闭链接
+	if (_bClose && _trans->getSendBuffer().empty() && _messages.empty())
+	{
+		return -2;
+	}
+
+	return 0;
+}
+
 void TC_EpollServer::Connection::setUdpRecvBuffer(size_t nSize)
 {
 	_trans->setUdpRecvBuffer(nSize);
@@ -944,7 +1176,8 @@ bool TC_EpollServer::Connection::setClose()
 {
 	_bClose = true;
 
-	return _trans->getSendBuffer().empty();
+	//合并发送模式下还有积攒的应答, 等flush完再关闭
+	return _trans->getSendBuffer().empty() && (!_trans->isGatherWrite() || _messages.empty());
 }
 
 ////////////////////////////////////////////////////////////////
@@ -1268,6 +1501,7 @@ TC_EpollServer::BindAdapter::BindAdapter(TC_EpollServer *epollServer)
 	: _pReportQueue(NULL)
 	, _pReportConRate(NULL)
 	, _pReportTimeoutNum(NULL)
+	, _pReportGatherSaved(NULL)
 	, _epollServer(epollServer)
 	, _pf(echo_protocol)
 	, _hf(echo_header_filter)
@@ -1454,13 +1688,21 @@ void TC_EpollServer::BindAdapter::insertRecvQueue(const shared_ptr<RecvContext>
 
 	if (iRet == 0 || force) //未过载
 	{
-		_dataBuffer->insertRecvQueue(recv);
+		if (!_dataBuffer->insertRecvQueue(recv))
+		{
+			++_ringDiscard;
+			_epollServer->error("[BindAdapter::insertRecvQueue] ring queue full, discard package, adapter:" + _name + ", total discard:" + TC_Common::tostr(_ringDiscard.load()));
+		}
 	}
 	else if (iRet == -1) //超过队列长度4/5，需要进行overload处理
 	{
 		recv->setOverload();
 
-		_dataBuffer->insertRecvQueue(recv);
+		if (!_dataBuffer->insertRecvQueue(recv))
+		{
+			++_ringDiscard;
+			_epollServer->error("[BindAdapter::insertRecvQueue] ring queue full, discard package, adapter:" + _name + ", total discard:" + TC_Common::tostr(_ringDiscard.load()));
+		}
 	}
 	else //接受队列满，需要丢弃
 	{
@@ -1468,6 +1710,22 @@ void TC_EpollServer::BindAdapter::insertRecvQueue(const shared_ptr<RecvContext>
 	}
 }
 
+void TC_EpollServer::BindAdapter::setQueueType(QUEUE_TYPE type)
+{
+	//环形队列容量固定, 预留超过过载阈值的空间
+	size_t capacity = (size_t)std::max(_iQueueCapacity, (int)DEFAULT_QUEUE_CAP) * 2;
+
+	_dataBuffer->setQueueType(type, capacity);
+}
+
+void TC_EpollServer::BindAdapter::setWorkSteal(bool steal)
+{
+	//handle取出请求的个数受协程池大小限制, 任务队列满时直接创建协程
+	size_t capacity = (size_t)std::max(_iQueueCapacity, (int)DEFAULT_QUEUE_CAP);
+
+	_dataBuffer->setWorkSteal(steal, capacity);
+}
+
 TC_NetWorkBuffer::PACKET_TYPE TC_EpollServer::BindAdapter::echo_protocol(TC_NetWorkBuffer &r, vector<char> &o)
 {
 	o = r.getBuffers();
@@ -1514,6 +1772,9 @@ void TC_EpollServer::BindAdapter::setProtocol(const TC_NetWorkBuffer::protocol_f
 {
 	_pf = pf;
 
+	//协议变了, 切片协议解析器不再适用
+	_spf = nullptr;
+
 	_hf = hf;
 
 	_iHeaderLen = iHeaderLen;
@@ -1527,6 +1788,11 @@ TC_EpollServer::NetThread::NetThread(int threadIndex, TC_EpollServer *epollServe
 	, _nUdpRecvBufferSize(DEFAULT_RECV_BUFFERSIZE)
 {
 	_list = std::make_shared<ConnectionList>(_epollServer);
+
+	if(_epollServer->getQueueType() == QUEUE_RING)
+	{
+		_sring.reset(new send_ring_queue(SEND_RING_QUEUE_CAP));
+	}
 }
 
 TC_EpollServer::NetThread::~NetThread()
@@ -1612,7 +1878,7 @@ void TC_EpollServer::NetThread::close(const shared_ptr<TC_EpollServer::RecvConte
 
 	shared_ptr<SendContext> send = data->createCloseContext();
 
-	_sbuffer.push_back(send);
+	pushSendQueue(send);
 
 //	通知epoll响应, 关闭连接
 	notify();
@@ -1644,22 +1910,72 @@ void TC_EpollServer::NetThread::send(const shared_ptr<TC_EpollServer::SendContex
 	else
 	{
 		//发送包线程和网络线程不是同一个线程, 需要先放队列, 再唤醒网络线程去发送
+		pushSendQueue(data);
+
+		notify();
+	}
+}
+
+void TC_EpollServer::NetThread::pushSendQueue(const shared_ptr<SendContext> & data)
+{
+	if (!_sring)
+	{
 		_sbuffer.push_back(data);
+		return;
+	}
+
+	//环形队列满了, 等待网络线程消费: 先让出cpu, 仍然满则睡眠等待, 最多等待SEND_RING_WAIT_MS后丢弃
+	int64_t deadline = 0;
+	size_t spin = 0;
+	while (!_sring->push_back(data, false))
+	{
+		if (_threadId == TC_Thread::CURRENT_THREADID())
+		{
+			processPipe();
+			continue;
+		}
 
 		notify();
+
+		if (++spin <= 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		if (deadline == 0)
+		{
+			deadline = TC_Common::now2ms() + SEND_RING_WAIT_MS;
+		}
+		else if (TC_Common::now2ms() >= deadline)
+		{
+			++_sendRingDiscard;
+			_epollServer->error("[NetThread::pushSendQueue] send ring queue full, discard response, uid:" + TC_Common::tostr(data->uid()) + ", total discard:" + TC_Common::tostr(_sendRingDiscard.load()));
+			return;
+		}
+
+		TC_Common::msleep(1);
+	}
+}
+
+bool TC_EpollServer::NetThread::popSendQueue(shared_ptr<SendContext> & data)
+{
+	if (_sring)
+	{
+		return _sring->pop_front(data, 0, false);
 	}
+
+	return _sbuffer.pop_front(data, 0, false);
 }
 
 void TC_EpollServer::NetThread::processPipe()
 {
 	// LOG_CONSOLE("processPipe");
 
-	while (!_sbuffer.empty())
-	{
-		shared_ptr<SendContext> sc = _sbuffer.front();
-
-		_sbuffer.pop_front();
+	shared_ptr<SendContext> sc;
 
+	while (popSendQueue(sc))
+	{
 		Connection *cPtr = getConnectionPtr(sc->uid());
 
 		if (!cPtr)
@@ -1690,6 +2006,25 @@ void TC_EpollServer::NetThread::processPipe()
 				assert(false);
 		}
 	}
+
+	if(!_flushUids.empty())
+	{
+		for(size_t i = 0; i < _flushUids.size(); i++)
+		{
+			Connection *cPtr = getConnectionPtr(_flushUids[i]);
+
+			if (cPtr)
+			{
+				int ret = cPtr->flushMessages();
+				if (ret < 0)
+				{
+					delConnection(cPtr, true, (ret == -1) ? EM_CLIENT_CLOSE : EM_SERVER_CLOSE);
+				}
+			}
+		}
+
+		_flushUids.clear();
+	}
 }
 
 void TC_EpollServer::NetThread::setInitializeHandle(std::function<void()> initialize, std::function<void()> handle)
@@ -1714,10 +2049,13 @@ void TC_EpollServer::NetThread::run()
 			_scheduler = TC_CoroutineScheduler::create();
 
 			_scheduler->setPoolStackSize(_epollServer->getCoroutinePoolSize(), _epollServer->getCoroutineStackSize());
+			_scheduler->setSharedStack(_epollServer->getCoroutineSharedStack());
+			_scheduler->setStackCheck(_epollServer->getCoroutineStackCheck(), _epollServer->isCoroutineStackAuto());
 		}
 
 		_epoller = _scheduler->getEpoller();
 		_epoller->setName("net-thread");
+		_epoller->setTimerType(_epollServer->getTimerType());
 
 		assert(_epoller);
 
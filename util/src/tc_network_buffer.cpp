@@ -222,7 +222,8 @@ shared_ptr<TC_NetWorkBuffer::Buffer> TC_NetWorkBuffer::getOrCreateBuffer(size_t
 
 	if(_bufferList.empty())
 	{
-		if(!_defaultBuff)
+		//还被切片引用着, 不能复用
+		if(!_defaultBuff || _defaultBuff->isSliced())
 		{
 			_defaultBuff = std::make_shared<Buffer>();
 			_defaultBuff->alloc(maxCapacity);
@@ -242,8 +243,8 @@ shared_ptr<TC_NetWorkBuffer::Buffer> TC_NetWorkBuffer::getOrCreateBuffer(size_t
 		auto buff = _bufferList.back();
 		if(buff->left() < minCapacity)
 		{
-			//剩余空间太小了, 检查看看是否容量够, 如果够, compact一下
-			if(buff->capacity() - buff->length() >= minCapacity && buff->length() * 3 < buff->capacity())
+			//剩余空间太小了, 检查看看是否容量够, 如果够, compact一下(被切片引用着不能compact)
+			if(!buff->isSliced() && buff->capacity() - buff->length() >= minCapacity && buff->length() * 3 < buff->capacity())
 			{
 				buff->compact();
 			}
@@ -351,6 +352,27 @@ pair<const char*, size_t> TC_NetWorkBuffer::getBufferPointer() const
 	return make_pair((*it)->buffer(), (*it)->length());
 }
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+size_t TC_NetWorkBuffer::getBufferPointers(struct iovec *vecs, size_t maxCount) const
+{
+	size_t count = 0;
+
+	for(auto it = _bufferList.begin(); it != _bufferList.end() && count < maxCount; ++it)
+	{
+		if((*it)->empty())
+		{
+			continue;
+		}
+
+		vecs[count].iov_base = (void*)(*it)->buffer();
+		vecs[count].iov_len  = (*it)->length();
+		++count;
+	}
+
+	return count;
+}
+#endif
+
 const char * TC_NetWorkBuffer::mergeBuffers()
 {
 	//merge to one buffer
@@ -469,6 +491,57 @@ bool TC_NetWorkBuffer::getHeader(size_t len, std::vector<char> &buffer) const
 	return true;
 }
 
+bool TC_NetWorkBuffer::getHeader(size_t len, Slice &slice) const
+{
+	if(getBufferLength() < len)
+		return false;
+
+	slice.clear();
+
+	if(len == 0)
+	{
+		return true;
+	}
+
+	for(auto it = _bufferList.begin(); it != _bufferList.end(); ++it)
+	{
+		if((*it)->empty())
+		{
+			continue;
+		}
+
+		//在同一个buffer中, 直接引用
+		if((*it)->length() >= len)
+		{
+			if(!(*it)->_slicePin)
+			{
+				(*it)->_slicePin = std::make_shared<char>(0);
+			}
+
+			slice.owner  = *it;
+			slice.pin    = (*it)->_slicePin;
+			slice.data   = (*it)->buffer();
+			slice.length = len;
+			return true;
+		}
+
+		break;
+	}
+
+	//跨越了多个buffer, copy到新的buffer中
+	slice.owner = std::make_shared<Buffer>();
+	slice.owner->alloc(len);
+
+	getBuffers(slice.owner->buffer(), len);
+
+	slice.owner->addWriteIdx(len);
+
+	slice.data   = slice.owner->buffer();
+	slice.length = len;
+
+	return true;
+}
+
 bool TC_NetWorkBuffer::moveHeader(size_t len)
 {
 	if(getBufferLength() < len)
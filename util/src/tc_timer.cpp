@@ -16,12 +16,358 @@
 
 #include "util/tc_timer.h"
 #include "util/tc_logger.h"
+#include <cstring>
 
 namespace tars
 {
 
 using namespace std;
 
+//最低位1的位置, v不能为0
+static inline int lowestBit(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(v);
+#else
+	int n = 0;
+	while ((v & 1) == 0)
+	{
+		v >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+TC_TimerBase::TimeWheel::TimeWheel()
+{
+	memset(_slots, 0, sizeof(_slots));
+	memset(_bitmap, 0, sizeof(_bitmap));
+}
+
+void TC_TimerBase::TimeWheel::link(int32_t slot, Func *func)
+{
+	func->_slot = slot;
+	func->_prev = NULL;
+	func->_next = _slots[slot];
+	if (func->_next)
+	{
+		func->_next->_prev = func;
+	}
+	_slots[slot] = func;
+
+	if (slot != PENDING)
+	{
+		_bitmap[slot >> 6] |= (1ULL << (slot & 63));
+	}
+}
+
+void TC_TimerBase::TimeWheel::unlink(Func *func)
+{
+	int32_t slot = func->_slot;
+
+	if (func->_prev)
+	{
+		func->_prev->_next = func->_next;
+	}
+	else
+	{
+		_slots[slot] = func->_next;
+	}
+
+	if (func->_next)
+	{
+		func->_next->_prev = func->_prev;
+	}
+
+	if (_slots[slot] == NULL && slot != PENDING)
+	{
+		_bitmap[slot >> 6] &= ~(1ULL << (slot & 63));
+	}
+
+	func->_prev = NULL;
+	func->_next = NULL;
+	func->_slot = -1;
+}
+
+void TC_TimerBase::TimeWheel::add(Func *func, uint64_t now)
+{
+	remove(func);
+
+	if (_size == 0)
+	{
+		_current = now;
+	}
+
+	++_size;
+
+	uint64_t expires = func->_fireMillseconds;
+
+	if (expires < _current)
+	{
+		link(PENDING, func);
+		return;
+	}
+
+	uint64_t delta = expires - _current;
+
+	if (delta < ROOT_SIZE)
+	{
+		link(expires & (ROOT_SIZE - 1), func);
+		return;
+	}
+
+	//超出时间轮范围的, 先放在最高层, 下放到第0层时再重新计算
+	const uint64_t maxDelta = (1ULL << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+	if (delta > maxDelta)
+	{
+		delta = maxDelta;
+		expires = _current + maxDelta;
+	}
+
+	int level = 1;
+	while (delta >= (1ULL << (ROOT_BITS + level * LEVEL_BITS)))
+	{
+		++level;
+	}
+
+	int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+
+	link(ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((expires >> shift) & (LEVEL_SIZE - 1)), func);
+}
+
+void TC_TimerBase::TimeWheel::remove(Func *func)
+{
+	if (func->_slot >= 0)
+	{
+		unlink(func);
+		--_size;
+	}
+}
+
+int TC_TimerBase::TimeWheel::cascade(int level, uint64_t tick)
+{
+	int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+	int index = (tick >> shift) & (LEVEL_SIZE - 1);
+	int32_t slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + index;
+
+	Func *func = _slots[slot];
+
+	_slots[slot] = NULL;
+	_bitmap[slot >> 6] &= ~(1ULL << (slot & 63));
+
+	while (func)
+	{
+		Func *next = func->_next;
+
+		func->_prev = NULL;
+		func->_next = NULL;
+		func->_slot = -1;
+		--_size;
+
+		add(func, tick);
+
+		func = next;
+	}
+
+	return index;
+}
+
+int TC_TimerBase::TimeWheel::findRoot(int from) const
+{
+	if (from >= ROOT_SIZE)
+	{
+		return -1;
+	}
+
+	int word = from >> 6;
+	uint64_t bits = _bitmap[word] & (~0ULL << (from & 63));
+
+	while (bits == 0)
+	{
+		if (++word >= ROOT_SIZE / 64)
+		{
+			return -1;
+		}
+		bits = _bitmap[word];
+	}
+
+	return (word << 6) + lowestBit(bits);
+}
+
+int64_t TC_TimerBase::TimeWheel::next() const
+{
+	if (_size == 0)
+	{
+		return -1;
+	}
+
+	if (_slots[PENDING])
+	{
+		//已经过期, 马上处理
+		return _current - 1;
+	}
+
+	int index = _current & (ROOT_SIZE - 1);
+	uint64_t base = _current - index;
+
+	//第0层的事件一定比上层的早, 先找本圈剩下的, 再找下一圈的
+	int n = findRoot(index);
+	if (n >= 0)
+	{
+		return base + n;
+	}
+
+	n = findRoot(0);
+	if (n >= 0)
+	{
+		return base + ROOT_SIZE + n;
+	}
+
+	//上层槽位只能给出下放的时间, 事件一定不早于这个时间
+	int64_t nextTick = -1;
+	for (int level = 1; level < LEVELS; ++level)
+	{
+		int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+		uint64_t bits = _bitmap[(ROOT_SIZE >> 6) + level - 1];
+		if (bits == 0)
+		{
+			continue;
+		}
+
+		uint64_t round = (_current + (1ULL << shift) - 1) >> shift;
+		int start = round & (LEVEL_SIZE - 1);
+		uint64_t rotated = start == 0 ? bits : ((bits >> start) | (bits << (LEVEL_SIZE - start)));
+
+		int64_t tick = (round + lowestBit(rotated)) << shift;
+		if (nextTick < 0 || tick < nextTick)
+		{
+			nextTick = tick;
+		}
+	}
+
+	return nextTick < 0 ? (int64_t)_current : nextTick;
+}
+
+int64_t TC_TimerBase::TimeWheel::expire(uint64_t now, EVENT_SET &el)
+{
+	Func *func = _slots[PENDING];
+	_slots[PENDING] = NULL;
+
+	while (func)
+	{
+		Func *next = func->_next;
+
+		func->_prev = NULL;
+		func->_next = NULL;
+		func->_slot = -1;
+		--_size;
+
+		el.insert(func->_uniqueId);
+
+		func = next;
+	}
+
+	while (_size > 0 && _current <= now)
+	{
+		uint64_t tick = _current;
+		int index = tick & (ROOT_SIZE - 1);
+
+		if (index == 0)
+		{
+			//跨过一圈, 上层对应槽位下放, 上层也转完一圈时继续下放更上一层
+			for (int level = 1; level < LEVELS && cascade(level, tick) == 0; ++level)
+			{
+			}
+		}
+
+		func = _slots[index];
+		if (func)
+		{
+			_slots[index] = NULL;
+			_bitmap[index >> 6] &= ~(1ULL << (index & 63));
+		}
+
+		while (func)
+		{
+			Func *next = func->_next;
+
+			func->_prev = NULL;
+			func->_next = NULL;
+			func->_slot = -1;
+			--_size;
+
+			if (func->_fireMillseconds <= tick)
+			{
+				el.insert(func->_uniqueId);
+			}
+			else
+			{
+				//超出范围被截断的事件, 重新放入
+				add(func, tick);
+			}
+
+			func = next;
+		}
+
+		//跳过空槽位: 本圈还有事件跳到该槽位, 只有下一圈的事件跳到圈的边界, 第0层空了直接跳到上层下放的时间
+		int n = findRoot(index + 1);
+		if (n >= 0)
+		{
+			_current = tick - index + n;
+		}
+		else if (findRoot(0) >= 0)
+		{
+			_current = tick - index + ROOT_SIZE;
+		}
+		else
+		{
+			_current = tick + 1;
+
+			int64_t nextTick = next();
+			if (nextTick > (int64_t)_current)
+			{
+				_current = nextTick;
+			}
+		}
+
+		if (_current > now + 1)
+		{
+			_current = now + 1;
+		}
+	}
+
+	if (_current <= now)
+	{
+		_current = now + 1;
+	}
+
+	return next();
+}
+
+void TC_TimerBase::TimeWheel::clear()
+{
+	for (int slot = 0; slot <= SLOTS; ++slot)
+	{
+		Func *func = _slots[slot];
+		while (func)
+		{
+			Func *next = func->_next;
+
+			func->_prev = NULL;
+			func->_next = NULL;
+			func->_slot = -1;
+
+			func = next;
+		}
+		_slots[slot] = NULL;
+	}
+
+	memset(_bitmap, 0, sizeof(_bitmap));
+	_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
 TC_TimerBase::~TC_TimerBase()
 {
 }
@@ -30,6 +376,7 @@ void TC_TimerBase::clear()
 {
 	std::lock_guard<std::mutex> lock(_mutex);
 
+	_wheel.clear();
 	_mapEvent.clear();
 	_mapTimer.clear();
 	_repeatIds.clear();
@@ -47,6 +394,47 @@ uint32_t TC_TimerBase::genUniqueId()
 	return i;
 }
 
+void TC_TimerBase::setTimerType(TIMER_TYPE type)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (type == _timerType)
+	{
+		return;
+	}
+
+	//把已经存在的事件迁移过去
+	if (type == TIMER_WHEEL)
+	{
+		uint64_t now = TNOWMS;
+		for (auto &it : _mapTimer)
+		{
+			for (auto uniqId : it.second)
+			{
+				auto itEvent = _mapEvent.find(uniqId);
+				if (itEvent != _mapEvent.end())
+				{
+					_wheel.add(itEvent->second.get(), now);
+				}
+			}
+		}
+		_mapTimer.clear();
+	}
+	else
+	{
+		for (auto &it : _mapEvent)
+		{
+			if (it.second->_slot >= 0)
+			{
+				_mapTimer[it.second->_fireMillseconds].insert(it.first);
+			}
+		}
+		_wheel.clear();
+	}
+
+	_timerType = type;
+}
+
 
 bool TC_TimerBase::exist(int64_t uniqId,bool repeat )
 {
@@ -69,13 +457,20 @@ void TC_TimerBase::erase(int64_t uniqId)
 	//LOG_CONSOLE_DEBUG << "before erase event!" << ",uniqId=" << uniqId << "|event size :" << _mapEvent.size() << "|timer size:" << _mapTimer.size() << endl;
 	if (it != _mapEvent.end())
 	{
-		auto itEvent = _mapTimer.find(it->second->_fireMillseconds);
-		if (itEvent != _mapTimer.end())
+		if (_timerType == TIMER_WHEEL)
 		{
-			itEvent->second.erase(uniqId);
-			if (itEvent->second.empty())
+			_wheel.remove(it->second.get());
+		}
+		else
+		{
+			auto itEvent = _mapTimer.find(it->second->_fireMillseconds);
+			if (itEvent != _mapTimer.end())
 			{
-				_mapTimer.erase(itEvent);
+				itEvent->second.erase(uniqId);
+				if (itEvent->second.empty())
+				{
+					_mapTimer.erase(itEvent);
+				}
 			}
 		}
 		it->second->_func = nullptr;
@@ -97,7 +492,14 @@ int64_t TC_TimerBase::post(const shared_ptr<TC_TimerBase::Func> & event, bool re
 		_mapEvent[uniqId] = event;
 	}
 
-	_mapTimer[event->_fireMillseconds].insert(uniqId);
+	if (_timerType == TIMER_WHEEL)
+	{
+		_wheel.add(event.get(), TNOWMS);
+	}
+	else
+	{
+		_mapTimer[event->_fireMillseconds].insert(uniqId);
+	}
 
 	// LOG_CONSOLE_DEBUG << "fireMillseconds:" << event->_fireMillseconds << ", " << TNOWMS << ", " << event->_fireMillseconds - TNOWMS << endl;
 
@@ -177,6 +579,13 @@ int64_t TC_TimerBase::getEvents(TC_TimerBase::EVENT_SET &el)
 {
 	std::unique_lock <std::mutex> lock(_mutex);
 
+	if (_timerType == TIMER_WHEEL)
+	{
+		_nextTimer = _wheel.expire(TNOWMS, el);
+
+		return _nextTimer;
+	}
+
 	_nextTimer = -1;
 
 	for (auto it = _mapTimer.begin(); it != _mapTimer.end();)
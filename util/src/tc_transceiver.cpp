@@ -616,10 +616,7 @@ void TC_Transceiver::doRequest()
 	//buf不为空,先发送buffer的内容
     while(!_sendBuffer.empty())
     {
-    	auto data = _sendBuffer.getBufferPointer();
-    	assert(data.first != NULL && data.second != 0);
-
-        int iRet = this->send(data.first, (uint32_t) data.second, 0);
+        int iRet = sendOnce();
 
         if (iRet <= 0)
         {
@@ -651,6 +648,19 @@ TC_Transceiver::ReturnStatus TC_Transceiver::sendRequest(const shared_ptr<TC_Net
 		return eRetNotSend;
 	}
 
+	ReturnStatus ret = appendRequest(buff, addr);
+	if(ret != eRetOk)
+	{
+		return ret;
+	}
+
+//	LOG_CONSOLE_DEBUG << _sendBuffer.getBufferLength() << endl;
+
+	return flushRequest();
+}
+
+TC_Transceiver::ReturnStatus TC_Transceiver::checkSend()
+{
 	if(eConnected != _connStatus)
 	{
 		return eRetNotSend;
@@ -662,23 +672,36 @@ TC_Transceiver::ReturnStatus TC_Transceiver::sendRequest(const shared_ptr<TC_Net
 
     if (_ep.isTcp() && _ep.getAuthType() == TC_Endpoint::AUTH_TYPELOCAL && _authState != eAuthSucc)
 	{
+		return eRetNotSend; // 需要鉴权但还没通过，不能发送非认证消息
+	}
+
 #if TARS_SSL
-		if (isSSL() && !_openssl)
-        {
-            return eRetNotSend;
-        }
+	if (isSSL() && (!_openssl || !_openssl->isHandshaked()))
+	{
+		return eRetNotSend;
+	}
 #endif
-		return eRetNotSend; // 需要鉴权但还没通过，不能发送非认证消息
+
+	return eRetOk;
+}
+
+TC_Transceiver::ReturnStatus TC_Transceiver::appendRequest(const shared_ptr<TC_NetWorkBuffer::Buffer> &buff, const TC_Socket::addr_type& addr)
+{
+	//空数据 直接返回成功
+	if(buff->empty()) {
+		return eRetOk;
+	}
+
+	ReturnStatus ret = checkSend();
+	if(ret != eRetOk)
+	{
+		return ret;
 	}
 
 #if TARS_SSL
 	// 握手数据已加密,直接发送，会话数据需加密
 	if (isSSL())
 	{
-		if(!_openssl->isHandshaked()) {
-			return eRetNotSend;
-		}
-
 		int ret = _openssl->write(buff->buffer(), (uint32_t) buff->length(), _sendBuffer);
 		if(ret != 0)
 		{
@@ -696,14 +719,16 @@ TC_Transceiver::ReturnStatus TC_Transceiver::sendRequest(const shared_ptr<TC_Net
 	_sendBuffer.addBuffer(buff);
 #endif
 
-//	LOG_CONSOLE_DEBUG << _sendBuffer.getBufferLength() << endl;
-
 	_lastAddr = addr;
-	do
-	{
-		auto data = _sendBuffer.getBufferPointer();
 
-		int iRet = this->send(data.first, (uint32_t) data.second, 0);
+	return eRetOk;
+}
+
+TC_Transceiver::ReturnStatus TC_Transceiver::flushRequest()
+{
+	while(!_sendBuffer.empty())
+	{
+		int iRet = sendOnce();
 		if(iRet < 0)
 		{
 			if(!isValid())
@@ -720,11 +745,39 @@ TC_Transceiver::ReturnStatus TC_Transceiver::sendRequest(const shared_ptr<TC_Net
 		_sendBuffer.moveHeader(iRet);
 //		assert(iRet != 0);
 	}
-	while(!_sendBuffer.empty());
 
 	return eRetOk;
 }
 
+int TC_Transceiver::sendOnce()
+{
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+	if(_gatherWrite && _sendBuffer.listSize() > 1)
+	{
+		struct iovec vecs[MAX_GATHER_IOV];
+
+		size_t count = _sendBuffer.getBufferPointers(vecs, MAX_GATHER_IOV);
+		assert(count > 0);
+
+		int iRet = this->sendv(vecs, (int)count);
+
+		++_sendStat.syscalls;
+		_sendStat.buffers += count;
+		_sendStat.saved   += count - 1;
+
+		return iRet;
+	}
+#endif
+
+	auto data = _sendBuffer.getBufferPointer();
+	assert(data.first != NULL && data.second != 0);
+
+	++_sendStat.syscalls;
+	++_sendStat.buffers;
+
+	return this->send(data.first, (uint32_t) data.second, 0);
+}
+
 
 void TC_Transceiver::doAuthCheck(TC_NetWorkBuffer *buff)
 {
@@ -887,8 +940,9 @@ void TC_TCPTransceiver::doResponse()
     int packetCount = 0;
 	do
     {
-        size_t expansion = std::max(std::min(_recvBuffer.getBufferLength(), (size_t)MAX_BUFFER_SIZE), (size_t)BUFFER_SIZE);
-       	auto data = _recvBuffer.getOrCreateBuffer(BUFFER_SIZE/8, expansion);
+        //尾部空闲空间至少能放下预期大小的1/4, 否则compact或者按预期大小新建buffer, 避免大包被切成很多小块再合并
+        size_t expansion = std::max(std::min(_recvBuffer.getBufferLength(), (size_t)MAX_BUFFER_SIZE), _recvHint);
+       	auto data = _recvBuffer.getOrCreateBuffer(std::max((size_t)BUFFER_SIZE/8, _recvHint/4), expansion);
 
        	uint32_t left = (uint32_t)data->left();
 
@@ -903,6 +957,8 @@ void TC_TCPTransceiver::doResponse()
 
             data->addWriteIdx(iRet);
 
+            updateRecvHint(iRet, left);
+
             _recvBuffer.addLength(iRet);
 
             //解析协议
@@ -928,6 +984,20 @@ void TC_TCPTransceiver::doResponse()
 
 #endif
 
+void TC_TCPTransceiver::updateRecvHint(size_t readLen, size_t left)
+{
+	if(readLen >= left && left * 2 >= _recvHint)
+	{
+		//读满了, 后面很可能还有数据, 放大
+		_recvHint = std::min(_recvHint * 2, (size_t)MAX_RECV_HINT);
+	}
+	else
+	{
+		_recvHint = (_recvHint * 7 + readLen * 2) / 8;
+		_recvHint = std::min(std::max(_recvHint, (size_t)MIN_RECV_HINT), (size_t)MAX_RECV_HINT);
+	}
+}
+
 int TC_TCPTransceiver::send(const void* buf, uint32_t len, uint32_t flag)
 {
     //只有是连接状态才能收发数据
@@ -954,6 +1024,26 @@ int TC_TCPTransceiver::send(const void* buf, uint32_t len, uint32_t flag)
     return iRet;
 }
 
+#if TARGET_PLATFORM_LINUX || TARGET_PLATFORM_IOS
+int TC_TCPTransceiver::sendv(const struct iovec *vecs, int vcnt)
+{
+    //只有是连接状态才能收发数据
+    if(eConnected != _connStatus)
+    {
+        return -1;
+    }
+
+	int iRet = ::writev(_fd, vecs, vcnt);
+
+	if (iRet < 0 && !TC_Socket::isPending())
+    {
+        THROW_ERROR(TC_Transceiver_Exception, CR_SEND, "TC_TCPTransceiver::sendv, " + _desc + ", fd:" + TC_Common::tostr(_fd));
+    }
+
+    return iRet;
+}
+#endif
+
 int TC_TCPTransceiver::recv(void* buf, uint32_t len, uint32_t flag)
 {
     //只有是连接状态才能收发数据